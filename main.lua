@@ -72,6 +72,10 @@ newoption {
 	trigger = "easyprofiler",
 	description = "Enables EasyProfiler.",
 }
+newoption {
+	trigger = "tracing",
+	description = "Enables built-in tracer with Chrome trace export.",
+}
 newoption { 
 	trigger = "gamebuild",
 	description = "Target build version of the game",
@@ -237,3 +241,8 @@ project "rageAm"
 		defines { "AM_EASYPROFILER" }
 		defines { "BUILD_WITH_EASY_PROFILER" }
 	filter {}
+
+	-- Built-in tracer (am/system/trace.h)
+	filter { "options:tracing" }
+		defines { "AM_TRACING" }
+	filter {}
@@ -0,0 +1,183 @@
+#include "compilecache.h"
+
+#include "am/file/fileutils.h"
+#include "am/system/datamgr.h"
+#include "am/system/trace.h"
+#include "am/xml/doc.h"
+#include "am/xml/exception.h"
+#include "common/logger.h"
+
+#include <mutex>
+
+namespace
+{
+	struct FileContentHash
+	{
+		rageam::file::WPath Path; // Normalized, path hash is only used as bucket
+		u64 ModifyTime;
+		u64 Size;
+		u64 Hash;
+	};
+
+	// Workspace rebuild hashes the same textures for every asset, only modified files are read again
+	std::mutex							s_FileHashesMutex;
+	rageam::HashSet<FileContentHash>	s_FileHashes;
+
+	constexpr u32 FILE_HASH_CHUNK_SIZE = 1024u * 1024u; // 1MB
+}
+
+void rageam::asset::AssetHashBuilder::Add(pConstVoid data, size_t size)
+{
+	m_Hasher.Add(data, size);
+}
+
+void rageam::asset::AssetHashBuilder::AddString(ConstString str)
+{
+	if (!str) str = "";
+	Add(str, strlen(str) + 1);
+}
+
+void rageam::asset::AssetHashBuilder::AddString(ConstWString str)
+{
+	if (!str) str = L"";
+	Add(str, (wcslen(str) + 1) * sizeof(wchar_t));
+}
+
+bool rageam::asset::AssetHashBuilder::AddFile(ConstWString path)
+{
+	AM_TRACE_FUNCTION();
+
+	u64 modifyTime = file::GetFileModifyTime(path);
+	u64 size = file::GetFileSize64(path);
+	file::WPath normalizedPath = file::WPath(path).Normalized();
+	u32 pathHash = Hash(normalizedPath);
+
+	{
+		std::unique_lock lock(s_FileHashesMutex);
+		FileContentHash* cached = s_FileHashes.TryGetAt(pathHash);
+		if (cached && String::Equals(cached->Path, normalizedPath, true) && cached->ModifyTime == modifyTime && cached->Size == size)
+		{
+			AddValue(cached->Hash);
+			return true;
+		}
+	}
+
+	file::FSHandle fs = file::OpenFileStream(path, L"rb");
+	if (!fs)
+	{
+		AM_ERRF(L"AssetHashBuilder::AddFile() -> Failed to open file '%ls'", path);
+		return false;
+	}
+
+	DataHasher fileHasher;
+	List<char> buffer;
+	buffer.Resize(FILE_HASH_CHUNK_SIZE);
+	size_t readSize;
+	while ((readSize = file::ReadFileSteam(buffer.GetItems(), FILE_HASH_CHUNK_SIZE, FILE_HASH_CHUNK_SIZE, fs.Get())) != 0)
+		fileHasher.Add(buffer.GetItems(), readSize);
+
+	// Paths with the same hash replace each other, colliding path is only read again
+	FileContentHash entry = { normalizedPath, modifyTime, size, fileHasher.Get64() };
+	{
+		std::unique_lock lock(s_FileHashesMutex);
+		if (s_FileHashes.ContainsAt(pathHash))
+			s_FileHashes.GetAt(pathHash) = entry;
+		else
+			s_FileHashes.InsertAt(pathHash, entry);
+	}
+
+	AddValue(entry.Hash);
+	return true;
+}
+
+void rageam::asset::AssetHashBuilder::AddXml(const IXml& object, ConstString rootName)
+{
+	XmlDoc xDoc(rootName);
+	XmlHandle xRoot = xDoc.Root();
+	try
+	{
+		object.Serialize(xRoot);
+	}
+	catch (const XmlException& ex)
+	{
+		ex.Print();
+	}
+
+	tinyxml2::XMLPrinter printer(nullptr, true);
+	xDoc.Print(printer);
+	Add(printer.CStr(), printer.CStrSize());
+}
+
+u64 rageam::asset::AssetHashBuilder::Get() const
+{
+	u64 key = m_Hasher.Get64();
+	return key != 0 ? key : 1;
+}
+
+rageam::file::WPath rageam::asset::AssetCompileCache::GetEntryPath(u64 key, ConstWString extension)
+{
+	return GetCacheDirectory() / String::FormatTemp(L"%016llx.%ls", key, extension);
+}
+
+const rageam::file::WPath& rageam::asset::AssetCompileCache::GetCacheDirectory()
+{
+	static file::WPath cacheDirectory;
+	static std::once_flag init;
+	std::call_once(init, []
+		{
+			cacheDirectory = DataManager::GetDataFolder() / L"AssetCache";
+			CreateDirectoryW(cacheDirectory, NULL);
+		});
+	return cacheDirectory;
+}
+
+bool rageam::asset::AssetCompileCache::TryRestore(u64 key, ConstWString extension, ConstWString outPath)
+{
+	AM_TRACE_FUNCTION();
+
+	file::WPath entryPath = GetEntryPath(key, extension);
+	if (!file::IsFileExists(entryPath))
+		return false;
+
+	// Hard link must be created on path that doesn't exist, old resource is replaced anyway
+	DetachOutput(outPath);
+	if (CreateHardLinkW(outPath, entryPath, NULL))
+		return true;
+
+	// Cache is on another volume
+	if (CopyFileW(entryPath, outPath, FALSE))
+		return true;
+
+	AM_WARNINGF(L"AssetCompileCache::TryRestore() -> Failed to restore '%ls' from cache, error code %u", outPath, GetLastError());
+	return false;
+}
+
+void rageam::asset::AssetCompileCache::DetachOutput(ConstWString outPath)
+{
+	if (DeleteFileW(outPath) || GetLastError() == ERROR_FILE_NOT_FOUND || GetLastError() == ERROR_PATH_NOT_FOUND)
+		return;
+
+	AM_WARNINGF(L"AssetCompileCache::DetachOutput() -> Failed to delete '%ls', error code %u", outPath, GetLastError());
+}
+
+void rageam::asset::AssetCompileCache::Store(u64 key, ConstWString extension, ConstWString compiledPath)
+{
+	AM_TRACE_FUNCTION();
+
+	file::WPath entryPath = GetEntryPath(key, extension);
+
+	// Copy under temporary name first, so interrupted copy never leaves truncated entry
+	file::WPath tempPath = entryPath;
+	tempPath += L".tmp";
+	if (!CopyFileW(compiledPath, tempPath, FALSE))
+	{
+		AM_WARNINGF(L"AssetCompileCache::Store() -> Failed to copy '%ls' to cache, error code %u", compiledPath, GetLastError());
+		return;
+	}
+
+	if (!MoveFileExW(tempPath, entryPath, MOVEFILE_REPLACE_EXISTING))
+	{
+		AM_WARNINGF(L"AssetCompileCache::Store() -> Failed to move cache entry '%ls', error code %u", entryPath.GetCStr(), GetLastError());
+		DeleteFileW(tempPath);
+	}
+}
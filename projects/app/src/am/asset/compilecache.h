@@ -0,0 +1,66 @@
+//
+// File: compilecache.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "am/types.h"
+#include "am/file/path.h"
+#include "am/system/datahash.h"
+#include "am/xml/serialize.h"
+#include "common/types.h"
+
+namespace rageam::asset
+{
+	// Must be incremented when compiler output changes for the same input, invalidates all cached resources
+	static constexpr u32 ASSET_COMPILE_CACHE_VERSION = 0;
+
+	/**
+	 * \brief Accumulates hash of everything that affects compiled asset, see AssetBase::ComputeHashKey.
+	 * \remarks Key collision means stale resource so it must be wide enough, full 64 bit DataHasher is used.
+	 */
+	class AssetHashBuilder
+	{
+		DataHasher m_Hasher;
+
+	public:
+		void Add(pConstVoid data, size_t size);
+		void AddString(ConstString str);
+		void AddString(ConstWString str);
+		template<typename T>
+		void AddValue(const T& value) { Add(&value, sizeof(T)); }
+		// Adds hash of file contents, file is read only if it was modified since last time
+		// Returns false if file can't be read, key must not be used then
+		bool AddFile(ConstWString path);
+		// Adds XML text of serialized object, tunes have no order-dependent or time-dependent state so text is stable
+		void AddXml(const IXml& object, ConstString rootName);
+
+		// Never returns 0, it is reserved for assets that can't be cached
+		u64 Get() const;
+	};
+
+	/**
+	 * \brief On-disk content addressed store of compiled resources, entry file name is asset hash key.
+	 * Unchanged asset is restored by hard link (or copy if cache is on another volume) instead of being compiled again.
+	 */
+	class AssetCompileCache
+	{
+		static file::WPath GetEntryPath(u64 key, ConstWString extension);
+
+	public:
+		// data/AssetCache
+		static const file::WPath& GetCacheDirectory();
+
+		// Restored resource is hard link to cache entry, it must be deleted before compiling to the same path,
+		// otherwise writing to it would overwrite the entry. Called by TryRestore and GameRscAsset::CompileToFile
+		static void DetachOutput(ConstWString outPath);
+
+		// Places cached resource at given path, returns false if there's no entry for the key
+		static bool TryRestore(u64 key, ConstWString extension, ConstWString outPath);
+		// Adds compiled resource file to the cache, existing entry is replaced
+		static void Store(u64 key, ConstWString extension, ConstWString compiledPath);
+	};
+}
@@ -1,18 +1,14 @@
 #pragma once
 
 #include "am/types.h"
+#include "am/asset/compilecache.h"
 #include "am/file/fileutils.h"
 #include "am/file/path.h"
 #include "am/system/ptr.h"
+#include "am/system/trace.h"
 #include "am/xml/serialize.h"
 #include "rage/paging/compiler/compiler.h"
 
-// TODO:
-// - Cache system
-//		When compiling large problems, we don't want to recompile unchanged asset many times
-//		for caching we will need to correctly compute hash of an asset, for TXD
-//		we have to account texture files hash-sum + resolved templates
-
 namespace rageam::asset
 {
 #define ASSET_CONFIG_NAME L"tune.xml"
@@ -103,8 +99,9 @@ namespace rageam::asset
 			return path;
 		}
 
-		
-		virtual HashValue ComputeHashKey() { return 0; }
+		// Hash of everything compiled asset depends on - source files, tune and resolved texture presets,
+		// 0 if asset can't be cached. Compile options are added by GameRscAsset
+		virtual u64 ComputeHashKey() { return 0; }
 
 		virtual eAssetType GetType() const = 0;
 
@@ -114,6 +111,13 @@ namespace rageam::asset
 		// Note: This is not thread-safe function! Most likely going to be invoked from BackgroundWorker threads.
 		std::function<AssetCompileCallback> CompileCallback;
 
+		// Trade-off between resource file size and compression time, used only by resource assets
+		rage::pgRscCompressionPreset CompressionPreset = rage::pgRscCompressDefault;
+		// Spend more time on packing resource chunks to reduce memory resource takes in game
+		bool OptimizeResourcePacking = false;
+		// Unchanged asset is restored from AssetCompileCache instead of being compiled again, used only by resource assets
+		bool UseCompileCache = true;
+
 	protected:
 		void ReportProgress(const wchar_t* message, double progress) const
 		{
@@ -184,18 +188,38 @@ namespace rageam::asset
 
 		bool CompileToFile(ConstWString filePath = nullptr) override
 		{
+			AM_TRACE_SCOPE_DETAIL("GameRscAsset::CompileToFile", this->GetDirectoryPath().GetCStr());
 			AM_TRACEF(L"Compiling game asset %ls", this->GetDirectoryPath());
 
-			TGameFormat gameFormat;
-			if (!AM_VERIFY(this->CompileToGame(&gameFormat), "GameRscAsset::CompileToFile() -> Failed to compile game format..."))
-				return false;
-
 			file::WPath compilePath;
 			if (filePath)
 				compilePath = filePath;
 			else
 				compilePath = this->GetCompilePath();
 
+			u64 cacheKey = 0;
+			if (this->UseCompileCache)
+			{
+				AM_TRACE_SCOPE("GameRscAsset::ComputeCacheKey");
+				cacheKey = ComputeCacheKey();
+			}
+			if (cacheKey != 0 && AssetCompileCache::TryRestore(cacheKey, this->GetCompileExtension(), compilePath))
+			{
+				AM_TRACEF(L"GameRscAsset::CompileToFile() -> Asset is unchanged, restored %ls from compile cache", compilePath.GetCStr());
+				this->ReportProgress(L"- Restored from compile cache", 1.0);
+				return true;
+			}
+
+			// Output may still be hard link to cache entry from previous restore, resource writer must not write through it
+			AssetCompileCache::DetachOutput(compilePath);
+
+			TGameFormat gameFormat;
+			{
+				AM_TRACE_SCOPE("GameRscAsset::CompileToGame");
+				if (!AM_VERIFY(this->CompileToGame(&gameFormat), "GameRscAsset::CompileToFile() -> Failed to compile game format..."))
+					return false;
+			}
+
 			this->ReportProgress(L"- Compiling resource", 0);
 
 			rage::pgRscCompiler compiler;
@@ -203,8 +227,38 @@ namespace rageam::asset
 				{
 					this->ReportProgress(message, progress);
 				};
+			compiler.CompressionPreset = this->CompressionPreset;
+			compiler.OptimizePacking = this->OptimizeResourcePacking;
+
+			{
+				AM_TRACE_SCOPE("pgRscCompiler::Compile");
+				if (!compiler.Compile(&gameFormat, GetResourceVersion(), compilePath))
+					return false;
+			}
+
+			if (cacheKey != 0)
+			{
+				AM_TRACE_SCOPE("AssetCompileCache::Store");
+				AssetCompileCache::Store(cacheKey, this->GetCompileExtension(), compilePath);
+			}
+			return true;
+		}
 
-			return compiler.Compile(&gameFormat, GetResourceVersion(), compilePath);
+		// Asset hash key combined with resource format and compiler options, 0 if asset can't be cached
+		u64 ComputeCacheKey()
+		{
+			u64 assetKey = this->ComputeHashKey();
+			if (assetKey == 0)
+				return 0;
+
+			AssetHashBuilder builder;
+			builder.AddValue(ASSET_COMPILE_CACHE_VERSION);
+			builder.AddValue(assetKey);
+			builder.AddValue(this->GetFormatVersion());
+			builder.AddValue(GetResourceVersion());
+			builder.AddValue(this->CompressionPreset);
+			builder.AddValue(this->OptimizeResourcePacking);
+			return builder.Get();
 		}
 
 		// Hot-reload part of asset, if possible.
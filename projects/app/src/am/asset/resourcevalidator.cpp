@@ -0,0 +1,725 @@
+#include "resourcevalidator.h"
+
+#include "am/file/fileutils.h"
+#include "am/file/json.h"
+#include "am/file/iterator.h"
+#include "am/string/string.h"
+#include "am/system/timer.h"
+#include "am/system/trace.h"
+#include "am/system/worker.h"
+#include "common/logger.h"
+#include "game/drawable.h"
+#include "rage/file/device.h"
+#include "rage/grcore/txd.h"
+#include "rage/paging/builder/builder.h"
+#include "rage/paging/resource.h"
+#include "rage/paging/resourceheader.h"
+#include "rage/physics/bounds/boundbvh.h"
+#include "rage/physics/bounds/boundcomposite.h"
+#include "rage/system/systemheap.h"
+
+#include <cstdarg>
+
+namespace
+{
+	// Resource pointers are file offsets in virtual or physical address range, before they are fixed up
+	constexpr u64 RESOURCE_ADDRESS_END = rage::PG_PHYSICAL_MASK + (rage::PG_PHYSICAL_MASK - rage::PG_VIRTUAL_MASK);
+
+	u32 GetResourceVersion(rageam::asset::eResourceType type)
+	{
+		switch (type)
+		{
+		case rageam::asset::ResourceType_Txd:		return 13;
+		case rageam::asset::ResourceType_Drawable:	return 165;
+		case rageam::asset::ResourceType_Bound:		return 43;
+		default:									return 0;
+		}
+	}
+
+	ConstString GetResourceTypeName(rageam::asset::eResourceType type)
+	{
+		switch (type)
+		{
+		case rageam::asset::ResourceType_Txd:		return "txd";
+		case rageam::asset::ResourceType_Drawable:	return "drawable";
+		case rageam::asset::ResourceType_Bound:		return "bound";
+		default:									return "unknown";
+		}
+	}
+
+	// Size of chunk without trailing zero bytes
+	u64 GetUsedChunkSize(const rage::datResourceChunk& chunk)
+	{
+		const u8* data = static_cast<const u8*>(chunk.GetAllocatedAddress());
+		u64 used = chunk.Size;
+
+		// Chunk size is always multiple of min chunk size, so we can skip 8 bytes at once
+		while (used >= sizeof(u64) && *reinterpret_cast<const u64*>(data + used - sizeof(u64)) == 0)
+			used -= sizeof(u64);
+		while (used > 0 && data[used - 1] == 0)
+			used--;
+		return used;
+	}
+
+	void FreeChunks(const rage::datResourceMap& map)
+	{
+		rage::sysMemAllocator* allocator = GetMultiAllocator();
+		for (u32 i = 0; i < map.GetChunkCount(); i++)
+		{
+			if (map.Chunks[i].DestAddr)
+				allocator->Free(map.Chunks[i].GetAllocatedAddress());
+		}
+	}
+
+	bool IsAABBInside(const rage::phOptimizedBvhNode& outer, const rage::phOptimizedBvhNode& inner)
+	{
+		for (int i = 0; i < 3; i++)
+		{
+			if (inner.AABBMin[i] < outer.AABBMin[i] || inner.AABBMax[i] > outer.AABBMax[i])
+				return false;
+		}
+		return true;
+	}
+}
+
+void rageam::asset::ResourceValidationResult::AddError(ConstString fmt, ...)
+{
+	ErrorCount++;
+	if (Errors.GetSize() >= MAX_ERRORS)
+		return;
+
+	char buffer[512];
+	va_list args;
+	va_start(args, fmt);
+	String::FormatVA(buffer, sizeof buffer, fmt, args);
+	va_end(args);
+
+	Errors.Add(buffer);
+}
+
+u64 rageam::asset::ResourceValidationResult::GetSize(bool physical) const
+{
+	u64 size = 0;
+	for (const ResourceChunkUsage& chunk : Chunks)
+	{
+		if (chunk.Physical == physical)
+			size += chunk.Size;
+	}
+	return size;
+}
+
+u64 rageam::asset::ResourceValidationResult::GetUsedSize(bool physical) const
+{
+	u64 used = 0;
+	for (const ResourceChunkUsage& chunk : Chunks)
+	{
+		if (chunk.Physical == physical)
+			used += chunk.Used;
+	}
+	return used;
+}
+
+void rageam::asset::ResourceValidator::ScanRecurse(ConstWString path)
+{
+	file::WPath searchPath = path;
+	searchPath /= L"*";
+
+	file::Iterator iterator(searchPath);
+	file::FindData findData;
+	while (iterator.Next())
+	{
+		iterator.GetCurrent(findData);
+
+		if (findData.Attributes & FILE_ATTRIBUTE_DIRECTORY)
+		{
+			if (m_Options.Recursive)
+				ScanRecurse(findData.Path);
+			continue;
+		}
+
+		eResourceType type = GetResourceType(findData.Path);
+		if (type == ResourceType_Unknown)
+			continue;
+
+		ResourceValidationResult& result = m_Results.Construct();
+		result.Path = findData.Path;
+		result.Type = type;
+	}
+}
+
+void rageam::asset::ResourceValidator::ValidateFile(ResourceValidationResult& result) const
+{
+	AM_TRACE_FUNCTION();
+
+	rage::datResourceInfo info;
+	if (!ValidateHeader(result, info))
+		return;
+
+	// Chunks must be checked before they are decoded, invalid encoding overflows resource map
+	ValidateChunkEncoding(result, info);
+	if (!result.IsValid())
+		return;
+
+	file::U8Path path = file::PathConverter::WideToUtf8(result.Path);
+
+	rage::datResourceMap map = {};
+	if (!rage::pgRscBuilder::LoadBuild(path, result.Version, map, info))
+	{
+		result.AddError("Failed to read chunks, file is either truncated or compressed data is corrupted.");
+		FreeChunks(map);
+		return;
+	}
+
+	ComputeChunkUsage(result, map);
+
+	// Resource is made current in this thread, pgPtr's are placed automatically while it exists
+	{
+		rage::datResource rsc(map, path);
+		ValidatePointers(result, rsc);
+
+		// Placing resource with dangling pointer would hit invalid fixup
+		if (result.IsValid() && m_Options.PlaceResources)
+			ValidatePlaced(result, rsc);
+	}
+
+	// We don't call destructors, they would release GPU objects that were never created
+	FreeChunks(map);
+}
+
+bool rageam::asset::ResourceValidator::ValidateHeader(ResourceValidationResult& result, rage::datResourceInfo& info) const
+{
+	file::U8Path path = file::PathConverter::WideToUtf8(result.Path);
+	rage::fiDevice* device = rage::fiDevice::GetDeviceImpl(path);
+
+	u64 offset;
+	fiHandle_t file = device->OpenBulk(path, offset);
+	if (file == FI_INVALID_HANDLE)
+	{
+		result.AddError("Unable to open file.");
+		return false;
+	}
+
+	rage::datResourceHeader header = {};
+	u32 readSize = device->ReadBulk(file, offset, &header, sizeof header);
+	device->CloseBulk(file);
+
+	if (readSize != sizeof header)
+	{
+		result.AddError("File is too small to hold resource header.");
+		return false;
+	}
+
+	if (!header.IsValidMagic())
+	{
+		result.AddError("Invalid magic %#x, file is not RSC7 resource.", header.Magic);
+		return false;
+	}
+
+	result.Version = header.Version;
+	u32 expectedVersion = GetResourceVersion(result.Type);
+	if (header.Version != expectedVersion)
+	{
+		result.AddError("Resource version is %u, %s must have version %u.",
+			header.Version, GetResourceTypeName(result.Type), expectedVersion);
+		return false;
+	}
+
+	info = header.Info;
+	if (info.GetVersion() != static_cast<int>(header.Version & 0xFF))
+	{
+		result.AddError("Version encoded in datResourceInfo is %i, header version is %u.", info.GetVersion(), header.Version);
+	}
+	return true;
+}
+
+void rageam::asset::ResourceValidator::ValidateChunkEncoding(ResourceValidationResult& result, const rage::datResourceInfo& info) const
+{
+	u32 virtualCount = info.GetVirtualChunkCount();
+	u32 physicalCount = info.GetPhysicalChunkCount();
+
+	if (virtualCount == 0)
+		result.AddError("Resource has no virtual chunks, there's no root structure.");
+
+	// Every bucket may hold more chunks than resource map can fit
+	if (virtualCount + physicalCount > rage::PG_MAX_CHUNKS)
+	{
+		result.AddError("Resource has %u chunks (virtual: %u, physical: %u), max is %u.",
+			virtualCount + physicalCount, virtualCount, physicalCount, rage::PG_MAX_CHUNKS);
+		return;
+	}
+
+	rage::datResourceMap map;
+	info.GenerateMap(map);
+
+	for (u32 i = 0; i < map.GetChunkCount(); i++)
+	{
+		const rage::datResourceChunk& chunk = map.Chunks[i];
+		if (chunk.Size > rage::PG_MAX_CHUNK_SIZE)
+			result.AddError("Chunk %u size is %#llx, max is %#x.", i, chunk.Size, rage::PG_MAX_CHUNK_SIZE);
+	}
+
+	// Both address ranges are 256MB, pointers can't be resolved if they overlap
+	if (virtualCount > 0)
+	{
+		const rage::datResourceChunk& lastVirtual = map.Chunks[virtualCount - 1];
+		if (lastVirtual.SrcAddr + lastVirtual.Size > rage::PG_PHYSICAL_MASK)
+			result.AddError("Virtual chunks end at %#llx and overlap physical address range.", lastVirtual.SrcAddr + lastVirtual.Size);
+	}
+	if (physicalCount > 0)
+	{
+		const rage::datResourceChunk& lastPhysical = map.Chunks[map.GetChunkCount() - 1];
+		if (lastPhysical.SrcAddr + lastPhysical.Size > RESOURCE_ADDRESS_END)
+			result.AddError("Physical chunks end at %#llx, out of physical address range.", lastPhysical.SrcAddr + lastPhysical.Size);
+	}
+}
+
+void rageam::asset::ResourceValidator::ComputeChunkUsage(ResourceValidationResult& result, const rage::datResourceMap& map) const
+{
+	result.Chunks.Reserve(map.GetChunkCount());
+	for (u32 i = 0; i < map.GetChunkCount(); i++)
+	{
+		const rage::datResourceChunk& chunk = map.Chunks[i];
+
+		ResourceChunkUsage& usage = result.Chunks.Construct();
+		usage.Size = chunk.Size;
+		usage.Used = GetUsedChunkSize(chunk);
+		usage.Physical = i >= map.VirtualChunkCount;
+	}
+}
+
+void rageam::asset::ResourceValidator::ValidatePointers(ResourceValidationResult& result, const rage::datResource& rsc) const
+{
+	AM_TRACE_FUNCTION();
+
+	// Pointers are not typed in resource, so we scan every aligned 64 bit value in virtual chunks. Plain data that
+	// falls into resource address range (upper dword is zero, lower is 0x5XXXXXXX or 0x6XXXXXXX) is very unlikely
+	const rage::datResourceMap& map = *rsc.Map;
+	for (u32 i = 0; i < map.VirtualChunkCount; i++)
+	{
+		const rage::datResourceChunk& chunk = map.Chunks[i];
+		const u64* values = static_cast<const u64*>(chunk.GetAllocatedAddress());
+		u64 valueCount = (result.Chunks[i].Used + sizeof(u64) - 1) / sizeof(u64);
+
+		for (u64 k = 0; k < valueCount; k++)
+		{
+			u64 value = values[k];
+			if (value < rage::PG_VIRTUAL_MASK || value >= RESOURCE_ADDRESS_END)
+				continue;
+
+			if (rsc.Find(rsc.SrcChunks, value))
+			{
+				result.FixupCount++;
+				continue;
+			}
+
+			result.DanglingCount++;
+			result.AddError("Pointer at %#llx points to %#llx, outside of all chunks.", chunk.SrcAddr + k * sizeof(u64), value);
+		}
+	}
+}
+
+void rageam::asset::ResourceValidator::ValidatePlaced(ResourceValidationResult& result, rage::datResource& rsc) const
+{
+	AM_TRACE_FUNCTION();
+
+	pVoid root = rsc.Map->MainChunk;
+	switch (result.Type)
+	{
+	case ResourceType_Txd:
+	{
+		rage::grcTextureDictionary* dict = static_cast<rage::grcTextureDictionary*>(root);
+		rsc.Place(dict);
+
+		// Dictionary is searched using binary search
+		for (u16 i = 0; i < dict->GetSize(); i++)
+		{
+			rage::pgKeyPair<rage::grcTexture> pair = dict->GetAt(i);
+			if (!pair.Value)
+				result.AddError("Texture at index %u is null.", i);
+			if (i > 0 && pair.Key <= dict->GetAt(i - 1).Key)
+				result.AddError("Texture keys are not sorted, key %u at index %u.", pair.Key, i);
+		}
+		break;
+	}
+	case ResourceType_Drawable:
+	{
+		gtaDrawable* drawable = static_cast<gtaDrawable*>(root);
+		rsc.Place(drawable);
+		ValidateDrawable(result, drawable);
+		break;
+	}
+	case ResourceType_Bound:
+	{
+		rage::phBound* bound = static_cast<rage::phBound*>(root);
+		rsc.Place(bound);
+		ValidateBound(result, bound);
+		break;
+	}
+	default: AM_UNREACHABLE("ResourceValidator::ValidatePlaced() -> Type '%i' is not implemented.", result.Type);
+	}
+}
+
+void rageam::asset::ResourceValidator::ValidateBound(ResourceValidationResult& result, rage::phBound* bound) const
+{
+	switch (bound->GetShapeType())
+	{
+	case rage::PH_BOUND_COMPOSITE:
+	{
+		rage::phBoundComposite* composite = static_cast<rage::phBoundComposite*>(bound);
+		u16 boundCount = composite->GetNumBounds();
+		for (u16 i = 0; i < boundCount; i++)
+		{
+			// Composite may have empty slots
+			rage::phBound* child = composite->GetBound(i).Get();
+			if (!child)
+				continue;
+
+			if (child->GetShapeType() == rage::PH_BOUND_COMPOSITE)
+			{
+				result.AddError("Composite child %u is composite, nested composites are not supported.", i);
+				continue;
+			}
+			ValidateBound(result, child);
+		}
+
+		if (composite->GetBVH())
+			ValidateBVH(result, composite->GetBVH(), boundCount);
+		break;
+	}
+	case rage::PH_BOUND_BVH:
+	{
+		rage::phBoundBVH* bvhBound = static_cast<rage::phBoundBVH*>(bound);
+		ValidateGeometry(result, bvhBound);
+
+		if (bvhBound->GetBVH())
+			ValidateBVH(result, bvhBound->GetBVH(), bvhBound->GetPrimitiveCount());
+		else
+			result.AddError("BVH bound has no BVH.");
+		break;
+	}
+	case rage::PH_BOUND_GEOMETRY:
+		ValidateGeometry(result, static_cast<rage::phBoundGeometry*>(bound));
+		break;
+
+	case rage::PH_BOUND_SPHERE:
+	case rage::PH_BOUND_CAPSULE:
+	case rage::PH_BOUND_BOX:
+	case rage::PH_BOUND_DISC:
+	case rage::PH_BOUND_CYLINDER:
+	case rage::PH_BOUND_PLANE:
+		break;
+
+	default:
+		result.AddError("Bound has unknown type %u.", static_cast<u32>(bound->GetShapeType()));
+		break;
+	}
+}
+
+void rageam::asset::ResourceValidator::ValidateGeometry(ResourceValidationResult& result, rage::phBoundGeometry* geometry) const
+{
+	// Only BVH may hold primitives other than polygons
+	rage::phBoundBVH* bvhBound = nullptr;
+	if (geometry->GetShapeType() == rage::PH_BOUND_BVH)
+		bvhBound = static_cast<rage::phBoundBVH*>(geometry);
+
+	u32 vertexCount = geometry->GetVertexCount();
+	u32 polygonCount = geometry->GetPolygonCount();
+	for (u32 i = 0; i < polygonCount; i++)
+	{
+		rage::phPrimitive& primitive = bvhBound ?
+			bvhBound->GetPrimitive(static_cast<int>(i)) : geometry->GetPolygon(static_cast<u16>(i)).GetPrimitive();
+
+		u16 indices[4];
+		u32 indexCount = 0;
+		switch (primitive.GetType())
+		{
+		case rage::PRIM_TYPE_POLYGON:
+		{
+			rage::phPolygon& polygon = primitive.GetPolygon();
+			for (u32 k = 0; k < 3; k++)
+				indices[indexCount++] = polygon.GetVertexIndex(k);
+			break;
+		}
+		case rage::PRIM_TYPE_SPHERE:
+			indices[indexCount++] = primitive.GetSphere().GetCenterIndex();
+			break;
+		case rage::PRIM_TYPE_CAPSULE:
+			indices[indexCount++] = primitive.GetCapsule().GetEndIndex0();
+			indices[indexCount++] = primitive.GetCapsule().GetEndIndex1();
+			break;
+		case rage::PRIM_TYPE_BOX:
+			for (int k = 0; k < 4; k++)
+				indices[indexCount++] = primitive.GetBox().GetVertexIndex(k);
+			break;
+		case rage::PRIM_TYPE_CYLINDER:
+			indices[indexCount++] = primitive.GetCylinder().GetEndIndex0();
+			indices[indexCount++] = primitive.GetCylinder().GetEndIndex1();
+			break;
+		default:
+			result.AddError("Primitive %u has invalid type %u.", i, static_cast<u32>(primitive.GetType()));
+			continue;
+		}
+
+		if (!bvhBound && !primitive.IsPolygon())
+			result.AddError("Primitive %u in geometry bound is not polygon.", i);
+
+		for (u32 k = 0; k < indexCount; k++)
+		{
+			if (indices[k] >= vertexCount)
+				result.AddError("Primitive %u references vertex %u, bound has %u vertices.", i, indices[k], vertexCount);
+		}
+	}
+}
+
+void rageam::asset::ResourceValidator::ValidateBVH(
+	ResourceValidationResult& result, const rage::phOptimizedBvh* bvh, u32 primitiveCount) const
+{
+	int nodeCount = bvh->GetNodeCount();
+	if (nodeCount == 0)
+	{
+		result.AddError("BVH has no nodes.");
+		return;
+	}
+
+	List<bool> isPrimitiveInLeaf;
+	isPrimitiveInLeaf.Resize(primitiveCount);
+	for (u32 i = 0; i < primitiveCount; i++)
+		isPrimitiveInLeaf[i] = false;
+
+	for (int i = 0; i < nodeCount; i++)
+	{
+		const rage::phOptimizedBvhNode& node = bvh->GetNode(i);
+
+		for (int k = 0; k < 3; k++)
+		{
+			if (node.AABBMin[k] > node.AABBMax[k])
+			{
+				result.AddError("BVH node %i has inverted bounding box.", i);
+				break;
+			}
+		}
+
+		if (node.IsLeafNode())
+		{
+			u32 begin = node.GetPrimitiveIndex();
+			u32 end = begin + node.GetPrimitiveCount();
+			if (end > primitiveCount)
+			{
+				result.AddError("BVH leaf node %i references primitives %u-%u, there are %u.", i, begin, end, primitiveCount);
+				continue;
+			}
+
+			for (u32 k = begin; k < end; k++)
+				isPrimitiveInLeaf[k] = true;
+			continue;
+		}
+
+		// Traversal jumps over subtree using escape index, so it must stay within the tree
+		int escapeIndex = node.GetEscapeIndex();
+		int subtreeEnd = i + escapeIndex;
+		if (escapeIndex <= 1 || subtreeEnd > nodeCount)
+		{
+			result.AddError("BVH node %i has invalid escape index %i, there are %i nodes.", i, escapeIndex, nodeCount);
+			continue;
+		}
+
+		// Children must be inside parent box, otherwise traversal won't reach them. Checking only direct children
+		// is enough, they are checked against their own children in turn
+		int left = i + 1;
+		int right = left + MAX(bvh->GetNode(left).GetEscapeIndex(), 1);
+		if (!IsAABBInside(node, bvh->GetNode(left)))
+			result.AddError("BVH node %i is outside of parent node %i.", left, i);
+		if (right < subtreeEnd && !IsAABBInside(node, bvh->GetNode(right)))
+			result.AddError("BVH node %i is outside of parent node %i.", right, i);
+	}
+
+	u32 missingCount = 0;
+	for (u32 i = 0; i < primitiveCount; i++)
+	{
+		if (!isPrimitiveInLeaf[i])
+			missingCount++;
+	}
+	if (missingCount != 0)
+		result.AddError("%u of %u primitives are not in any BVH leaf, they won't collide.", missingCount, primitiveCount);
+}
+
+void rageam::asset::ResourceValidator::ValidateDrawable(ResourceValidationResult& result, gtaDrawable* drawable) const
+{
+	rage::rmcLodGroup& lodGroup = drawable->GetLodGroup();
+	for (int lod = 0; lod < lodGroup.GetLodCount(); lod++)
+	{
+		rage::rmcLod* lodModels = lodGroup.GetLod(lod);
+		for (u16 i = 0; i < lodModels->GetModels().GetSize(); i++)
+		{
+			rage::grmModel* model = lodModels->GetModel(i);
+			if (!model)
+			{
+				result.AddError("LOD %i model %u is null.", lod, i);
+				continue;
+			}
+
+			const rage::grmGeometries& geometries = model->GetGeometries();
+			for (u16 k = 0; k < geometries.GetSize(); k++)
+			{
+				rage::grmGeometryQB* geometry = geometries[k].Get();
+				rage::grcVertexBuffer* vertexBuffer = geometry ? geometry->GetVertexBuffer(0) : nullptr;
+				rage::grcIndexBuffer* indexBuffer = geometry ? geometry->GetIndexBuffer(0) : nullptr;
+				if (!vertexBuffer || !indexBuffer || !indexBuffer->GetIndexData())
+				{
+					result.AddError("LOD %i model %u geometry %u has no vertex or index buffer.", lod, i, k);
+					continue;
+				}
+
+				u32 indexCount = indexBuffer->GetIndexCount();
+				u32 vertexCount = vertexBuffer->GetVertexCount();
+				if (geometry->GetIndexCount() > indexCount)
+				{
+					result.AddError("LOD %i model %u geometry %u draws %u indices, buffer has %u.",
+						lod, i, k, geometry->GetIndexCount(), indexCount);
+				}
+
+				const u16* indices = indexBuffer->GetIndexData();
+				for (u32 j = 0; j < indexCount; j++)
+				{
+					if (indices[j] >= vertexCount)
+					{
+						result.AddError("LOD %i model %u geometry %u index %u references vertex %u, there are %u.",
+							lod, i, k, j, indices[j], vertexCount);
+						break;
+					}
+				}
+			}
+		}
+	}
+
+	if (drawable->GetBound())
+		ValidateBound(result, drawable->GetBound().Get());
+}
+
+rageam::asset::ResourceValidator::ResourceValidator(ConstWString path, const ResourceValidatorOptions& options)
+{
+	m_Path = path;
+	m_Options = options;
+}
+
+bool rageam::asset::ResourceValidator::Validate()
+{
+	AM_TRACE_FUNCTION();
+
+	Timer timer = Timer::StartNew();
+
+	m_Results.Clear();
+	if (file::IsDirectory(m_Path))
+	{
+		ScanRecurse(m_Path);
+	}
+	else if (eResourceType type = GetResourceType(m_Path); type != ResourceType_Unknown)
+	{
+		ResourceValidationResult& result = m_Results.Construct();
+		result.Path = m_Path;
+		result.Type = type;
+	}
+	else
+	{
+		AM_ERRF(L"ResourceValidator::Validate() -> '%ls' is neither directory nor resource file.", m_Path.GetCStr());
+		return false;
+	}
+
+	AM_TRACEF(L"ResourceValidator::Validate() -> Validating %u resources in '%ls'", m_Results.GetSize(), m_Path.GetCStr());
+
+	BackgroundWorker::ParallelFor(m_Results.GetSize(), [this](u32 index)
+		{
+			ResourceValidationResult& result = m_Results[index];
+
+			Timer fileTimer = Timer::StartNew();
+			ValidateFile(result);
+			fileTimer.Stop();
+			result.Time = static_cast<double>(fileTimer.GetElapsedMicroseconds()) / 1000000.0;
+
+			if (!result.IsValid())
+				AM_ERRF(L"ResourceValidator::Validate() -> '%ls' has %u errors", result.Path.GetCStr(), result.ErrorCount);
+		}, TaskPriority_Low);
+
+	timer.Stop();
+	m_TotalTime = static_cast<double>(timer.GetElapsedMicroseconds()) / 1000000.0;
+
+	bool success = true;
+	for (const ResourceValidationResult& result : m_Results)
+		success &= result.IsValid();
+	return success;
+}
+
+bool rageam::asset::ResourceValidator::WriteReport(ConstWString path) const
+{
+	file::FSHandle handle = file::OpenFileStream(path, L"w");
+	if (!handle)
+	{
+		AM_ERRF(L"ResourceValidator::WriteReport() -> Failed to open '%ls' for writing.", path);
+		return false;
+	}
+	FILE* fs = handle.Get();
+
+	u32 invalidCount = 0;
+	u64 totalSize = 0;
+	u64 totalUsed = 0;
+	for (const ResourceValidationResult& result : m_Results)
+	{
+		if (!result.IsValid())
+			invalidCount++;
+		totalSize += result.GetSize(false) + result.GetSize(true);
+		totalUsed += result.GetUsedSize(false) + result.GetUsedSize(true);
+	}
+
+	fputs("{\n\t\"path\": ", fs);
+	file::WriteJsonString(fs, m_Path);
+	fprintf(fs, ",\n\t\"totalTime\": %.3f,\n\t\"valid\": %u,\n\t\"invalid\": %u,\n\t\"size\": %llu,\n\t\"used\": %llu,\n\t\"waste\": %llu,\n\t\"resources\": [",
+		m_TotalTime, m_Results.GetSize() - invalidCount, invalidCount, totalSize, totalUsed, totalSize - totalUsed);
+
+	for (u32 i = 0; i < m_Results.GetSize(); i++)
+	{
+		const ResourceValidationResult& result = m_Results[i];
+		u64 virtualSize = result.GetSize(false);
+		u64 physicalSize = result.GetSize(true);
+		u64 virtualUsed = result.GetUsedSize(false);
+		u64 physicalUsed = result.GetUsedSize(true);
+
+		fputs(i == 0 ? "\n\t\t{\n\t\t\t\"path\": " : ",\n\t\t{\n\t\t\t\"path\": ", fs);
+		file::WriteJsonString(fs, result.Path);
+		fprintf(fs,
+			",\n\t\t\t\"type\": \"%s\", \"version\": %u, \"time\": %.3f, \"valid\": %s,"
+			"\n\t\t\t\"virtualSize\": %llu, \"virtualUsed\": %llu, \"physicalSize\": %llu, \"physicalUsed\": %llu, \"waste\": %llu,"
+			"\n\t\t\t\"fixups\": %u, \"danglingPointers\": %u,\n\t\t\t\"chunks\": [",
+			GetResourceTypeName(result.Type), result.Version, result.Time, result.IsValid() ? "true" : "false",
+			virtualSize, virtualUsed, physicalSize, physicalUsed, virtualSize + physicalSize - virtualUsed - physicalUsed,
+			result.FixupCount, result.DanglingCount);
+
+		for (u32 k = 0; k < result.Chunks.GetSize(); k++)
+		{
+			const ResourceChunkUsage& chunk = result.Chunks[k];
+			fprintf(fs, "%s{ \"physical\": %s, \"size\": %llu, \"used\": %llu }",
+				k == 0 ? "" : ", ", chunk.Physical ? "true" : "false", chunk.Size, chunk.Used);
+		}
+
+		fprintf(fs, "],\n\t\t\t\"errorCount\": %u, \"errors\": [", result.ErrorCount);
+		for (u32 k = 0; k < result.Errors.GetSize(); k++)
+		{
+			if (k != 0) fputs(", ", fs);
+			file::WriteJsonString(fs, result.Errors[k].GetCStr());
+		}
+		fputs("]\n\t\t}", fs);
+	}
+
+	fputs("\n\t]\n}\n", fs);
+
+	AM_TRACEF(L"ResourceValidator::WriteReport() -> Written to '%ls'", path);
+	return true;
+}
+
+rageam::asset::eResourceType rageam::asset::ResourceValidator::GetResourceType(ConstWString path)
+{
+	ConstWString extension = file::GetExtension(path);
+	if (String::Equals(extension, L"ytd", true)) return ResourceType_Txd;
+	if (String::Equals(extension, L"ydr", true)) return ResourceType_Drawable;
+	if (String::Equals(extension, L"ybn", true)) return ResourceType_Bound;
+	return ResourceType_Unknown;
+}
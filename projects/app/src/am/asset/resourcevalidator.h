@@ -0,0 +1,113 @@
+//
+// File: resourcevalidator.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "am/types.h"
+#include "am/file/path.h"
+#include "rage/paging/resourcemap.h"
+
+class gtaDrawable;
+
+namespace rage
+{
+	struct datResource;
+	class phBound;
+	class phBoundGeometry;
+	class phOptimizedBvh;
+}
+
+namespace rageam::asset
+{
+	enum eResourceType
+	{
+		ResourceType_Unknown,
+		ResourceType_Txd,		// .ytd
+		ResourceType_Drawable,	// .ydr
+		ResourceType_Bound,		// .ybn
+	};
+
+	struct ResourceValidatorOptions
+	{
+		bool Recursive = true;
+		// Places resource and checks type invariants (bounds, BVH, geometries),
+		// otherwise only header, chunks and pointers are validated
+		bool PlaceResources = true;
+	};
+
+	struct ResourceChunkUsage
+	{
+		u64  Size = 0;
+		u64  Used = 0;	// Chunk size without zero tail, tail is padding that packer left to fit chunk size
+		bool Physical = false;
+	};
+
+	struct ResourceValidationResult
+	{
+		static constexpr u32 MAX_ERRORS = 32; // Broken BVH may give error per node, we don't need all of them
+
+		file::WPath					Path;
+		eResourceType				Type = ResourceType_Unknown;
+		u32							Version = 0;
+		List<ResourceChunkUsage>	Chunks;
+		u32							FixupCount = 0;		// Pointers that resolve into one of resource chunks
+		u32							DanglingCount = 0;	// Pointers into resource address range but outside of all chunks
+		u32							ErrorCount = 0;
+		List<string>				Errors;				// First MAX_ERRORS errors
+		double						Time = 0;			// In seconds
+
+		PRINTF_ATTR(2, 3) void AddError(ConstString fmt, ...);
+
+		bool IsValid() const { return ErrorCount == 0; }
+
+		u64 GetSize(bool physical) const;
+		u64 GetUsedSize(bool physical) const;
+	};
+
+	/**
+	 * \brief Loads compiled resources (.ytd, .ydr, .ybn) without game and GPU and checks them for errors.
+	 * \n Checked are header and datResourceInfo chunk encoding, pointers in virtual chunks (every value in
+	 * resource address range must point inside of chunk), and after placement - bound, BVH and geometry invariants.
+	 * \n Per-chunk utilization shows how much memory is lost to chunk size rounding.
+	 * \remarks Files are validated in parallel on main background worker.
+	 */
+	class ResourceValidator
+	{
+		file::WPath						m_Path;
+		ResourceValidatorOptions		m_Options;
+		List<ResourceValidationResult>	m_Results;
+		double							m_TotalTime = 0;
+
+		void ScanRecurse(ConstWString path);
+
+		void ValidateFile(ResourceValidationResult& result) const;
+		bool ValidateHeader(ResourceValidationResult& result, rage::datResourceInfo& info) const;
+		void ValidateChunkEncoding(ResourceValidationResult& result, const rage::datResourceInfo& info) const;
+		void ComputeChunkUsage(ResourceValidationResult& result, const rage::datResourceMap& map) const;
+		void ValidatePointers(ResourceValidationResult& result, const rage::datResource& rsc) const;
+		void ValidatePlaced(ResourceValidationResult& result, rage::datResource& rsc) const;
+
+		void ValidateBound(ResourceValidationResult& result, rage::phBound* bound) const;
+		void ValidateGeometry(ResourceValidationResult& result, rage::phBoundGeometry* geometry) const;
+		void ValidateBVH(ResourceValidationResult& result, const rage::phOptimizedBvh* bvh, u32 primitiveCount) const;
+		void ValidateDrawable(ResourceValidationResult& result, gtaDrawable* drawable) const;
+
+	public:
+		// Path may be either single resource file or directory
+		ResourceValidator(ConstWString path, const ResourceValidatorOptions& options = {});
+
+		// Returns true if all resources are valid
+		bool Validate();
+
+		// Writes results of the last validation as JSON file
+		bool WriteReport(ConstWString path) const;
+
+		static eResourceType GetResourceType(ConstWString path);
+
+		const List<ResourceValidationResult>& GetResults() const { return m_Results; }
+	};
+}
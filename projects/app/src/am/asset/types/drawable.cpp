@@ -4,8 +4,12 @@
 #include "am/asset/factory.h"
 #include "am/file/iterator.h"
 #include "am/graphics/buffereditor.h"
+#include "am/graphics/dxgi_utils.h"
 #include "am/graphics/geomprimitives.h"
+#include "am/graphics/meshoptimizer.h"
 #include "am/graphics/meshsplitter.h"
+#include "am/system/trace.h"
+#include "am/system/worker.h"
 #include "rage/grcore/effectmgr.h"
 #include "am/xml/iterator.h"
 #include "rage/math/math.h"
@@ -14,6 +18,8 @@
 #include "rage/physics/bounds/boundgeometry.h"
 #include "rage/physics/bounds/boundbvh.h"
 
+#include <atomic>
+
 bool rageam::asset::DrawableTxd::TryCompile()
 {
 	Dict = nullptr;
@@ -549,6 +555,8 @@ void rageam::asset::DrawableTune::Serialize(XmlHandle& node) const
 	Lods.Serialize(xLodGroup);
 	Materials.Serialize(node);
 	Lights.Serialize(node);
+
+	XML_SET_CHILD_VALUE(node, OptimizeMeshes);
 }
 
 void rageam::asset::DrawableTune::Deserialize(const XmlHandle& node)
@@ -562,6 +570,8 @@ void rageam::asset::DrawableTune::Deserialize(const XmlHandle& node)
 	Lods.Deserialize(xLodGroup);
 	Materials.Deserialize(node);
 	Lights.Deserialize(node);
+
+	XML_GET_CHILD_VALUE(node, OptimizeMeshes);
 }
 
 rage::grmModel* rageam::asset::DrawableAssetMap::GetModelFromScene(rage::rmcDrawable* drawable, u16 sceneNodeIndex) const
@@ -644,6 +654,7 @@ void rageam::asset::DrawableAsset::PrepareForConversion()
 	m_NodeToModel.Resize(nodeCount);
 	m_NodeToBone.Resize(nodeCount);
 	m_EmbedDict = nullptr;
+	m_NewCompileCache = ReuseCache ? std::make_shared<CompileCache>() : nullptr;
 
 	CompiledDrawableMap = std::make_unique<DrawableAssetMap>();
 	CompiledDrawableMap->SceneNodeToModel.Resize(nodeCount);
@@ -666,12 +677,15 @@ void rageam::asset::DrawableAsset::CleanUpConversion()
 	m_NodeToModel.Destroy();
 	m_NodeToBone.Destroy();
 	m_EmbedDict = nullptr;
+	m_NewCompileCache = nullptr;
 }
 
-rageam::List<rageam::asset::DrawableAsset::SplittedGeometry> rageam::asset::DrawableAsset::ConvertSceneGeometry(
+rageam::List<rageam::asset::DrawableAsset::PackedGeometry> rageam::asset::DrawableAsset::PackSceneGeometry(
 	const graphics::SceneGeometry* sceneGeometry, bool skinned) const
 {
-	List<SplittedGeometry> geometries;
+	AM_TRACE_FUNCTION();
+
+	List<PackedGeometry> packedGeometries;
 
 	// Retrieve material & vertex declaration for scene geometry
 	const MaterialTune& material = *m_DrawableTune.Materials.Get(sceneGeometry->GetMaterialIndex()); // Material settings from tune.xml file (asset config)
@@ -682,8 +696,6 @@ rageam::List<rageam::asset::DrawableAsset::SplittedGeometry> rageam::asset::Draw
 	u32 totalVertexCount = sceneGeometry->GetVertexCount();
 	u32 totalIndexCount = sceneGeometry->GetIndexCount();
 
-	// AM_DEBUGF("DrawableAsset::ConvertSceneGeometry -> %u vertices; %u indices", totalVertexCount, totalIndexCount);
-
 	// Pack scene geometry attributes into single vertex buffer
 	graphics::VertexBufferEditor sceneVertexBuffer(decl);
 	sceneVertexBuffer.Init(totalVertexCount);
@@ -692,7 +704,7 @@ rageam::List<rageam::asset::DrawableAsset::SplittedGeometry> rageam::asset::Draw
 	{
 		sceneVertexBuffer.SetColorSingle(0, graphics::COLOR_WHITE);
 		AM_WARNINGF(
-			"DrawableAsset::ConvertSceneGeometry() -> Geometry '%u' of mesh '%s' has no vertex color! Using WHITE as default.",
+			"DrawableAsset::PackSceneGeometry() -> Geometry '%u' of mesh '%s' has no vertex color! Using WHITE as default.",
 			sceneGeometry->GetIndex(), sceneGeometry->GetParentMesh()->GetParentNode()->GetName());
 	}
 
@@ -703,25 +715,29 @@ rageam::List<rageam::asset::DrawableAsset::SplittedGeometry> rageam::asset::Draw
 		sceneVertexBuffer.SetBlendIndices(remappedBlendIndices.get(), DXGI_FORMAT_R32G32B32A32_FLOAT);
 	}
 
-	// Creates grmGeometry from given vertex data and adds it in geometries list
-	auto addGeometry = [&decl, &geometries](pVoid vertices, pVoid indices, u32 vertexCount, u32 indexCount, const rage::spdAABB& bb)
+	// Reorders triangles & vertices for post-transform cache, overdraw and vertex fetch
+	bool optimize = m_DrawableTune.OptimizeMeshes;
+	const graphics::VertexAttribute* positionAttr = decl.FindAttribute(graphics::POSITION, 0);
+	u32 positionOffset = positionAttr ? positionAttr->Offset : u32(-1);
+	List<u32> optimizedIndices;
+	auto optimizeMesh = [&](graphics::MeshChunk& mesh)
 		{
-			// Create geometry & set vertex data
-			rage::grmVertexData vertexData;
-			vertexData.Vertices = vertices;
-			vertexData.Indices = static_cast<u16*>(indices);
-			vertexData.VertexCount = vertexCount;
-			vertexData.IndexCount = indexCount;
-			vertexData.Info = decl.GrcInfo;
-
-			rage::pgUPtr grmGeometry = new rage::grmGeometryQB();
-			grmGeometry->SetVertexData(vertexData);
-
-			// Add resulting geometry in the list
-			SplittedGeometry splittedGeometry;
-			splittedGeometry.GrmGeometry = std::move(grmGeometry);
-			splittedGeometry.BoundingBox = bb;
-			geometries.Emplace(std::move(splittedGeometry));
+			u16* indices = mesh.Indices.get();
+			optimizedIndices.Resize(mesh.IndexCount);
+			for (u32 i = 0; i < mesh.IndexCount; i++)
+				optimizedIndices[i] = indices[i];
+
+			graphics::VertexCacheStats statsBefore, statsAfter;
+			mesh.VertexCount = graphics::MeshOptimizer::Optimize(
+				mesh.Vertices.get(), decl.Stride, positionOffset, mesh.VertexCount,
+				optimizedIndices.GetItems(), mesh.IndexCount, &statsBefore, &statsAfter);
+
+			for (u32 i = 0; i < mesh.IndexCount; i++)
+				indices[i] = static_cast<u16>(optimizedIndices[i]);
+
+			AM_DEBUGF("DrawableAsset::PackSceneGeometry() -> Optimized geometry '%u' of mesh '%s'; ACMR: %.3f -> %.3f; ATVR: %.3f -> %.3f",
+				sceneGeometry->GetIndex(), sceneGeometry->GetParentMesh()->GetParentNode()->GetName(),
+				statsBefore.ACMR, statsAfter.ACMR, statsBefore.ATVR, statsAfter.ATVR);
 		};
 
 	graphics::SceneData indices;
@@ -730,8 +746,19 @@ rageam::List<rageam::asset::DrawableAsset::SplittedGeometry> rageam::asset::Draw
 	// If indices are 16 bit we can just use them as is, otherwise we'll have to split geometry
 	if (indices.Format == DXGI_FORMAT_R16_UINT)
 	{
-		rage::spdAABB bound = sceneGeometry->GetAABB();
-		addGeometry(sceneVertexBuffer.GetBuffer(), indices.Buffer, totalVertexCount, totalIndexCount, bound);
+		size_t vertexBufferSize = static_cast<size_t>(totalVertexCount) * decl.Stride;
+		char* vertices = new char[vertexBufferSize];
+		u16* geometryIndices = new u16[totalIndexCount];
+		memcpy(vertices, sceneVertexBuffer.GetBuffer(), vertexBufferSize);
+		memcpy(geometryIndices, indices.Buffer, sizeof(u16) * totalIndexCount);
+
+		PackedGeometry& packedGeometry = packedGeometries.Construct();
+		packedGeometry.Mesh = graphics::MeshChunk{
+			amUniquePtr<char>(vertices), amUniquePtr<u16>(geometryIndices), totalVertexCount, totalIndexCount };
+		packedGeometry.BoundingBox = sceneGeometry->GetAABB();
+
+		if (optimize)
+			optimizeMesh(packedGeometry.Mesh);
 	}
 	else
 	{
@@ -740,24 +767,63 @@ rageam::List<rageam::asset::DrawableAsset::SplittedGeometry> rageam::asset::Draw
 		auto splitVertices = graphics::MeshSplitter::Split(
 			sceneVertexBuffer.GetBuffer(), decl.Stride, (u32*)indices.Buffer, totalIndexCount);
 
-		for (const graphics::MeshChunk& chunk : splitVertices)
+		packedGeometries.Reserve(splitVertices.GetSize());
+		for (graphics::MeshChunk& chunk : splitVertices)
 		{
+			if (optimize)
+				optimizeMesh(chunk);
+
 			// Use vertex editor to compute AABB
 			graphics::VertexBufferEditor bufferEditor(decl);
 			bufferEditor.Init(chunk.VertexCount, chunk.Vertices.get());
 
-			rage::spdAABB chunkBound;
-			bufferEditor.ComputeMinMax_Position(chunkBound.Min, chunkBound.Max);
-
-			addGeometry(chunk.Vertices.get(), chunk.Indices.get(), chunk.VertexCount, chunk.IndexCount, chunkBound);
+			PackedGeometry& packedGeometry = packedGeometries.Construct();
+			bufferEditor.ComputeMinMax_Position(packedGeometry.BoundingBox.Min, packedGeometry.BoundingBox.Max);
+			packedGeometry.Mesh = std::move(chunk);
 		}
 	}
 
+	return packedGeometries;
+}
+
+rageam::List<rageam::asset::DrawableAsset::SplittedGeometry> rageam::asset::DrawableAsset::ConvertSceneGeometry(
+	const graphics::SceneGeometry* sceneGeometry, bool skinned, const List<PackedGeometry>& packedGeometries) const
+{
+	List<SplittedGeometry> geometries;
+	geometries.Reserve(packedGeometries.GetSize());
+
+	const MaterialTune& material = *m_DrawableTune.Materials.Get(sceneGeometry->GetMaterialIndex());
+	const EffectInfo& effectInfo = m_EffectCache.GetAt(Hash(material.Effect));
+	const graphics::VertexDeclaration& decl = skinned ? effectInfo.VertexDeclSkin : effectInfo.VertexDecl;
+
+	for (const PackedGeometry& packedGeometry : packedGeometries)
+	{
+		const graphics::MeshChunk& mesh = packedGeometry.Mesh;
+
+		// Create geometry & set vertex data
+		rage::grmVertexData vertexData;
+		vertexData.Vertices = mesh.Vertices.get();
+		vertexData.Indices = mesh.Indices.get();
+		vertexData.VertexCount = mesh.VertexCount;
+		vertexData.IndexCount = mesh.IndexCount;
+		vertexData.Info = decl.GrcInfo;
+
+		rage::pgUPtr grmGeometry = new rage::grmGeometryQB();
+		grmGeometry->SetVertexData(vertexData);
+
+		// Add resulting geometry in the list
+		SplittedGeometry splittedGeometry;
+		splittedGeometry.GrmGeometry = std::move(grmGeometry);
+		splittedGeometry.BoundingBox = packedGeometry.BoundingBox;
+		geometries.Emplace(std::move(splittedGeometry));
+	}
+
 	return geometries;
 }
 
 rage::pgUPtr<rage::grmModel> rageam::asset::DrawableAsset::ConvertSceneModel(const graphics::SceneNode* sceneNode)
 {
+	AM_TRACE_SCOPE_DETAIL("DrawableAsset::ConvertSceneModel", sceneNode->GetName());
 	ReportProgress(String::FormatTemp(L"Converting model '%hs'", sceneNode->GetName()), 0.2);
 
 	AM_ASSERT(sceneNode->HasMesh(), "DrawableAsset::ConvertSceneModel() -> Given node has no mesh!");
@@ -770,14 +836,52 @@ rage::pgUPtr<rage::grmModel> rageam::asset::DrawableAsset::ConvertSceneModel(con
 	AM_DEBUGF("DrawableAsset() -> Converting '%s' into grmModel, '%u' initial geometries to split",
 		sceneNode->GetName(), sceneMesh->GetGeometriesCount());
 
+	// Geometries are independent, pack (split & optimize) them in parallel
+	u32 geometryCount = sceneMesh->GetGeometriesCount();
+	amUniquePtr<amPtr<List<PackedGeometry>>[]> packedGeometries = std::make_unique<amPtr<List<PackedGeometry>>[]>(geometryCount);
+	amUniquePtr<Hash128[]> packKeys = std::make_unique<Hash128[]>(geometryCount);
+	std::atomic_uint reusedGeometryCount = 0;
+	BackgroundWorker::ParallelFor(geometryCount, [&](u32 index)
+		{
+			const graphics::SceneGeometry* sceneGeometry = sceneMesh->GetGeometry(index);
+
+			// Geometry content is the same as in previous compile, no need to pack it again
+			if (m_NewCompileCache)
+			{
+				packKeys[index] = ComputeGeometryPackKey(sceneGeometry, hasSkin);
+				CachedGeometry* cachedGeometry = ReuseCache->Geometries.TryGetAt(packKeys[index].Fold32());
+				if (cachedGeometry && cachedGeometry->Key == packKeys[index])
+				{
+					packedGeometries[index] = cachedGeometry->Packed;
+					++reusedGeometryCount;
+					return;
+				}
+			}
+
+			packedGeometries[index] = std::make_shared<List<PackedGeometry>>(PackSceneGeometry(sceneGeometry, hasSkin));
+		});
+
+	if (m_NewCompileCache)
+	{
+		for (u32 i = 0; i < geometryCount; i++)
+		{
+			// Different geometry in the same bucket is simply not cached
+			if (!m_NewCompileCache->Geometries.ContainsAt(packKeys[i].Fold32()))
+				m_NewCompileCache->Geometries.InsertAt(packKeys[i].Fold32(), CachedGeometry{ packKeys[i], packedGeometries[i] });
+		}
+
+		AM_DEBUGF("DrawableAsset() -> Reused %u of %u geometries of '%s' from previous compile",
+			reusedGeometryCount.load(), geometryCount, sceneNode->GetName());
+	}
+
 	// Convert every scene geometry to grmGeometry and add them to grmModel geometries array
 	u32 geometryIndex = 0; // For setting material
-	for (u32 i = 0; i < sceneMesh->GetGeometriesCount(); i++)
+	for (u32 i = 0; i < geometryCount; i++)
 	{
 		const graphics::SceneGeometry* sceneGeometry = sceneMesh->GetGeometry(i);
 
 		// If scene geometry was pretty high poly then it'll be split on many chunks that fit in 16 bit index buffer
-		for (SplittedGeometry& splittedGeometry : ConvertSceneGeometry(sceneGeometry, hasSkin))
+		for (SplittedGeometry& splittedGeometry : ConvertSceneGeometry(sceneGeometry, hasSkin, *packedGeometries[i]))
 		{
 			u16 materialIndex = sceneGeometry->GetMaterialIndex();
 
@@ -793,6 +897,104 @@ rage::pgUPtr<rage::grmModel> rageam::asset::DrawableAsset::ConvertSceneModel(con
 	return grmModel;
 }
 
+rageam::Hash128 rageam::asset::DrawableAsset::ComputeGeometryContentHash(const graphics::SceneGeometry* sceneGeometry) const
+{
+	u32 vertexCount = sceneGeometry->GetVertexCount();
+	u32 indexCount = sceneGeometry->GetIndexCount();
+
+	graphics::SceneData data;
+	sceneGeometry->GetIndices(data);
+	DataHasher hasher;
+	hasher.Add(data.Buffer, indexCount * graphics::DXGI::BitsPerPixel(data.Format) / 8);
+
+	// Scene formats provide different sets of attributes, missing ones are skipped
+	auto hashAttribute = [&](graphics::VertexSemantic semantic, u32 semanticIndex)
+		{
+			if (!sceneGeometry->GetAttribute(data, semantic, semanticIndex))
+				return;
+
+			u32 attributeKey = semantic << 8 | semanticIndex;
+			hasher.AddValue(attributeKey);
+			hasher.Add(data.Buffer, vertexCount * graphics::DXGI::BitsPerPixel(data.Format) / 8);
+		};
+
+	hashAttribute(graphics::POSITION, 0);
+	hashAttribute(graphics::NORMAL, 0);
+	hashAttribute(graphics::BLENDWEIGHT, 0);
+	hashAttribute(graphics::BLENDINDICES, 0);
+	for (u32 i = 0; i < rage::TEXCOORD_MAX; i++) hashAttribute(graphics::TEXCOORD, i);
+	for (u32 i = 0; i < rage::TANGENT_MAX; i++) hashAttribute(graphics::TANGENT, i);
+	for (u32 i = 0; i < rage::COLOR_MAX; i++) hashAttribute(graphics::COLOR, i);
+
+	return hasher.Get128();
+}
+
+rageam::Hash128 rageam::asset::DrawableAsset::ComputeGeometryPackKey(const graphics::SceneGeometry* sceneGeometry, bool skinned) const
+{
+	const MaterialTune& material = *m_DrawableTune.Materials.Get(sceneGeometry->GetMaterialIndex());
+
+	DataHasher hasher;
+	hasher.AddValue(ComputeGeometryContentHash(sceneGeometry));
+	// Vertex declaration is defined by effect
+	ConstString effectName = material.Effect;
+	hasher.Add(effectName, strlen(effectName) + 1);
+
+	u32 flags = (skinned ? 1 << 0 : 0) | (m_DrawableTune.OptimizeMeshes ? 1 << 1 : 0);
+	hasher.AddValue(flags);
+
+	// Blend indices are remapped to generated skeleton, which may change without touching geometry
+	if (skinned)
+	{
+		amUniquePtr<rage::Vector4[]> remappedBlendIndices = RemapBlendIndices(sceneGeometry);
+		hasher.Add(remappedBlendIndices.get(), sizeof(rage::Vector4) * sceneGeometry->GetVertexCount());
+	}
+
+	return hasher.Get128();
+}
+
+rageam::Hash128 rageam::asset::DrawableAsset::ComputeNodeBoundsKey(const graphics::SceneNode* sceneNode, bool isBvhRoot) const
+{
+	DataHasher hasher;
+	hasher.AddValue(isBvhRoot);
+
+	auto hashMeshNode = [&](const graphics::SceneNode* meshNode)
+		{
+			ConstString nodeName = meshNode->GetName();
+			hasher.Add(nodeName, strlen(nodeName) + 1);
+
+			graphics::SceneMesh* mesh = meshNode->GetMesh();
+			for (u16 i = 0; i < mesh->GetGeometriesCount(); i++)
+			{
+				graphics::SceneGeometry* geometry = mesh->GetGeometry(i);
+				const auto& materialTune = m_DrawableTune.Materials.Get(geometry->GetMaterialIndex());
+
+				hasher.AddValue(ComputeGeometryContentHash(geometry));
+				hasher.AddValue(materialTune->PhysicalMaterialId);
+			}
+		};
+
+	if (!isBvhRoot)
+	{
+		if (sceneNode->HasMesh())
+			hashMeshNode(sceneNode);
+		return hasher.Get128();
+	}
+
+	// BVH primitives are transformed relative to the root, see CreateBvhFromNode
+	rage::Mat44V bvhWorldInverse = sceneNode->GetWorldTransform().Inverse();
+	for (graphics::SceneNode* childNode : sceneNode->GetAllChildrenRecurse())
+	{
+		if (!childNode->HasMesh())
+			continue;
+
+		rage::Mat44V transform = childNode->GetWorldTransform() * bvhWorldInverse;
+		hasher.AddValue(transform);
+		hashMeshNode(childNode);
+	}
+
+	return hasher.Get128();
+}
+
 amUniquePtr<rage::Vector4[]> rageam::asset::DrawableAsset::RemapBlendIndices(const graphics::SceneGeometry* sceneGeometry) const
 {
 	struct IndicesU32 { u8 X, Y, Z, W; };
@@ -1318,7 +1520,8 @@ rageam::List<rageam::graphics::Primitive> rageam::asset::DrawableAsset::GetPrimi
 	return primitives;
 }
 
-rageam::List<rageam::asset::DrawableAsset::CreatedBoundInfo> rageam::asset::DrawableAsset::CreateBoundsFromNode(int boundIndex, graphics::SceneNode* node) const
+rageam::List<rageam::asset::DrawableAsset::CreatedBoundInfo> rageam::asset::DrawableAsset::CreateBoundsFromNode(
+	graphics::SceneNode* node, List<BoundMaterialLink>& outMaterialLinks) const
 {
 	List<CreatedBoundInfo> bounds;
 	for (graphics::Primitive& primitive : GetPrimitivesFromNode(node))
@@ -1354,16 +1557,13 @@ rageam::List<rageam::asset::DrawableAsset::CreatedBoundInfo> rageam::asset::Draw
 
 		if (newBound)
 		{
-			int newBoundIndex = boundIndex + bounds.GetSize();
-
 			// Set material
 			// At the moment all meshes are split by materials, so we don't need more than 1 material on geometry bound
-			int sceneMaterialIndex = primitive.Geometry->GetMaterialIndex();
+			u16 sceneMaterialIndex = primitive.Geometry->GetMaterialIndex();
 			const auto& materialTune = m_DrawableTune.Materials.Get(sceneMaterialIndex);
 			newBound->SetMaterial(materialTune->PhysicalMaterialId);
 			// Link material to bound
-			CompiledDrawableMap->SceneMaterialToBounds[sceneMaterialIndex].Add(
-				DrawableAssetMap::BoundMaterialHandle(newBoundIndex, 0));
+			outMaterialLinks.Add({ sceneMaterialIndex, static_cast<u16>(bounds.GetSize()), 0 });
 
 			CreatedBoundInfo createdBound;
 			createdBound.Node = node;
@@ -1375,7 +1575,8 @@ rageam::List<rageam::asset::DrawableAsset::CreatedBoundInfo> rageam::asset::Draw
 	return bounds;
 }
 
-rageam::asset::DrawableAsset::CreatedBoundInfo rageam::asset::DrawableAsset::CreateBvhFromNode(int boundIndex, graphics::SceneNode* node) const
+rageam::asset::DrawableAsset::CreatedBoundInfo rageam::asset::DrawableAsset::CreateBvhFromNode(
+	graphics::SceneNode* node, List<BoundMaterialLink>& outMaterialLinks) const
 {
 	struct GroupedMaterial
 	{
@@ -1509,8 +1710,7 @@ rageam::asset::DrawableAsset::CreatedBoundInfo rageam::asset::DrawableAsset::Cre
 			bvh->SetMaterial(materialTune->PhysicalMaterialId, currentMaterialIndex);
 			bvh->SetPolygonMaterialIndex(primitiveIndex, currentMaterialIndex);
 			// Link material to bound
-			CompiledDrawableMap->SceneMaterialToBounds[groupedMaterial->SceneMaterialIndex].Add(
-				DrawableAssetMap::BoundMaterialHandle(boundIndex, currentMaterialIndex));
+			outMaterialLinks.Add({ groupedMaterial->SceneMaterialIndex, 0, currentMaterialIndex });
 		}
 		currentMaterialIndex++;
 	}
@@ -1575,6 +1775,47 @@ bool rageam::asset::DrawableAsset::IsBvhIdentifierNode(const graphics::SceneNode
 	return nodeName.EndsWith(COL_BVH_EXT, true);
 }
 
+rageam::asset::DrawableAsset::CachedNodeBounds rageam::asset::DrawableAsset::CreateOrReuseNodeBounds(graphics::SceneNode* node, ColType colType) const
+{
+	bool isBvhRoot = colType == ColBvhRoot;
+
+	// Bounds are immutable once created and ref counted, so unchanged ones can be shared with previous drawable
+	Hash128 cacheKey = {};
+	if (m_NewCompileCache)
+	{
+		cacheKey = ComputeNodeBoundsKey(node, isBvhRoot);
+		CachedNodeBounds* cachedBounds = ReuseCache->Bounds.TryGetAt(cacheKey.Fold32());
+		if (cachedBounds && cachedBounds->Key == cacheKey)
+		{
+			if (!m_NewCompileCache->Bounds.ContainsAt(cacheKey.Fold32()))
+				m_NewCompileCache->Bounds.InsertAt(cacheKey.Fold32(), *cachedBounds);
+			return *cachedBounds;
+		}
+	}
+
+	CachedNodeBounds nodeBounds;
+	nodeBounds.Key = cacheKey;
+
+	// BVH collider doesn't hold bounds as separate entities, it uses primitives instead
+	// Because of this we have to handle construction differently from composite
+	if (isBvhRoot)
+	{
+		CreatedBoundInfo createdBvh = CreateBvhFromNode(node, nodeBounds.MaterialLinks);
+		if (createdBvh.Bound)
+			nodeBounds.Bounds.Emplace(std::move(createdBvh));
+	}
+	else
+	{
+		nodeBounds.Bounds = CreateBoundsFromNode(node, nodeBounds.MaterialLinks);
+	}
+
+	// Different node in the same bucket is simply not cached
+	if (m_NewCompileCache && !m_NewCompileCache->Bounds.ContainsAt(cacheKey.Fold32()))
+		m_NewCompileCache->Bounds.InsertAt(cacheKey.Fold32(), nodeBounds);
+
+	return nodeBounds;
+}
+
 void rageam::asset::DrawableAsset::CreateBound() const
 {
 	// TODO:
@@ -1595,23 +1836,17 @@ void rageam::asset::DrawableAsset::CreateBound() const
 
 		int newBoundIndex = static_cast<int>(createdBounds.GetSize());
 
-		// Regular collision will be later added to a composite
-		if (colType == ColRegular)
+		// Regular collision will be later added to a composite, BVH root is added as single bound
+		CachedNodeBounds nodeBounds = CreateOrReuseNodeBounds(node, colType);
+		for (BoundMaterialLink& link : nodeBounds.MaterialLinks)
 		{
-			List<CreatedBoundInfo> createdNodeBounds = CreateBoundsFromNode(newBoundIndex, node);
-			for (CreatedBoundInfo& createdNodeBound : createdNodeBounds)
-				createdBounds.Emplace(std::move(createdNodeBound));
-			continue;
+			CompiledDrawableMap->SceneMaterialToBounds[link.SceneMaterialIndex].Add(
+				DrawableAssetMap::BoundMaterialHandle(newBoundIndex + link.BoundOffset, link.MaterialIndex));
 		}
-
-		// BVH collider doesn't hold bounds as separate entities, it uses primitives instead
-		// Because of this we have to handle construction differently from composite
-		if (colType == ColBvhRoot)
+		for (CreatedBoundInfo& createdNodeBound : nodeBounds.Bounds)
 		{
-			CreatedBoundInfo createdBvh = CreateBvhFromNode(newBoundIndex, node);
-			if (createdBvh.Bound)
-				createdBounds.Emplace(std::move(createdBvh));
-			continue;
+			createdNodeBound.Node = node;
+			createdBounds.Emplace(std::move(createdNodeBound));
 		}
 	}
 
@@ -1844,25 +2079,37 @@ bool rageam::asset::DrawableAsset::ValidateScene() const
 bool rageam::asset::DrawableAsset::TryCompileToGame()
 {
 	ReportProgress(L"Validating scene", 0.0);
-	if (!ValidateScene())
-		return false;
+	{
+		AM_TRACE_SCOPE("DrawableAsset::ValidateScene");
+		if (!ValidateScene())
+			return false;
+	}
 
 	ReportProgress(L"Compiling embed dictionary", 0.0);
-	if (!CompileAndSetEmbedDict())
 	{
-		AM_ERRF("DrawableAsset::TryCompileToGame() -> Conversion canceled, failed to convert embed dictionary.");
-		return false;
+		AM_TRACE_SCOPE("DrawableAsset::CompileAndSetEmbedDict");
+		if (!CompileAndSetEmbedDict())
+		{
+			AM_ERRF("DrawableAsset::TryCompileToGame() -> Conversion canceled, failed to convert embed dictionary.");
+			return false;
+		}
 	}
 
 	// We must generate skeleton first because we'll have to remap skinning blend indices
 	AM_DEBUGF("DrawableAsset() -> Creating skeleton");
 	ReportProgress(L"Creating skeleton", 0.1);
-	if (!GenerateSkeleton())
-		return false;
+	{
+		AM_TRACE_SCOPE("DrawableAsset::GenerateSkeleton");
+		if (!GenerateSkeleton())
+			return false;
+	}
 
 	AM_DEBUGF("DrawableAsset() -> Setting up lod models");
 	ReportProgress(L"Creating LODs", 0.2);
-	SetupLodModels();
+	{
+		AM_TRACE_SCOPE("DrawableAsset::SetupLodModels");
+		SetupLodModels();
+	}
 
 	// First lod must have at least one model! That's requirement of the game because it accesses it on creating entity
 	if (!m_Drawable->GetLodGroup().GetLod(0)->GetModels().Any())
@@ -1873,26 +2120,42 @@ bool rageam::asset::DrawableAsset::TryCompileToGame()
 
 	AM_DEBUGF("DrawableAsset() -> Linking models to skeleton");
 	ReportProgress(L"Linking models to skeleton", 0.3);
-	LinkModelsToSkeleton();
+	{
+		AM_TRACE_SCOPE("DrawableAsset::LinkModelsToSkeleton");
+		LinkModelsToSkeleton();
+	}
 
 	AM_DEBUGF("DrawableAsset() -> Creating materials");
 	ReportProgress(L"Generating materials", 0.4);
-	if (!CreateMaterials())
-		return false;
+	{
+		AM_TRACE_SCOPE("DrawableAsset::CreateMaterials");
+		if (!CreateMaterials())
+			return false;
+	}
 
 	AM_DEBUGF("DrawableAsset() -> Creating collision bounds");
 	ReportProgress(L"Creating collision bounds", 0.5);
-	CreateBound();
+	{
+		AM_TRACE_SCOPE("DrawableAsset::CreateBound");
+		CreateBound();
+	}
 
 	AM_DEBUGF("DrawableAsset() -> Creating lights");
 	ReportProgress(L"Creating lights", 0.6);
-	CreateLights();
+	{
+		AM_TRACE_SCOPE("DrawableAsset::CreateLights");
+		CreateLights();
+	}
 
 	AM_DEBUGF("DrawableAsset() -> Posing bounds from scene");
 	ReportProgress(L"Posing bound", 0.7);
-	PoseModelBoundsFromScene();
+	{
+		AM_TRACE_SCOPE("DrawableAsset::PoseModelBoundsFromScene");
+		PoseModelBoundsFromScene();
+	}
 
 	ReportProgress(L"Calculating lod extents", 0.8);
+	AM_TRACE_SCOPE("DrawableAsset::Finalize");
 	CalculateLodExtents();
 
 	m_Drawable->GetLodGroup().ComputeBucketMask(m_Drawable->GetShaderGroup());
@@ -2030,6 +2293,7 @@ bool rageam::asset::DrawableAsset::CompileToGame(gtaDrawable* ppOutGameFormat)
 	u64 sceneModifyTime = GetFileModifyTime(scenePath);
 	if (!m_Scene || sceneModifyTime != m_SceneFileTime)
 	{
+		AM_TRACE_SCOPE_DETAIL("DrawableAsset::LoadScene", scenePath.GetCStr());
 		m_SceneFileTime = sceneModifyTime;
 		m_Scene = graphics::SceneFactory::LoadFrom(scenePath);
 		if (!m_Scene)
@@ -2041,8 +2305,14 @@ bool rageam::asset::DrawableAsset::CompileToGame(gtaDrawable* ppOutGameFormat)
 
 	m_Drawable = ppOutGameFormat;
 	ReportProgress(L"Preparing assets", 0.0);
-	PrepareForConversion();
+	{
+		AM_TRACE_SCOPE("DrawableAsset::PrepareForConversion");
+		PrepareForConversion();
+	}
 	bool result = TryCompileToGame();
+	// Parts that were not used in this compile are dropped from cache
+	if (result && m_NewCompileCache)
+		ReuseCache = m_NewCompileCache;
 	ReportProgress(L"Cleaning up", 0.99);
 	CleanUpConversion();
 	m_Drawable = nullptr;
@@ -2125,6 +2395,42 @@ void rageam::asset::DrawableAsset::RefreshTunesFromScene()
 	m_DrawableTune.Lods.Models.Refresh(m_Scene.get());
 }
 
+u64 rageam::asset::DrawableAsset::ComputeHashKey()
+{
+	// Same as in CompileToGame, picks up new scene materials and textures
+	Refresh();
+
+	if (String::IsNullOrEmpty(m_DrawableTune.SceneFileName))
+		return 0;
+
+	AssetHashBuilder builder;
+	builder.AddXml(*this, "Drawable");
+	if (!builder.AddFile(GetScenePath()))
+		return 0;
+
+	auto addDictKey = [&builder](const TxdAssetPtr& txd)
+		{
+			u64 txdKey = txd->ComputeHashKey();
+			builder.AddValue(txdKey);
+			return txdKey != 0;
+		};
+
+	if (m_EmbedDictTune && !addDictKey(m_EmbedDictTune))
+		return 0;
+
+	// Textures that are not in embed dictionary are resolved from workspace
+	if (WorkspaceTXD)
+	{
+		for (u16 i = 0; i < WorkspaceTXD->GetTexDictCount(); i++)
+		{
+			if (!addDictKey(WorkspaceTXD->GetTexDict(i)))
+				return 0;
+		}
+	}
+
+	return builder.Get();
+}
+
 void rageam::asset::DrawableAsset::Serialize(XmlHandle& node) const
 {
 	m_DrawableTune.Serialize(node);
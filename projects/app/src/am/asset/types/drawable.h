@@ -15,6 +15,7 @@
 #include "game/drawable.h"
 #include "am/types.h"
 #include "am/graphics/geomprimitives.h"
+#include "am/graphics/meshsplitter.h"
 
 #include <any>
 
@@ -292,6 +293,7 @@ namespace rageam::asset
 		LightTuneGroup    Lights;
 		LodGroupTune      Lods;
 		bool			  DefaultBVH = false; // All collision bounds are placed in BVH, no composite is created
+		bool			  OptimizeMeshes = false; // Reorder triangles and vertices for vertex cache, overdraw and vertex fetch
 
 		DrawableTune() = default;
 		DrawableTune(const DrawableTune& other) = default;
@@ -358,6 +360,53 @@ namespace rageam::asset
 			rage::spdAABB						BoundingBox;
 		};
 
+		// Vertex data of scene geometry (or its part if it was split) in effect vertex format
+		struct PackedGeometry
+		{
+			graphics::MeshChunk	Mesh;
+			rage::spdAABB		BoundingBox;
+		};
+
+		// Link between scene material and bound material, bound index is relative to the first bound created from the node
+		struct BoundMaterialLink
+		{
+			u16 SceneMaterialIndex;
+			u16 BoundOffset;
+			u16 MaterialIndex;
+		};
+
+		struct CreatedBoundInfo
+		{
+			graphics::SceneNode* Node;
+			graphics::Primitive  Primitive;
+			rage::phBoundPtr     Bound;
+		};
+
+		// Bounds created from single collision node (or BVH root with all its children)
+		struct CachedNodeBounds
+		{
+			Hash128					Key;	// See ComputeNodeBoundsKey
+			List<CreatedBoundInfo>	Bounds;
+			List<BoundMaterialLink>	MaterialLinks;
+		};
+
+	public:
+		struct CachedGeometry
+		{
+			Hash128							Key;	// See ComputeGeometryPackKey
+			amPtr<List<PackedGeometry>>		Packed;
+		};
+
+		// Results of expensive conversion steps keyed by content hash of their inputs, see ReuseCache
+		// Sets are bucketed by 32 bit fold of the key, entry is only reused if full key matches
+		struct CompileCache
+		{
+			HashSet<CachedGeometry>		Geometries;
+			HashSet<CachedNodeBounds>	Bounds;
+		};
+		using CompileCachePtr = amPtr<CompileCache>;
+
+	private:
 		struct EffectInfo
 		{
 			rage::grcEffect*			Effect;
@@ -383,6 +432,8 @@ namespace rageam::asset
 		// Key is SceneNode index
 		List<rage::grmModel*>		m_NodeToModel;
 		List<rage::crBoneData*>		m_NodeToBone;
+		// Built during conversion if ReuseCache is set, replaces it once drawable was compiled successfully
+		CompileCachePtr				m_NewCompileCache;
 
 		// Looks up effect (shader) for every material and caches them in m_EffectCache
 		bool CacheEffects();
@@ -392,14 +443,24 @@ namespace rageam::asset
 		// Performs three things:
 		// - Composes vertex buffer for given vertex declaration
 		// - Splits vertices to satisfy 16 bit index limit
-		// - Creates grmGeometry from processed vertex data
-		List<SplittedGeometry> ConvertSceneGeometry(const graphics::SceneGeometry* sceneGeometry, bool skinned) const;
+		// - Optimizes vertex & index order if enabled in tune
+		// Doesn't create any rage objects, so geometries can be packed in parallel
+		List<PackedGeometry> PackSceneGeometry(const graphics::SceneGeometry* sceneGeometry, bool skinned) const;
+		// Creates grmGeometry from packed vertex data
+		List<SplittedGeometry> ConvertSceneGeometry(const graphics::SceneGeometry* sceneGeometry, bool skinned, const List<PackedGeometry>& packedGeometries) const;
 
 		// - Converts single SceneModel to grmModel
 		// - Links geometries to shader group
 		// - Adds created model to m_SceneToGrmModel
 		rage::pgUPtr<rage::grmModel> ConvertSceneModel(const graphics::SceneNode* sceneNode);
 
+		// Hash of geometry indices and all vertex attributes, used as the base of compile cache keys
+		Hash128 ComputeGeometryContentHash(const graphics::SceneGeometry* sceneGeometry) const;
+		// Key of packed geometry in compile cache, includes everything PackSceneGeometry output depends on
+		Hash128 ComputeGeometryPackKey(const graphics::SceneGeometry* sceneGeometry, bool skinned) const;
+		// Key of node bounds in compile cache, for BVH root children geometries and transforms are included too
+		Hash128 ComputeNodeBoundsKey(const graphics::SceneNode* sceneNode, bool isBvhRoot) const;
+
 		// We have to remap blend indices from scene space to generated skeleton, which can be different
 		// Also note that in rage blend indices are stored in float[4], that's not typo
 		amUniquePtr<rage::Vector4[]> RemapBlendIndices(const graphics::SceneGeometry* sceneGeometry) const;
@@ -431,12 +492,6 @@ namespace rageam::asset
 		void SetMissingTexture(rage::grcInstanceVar* var, ConstString textureName) const;
 		bool CompileAndSetEmbedDict();
 
-		struct CreatedBoundInfo
-		{
-			graphics::SceneNode* Node;
-			graphics::Primitive  Primitive;
-			rage::phBoundPtr     Bound;
-		};
 		enum ColType
 		{
 			ColNone,	// Node is not collision
@@ -449,8 +504,10 @@ namespace rageam::asset
 		// Creates collision bounds from node mesh geometries, geometries are usually split by material
 		// May return empty array if no primitives were created from the node (for example node has no mesh or invalid topology)
 		// Outputs bound of types: phBoundBox, phBoundSphere, phBoundCylinder, phBoundCapsule, phBoundGeometry
-		List<CreatedBoundInfo> CreateBoundsFromNode(int boundIndex, graphics::SceneNode* node) const;
-		CreatedBoundInfo CreateBvhFromNode(int boundIndex, graphics::SceneNode* node) const;
+		List<CreatedBoundInfo> CreateBoundsFromNode(graphics::SceneNode* node, List<BoundMaterialLink>& outMaterialLinks) const;
+		CreatedBoundInfo CreateBvhFromNode(graphics::SceneNode* node, List<BoundMaterialLink>& outMaterialLinks) const;
+		// Looks up bounds of unchanged node in compile cache or creates them
+		CachedNodeBounds CreateOrReuseNodeBounds(graphics::SceneNode* node, ColType colType) const;
 		ColType GetNodeColType(const graphics::SceneNode* sceneNode) const;
 		bool IsColIdentifierNode(const graphics::SceneNode* sceneNode) const;
 		bool IsBvhIdentifierNode(const graphics::SceneNode* sceneNode) const;
@@ -506,6 +563,9 @@ namespace rageam::asset
 
 		eAssetType GetType() const override { return AssetType_Drawable; }
 
+		// Scene file, tune and keys of texture dictionaries materials can resolve textures from
+		u64 ComputeHashKey() override;
+
 		ASSET_IMPLEMENT_ALLOCATE(DrawableAsset);
 
 		// ---------- Asset Related ----------
@@ -528,6 +588,9 @@ namespace rageam::asset
 		amUPtr<DrawableAssetMap> CompiledDrawableMap;
 		// Workspace with shared texture dictionaries loaded, may be NULL
 		WorkspacePtr			 WorkspaceTXD;
+		// Results of the previous compile, if set - geometries and bounds with unchanged content are reused
+		// instead of being rebuilt, and cache is replaced with the one from current compile
+		CompileCachePtr			 ReuseCache;
 		// TXDs with textures that are used by drawable materials (NOT including embed TXD)
 		// NOTE: Destroying asset will destroy those dictionaries and all the textures!
 		DrawableTxdSet			 SharedTXDs;
@@ -1,6 +1,7 @@
 #include "hotdrawable.h"
 
 #include "am/graphics/render.h"
+#include "am/system/trace.h"
 #include "am/system/worker.h"
 #include "rage/grcore/texturepc.h"
 
@@ -401,6 +402,7 @@ void rageam::asset::HotDrawable::HandleChange_Txd(const file::DirectoryChange& c
 
 void rageam::asset::HotDrawable::HandleChange(const file::DirectoryChange& change)
 {
+	AM_TRACE_SCOPE_DETAIL("HotDrawable::HandleChange", change.Path.GetCStr());
 	AM_DEBUGF(L"HotDrawable::HandleChange() -> '%hs' in '%ls' / '%ls'",
 	          Enum::GetName(change.Action), change.Path.GetCStr(), change.NewPath.GetCStr());
 
@@ -500,7 +502,10 @@ void rageam::asset::HotDrawable::UpdateBackgroundJobs()
 			continue;
 
 		// Finish up the task, apply changes...
-		task->UserDelegate();
+		{
+			AM_TRACE_SCOPE("HotDrawable::ApplyTaskResult");
+			task->UserDelegate();
+		}
 
 		// In reversed order, to prevent element shifting on deletion (last -> first)
 		indicesToRemove.Insert(0, i);
@@ -517,6 +522,8 @@ void rageam::asset::HotDrawable::UpdateDrawableCompiling()
 	if (!m_LoadingTask || !m_LoadingTask->IsFinished())
 		return;
 
+	AM_TRACE_SCOPE("HotDrawable::ApplyCompiledDrawable");
+
 	// Will be destroyed on return
 	BackgroundTaskPtr loadingTask = std::move(m_LoadingTask);
 	if (!loadingTask->IsSuccess())
@@ -528,6 +535,7 @@ void rageam::asset::HotDrawable::UpdateDrawableCompiling()
 	m_Asset->SetScene(compileResult->Scene);
 	m_Asset->RefreshTunesFromScene();
 	m_Asset->CompiledDrawableMap = std::move(compileResult->Map);
+	m_CompileCache = std::move(compileResult->CompileCache);
 
 	// Initialize our mega dictionary with textures from embed and workspace dictionaries
 	if (!m_MegaDictionary)
@@ -596,6 +604,8 @@ rageam::asset::HotDrawable::HotDrawable(ConstWString assetPath)
 
 void rageam::asset::HotDrawable::LoadAndCompileAsync(bool keepAsset)
 {
+	AM_TRACE_FUNCTION();
+
 	m_JustRequestedLoad = true;
 
 	// Wait for existing background stuff to finish...
@@ -645,9 +655,14 @@ void rageam::asset::HotDrawable::LoadAndCompileAsync(bool keepAsset)
 	// NOTE: We're copying asset here because fields like CompiledDrawableMap cannot be shared safely
 	// both by update and worker thread at the same time
 	amPtr assetCopy = std::make_shared<DrawableAsset>(*m_Asset);
+	if (!m_CompileCache)
+		m_CompileCache = std::make_shared<DrawableAsset::CompileCache>();
+	assetCopy->ReuseCache = m_CompileCache;
 
 	m_LoadingTask = BackgroundWorker::Run([assetCopy]
 	{
+		AM_TRACE_SCOPE_DETAIL("HotDrawable::CompileDrawable", assetCopy->GetDirectoryPath().GetCStr());
+
 		gtaDrawablePtr drawable = rage::pgCountedPtr(new gtaDrawable());
 
 		bool oldSkipTextures = DrawableAsset::tl_SkipTextures;
@@ -663,7 +678,7 @@ void rageam::asset::HotDrawable::LoadAndCompileAsync(bool keepAsset)
 		}
 
 		amPtr result = std::make_shared<CompileDrawableResult>(
-			std::move(drawable), assetCopy->GetScene(), std::move(assetCopy->CompiledDrawableMap));
+			std::move(drawable), assetCopy->GetScene(), std::move(assetCopy->CompiledDrawableMap), assetCopy->ReuseCache);
 
 		BackgroundWorker::SetCurrentResult(result);
 		return true;
@@ -696,6 +711,8 @@ void rageam::asset::HotDrawable::NotifyTextureWasUnselected(const rage::grcTextu
 
 rageam::asset::HotDrawableInfo rageam::asset::HotDrawable::UpdateAndApplyChanges()
 {
+	AM_TRACE_FUNCTION();
+
 	m_HotFlags = AssetHotFlags_None;
 
 	UpdateBackgroundJobs();
@@ -754,7 +771,7 @@ const rageam::List<rageam::asset::HotDictionary>& rageam::asset::HotDrawable::Ge
 	{
 		m_HotDictsDirty = false;
 
-		Timer timer = Timer::StartNew();
+		AM_TRACE_SCOPE("HotDrawable::RebuildHotDictionaries");
 
 		m_HotDicts.Clear();
 
@@ -815,9 +832,6 @@ const rageam::List<rageam::asset::HotDictionary>& rageam::asset::HotDrawable::Ge
 		}
 		if (orphanDict.Indices.Any())
 			m_HotDicts.Insert(0, orphanDict);
-
-		timer.Stop();
-		AM_DEBUGF("HotDictionary::GetHotTxds() -> Rebuilt map in %llu micros.", timer.GetElapsedMicroseconds());
 	}
 
 	return m_HotDicts;
@@ -66,6 +66,8 @@ namespace rageam::asset
 			// Those are moved from drawable asset copy
 			graphics::ScenePtr        Scene;
 			amUPtr<DrawableAssetMap>  Map;
+			// Geometries and bounds of this compile, reused by the next one
+			DrawableAsset::CompileCachePtr CompileCache;
 		};
 
 		struct TextureInfo
@@ -105,6 +107,8 @@ namespace rageam::asset
 		Tasks							m_AsyncTasks;
 		DrawableAssetPtr				m_Asset;
 		gtaDrawablePtr					m_CompiledDrawable;
+		// Only parts of the scene that were changed since the last compile are rebuilt
+		DrawableAsset::CompileCachePtr	m_CompileCache;
 		AssetHotFlags					m_HotFlags = AssetHotFlags_None;
 		List<file::DirectoryChange>		m_PendingChanges;
 		bool							m_JustRequestedLoad = false;
@@ -115,8 +119,8 @@ namespace rageam::asset
 		// All the extra metadata for the specific texture is stored in separate hashmap m_TextureInfos.
 		// This allows us to lazy load textures after entity was spawned, greatly reducing loading time
 		rage::grcTextureDictionaryPtr			m_MegaDictionary;
-		HashSet<TextureInfo, TextureInfoHashFn>	m_TextureInfos;
-		HashSet<TxdAssetPtr, TxdAssetHashFn>	m_TxdAssetStore;	// Instead of loading TXD asset every time, we cache them here
+		FlatSet<TextureInfo, TextureInfoHashFn>	m_TextureInfos;
+		FlatSet<TxdAssetPtr, TxdAssetHashFn>	m_TxdAssetStore;	// Instead of loading TXD asset every time, we cache them here
 		List<HotDictionary>						m_HotDicts;			// Mapping between TXD and textures in mega dictionary
 		bool									m_HotDictsDirty = false; // Flag indicating that hot dictionaries must be rebuilt on request
 
@@ -2,14 +2,13 @@
 
 #include "am/file/iterator.h"
 #include "am/string/string.h"
+#include "am/system/trace.h"
 #include "am/system/worker.h"
 #include "am/xml/iterator.h"
 #include "rage/grcore/texturepc.h"
 #include "helpers/format.h"
 #include "texpresets.h"
 
-#include <semaphore>
-
 void rageam::asset::TextureOptions::SerializeChanged(const XmlHandle& node, const TextureOptions& options) const
 {
 #define TEX_SET_IF_CHANGED(field) \
@@ -125,75 +124,100 @@ rageam::asset::TxdAsset::TxdAsset(const file::WPath& path) : GameRscAsset(path)
 
 bool rageam::asset::TxdAsset::CompileToGame(rage::grcTextureDictionary* object)
 {
+	AM_TRACE_FUNCTION();
 	ReportProgress(L"Compressing textures", 0);
 
 	rage::grcTextureDictionary& txd = *object;
 
-	std::counting_semaphore<ASSET_TXD_BACKGROUND_THREADS_MAX> sema(ASSET_TXD_BACKGROUND_THREADS_MAX);
-	std::mutex mutex;
-
 	u32 textureCount = m_TextureTunes.GetSize();
-	u32 texturesDoneCount = 0; // For progress reporting
 
-	Tasks tasks;
-	tasks.Reserve(textureCount);
+	// We compress all textures in a single batch, this way block rows of all textures (and all their mip maps)
+	// are encoded together and threads are not left idle on small textures or mip map tails
+	List<ConstWString>				texturePaths;
+	List<file::Path>				textureNames;
+	List<TexturePresetPtr>			texturePresets;
+	graphics::ImageCompressorBatch	batch;
+	texturePaths.Reserve(textureCount);
+	textureNames.Reserve(textureCount);
+	texturePresets.Reserve(textureCount);
+	batch.Reserve(textureCount);
+
+	for (u32 i = 0; i < textureCount; i++)
+	{
+		TextureTune& tune = m_TextureTunes[i];
+
+		// Ensure that texture name is valid before compression, we can't create even missing texture without name
+		file::Path validatedName;
+		if (!GetValidatedTextureName(tune.GetFilePath(), validatedName))
+			return false;
+
+		TexturePresetPtr& usedPreset = texturePresets.Construct();
+		graphics::ImageCompressorBatchItem& item = batch.Construct();
+		item.Options = tune.GetCustomOptionsOrFromPreset(&usedPreset).CompressorOptions;
+		texturePaths.Add(tune.GetFilePath());
+		textureNames.Add(validatedName);
+	}
+
+	// Textures are done out of order, progress is reported as soon as each one is compressed (or loaded from cache)
+	u32 doneCount = 0;
+	auto onTextureDone = [&](u32 index)
+		{
+			doneCount++;
+			if (!CompileCallback)
+				return;
+
+			const graphics::ImageCompressorBatchItem& item = batch[index];
+			TexturePresetPtr& usedPreset = texturePresets[index];
+			ConstString presetName = usedPreset ? usedPreset->Name.GetCStr() : "-";
+			ConstString size = item.Result ? FormatSize(item.Result->ComputeTotalSizeWithMips()) : "missing";
+			double progress = static_cast<double>(doneCount) / textureCount;
+			ConstWString message = String::FormatTemp(L"%u/%u %hs (size: %hs, preset: %hs)",
+				doneCount,
+				textureCount,
+				textureNames[index].GetCStr(),
+				size,
+				presetName);
+			CompileCallback(message, progress);
+		};
 
-	for (u32 i = 0; i < m_TextureTunes.GetSize(); i++)
 	{
-		tasks.Emplace(BackgroundWorker::Run([&, i]
-			{
-				TextureTune& tune = m_TextureTunes[i];
-
-				sema.acquire();
-				TexturePresetPtr usedPreset;
-				rage::grcTexture* gameTexture = CompileSingleTexture(tune, true, &usedPreset);
-				sema.release();
-
-				if (!gameTexture)
-				{
-					if (!UseMissingTexturesInsteadOfFailing)
-						return false;
-
-					file::Path textureName;
-					if (!tune.GetValidatedTextureName(textureName, false))
-						return false;
-
-					gameTexture = CreateMissingTexture(textureName);
-				}
-
-				std::unique_lock lock(mutex);
-
-				// For sanity check, we must ensure that there are no multiple textures with the same name
-				if (txd.Contains(gameTexture->GetName()))
-				{
-					AM_ERRF("TxdAsset::CompileToGame() -> Found 2 textures with the same name ('%s'), this cannot continue.",
-						gameTexture->GetName());
-					return false;
-				}
-
-				// Insert baked texture into dictionary
-				txd.Insert(gameTexture->GetName(), gameTexture);
-
-				// Progress report
-				if (CompileCallback)
-				{
-					ConstString presetName = usedPreset ? usedPreset->Name.GetCStr() : "-";
-					texturesDoneCount++;
-					double progress = static_cast<double>(texturesDoneCount) / textureCount;
-					ConstWString message = String::FormatTemp(L"%i/%u %hs (size: %hs, preset: %hs)",
-						texturesDoneCount,
-						textureCount,
-						gameTexture->GetName(),
-						FormatSize(gameTexture->GetPhysicalSize()),
-						presetName);
-					CompileCallback(message, progress);
-				}
-
-				return true;
-			}));
+		AM_TRACE_SCOPE("TxdAsset::CompressTextures");
+		AM_TRACE_COUNTER("TxdAsset::TextureCount", textureCount);
+		graphics::ImageFactory::LoadFromPathAndCompress(texturePaths, batch, onTextureDone);
 	}
 
-	return BackgroundWorker::WaitFor(tasks);
+	for (u32 i = 0; i < batch.GetSize(); i++)
+	{
+		graphics::ImageCompressorBatchItem& item = batch[i];
+		ConstString textureName = textureNames[i];
+
+		rage::grcTexture* gameTexture;
+		if (item.Result)
+		{
+			gameTexture = CreateGameTexture(textureName, item.Result, item.CompInfo, true);
+		}
+		else
+		{
+			if (!UseMissingTexturesInsteadOfFailing)
+				return false;
+
+			gameTexture = CreateMissingTexture(textureName);
+		}
+
+		// For sanity check, we must ensure that there are no multiple textures with the same name
+		if (txd.Contains(gameTexture->GetName()))
+		{
+			AM_ERRF("TxdAsset::CompileToGame() -> Found 2 textures with the same name ('%s'), this cannot continue.",
+				gameTexture->GetName());
+			delete gameTexture;
+			return false;
+		}
+
+		// Insert baked texture into dictionary
+		txd.Insert(gameTexture->GetName(), gameTexture);
+	}
+
+	return true;
 }
 
 void rageam::asset::TxdAsset::ParseFromGame(rage::grcTextureDictionary* object)
@@ -291,6 +315,22 @@ void rageam::asset::TxdAsset::Deserialize(const XmlHandle& node)
 	}
 }
 
+u64 rageam::asset::TxdAsset::ComputeHashKey()
+{
+	AssetHashBuilder builder;
+	builder.AddValue(m_TextureTunes.GetSize());
+	for (TextureTune& tune : m_TextureTunes)
+	{
+		builder.AddString(tune.GetName());
+		if (!builder.AddFile(tune.GetFilePath()))
+			return 0;
+
+		// Preset is resolved here, changing preset in the workspace affects all textures matching it
+		builder.AddXml(tune.GetCustomOptionsOrFromPreset(), "TextureOptions");
+	}
+	return builder.Get();
+}
+
 rageam::asset::TextureTune& rageam::asset::TxdAsset::AddTune(ConstWString filePath)
 {
 	return m_TextureTunes.Construct(this, filePath);
@@ -337,6 +377,7 @@ rage::grcTexture* rageam::asset::TxdAsset::CompileSingleTexture(TextureTune& tun
 {
 	// Ensure that texture name is valid before compression
 	ConstWString filePath = tune.GetFilePath();
+	AM_TRACE_SCOPE_DETAIL("TxdAsset::CompileSingleTexture", filePath);
 	file::Path validatedName;
 	if (!GetValidatedTextureName(filePath, validatedName))
 		return nullptr;
@@ -349,7 +390,13 @@ rage::grcTexture* rageam::asset::TxdAsset::CompileSingleTexture(TextureTune& tun
 	if (!compressedImage)
 		return nullptr;
 
-	graphics::ImageInfo& imageInfo = encodedInfo.ImageInfo;
+	return CreateGameTexture(validatedName, compressedImage, encodedInfo, storeData);
+}
+
+rage::grcTexture* rageam::asset::TxdAsset::CreateGameTexture(
+	ConstString name, const graphics::ImagePtr& compressedImage, const graphics::CompressedImageInfo& encodedInfo, bool storeData)
+{
+	const graphics::ImageInfo& imageInfo = encodedInfo.ImageInfo;
 	rage::grcTextureDX11* gameTexture = new rage::grcTextureDX11(
 		imageInfo.Width,
 		imageInfo.Height,
@@ -357,7 +404,7 @@ rage::grcTexture* rageam::asset::TxdAsset::CompileSingleTexture(TextureTune& tun
 		ImagePixelFormatToDXGI(imageInfo.PixelFormat),
 		compressedImage->GetPixelDataBytes(),
 		storeData);
-	gameTexture->SetName(validatedName);
+	gameTexture->SetName(name);
 
 	return gameTexture;
 }
@@ -13,9 +13,6 @@
 
 namespace rageam::asset
 {
-	// Maximum num of texture compressing in background in parallel
-	static constexpr int ASSET_TXD_BACKGROUND_THREADS_MAX = 12;
-
 	// Version History:
 	// 0: Initial
 
@@ -74,6 +71,10 @@ namespace rageam::asset
 
 		Textures m_TextureTunes;
 
+		// Creates game texture from compressed image, see CompileSingleTexture
+		static rage::grcTexture* CreateGameTexture(
+			ConstString name, const graphics::ImagePtr& compressedImage, const graphics::CompressedImageInfo& encodedInfo, bool storeData);
+
 	public:
 		TxdAsset(const file::WPath& path);
 
@@ -91,6 +92,9 @@ namespace rageam::asset
 
 		eAssetType GetType() const override { return AssetType_Txd; }
 
+		// Texture file contents and their resolved compression options
+		u64 ComputeHashKey() override;
+
 		ASSET_IMPLEMENT_ALLOCATE(TxdAsset);
 
 		// ---------- Asset Related ----------
@@ -45,10 +45,10 @@ bool rageam::ui::AssetAsyncCompiler::ProcessNewRequest()
 	};
 
 	// Start the background compilation task
-	m_ActiveCompileTask = BackgroundWorker::Run([this]
+	m_ActiveCompileTask = BackgroundWorker::RunWithPriority([this]
 	{
 		return m_ActiveAsset->CompileToFile();
-	}, L"Compile %ls", requestPath.GetCStr());
+	}, TaskPriority_Low, {}, L"Compile %ls", requestPath.GetCStr());
 
 	// Finally, open UI dialog
 	ImGui::OpenPopup(SAVE_POPUP_NAME);
@@ -20,6 +20,8 @@ bool rageam::ui::RenderCompressOptionsControls(graphics::ImageCompressorOptions&
 	ImGui::SliderFloat("Quality", &options.Quality, 0.0f, 1.0f);
 	if (ImGui::IsItemDeactivated())
 		needRecompress = true;
+	ImGui::SameLine();
+	ImGui::HelpMarker(String::FormatTemp("Quality up to %.2f uses fast preview encoder for BC1-BC5.", graphics::IMAGE_BC_PREVIEW_QUALITY));
 	if (qualityAvailable) ImGui::EndDisabled();
 
 	// Compression format
@@ -115,7 +117,7 @@ void rageam::ui::TextureVM::AsyncImage::LoadAsyncCompressed(const file::WPath& p
 {
 	CancelAsyncLoading();
 
-	LoadTask = BackgroundWorker::Run([this, options, path]
+	LoadTask = BackgroundWorker::RunWithPriority([this, options, path]
 		{
 			Timer timer = Timer::StartNew();
 
@@ -148,12 +150,12 @@ void rageam::ui::TextureVM::AsyncImage::LoadAsyncCompressed(const file::WPath& p
 			Mutex.unlock();
 
 			return true;
-		});
+		}, TaskPriority_High);
 }
 
 void rageam::ui::TextureVM::AsyncImage::LoadAsync(const file::WPath& path)
 {
-	LoadTask = BackgroundWorker::Run([this, path]
+	LoadTask = BackgroundWorker::RunWithPriority([this, path]
 		{
 			Timer timer = Timer::StartNew();
 
@@ -187,7 +189,7 @@ void rageam::ui::TextureVM::AsyncImage::LoadAsync(const file::WPath& path)
 			Mutex.unlock();
 
 			return true;
-		});
+		}, TaskPriority_High);
 }
 
 void rageam::ui::TextureVM::AsyncImage::CancelAsyncLoading()
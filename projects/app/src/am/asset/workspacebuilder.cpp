@@ -0,0 +1,211 @@
+#include "workspacebuilder.h"
+
+#include "types/drawable.h"
+#include "types/txd.h"
+#include "am/file/fileutils.h"
+#include "am/file/json.h"
+#include "am/string/string.h"
+#include "am/system/trace.h"
+#include "am/system/worker.h"
+#include "common/logger.h"
+
+#include <chrono>
+#include <mutex>
+
+namespace
+{
+	using BuildClock = std::chrono::steady_clock;
+
+	double SecondsSince(BuildClock::time_point time)
+	{
+		return std::chrono::duration<double>(BuildClock::now() - time).count();
+	}
+}
+
+void rageam::asset::WorkspaceBuilder::CreateNodes(const Workspace& workspace)
+{
+	m_Nodes.Clear();
+
+	// Dictionaries go first, they have no dependencies and unblock drawables
+	u16 tdCount = workspace.GetTexDictCount();
+	for (u16 i = 0; i < tdCount; i++)
+	{
+		BuildNode& node = m_Nodes.Construct();
+		node.Asset = workspace.GetTexDict(i);
+	}
+
+	List<bool> dependsOnTxd;
+	dependsOnTxd.Resize(tdCount);
+	for (u16 i = 0; i < workspace.GetDrawableCount(); i++)
+	{
+		amPtr<DrawableAsset> drawable = workspace.GetDrawable(i);
+		u32 nodeIndex = m_Nodes.GetSize();
+		u32 pendingDependencies = 0;
+
+		// Find dictionaries that ResolveAndSetTexture will take material textures from
+		for (u16 k = 0; k < tdCount; k++)
+			dependsOnTxd[k] = false;
+		MaterialTuneGroup& materials = drawable->GetDrawableTune().Materials;
+		for (u16 m = 0; m < materials.GetCount(); m++)
+		{
+			amPtr<MaterialTune> material = materials.Get(m);
+			for (MaterialTune::Param& param : material->Params)
+			{
+				if (param.Type != MaterialTune::String)
+					continue;
+
+				string textureName = param.GetValue<string>();
+				if (String::IsNullOrEmpty(textureName))
+					continue;
+
+				for (u16 k = 0; k < tdCount; k++)
+				{
+					if (dependsOnTxd[k] || !workspace.GetTexDict(k)->ContainsTextureWithName(textureName))
+						continue;
+
+					dependsOnTxd[k] = true;
+					m_Nodes[k].Dependents.Add(nodeIndex);
+					pendingDependencies++;
+				}
+			}
+		}
+
+		BuildNode& node = m_Nodes.Construct();
+		node.Asset = std::move(drawable);
+		node.PendingDependencies = pendingDependencies;
+	}
+}
+
+rageam::asset::WorkspaceBuilder::WorkspaceBuilder(ConstWString workspacePath, const WorkspaceBuildOptions& options)
+{
+	m_Path = workspacePath;
+	m_Options = options;
+}
+
+bool rageam::asset::WorkspaceBuilder::Build()
+{
+	AM_TRACE_FUNCTION();
+
+	BuildClock::time_point buildStart = BuildClock::now();
+
+	Workspace workspace(m_Path, WF_LoadAll);
+	CreateNodes(workspace);
+
+	u32 nodeCount = m_Nodes.GetSize();
+	m_Results.Clear();
+	m_Results.Resize(nodeCount);
+
+	TaskScheduler* scheduler = BackgroundWorker::GetInstance()->GetScheduler();
+	m_ParallelAssets = m_Options.MaxParallelAssets;
+	if (m_ParallelAssets == 0)
+		m_ParallelAssets = MAX(scheduler->GetThreadCount() / 4, 1u);
+	m_ParallelAssets = MAX(MIN(m_ParallelAssets, nodeCount), 1u);
+
+	AM_TRACEF(L"WorkspaceBuilder::Build() -> Building %u assets in '%ls', %u at a time",
+		nodeCount, m_Path.GetCStr(), m_ParallelAssets);
+
+	std::mutex	mutex;
+	List<u32>	readyNodes;
+	u32			readyHead = 0;
+	u32			runningCount = 0;
+	readyNodes.Reserve(nodeCount);
+	for (u32 i = 0; i < nodeCount; i++)
+	{
+		if (m_Nodes[i].PendingDependencies == 0)
+			readyNodes.Add(i);
+	}
+
+	// Asset tasks are low priority, so workers take textures and geometries of assets that already started first
+	std::function<void(u32)> buildNode;
+	TaskGroup group(scheduler, TaskPriority_Low);
+
+	// Starts ready assets while number of running ones is below the limit, mutex must be locked
+	auto startReadyNodes = [&]
+		{
+			while (runningCount < m_ParallelAssets && readyHead < readyNodes.GetSize())
+			{
+				u32 nodeIndex = readyNodes[readyHead++];
+				runningCount++;
+				group.Run([&buildNode, nodeIndex] { buildNode(nodeIndex); });
+			}
+		};
+
+	buildNode = [&](u32 nodeIndex)
+		{
+			BuildNode& node = m_Nodes[nodeIndex];
+			WorkspaceBuildResult& result = m_Results[nodeIndex];
+			result.Asset = node.Asset;
+			result.WaitTime = SecondsSince(buildStart);
+
+			BuildClock::time_point compileStart = BuildClock::now();
+			node.Asset->UseCompileCache = m_Options.UseCompileCache;
+			node.Asset->CompressionPreset = m_Options.CompressionPreset;
+			node.Asset->OptimizeResourcePacking = m_Options.OptimizeResourcePacking;
+			result.Success = node.Asset->CompileToFile();
+			result.CompileTime = SecondsSince(compileStart);
+
+			if (!result.Success)
+				AM_ERRF(L"WorkspaceBuilder::Build() -> Failed to compile '%ls'", node.Asset->GetDirectoryPath().GetCStr());
+
+			std::unique_lock lock(mutex);
+			runningCount--;
+			for (u32 dependent : node.Dependents)
+			{
+				if (--m_Nodes[dependent].PendingDependencies == 0)
+					readyNodes.Add(dependent);
+			}
+			startReadyNodes();
+		};
+
+	{
+		std::unique_lock lock(mutex);
+		startReadyNodes();
+	}
+	// Dependents are added to the group before the asset that unblocked them finishes, so group is never empty too early
+	group.Wait();
+
+	m_TotalTime = SecondsSince(buildStart);
+
+	bool success = true;
+	for (const WorkspaceBuildResult& result : m_Results)
+		success &= result.Success;
+	return success;
+}
+
+bool rageam::asset::WorkspaceBuilder::WriteReport(ConstWString path) const
+{
+	file::FSHandle handle = file::OpenFileStream(path, L"w");
+	if (!handle)
+	{
+		AM_ERRF(L"WorkspaceBuilder::WriteReport() -> Failed to open '%ls' for writing.", path);
+		return false;
+	}
+	FILE* fs = handle.Get();
+
+	u32 failedCount = 0;
+	for (const WorkspaceBuildResult& result : m_Results)
+	{
+		if (!result.Success)
+			failedCount++;
+	}
+
+	fputs("{\n\t\"workspace\": ", fs);
+	file::WriteJsonString(fs, m_Path);
+	fprintf(fs, ",\n\t\"parallelAssets\": %u,\n\t\"totalTime\": %.3f,\n\t\"succeeded\": %u,\n\t\"failed\": %u,\n\t\"assets\": [",
+		m_ParallelAssets, m_TotalTime, m_Results.GetSize() - failedCount, failedCount);
+
+	for (u32 i = 0; i < m_Results.GetSize(); i++)
+	{
+		const WorkspaceBuildResult& result = m_Results[i];
+		fputs(i == 0 ? "\n\t\t{ \"path\": " : ",\n\t\t{ \"path\": ", fs);
+		file::WriteJsonString(fs, result.Asset->GetDirectoryPath());
+		fprintf(fs, ", \"type\": \"%s\", \"waitTime\": %.3f, \"compileTime\": %.3f, \"success\": %s }",
+			result.Asset->GetType() == AssetType_Txd ? "txd" : "drawable",
+			result.WaitTime, result.CompileTime, result.Success ? "true" : "false");
+	}
+
+	fputs("\n\t]\n}\n", fs);
+
+	AM_TRACEF(L"WorkspaceBuilder::WriteReport() -> Written to '%ls'", path);
+	return true;
+}
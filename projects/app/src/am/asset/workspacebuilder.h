@@ -0,0 +1,71 @@
+//
+// File: workspacebuilder.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "workspace.h"
+#include "am/types.h"
+#include "am/file/path.h"
+
+namespace rageam::asset
+{
+	struct WorkspaceBuildOptions
+	{
+		// How many assets are compiled at the same time, 0 to pick from number of worker threads.
+		// Every asset already compiles in parallel internally (textures, geometries), so this is mostly
+		// to hide I/O and serial parts, while keeping peak memory of in-flight assets bounded
+		u32  MaxParallelAssets = 0;
+		bool UseCompileCache = true;
+		// Applied to every resource asset in workspace
+		rage::pgRscCompressionPreset CompressionPreset = rage::pgRscCompressDefault;
+		bool OptimizeResourcePacking = false;
+	};
+
+	struct WorkspaceBuildResult
+	{
+		AssetPtr Asset;
+		double   WaitTime = 0;		// Time since build start until asset dependencies were compiled, in seconds
+		double   CompileTime = 0;	// In seconds
+		bool     Success = false;
+	};
+
+	/**
+	 * \brief Compiles all texture dictionaries and drawables in workspace without UI.
+	 * \remarks Drawables are scheduled only after dictionaries that their materials resolve textures from are compiled,
+	 * this way textures are encoded once (and shared via ImageCache) instead of drawables encoding the same textures at the same time.
+	 * Assets are compiled as low priority tasks of BackgroundWorker scheduler, the same one that their textures and geometries are processed on.
+	 */
+	class WorkspaceBuilder
+	{
+		struct BuildNode
+		{
+			AssetPtr  Asset;
+			List<u32> Dependents;			// Indices of nodes that wait for this one
+			u32		  PendingDependencies = 0;
+		};
+
+		file::WPath					m_Path;
+		WorkspaceBuildOptions		m_Options;
+		List<BuildNode>				m_Nodes;
+		List<WorkspaceBuildResult>	m_Results;
+		double						m_TotalTime = 0;
+		u32							m_ParallelAssets = 0;
+
+		void CreateNodes(const Workspace& workspace);
+
+	public:
+		WorkspaceBuilder(ConstWString workspacePath, const WorkspaceBuildOptions& options = {});
+
+		// Returns true if all assets were compiled successfully
+		bool Build();
+
+		// Writes timings of the last build as JSON file
+		bool WriteReport(ConstWString path) const;
+
+		const List<WorkspaceBuildResult>& GetResults() const { return m_Results; }
+	};
+}
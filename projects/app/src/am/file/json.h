@@ -0,0 +1,46 @@
+//
+// File: json.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "am/string/string.h"
+#include "common/types.h"
+
+#include <cstdio>
+
+namespace rageam::file
+{
+	// Writes quoted UTF-8 string with JSON escapes, for reports that are written by hand with fprintf
+	inline void WriteJsonString(FILE* fs, ConstString str)
+	{
+		fputc('"', fs);
+		for (ConstString c = str; *c; c++)
+		{
+			switch (*c)
+			{
+			case '"':  fputs("\\\"", fs); break;
+			case '\\': fputs("\\\\", fs); break;
+			case '\n': fputs("\\n", fs); break;
+			case '\r': fputs("\\r", fs); break;
+			case '\t': fputs("\\t", fs); break;
+			default:
+				// Other control characters are not allowed in JSON string either
+				if (static_cast<u8>(*c) < 0x20)
+					fprintf(fs, "\\u%04x", static_cast<u8>(*c));
+				else
+					fputc(*c, fs);
+				break;
+			}
+		}
+		fputc('"', fs);
+	}
+
+	inline void WriteJsonString(FILE* fs, ConstWString str)
+	{
+		WriteJsonString(fs, String::ToUtf8Temp(str));
+	}
+}
@@ -4,6 +4,8 @@
 #include "am/integration/im3d.h"
 #include "am/ui/extensions.h"
 
+#include <easy/profiler.h>
+
 GIZMO_INITIALIZE_INFO(rageam::gizmo::GizmoRotation, "Rotation");
 
 void rageam::gizmo::GizmoRotation::Draw(const GizmoContext& context)
@@ -1,19 +1,21 @@
 #include "bc.h"
+#include "bcdecoder.h"
+#include "bcrangefit.h"
 
 #include "am/system/enum.h"
 #include "am/file/fileutils.h"
 #include "am/xml/doc.h"
 #include "am/xml/serialize.h"
+#include "am/system/trace.h"
 #include "am/system/worker.h"
+#include "helpers/align.h"
 #include "rage/math/math.h"
 #include "imagecache.h"
 
 #include <rgbcx.h>
 #include <icbc.h>
 #include <bc7decomp.h>
-#include <easy/profiler.h>
-
-rageam::BackgroundWorker* rageam::graphics::ImageCompressor::sm_RegionWorker = nullptr;
+#include <thread>
 
 rageam::graphics::BlockFormat rageam::graphics::ImagePixelFormatToBlockFormat(ImagePixelFormat fmt)
 {
@@ -50,36 +52,46 @@ rageam::graphics::PixelDataOwner rageam::graphics::ImageDecodeBCToRGBA(const Pix
 	PixelDataOwner decodedDataOwner = PixelDataOwner::AllocateForImage(mipWidth, mipHeight, ImagePixelFormat_U32);
 	char* decodedPixels = decodedDataOwner.Data()->Bytes;
 
-	for (int blockY = 0; blockY < blocksY; blockY++)
-	{
-		int y = blockY * 4;
-		for (int blockX = 0; blockX < blocksX; blockX++)
-		{
-			int x = blockX * 4;
-
-			// Decode 4x4 pixels block
-			char decodedBlock[IMAGE_BC_BLOCK_SLICE_PITCH];
-			char* encodedBlock = mipBytes + static_cast<size_t>(blockY * encodedRowPitch + blockX * blockWidth);
-			ImageCompressor::DecompressBlock(encodedBlock, decodedBlock, format);
+	if (blocksX == 0 || blocksY == 0)
+		return decodedDataOwner;
 
-			// Copy it line by line to the decoded pixel array
-			char* dstRow = decodedPixels + static_cast<size_t>(decodedRowPitch) * y + IMAGE_RGBA_PITCH * x;
-			for (int i = 0; i < 4; i++)
+	// Large mips are split on block row ranges and decoded in parallel
+	int rowsPerJob = std::clamp(static_cast<int>(IMAGE_BC_JOB_MIN_BLOCKS) / blocksX, 1, blocksY);
+	int jobCount = (blocksY + rowsPerJob - 1) / rowsPerJob;
+	ImageCompressor::ParallelFor(jobCount, [&](int jobIndex)
+		{
+			int blockRowStart = jobIndex * rowsPerJob;
+			int blockRowEnd = MIN(blockRowStart + rowsPerJob, blocksY);
+			for (int blockY = blockRowStart; blockY < blockRowEnd; blockY++)
 			{
-				char* srcRow = decodedBlock + i * IMAGE_BC_BLOCK_ROW_PITCH;
-
-				memcpy(dstRow, srcRow, IMAGE_RGBA_PITCH * 4);
-
-				dstRow += decodedRowPitch;
+				const char* encodedRow = mipBytes + static_cast<size_t>(blockY) * encodedRowPitch;
+				char* decodedRow = decodedPixels + static_cast<size_t>(blockY) * 4 * decodedRowPitch;
+				BCDecodeBlockRow(format, blocksX, encodedRow, decodedRow, decodedRowPitch);
 			}
-		}
-	}
+		});
 
 	return decodedDataOwner;
 }
 
 void rageam::graphics::ImageCompressor::CompressBlocks(const EncoderState& encoderState, int numBlocks, char* dstBlocks, char* srcBlocks)
 {
+	// Range fit encodes whole block group at once
+	if (encoderState.EncoderImpl == BlockCompressorImpl::rangefit)
+	{
+		RangeFitQuality quality = RangeFitQuality(encoderState.EncodeInfo.EncoderData_rangefit.Quality);
+		switch (encoderState.DstPixelFormat)
+		{
+		case ImagePixelFormat_BC1: BCRangeFitEncodeBC1(numBlocks, dstBlocks, srcBlocks, quality); break;
+		case ImagePixelFormat_BC2: BCRangeFitEncodeBC2(numBlocks, dstBlocks, srcBlocks, quality); break;
+		case ImagePixelFormat_BC3: BCRangeFitEncodeBC3(numBlocks, dstBlocks, srcBlocks, quality); break;
+		case ImagePixelFormat_BC4: BCRangeFitEncodeBC4(numBlocks, dstBlocks, srcBlocks, quality); break;
+		case ImagePixelFormat_BC5: BCRangeFitEncodeBC5(numBlocks, dstBlocks, srcBlocks, quality); break;
+
+		default: break;
+		}
+		return;
+	}
+
 	for (int i = 0; i < numBlocks; i++)
 	{
 		u8* srcBlockU8 = reinterpret_cast<u8*>(srcBlocks);
@@ -164,17 +176,44 @@ void rageam::graphics::ImageCompressor::CompressBlocks(const EncoderState& encod
 	}
 }
 
-void rageam::graphics::ImageCompressor::CompressMipRegion(const EncoderState& encoderState, const Region& region)
+bool rageam::graphics::ImageCompressor::HasStripOperators(const EncoderState& encoderState, const EncoderMip& mip)
+{
+	const CompressedImageInfo& encodeInfo = encoderState.EncodeInfo;
+	return
+		encodeInfo.Brightness != 0 || encodeInfo.Contrast != 0 ||
+		encodeInfo.CutoutAlpha ||
+		(encodeInfo.AlphaTestCoverage && mip.AlphaCoverageScale != 1.0f);
+}
+
+void rageam::graphics::ImageCompressor::ApplyStripOperators(const EncoderState& encoderState, const EncoderMip& mip, char* pixels, int pixelCount)
 {
-	EASY_FUNCTION("");
+	const CompressedImageInfo& encodeInfo = encoderState.EncodeInfo;
 
-	char* srcPixels = region.SrcPixels;
-	char* dstPixels = region.DstPixels;
+	// Operators are per-pixel so we can treat strip as single pixel row
+	if (encodeInfo.Brightness != 0 || encodeInfo.Contrast != 0)
+		ImageAdjustBrightnessAndContrastRGBA(pixels, pixelCount, 1, encodeInfo.Brightness, encodeInfo.Contrast);
 
-	int blockCountX = encoderState.BlockCountX;
-	int regionCount = encoderState.RegionBlocksCount;
+	if (encodeInfo.CutoutAlpha)
+		ImageCutoutAlphaRGBA(pixels, pixelCount, 1, encodeInfo.CutoutAlphaThreshold);
 
-	const CompressedImageInfo& encodeInfo = encoderState.EncodeInfo;
+	// First mip doesn't require alpha scaling, its scale is always 1
+	if (encodeInfo.AlphaTestCoverage && mip.AlphaCoverageScale != 1.0f)
+		ImageScaleAlphaRGBA(pixels, pixelCount, 1, mip.AlphaCoverageScale);
+}
+
+void rageam::graphics::ImageCompressor::CompressJob(const EncoderJob& job)
+{
+	AM_TRACE_FUNCTION();
+
+	const EncoderState& encoderState = *job.State;
+	const EncoderMip&   mip = *job.Mip;
+
+	char* srcPixels = mip.SrcPixels + static_cast<size_t>(job.BlockRowStart) * 4 * mip.SrcRowPitch;
+	char* dstPixels = mip.DstPixels + static_cast<size_t>(job.BlockRowStart) * mip.DstRowPitch;
+
+	int blockCountX = mip.BlockCountX;
+
+	bool needStripOperators = HasStripOperators(encoderState, mip);
 
 	// According to bc7enc_rdo comments, 64 blocks at a time is ideal for efficient SIMD processing
 	// One block is 4x4 pixels, 64 blocks is 256x4 pixels
@@ -182,7 +221,7 @@ void rageam::graphics::ImageCompressor::CompressMipRegion(const EncoderState& en
 
 	alignas(32) char srcBlockGroupBuffer[IMAGE_BC_BLOCK_SLICE_PITCH * BLOCK_GROUP_SIZE];
 
-	for (int blockY = 0; blockY < regionCount; blockY++)
+	for (int blockY = 0; blockY < job.BlockRowCount; blockY++)
 	{
 		char* srcBlockRowPixels = srcPixels;
 
@@ -208,32 +247,8 @@ void rageam::graphics::ImageCompressor::CompressMipRegion(const EncoderState& en
 					// Copy 4 pixels to destination block row
 					memcpy(dstBlockPixels, srcBlockPixels, IMAGE_BC_BLOCK_ROW_PITCH);
 
-					// Apply coverage + cutout alpha on those 4 pixels that we just copied
-					if (encodeInfo.CutoutAlpha || encodeInfo.AlphaTestCoverage)
-					{
-						// It is faster to do this inline than calling ImageCutoutAlpha
-						ColorU32* pixels = reinterpret_cast<ColorU32*>(dstBlockPixels);
-						for (int i = 0; i < 4; i++)
-						{
-							if (encodeInfo.CutoutAlpha)
-							{
-								if (pixels[i].A < static_cast<u8>(encodeInfo.CutoutAlphaThreshold))
-									pixels[i].A = 0;
-								else
-									pixels[i].A = 255;
-							}
-
-							if (encodeInfo.AlphaTestCoverage)
-							{
-								float scaledAlpha = static_cast<float>(pixels[i].A) * encoderState.AlphaCoverageScale;
-								if (scaledAlpha > 255.0f) scaledAlpha = 255.0f;
-								pixels[i].A = static_cast<u8>(scaledAlpha);
-							}
-						}
-					}
-
 					// Shift to next row
-					srcBlockPixels += encoderState.SrcRowPitch;
+					srcBlockPixels += mip.SrcRowPitch;
 					dstBlockPixels += IMAGE_BC_BLOCK_ROW_PITCH;
 				}
 
@@ -241,6 +256,10 @@ void rageam::graphics::ImageCompressor::CompressMipRegion(const EncoderState& en
 				srcBlockRowPixels += IMAGE_BC_BLOCK_ROW_PITCH;
 			}
 
+			// Post-processing is done on block group while it's still in cache, order of pixels doesn't matter here
+			if (needStripOperators)
+				ApplyStripOperators(encoderState, mip, srcBlockGroupBuffer, numBlocks * 16);
+
 			// Finally, compress block group
 			if (encoderState.EncoderImpl == BlockCompressorImpl::bc7enc_rdo &&
 				encoderState.DstPixelFormat == ImagePixelFormat_BC7)
@@ -257,89 +276,75 @@ void rageam::graphics::ImageCompressor::CompressMipRegion(const EncoderState& en
 		}
 
 		// We compressed all 4x4 pixel blocks, move to next block row 4 lines below
-		srcPixels += static_cast<size_t>(4 * encoderState.SrcRowPitch);
-
-		if (encoderState.Token)
-		{
-			std::unique_lock lock(encoderState.Token->Mutex);
-			encoderState.Token->ProcessedBlockLines++;
-		}
+		srcPixels += static_cast<size_t>(4 * mip.SrcRowPitch);
 	}
-}
-
-void rageam::graphics::ImageCompressor::CompressMip(EncoderState& imgEncData)
-{
-	EASY_FUNCTION();
-
-	ImageInfo imgInfo = imgEncData.Image->GetInfo();
 
-	char* srcPixels = imgEncData.Image->GetPixelDataBytes();
-	char* dstPixels = imgEncData.DstPixels;
-
-	int blockCountY = imgEncData.BlockCountY;
-
-	// Small image, process on main thread
-	if (blockCountY < IMAGE_BC_MULTITHREAD_MIN_REGION_SIZE)
+	if (encoderState.Token)
 	{
-		imgEncData.RegionBlocksCount = blockCountY;
-
-		Region& regEncData = imgEncData.Regions[0];
-		regEncData.SrcPixels = srcPixels;
-		regEncData.DstPixels = dstPixels;
-		CompressMipRegion(imgEncData, regEncData);
-		return;
+		std::unique_lock lock(encoderState.Token->Mutex);
+		encoderState.Token->ProcessedBlockLines += job.BlockRowCount;
 	}
+}
 
-	// Compute thread count
-	int regionCount = blockCountY / IMAGE_BC_MULTITHREAD_MIN_REGION_SIZE;
-	regionCount = MIN(regionCount, IMAGE_BC_MULTITHREAD_MAX_REGIONS);
-	int regionBlocksCount = blockCountY / regionCount; // We have to recompute size after clamping count
-	int regionPixelRows = imgInfo.Height / regionCount;
-
-	imgEncData.RegionBlocksCount = regionBlocksCount;
-
-	// Create background task for every region
-	amPtr<BackgroundTask> regionTasks[IMAGE_BC_MULTITHREAD_MAX_REGIONS];
-
-	u32 srcRegionSlicePitch = imgEncData.SrcRowPitch * regionPixelRows;
-	u32 dstRegionSlicePitch = imgEncData.DstRowPitch * regionBlocksCount;
-
-	BackgroundWorker::Push(sm_RegionWorker);
+void rageam::graphics::ImageCompressor::CollectJobs(const EncoderState& state, EncoderJobs& jobs)
+{
+	AM_TRACE_FUNCTION();
 
-	for (int i = 0; i < regionCount; i++)
+	for (const EncoderMip& mip : state.Mips)
 	{
-		Region& regEncData = imgEncData.Regions[i];
-		regEncData.SrcPixels = srcPixels;
-		regEncData.DstPixels = dstPixels;
+		// RGBA mip was already copied in PrepareMip
+		if (mip.BlockCountX == 0 || mip.BlockCountY == 0)
+			continue;
 
-		regionTasks[i] = BackgroundWorker::Run([&]
-			{
-				CompressMipRegion(imgEncData, regEncData);
-				return true;
-			});
+		// Group block rows until job has at least IMAGE_BC_JOB_MIN_BLOCKS, small mips end up in a single job
+		int rowsPerJob = IMAGE_BC_JOB_MIN_BLOCKS / mip.BlockCountX;
+		rowsPerJob = std::clamp(rowsPerJob, 1, mip.BlockCountY);
 
-		srcPixels += srcRegionSlicePitch;
-		dstPixels += dstRegionSlicePitch;
+		for (int blockY = 0; blockY < mip.BlockCountY; blockY += rowsPerJob)
+		{
+			EncoderJob job;
+			job.State = &state;
+			job.Mip = &mip;
+			job.BlockRowStart = blockY;
+			job.BlockRowCount = MIN(rowsPerJob, mip.BlockCountY - blockY);
+			jobs.Add(job);
+		}
 	}
+}
 
-	// Wait for parallel tasks to finish the job
-	for (int k = 0; k < regionCount; k++)
-	{
-		regionTasks[k]->Wait();
-	}
+void rageam::graphics::ImageCompressor::RunJobs(const EncoderJobs& jobs)
+{
+	AM_TRACE_FUNCTION();
+	AM_TRACE_COUNTER("ImageCompressor::Jobs", jobs.GetSize());
+
+	ParallelFor(static_cast<int>(jobs.GetSize()), [&jobs](int jobIndex)
+		{
+			CompressJob(jobs[jobIndex]);
+		});
+}
 
-	BackgroundWorker::Pop();
+void rageam::graphics::ImageCompressor::ParallelFor(int count, const std::function<void(int index)>& fn)
+{
+#ifdef IMAGE_BC_USE_MULTITHREADING
+	BackgroundWorker::ParallelFor(static_cast<u32>(count), [&fn](u32 index)
+		{
+			fn(static_cast<int>(index));
+		});
+#else
+	for (int i = 0; i < count; i++)
+		fn(i);
+#endif
 }
 
 rageam::graphics::CompressedImageInfo rageam::graphics::ImageCompressor::GetInfoAndHash(
 	const ImageInfo& imgInfo,
 	const ImageCompressorOptions& options,
-	u32& outHash,
-	const u32* pixelHashOverride,
+	Hash128& outHash,
+	const Hash128* pixelHashOverride,
 	ImagePixelData pixelData,
 	u32 pixelDataSize)
 {
-	EASY_FUNCTION();
+	AM_TRACE_FUNCTION();
 
 	AM_ASSERT(options.Format == BlockFormat_None || ImageIsResolutionValidForMipMapsAndCompression(imgInfo.Width, imgInfo.Height),
 		"ImageCompressor::GetInfoAndHash() -> Given image can't be compressed!");
@@ -396,7 +401,12 @@ rageam::graphics::CompressedImageInfo rageam::graphics::ImageCompressor::GetInfo
 	// Choose block compressor from options
 	BlockCompressorImpl encoderImpl = options.CompressorImpl;
 	if (encoderImpl == BlockCompressorImpl::None)
-		encoderImpl = BlockFormatToDefaultCompressorImpl[options.Format];
+	{
+		if (options.Quality <= IMAGE_BC_PREVIEW_QUALITY && (IMAGE_RANGEFIT_FORMATS & 1 << options.Format))
+			encoderImpl = BlockCompressorImpl::rangefit;
+		else
+			encoderImpl = BlockFormatToDefaultCompressorImpl[options.Format];
+	}
 	encodeInfo.EncoderImpl = encoderImpl;
 
 	// Compute options for bc7enc_rdo
@@ -427,12 +437,20 @@ rageam::graphics::CompressedImageInfo rageam::graphics::ImageCompressor::GetInfo
 		}
 	}
 
+	// Compute options for range fit
+	if (encoderImpl == BlockCompressorImpl::rangefit)
+	{
+		encodeInfo.EncoderData_rangefit.Quality = options.Quality < 0.5f ? RangeFitQuality_Preview : RangeFitQuality_Normal;
+	}
+
 	// Compute image cache hash
-	u32 imgHash;
+	Hash128 imgHash;
 	if (pixelHashOverride)
 	{
-		imgHash = DataHash(&encodeInfo, sizeof CompressedImageInfo);
-		imgHash = DataHash(pixelHashOverride, sizeof u32, imgHash);
+		DataHasher hasher;
+		hasher.AddValue(encodeInfo);
+		hasher.AddValue(*pixelHashOverride);
+		imgHash = hasher.Get128();
 	}
 	else
 	{
@@ -447,14 +465,24 @@ rageam::graphics::CompressedImageInfo rageam::graphics::ImageCompressor::GetInfo
 	return encodeInfo;
 }
 
-rageam::graphics::ImagePtr rageam::graphics::ImageCompressor::Compress(
-	const ImagePtr& img, const ImageCompressorOptions& options, const u32* pixelHashOverride, CompressedImageInfo* outCompInfo, ImageCompressorToken* token)
+bool rageam::graphics::ImageCompressor::BeginCompress(EncoderState& state)
 {
-	EASY_FUNCTION();
+	AM_TRACE_FUNCTION();
+
+	// Converted and padded copies that are only input of the next step are bumped from job arena, see below
+	ImageAllocJobScope allocScope;
+
+	ImageCompressorBatchItem& item = *state.Item;
+	const ImagePtr& img = item.Image;
+	const ImageCompressorOptions& options = item.Options;
+	ImageCompressorToken* token = item.Token;
+	const Hash128* pixelHashOverride = item.PixelHashOverride.HasValue() ? &item.PixelHashOverride.GetValue() : nullptr;
 
 	if (token) token->Reset();
 
-	u32 cacheHash;
+	item.Result = nullptr;
+
+	Hash128 cacheHash;
 	CompressedImageInfo encodeInfo = GetInfoAndHash(
 		img->GetInfo(), options, cacheHash, pixelHashOverride, img->GetPixelData().Data(), img->ComputeSlicePitch());
 
@@ -463,111 +491,116 @@ rageam::graphics::ImagePtr rageam::graphics::ImageCompressor::Compress(
 		encodeInfo.UV2 = img->ComputePadExtent();
 	}
 
-	if (outCompInfo) *outCompInfo = encodeInfo;
+	item.CompInfo = encodeInfo;
 
 	ImageInfo& encodedImageInfo = encodeInfo.ImageInfo;
 	ImageInfo imageInfo = img->GetInfo();
 
 	// Attempt to retrieve image from cache
 	ImageCache* cache = ImageCache::GetInstance();
-	amPtr<Image> compressedImage = cache->GetFromCache(cacheHash, &encodeInfo.UV2);
+	amPtr<Image> compressedImage = cache->GetFromCache(cacheHash, &item.CompInfo.UV2);
 	if (compressedImage)
-		return compressedImage;
+	{
+		item.Result = compressedImage;
+		return false;
+	}
 
 	// Previously we needed only metadata to locate image in cache, now we need pixel data too to compress it
 	if (!img->EnsurePixelDataLoaded())
 	{
 		AM_ERRF("ImageCompressor::Compress() -> Failed to load image pixel data!");
-		return nullptr;
+		return false;
 	}
 
 	// Image was not in cache, compress it. We compute compress time to cache only expensive images
-	Timer timer = Timer::StartNew();
+	state.CompressTimer = Timer::StartNew();
 
 	// Image can be converted to RGBA + rescaled, we hold separate pointer
 	ImagePtr preparedImage = img;
+	ImagePixelFormat srcPixelFormat = imageInfo.PixelFormat;
+	imageInfo.PixelFormat = ImagePixelFormat_U32;
+
+	// Pad to power of two if we want to generate mip maps, encoding info of padded image is known before padding
+	bool needPadImage = options.PadToPowerOfTwo && !ImageIsResolutionValidForMipMaps(imageInfo.Width, imageInfo.Height);
+	if (options.PadToPowerOfTwo)
+	{
+		imageInfo.Width = static_cast<int>(ALIGN_POWER_OF_TWO_32(imageInfo.Width));
+		imageInfo.Height = static_cast<int>(ALIGN_POWER_OF_TWO_32(imageInfo.Height));
+		// We must ignore this hash because we use one from non-padded image, override skips hashing pixels
+		Hash128 unusedHash;
+		encodeInfo = GetInfoAndHash(imageInfo, options, unusedHash, &cacheHash);
+		encodeInfo.UV2 = item.CompInfo.UV2;
+	}
+
+	// Now that we know image is not in cache, we can resize it (size depends on options.MaxResolution)
+	int mipCount = encodedImageInfo.MipCount;
+	int compWidth = encodeInfo.ImageInfo.Width;
+	int compHeight = encodeInfo.ImageInfo.Height;
+	bool needResizeImage = compWidth != imageInfo.Width || compHeight != imageInfo.Height;
 
+	// Intermediate copies are not needed once the next step is done, they are bumped from job arena and released in one go
+	// when this function returns. The last step result becomes first mip and must be allocated from heap
 	// Input image must be in RGBA for faster encoding, converting pixel format is extremely fast
-	if (imageInfo.PixelFormat != ImagePixelFormat_U32)
+	if (srcPixelFormat != ImagePixelFormat_U32)
 	{
-		if (ImageIsCompressedFormat(imageInfo.PixelFormat) && options.AllowRecompress)
+		if (ImageIsCompressedFormat(srcPixelFormat) && options.AllowRecompress)
 			preparedImage = Decompress(img);
 		else
-			preparedImage = img->ConvertPixelFormat(ImagePixelFormat_U32);
-		imageInfo.PixelFormat = ImagePixelFormat_U32;
+			preparedImage = img->ConvertPixelFormat(ImagePixelFormat_U32, needPadImage || needResizeImage);
 	}
 
-	// Pad to power of two if we want to generate mip maps...
-	if (options.PadToPowerOfTwo)
+	if (needPadImage)
 	{
 		Vec2S uv2;
-		preparedImage = preparedImage->PadToPowerOfTwo(uv2);
-		imageInfo = preparedImage->GetInfo();
-		u32 unusedHash; // We must ignore this hash because we use one from non-padded image
-		encodeInfo = GetInfoAndHash(
-			imageInfo, options, unusedHash, pixelHashOverride, preparedImage->GetPixelData().Data(), preparedImage->ComputeSlicePitch());
-
-		if (outCompInfo)
-		{
-			outCompInfo->UV2 = uv2;
-		}
-		else
-		{
-			AM_WARNINGF("ImageCompressor::Compress() -> Padded to power of two but outCompInfo is NULL.");
-		}
+		preparedImage = preparedImage->PadToPowerOfTwo(uv2, needResizeImage);
 	}
 
-	// Now that we know image is not in cache, we can resize it (size depends on options.MaxResolution)
-	int mipCount = encodedImageInfo.MipCount;
-	int compWidth = encodeInfo.ImageInfo.Width;
-	int compHeight = encodeInfo.ImageInfo.Height;
-	bool needResizeImage = compWidth != imageInfo.Width || compHeight != imageInfo.Height;
 	preparedImage = needResizeImage ? preparedImage->Resize(compWidth, compHeight) : preparedImage;
 
+	state.Token = token;
+	state.EncodeInfo = encodeInfo;
+	state.CacheHash = cacheHash;
+	state.DstPixelFormat = encodedImageInfo.PixelFormat;
+
 	// Skip encoders initialization for RGBA
-	EncoderState encoderState = {};
-	encoderState.Token = token;
 	if (options.Format != BlockFormat_None)
 	{
-		encoderState.SrcPixelPitch = ImagePixelFormatBitsPerPixel[imageInfo.PixelFormat] / 8;
-		encoderState.EncodeInfo = encodeInfo;
-		encoderState.ImageInfo = imageInfo;
-		encoderState.EncoderImpl = encodeInfo.EncoderImpl;
+		state.SrcPixelPitch = ImagePixelFormatBitsPerPixel[imageInfo.PixelFormat] / 8;
+		state.EncoderImpl = encodeInfo.EncoderImpl;
 
 		if (encodeInfo.EncoderImpl == BlockCompressorImpl::None)
 		{
-			if (outCompInfo) *outCompInfo = {};
+			item.CompInfo = {};
 			AM_ERRF("ImageCompressor::Compress() -> Encoder was not resolved to any implementation, returning NULL.");
-			return nullptr;
+			return false;
 		}
 
 		// Initialize block encoders
-		static bool s_CompressorsInitialized = false;
-		if (!s_CompressorsInitialized)
-		{
-			ispc::bc7e_compress_block_init();
-			rgbcx::init();
-			icbc::init();
-			s_CompressorsInitialized = true;
-		}
+		static std::once_flag s_CompressorsInitialized;
+		std::call_once(s_CompressorsInitialized, []
+			{
+				ispc::bc7e_compress_block_init();
+				rgbcx::init();
+				icbc::init();
+			});
 
 		if (options.Format == BlockFormat_BC1 || options.Format == BlockFormat_BC4)
-			encoderState.DstPixelPitch = IMAGE_BC_1_4_BLOCK_SIZE;
+			state.DstPixelPitch = IMAGE_BC_1_4_BLOCK_SIZE;
 		else
-			encoderState.DstPixelPitch = IMAGE_BC_2_3_5_7_BLOCK_SIZE;
+			state.DstPixelPitch = IMAGE_BC_2_3_5_7_BLOCK_SIZE;
 
 		// Choose encoder quality for bc7enc_rdo
 		if (encodeInfo.EncoderImpl == BlockCompressorImpl::bc7enc_rdo && options.Format == BlockFormat_BC7)
 		{
 			switch (encodeInfo.EncoderData_bc7enc_rdo.Bc7Quality)
 			{
-			case 0: bc7e_compress_block_params_init_ultrafast(&encoderState.bc7enc_rdo_params, false);	break;
-			case 1: bc7e_compress_block_params_init_veryfast(&encoderState.bc7enc_rdo_params, false);	break;
-			case 2: bc7e_compress_block_params_init_fast(&encoderState.bc7enc_rdo_params, false);		break;
-			case 3: bc7e_compress_block_params_init_basic(&encoderState.bc7enc_rdo_params, false);		break;
-			case 4: bc7e_compress_block_params_init_slow(&encoderState.bc7enc_rdo_params, false);		break;
-			case 5: bc7e_compress_block_params_init_veryslow(&encoderState.bc7enc_rdo_params, false);	break;
-			case 6: bc7e_compress_block_params_init_slowest(&encoderState.bc7enc_rdo_params, false);	break;
+			case 0: bc7e_compress_block_params_init_ultrafast(&state.bc7enc_rdo_params, false);	break;
+			case 1: bc7e_compress_block_params_init_veryfast(&state.bc7enc_rdo_params, false);	break;
+			case 2: bc7e_compress_block_params_init_fast(&state.bc7enc_rdo_params, false);		break;
+			case 3: bc7e_compress_block_params_init_basic(&state.bc7enc_rdo_params, false);		break;
+			case 4: bc7e_compress_block_params_init_slow(&state.bc7enc_rdo_params, false);		break;
+			case 5: bc7e_compress_block_params_init_veryslow(&state.bc7enc_rdo_params, false);	break;
+			case 6: bc7e_compress_block_params_init_slowest(&state.bc7enc_rdo_params, false);	break;
 
 			default: AM_UNREACHABLE("ImageCompressor::Compress() -> Invalid BC7 quality '%i' for bc7enc_rdo",
 				encodeInfo.EncoderData_bc7enc_rdo.Bc7Quality);
@@ -576,102 +609,327 @@ rageam::graphics::ImagePtr rageam::graphics::ImageCompressor::Compress(
 	}
 
 	// Allocate continuous block of memory for all mip maps
-	u32 encodedDataSize = ImageComputeTotalSizeWithMips(compWidth, compHeight, mipCount, encodedImageInfo.PixelFormat);
-	PixelDataOwner encodedDataOwner = PixelDataOwner::AllocateWithSize(encodedDataSize);
-	pChar encodedPixels = encodedDataOwner.Data()->Bytes;
+	state.EncodedDataSize = ImageComputeTotalSizeWithMips(compWidth, compHeight, mipCount, encodedImageInfo.PixelFormat);
+	state.EncodedData = PixelDataOwner::AllocateWithSize(state.EncodedDataSize);
+	state.EncodedPixels = state.EncodedData.Data()->Bytes;
+	state.MipIndex = 0;
+	state.MipCount = mipCount;
+	// Jobs point to mips, list must never be reallocated
+	state.Mips.Reserve(mipCount);
 
 	// Compute total amount of rows for progress report
-	if (encoderState.Token)
+	if (token)
 	{
-		std::unique_lock lock(encoderState.Token->Mutex);
+		std::unique_lock lock(token->Mutex);
 		for (int i = 0; i < mipCount; i++)
 		{
-			encoderState.Token->TotalBlockLines += (imageInfo.Height >> i) / 4;
+			token->TotalBlockLines += (imageInfo.Height >> i) / 4;
 		}
 	}
 
-	// We compress every mip layer by downsampling image by factor of 2 every time
-	ImageInfo mipInfo;
-	for (int i = 0; i < mipCount; i++)
-	{
-		// NOTE: We keep mipImage as separate copy so post-processing doesn't stack up...
-		ImagePtr  mipImage = preparedImage;
-		mipInfo = mipImage->GetInfo();
+	// Mip chain is built serially because every mip depends on previous one, but only current mip is kept,
+	// next one is downsampled after current one is encoded, see NextMip and PrepareMips
+	PrepareMips(state, preparedImage);
 
-		u32 encodedMipSlicePitch = ImageComputeSlicePitch(mipInfo.Width, mipInfo.Height, encodedImageInfo.PixelFormat);
+	if (token && token->Canceled)
+		return false;
 
-		// Compute scaling factor to preserve alpha coverage
-		if (encodeInfo.AlphaTestCoverage)
-		{
-			float alphaCoverage = ImageAlphaTestCoverageRGBA(
-				mipImage->GetPixelDataBytes(), mipInfo.Width, mipInfo.Height, encodeInfo.AlphaTestThreshold);
+	return true;
+}
 
-			// Compute alpha coverage if we're on the first mip (as reference) and then
-			if (i == 0)
-			{
-				encoderState.DesiredAlphaCoverage = alphaCoverage;
-				encoderState.AlphaCoverageScale = 1.0f;
-			}
-			else
-			{
-				encoderState.AlphaCoverageScale = ImageAlphaTestFindBestScaleRGBA(
-					mipImage->GetPixelDataBytes(), mipInfo.Width, mipInfo.Height, encodeInfo.AlphaTestThreshold,
-					encoderState.DesiredAlphaCoverage);
-			}
-		}
+void rageam::graphics::ImageCompressor::PrepareMip(EncoderState& state, const ImagePtr& mipImage)
+{
+	AM_TRACE_FUNCTION();
 
-		// Post-processing, we do it per mip because it's very fast
-		// If we do processing on the first mip, it will invalidate caching for Image::Resize...
-		if (encodeInfo.Brightness != 0 || encodeInfo.Contrast != 0)
-		{
-			mipImage = mipImage->AdjustBrightnessAndContrast(encodeInfo.Brightness, encodeInfo.Contrast);
-		}
+	const CompressedImageInfo& encodeInfo = state.EncodeInfo;
+	ImageInfo mipInfo = mipImage->GetInfo();
+	int mipIndex = state.MipIndex + static_cast<int>(state.Mips.GetSize());
+
+	// Compute scaling factor to preserve alpha coverage
+	float alphaCoverageScale = 1.0f;
+	if (encodeInfo.AlphaTestCoverage)
+	{
+		float alphaCoverage = ImageAlphaTestCoverageRGBA(
+			mipImage->GetPixelDataBytes(), mipInfo.Width, mipInfo.Height, encodeInfo.AlphaTestThreshold);
 
-		if (options.Format != BlockFormat_None)
+		// Compute alpha coverage if we're on the first mip (as reference) and then
+		if (mipIndex == 0)
 		{
-			encoderState.Image = mipImage;
-			encoderState.DstPixels = encodedPixels;
-			encoderState.DstPixelFormat = encodeInfo.ImageInfo.PixelFormat;
-			encoderState.SrcRowPitch = ImageComputeRowPitch(mipInfo.Width, mipInfo.PixelFormat);
-			encoderState.DstRowPitch = ImageComputeRowPitch(mipInfo.Width, encodedImageInfo.PixelFormat);
-			encoderState.BlockCountX = mipInfo.Width / 4;
-			encoderState.BlockCountY = mipInfo.Height / 4;
-			CompressMip(encoderState);
+			state.DesiredAlphaCoverage = alphaCoverage;
 		}
 		else
 		{
-			// For RGBA we just need to copy pixels
-			memcpy(encodedPixels, mipImage->GetPixelDataBytes(), encodedMipSlicePitch);
-
-			// For BC we process this in compress block function
-			if (encodeInfo.CutoutAlpha)
-				ImageCutoutAlphaRGBA(encodedPixels, mipInfo.Width, mipInfo.Height, encodeInfo.CutoutAlphaThreshold);
-			// First mip doesn't require alpha scaling
-			if (i != 0 && encodeInfo.AlphaTestCoverage)
-				ImageScaleAlphaRGBA(encodedPixels, mipInfo.Width, mipInfo.Height, encoderState.AlphaCoverageScale);
+			alphaCoverageScale = ImageAlphaTestFindBestScaleRGBA(
+				mipImage->GetPixelDataBytes(), mipInfo.Width, mipInfo.Height, encodeInfo.AlphaTestThreshold,
+				state.DesiredAlphaCoverage);
 		}
+	}
+
+	// NOTE: Post-processing (brightness, contrast, alpha) is not applied on mip image, it is done on
+	// small pixel strips right before encoding, see ApplyStripOperators. This way we don't need
+	// full resolution copy of every mip for each operator and source mip stays untouched for Image::Resize caching
+
+	// Mips of the batch are placed one after another in encoded data
+	pChar dstPixels = state.EncodedPixels;
+	if (state.Mips.Any())
+	{
+		const EncoderMip& prevMip = state.Mips.Last();
+		dstPixels = prevMip.DstPixels + ImageComputeSlicePitch(prevMip.Image->GetWidth(), prevMip.Image->GetHeight(), state.DstPixelFormat);
+	}
+
+	EncoderMip& mip = state.Mips.Construct();
+	mip.Image = mipImage;
+	mip.DstPixels = dstPixels;
+	mip.AlphaCoverageScale = alphaCoverageScale;
+
+	if (state.Item->Options.Format != BlockFormat_None)
+	{
+		// Actual encoding is done later in parallel, see CollectJobs
+		mip.SrcPixels = mipImage->GetPixelDataBytes();
+		mip.SrcRowPitch = ImageComputeRowPitch(mipInfo.Width, mipInfo.PixelFormat);
+		mip.DstRowPitch = ImageComputeRowPitch(mipInfo.Width, state.DstPixelFormat);
+		mip.BlockCountX = mipInfo.Width / 4;
+		mip.BlockCountY = mipInfo.Height / 4;
+	}
+	else
+	{
+		// For RGBA we just need to copy pixels, post-processing is done in place by 4 row strips
+		bool needStripOperators = HasStripOperators(state, mip);
+
+		u32 rowPitch = ImageComputeRowPitch(mipInfo.Width, ImagePixelFormat_U32);
+		pChar srcPixels = mipImage->GetPixelDataBytes();
+		for (int y = 0; y < mipInfo.Height; y += 4)
+		{
+			int stripHeight = MIN(mipInfo.Height - y, 4);
+			size_t stripOffset = static_cast<size_t>(y) * rowPitch;
+			memcpy(dstPixels + stripOffset, srcPixels + stripOffset, static_cast<size_t>(stripHeight) * rowPitch);
+
+			if (needStripOperators)
+				ApplyStripOperators(state, mip, dstPixels + stripOffset, mipInfo.Width * stripHeight);
+		}
+	}
+}
 
-		if (token && token->Canceled)
-			return nullptr;
+void rageam::graphics::ImageCompressor::PrepareMips(EncoderState& state, const ImagePtr& mipImage)
+{
+	AM_TRACE_FUNCTION();
+
+	// Memory vs parallelism: every mip is downsampled from previous one, so encoding mips level by level puts a barrier after
+	// each level. Large mips are split on many jobs and keep all threads busy on their own, holding the whole chain instead
+	// would add 1/3 of base mip per image in the wave, so they are still encoded one at a time.
+	// Mips that fit in a single job (tail, 128x128 and smaller) would leave all threads but one idle behind a barrier per level,
+	// so the whole tail is downsampled at once and encoded as one batch, each tail mip is a job of its own.
+	// It costs at most 1/3 of 128x128 RGBA mip extra, and downsampling tiny mips serially is cheaper than a barrier
+	PrepareMip(state, mipImage);
+
+	ImagePtr tailMip = mipImage;
+	auto isTailMip = [](const ImagePtr& mip) { return (mip->GetWidth() / 4) * (mip->GetHeight() / 4) <= IMAGE_BC_JOB_MIN_BLOCKS; };
+	while (isTailMip(tailMip) && state.MipIndex + static_cast<int>(state.Mips.GetSize()) < state.MipCount)
+	{
+		tailMip = tailMip->Resize(tailMip->GetWidth() / 2, tailMip->GetHeight() / 2, state.Item->Options.MipFilter);
+		PrepareMip(state, tailMip);
+	}
+}
+
+bool rageam::graphics::ImageCompressor::NextMip(EncoderState& state)
+{
+	AM_TRACE_FUNCTION();
+
+	ImageAllocJobScope allocScope;
 
-		// Move to next compressed mip map pixel data
-		encodedPixels += encodedMipSlicePitch;
+	if (state.Token && state.Token->Canceled)
+		return false;
+
+	ImagePtr mipImage = state.Mips.Last().Image;
+	int mipWidth = mipImage->GetWidth();
+	int mipHeight = mipImage->GetHeight();
+
+	// Move to compressed pixel data of the mip after the batch
+	state.EncodedPixels = state.Mips.Last().DstPixels + ImageComputeSlicePitch(mipWidth, mipHeight, state.DstPixelFormat);
+	state.MipIndex += static_cast<int>(state.Mips.GetSize());
+
+	// Source pixels are not needed anymore, last one is still held by mipImage
+	state.Mips.Clear();
+
+	if (state.MipIndex >= state.MipCount)
+		return false;
+
+	// Downsample to next mip map
+	PrepareMips(state, mipImage->Resize(mipWidth / 2, mipHeight / 2, state.Item->Options.MipFilter));
+
+	return !(state.Token && state.Token->Canceled);
+}
 
-		// Downsample to next mip map
-		preparedImage = preparedImage->Resize(mipInfo.Width / 2, mipInfo.Height / 2, options.MipFilter);
+void rageam::graphics::ImageCompressor::EndCompress(EncoderState& state)
+{
+	AM_TRACE_FUNCTION();
+
+	ImageCompressorBatchItem& item = *state.Item;
+
+	// Source pixels are not needed anymore, mips are still set if compression was canceled
+	state.Mips.Clear();
+
+	if (state.Token && state.Token->Canceled)
+	{
+		item.Result = nullptr;
+		return;
 	}
 
 	// Create DDS image from compressed pixel data
-	ImagePtr compImage = std::make_shared<Image>(encodedDataOwner, encodedImageInfo);
+	ImagePtr compImage = std::make_shared<Image>(state.EncodedData, state.EncodeInfo.ImageInfo);
+	item.Result = compImage;
 
 	// See if image compression took long enough to compress it
-	timer.Stop();
-	if (cache->ShouldStore(timer.GetElapsedMilliseconds()))
+	// NOTE: In batch this includes time spent on encoding other images, but those are expensive anyway
+	state.CompressTimer.Stop();
+	ImageCache* cache = ImageCache::GetInstance();
+	if (cache->ShouldStore(state.CompressTimer.GetElapsedMilliseconds()))
+	{
+		cache->Cache(compImage, state.CacheHash, state.EncodedDataSize, ImageCacheEntryFlags_StoreInFileSystem, item.CompInfo.UV2);
+	}
+}
+
+u64 rageam::graphics::ImageCompressor::EstimateMemoryUsage(const ImageCompressorBatchItem& item)
+{
+	// Metadata is always available, pixels may not be loaded yet
+	int width = item.Image->GetWidth();
+	int height = item.Image->GetHeight();
+	if (item.Options.MaxResolution != 0)
+	{
+		width = MIN(width, item.Options.MaxResolution);
+		height = MIN(height, item.Options.MaxResolution);
+	}
+
+	// Only one RGBA mip is held at a time, peak is base mip plus next mip (1/4) while it is downsampled,
+	// encoded mip chain takes 4/3 of encoded base mip. Post-processing doesn't add anything because it's done on small strips
+	ImagePixelFormat encodedFormat = BlockFormatToPixelFormat[item.Options.Format];
+	u64 baseSize = ImageComputeSlicePitch(width, height, ImagePixelFormat_U32);
+	u64 encodedSize = ImageComputeSlicePitch(width, height, encodedFormat);
+	return baseSize + baseSize / 4 + encodedSize * 4 / 3;
+}
+
+rageam::graphics::ImagePtr rageam::graphics::ImageCompressor::Compress(
+	const ImagePtr& img, const ImageCompressorOptions& options, const Hash128* pixelHashOverride, CompressedImageInfo* outCompInfo, ImageCompressorToken* token)
+{
+	AM_TRACE_FUNCTION();
+
+	ImageCompressorBatchItem item;
+	item.Image = img;
+	item.Options = options;
+	item.Token = token;
+	if (pixelHashOverride)
+		item.PixelHashOverride = *pixelHashOverride;
+
+	EncoderState state = {};
+	state.Item = &item;
+	if (BeginCompress(state))
 	{
-		cache->Cache(compImage, cacheHash, encodedDataSize, ImageCacheEntryFlags_StoreInFileSystem, outCompInfo->UV2);
+		EncoderJobs jobs;
+		do
+		{
+			jobs.Clear();
+			CollectJobs(state, jobs);
+			RunJobs(jobs);
+		} while (NextMip(state));
+		EndCompress(state);
+	}
+
+	if (outCompInfo) *outCompInfo = item.CompInfo;
+	return item.Result;
+}
+
+bool rageam::graphics::ImageCompressor::CompressBatch(ImageCompressorBatch& batch, const ImageCompressorItemDoneFn& onItemDone)
+{
+	AM_TRACE_FUNCTION();
+
+	u32 itemCount = batch.GetSize();
+	u32 nextItem = 0;
+	bool success = true;
+
+	auto itemDone = [&](const EncoderState& state)
+		{
+			if (!state.Item->Result)
+				success = false;
+			if (onItemDone)
+				onItemDone(static_cast<u32>(state.Item - batch.GetItems()));
+		};
+
+	// We can't prepare all images at once because it would take enormous amount of memory on large dictionaries,
+	// instead images are processed in waves that fit in memory budget
+	while (nextItem < itemCount)
+	{
+		AM_TRACE_SCOPE("ImageCompressor::CompressWave");
+
+		List<EncoderStatePtr> states;
+		u64 waveMemory = 0;
+		while (nextItem < itemCount)
+		{
+			ImageCompressorBatchItem& item = batch[nextItem];
+			u64 itemMemory = EstimateMemoryUsage(item);
+			if (states.Any() && waveMemory + itemMemory > IMAGE_BC_BATCH_MEMORY_BUDGET)
+				break;
+
+			EncoderStatePtr& state = states.Construct(std::make_unique<EncoderState>());
+			state->Item = &item;
+			waveMemory += itemMemory;
+			nextItem++;
+		}
+		AM_TRACE_COUNTER("ImageCompressor::WaveMemory", waveMemory);
+
+		// Loading and resizing are independent for every image
+		List<bool> needEncoding;
+		needEncoding.Resize(states.GetSize());
+		{
+			ParallelFor(static_cast<int>(states.GetSize()), [&](int i)
+				{
+					needEncoding[i] = BeginCompress(*states[i]);
+				});
+		}
+
+		// Images that were found in cache (or failed to prepare) are done already
+		List<EncoderState*> encoding;
+		for (u32 i = 0; i < states.GetSize(); i++)
+		{
+			if (needEncoding[i])
+				encoding.Add(states[i].get());
+			else
+				itemDone(*states[i]);
+		}
+
+		// Now encode block rows of current mip (or whole tail) of every image as one flat job list, then downsample all to the next mip
+		EncoderJobs jobs;
+		List<bool> hasNextMip;
+		while (encoding.Any())
+		{
+			jobs.Clear();
+			for (EncoderState* state : encoding)
+				CollectJobs(*state, jobs);
+			RunJobs(jobs);
+
+			hasNextMip.Resize(encoding.GetSize());
+			ParallelFor(static_cast<int>(encoding.GetSize()), [&](int i)
+				{
+					hasNextMip[i] = NextMip(*encoding[i]);
+				});
+
+			// Images with smaller mip chain are done earlier
+			u32 remaining = 0;
+			for (u32 i = 0; i < encoding.GetSize(); i++)
+			{
+				if (hasNextMip[i])
+				{
+					encoding[remaining++] = encoding[i];
+					continue;
+				}
+
+				EndCompress(*encoding[i]);
+				itemDone(*encoding[i]);
+			}
+			encoding.Resize(remaining);
+		}
 	}
 
-	return compImage;
+	return success;
 }
 
 rageam::graphics::ImagePtr rageam::graphics::ImageCompressor::Decompress(const ImagePtr& img, int mipIndex)
@@ -687,13 +945,23 @@ rageam::graphics::ImagePtr rageam::graphics::ImageCompressor::Decompress(const I
 
 void rageam::graphics::ImageCompressor::DecompressBlock(const char* inBlock, char* outPixels, ImagePixelFormat fmt)
 {
-
 	switch (fmt)
 	{
 	case ImagePixelFormat_BC1: rgbcx::unpack_bc1(inBlock, outPixels);		return;
+	case ImagePixelFormat_BC2:
+		rgbcx::unpack_bc1(inBlock + 8, outPixels);
+		// Explicit 4 bit alpha, first 8 bytes of the block
+		for (int i = 0; i < 16; i++)
+		{
+			u8 alpha = static_cast<u8>(inBlock[i / 2]) >> (i % 2 * 4) & 0xF;
+			outPixels[i * IMAGE_RGBA_PITCH + 3] = static_cast<char>(alpha * 17);
+		}
+		return;
 	case ImagePixelFormat_BC3: rgbcx::unpack_bc3(inBlock, outPixels);		return;
 	case ImagePixelFormat_BC4:
-		memcpy(outPixels, &IMAGE_RGBA_ALPHA_MASK, IMAGE_BC_BLOCK_SLICE_PITCH); // unpack_bc4 only sets R component
+		// unpack_bc4 only sets R component
+		for (int i = 0; i < 4; i++)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(outPixels + i * IMAGE_BC_BLOCK_ROW_PITCH), IMAGE_RGBA_ALPHA_MASK);
 		rgbcx::unpack_bc4(inBlock, (u8*)outPixels);	return;
 	case ImagePixelFormat_BC5:
 		memset(outPixels, 0, IMAGE_BC_BLOCK_SLICE_PITCH); // unpack_bc4 only sets R and G components
@@ -704,27 +972,17 @@ void rageam::graphics::ImageCompressor::DecompressBlock(const char* inBlock, cha
 		{
 			char* lane = &outPixels[i * IMAGE_BC_BLOCK_ROW_PITCH];
 			__m128i fourPixels;
-			fourPixels = _mm_loadu_epi8(lane);
-			fourPixels = _mm_or_epi32(fourPixels, IMAGE_RGBA_ALPHA_MASK);
-			_mm_storeu_epi8(lane, fourPixels);
+			fourPixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(lane));
+			fourPixels = _mm_or_si128(fourPixels, IMAGE_RGBA_ALPHA_MASK);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(lane), fourPixels);
 		}
 		return;
 
 	case ImagePixelFormat_BC7:
+		memset(outPixels, 0, IMAGE_BC_BLOCK_SLICE_PITCH); // Reference decoder doesn't write anything for invalid blocks
 		bc7decomp_ref::unpack_bc7(inBlock, (bc7decomp::color_rgba*)outPixels);
 		return;
 
 	default: AM_UNREACHABLE("DecompressBlock() -> Unsupported format '%s'", Enum::GetName(fmt));
 	}
 }
-
-void rageam::graphics::ImageCompressor::InitClass()
-{
-	sm_RegionWorker = new BackgroundWorker("Img BC", IMAGE_BC_MULTITHREAD_MAX_REGIONS);
-}
-
-void rageam::graphics::ImageCompressor::ShutdownClass()
-{
-	delete sm_RegionWorker;
-	sm_RegionWorker = nullptr;
-}
@@ -8,6 +8,9 @@
 #pragma once
 
 #include "image.h"
+#include "am/system/timer.h"
+
+#include <functional>
 
 #ifdef AM_IMAGE_USE_AVX2
 #include <bc7e_ispc_avx2.h>
@@ -37,14 +40,12 @@ namespace rageam::graphics
 	// Normal					BC1, BC5
 
 #define IMAGE_BC_USE_MULTITHREADING
-
-#ifdef IMAGE_BC_USE_MULTITHREADING // Must be power of 2!
-	static constexpr int IMAGE_BC_MULTITHREAD_MAX_REGIONS = 16;		// Max threads
-	static constexpr int IMAGE_BC_MULTITHREAD_MIN_REGION_SIZE = 16;	// Num of Y blocks per one region
-#else
-	static constexpr int IMAGE_BC_MULTITHREAD_MAX_REGIONS = 1;
-	static constexpr int IMAGE_BC_MULTITHREAD_MIN_REGION_SIZE = IMAGE_MAX_RESOLUTION / 4;
-#endif
+	// Minimum number of 4x4 blocks in a single encoder job, block rows are grouped until they reach this size
+	// 1024 blocks is 16 rows of 256px mip or whole 128x128 mip, small enough to balance load well
+	// Mips that fit in a single job are the tail of mip chain, whole tail is encoded in one batch (see ImageCompressor::PrepareMips)
+	static constexpr int IMAGE_BC_JOB_MIN_BLOCKS = 1024;
+	// Maximum size of prepared (decoded and resized) source and encoded pixel data held in memory by one batch wave
+	static constexpr u64 IMAGE_BC_BATCH_MEMORY_BUDGET = 1024ull * 1024ull * 1024ull; // 1GB
 
 	enum BlockFormat // We keep it as separate enumeration from pixel formats to prevent using non-compressed formats in compressor
 	{
@@ -83,13 +84,14 @@ namespace rageam::graphics
 		None,			// RGBA / To choose implementation automatically
 		bc7enc_rdo,		// BC1, BC3, BC4, BC5, BC7
 		icbc,			// BC1
+		rangefit,		// BC1, BC2, BC3, BC4, BC5
 	};
 
 	static constexpr BlockCompressorImpl BlockFormatToDefaultCompressorImpl[] =
 	{
 		BlockCompressorImpl::None,			// RGBA
 		BlockCompressorImpl::bc7enc_rdo,	// BC1
-		BlockCompressorImpl::None,			// BC2
+		BlockCompressorImpl::rangefit,		// BC2
 		BlockCompressorImpl::bc7enc_rdo,	// BC3
 		BlockCompressorImpl::bc7enc_rdo,	// BC4
 		BlockCompressorImpl::bc7enc_rdo,	// BC5
@@ -115,14 +117,22 @@ namespace rageam::graphics
 	// Only BC1
 	static constexpr int IMAGE_ICBC_FORMATS = 1 << BlockFormat_BC1;
 
+	// All except BC7
+	static constexpr int IMAGE_RANGEFIT_FORMATS =
+		1 << BlockFormat_BC1 | 1 << BlockFormat_BC2 | 1 << BlockFormat_BC3 | 1 << BlockFormat_BC4 | 1 << BlockFormat_BC5;
+
 	PixelDataOwner ImageDecodeBCToRGBA(const PixelDataOwner& pixels, int width, int height, ImagePixelFormat format);
 
+	// If compressor is chosen automatically, BC1-BC5 with quality up to this value are encoded with range fit preview tier,
+	// it is many times faster than other encoders and is meant for live editing
+	static constexpr float IMAGE_BC_PREVIEW_QUALITY = 0.1f;
+
 	struct ImageCompressorOptions
 	{
 		BlockCompressorImpl CompressorImpl = BlockCompressorImpl::None;
 		BlockFormat			Format = BlockFormat_BC7;
 		ResizeFilter		MipFilter = ResizeFilter_Box;
-		float				Quality = 0.65f;			// 0 - Worst, fastest; 1 - Best, slowest
+		float				Quality = 0.65f;			// 0 - Worst, fastest; 1 - Best, slowest; See IMAGE_BC_PREVIEW_QUALITY
 		int					MaxResolution = 0;			// Down-scales base image resolution to specified one, 0 to use original
 		bool				GenerateMipMaps = true;		// Creates mip maps up to 4x4
 		bool				CutoutAlpha = false;		// All pixels with alpha less than threshold are made transparent, otherwise fully opaque
@@ -156,6 +166,11 @@ namespace rageam::graphics
 		int Quality;
 	};
 
+	struct EncoderData_rangefit
+	{
+		int Quality; // RangeFitQuality
+	};
+
 	// Information about compressed image
 	struct CompressedImageInfo
 	{
@@ -170,6 +185,7 @@ namespace rageam::graphics
 		BlockCompressorImpl		EncoderImpl;
 		EncoderData_bc7enc_rdo	EncoderData_bc7enc_rdo;
 		EncoderData_icbc		EncoderData_icbc;
+		EncoderData_rangefit	EncoderData_rangefit;
 		Vec2S					UV2 = { 1.0f, 1.0f };
 		// if ImageCompressorOptions::AllowRecompress was set to true, this flag
 		// indicates if source DDS image was recompressed
@@ -195,73 +211,127 @@ namespace rageam::graphics
 	};
 	using ImageCompressorTokenPtr = ImageCompressorToken*;
 
+	// Single image in compressor batch, see ImageCompressor::CompressBatch
+	struct ImageCompressorBatchItem
+	{
+		ImagePtr				Image;
+		ImageCompressorOptions	Options;
+		// See ImageCompressor::Compress
+		Nullable<Hash128>		PixelHashOverride;
+		ImageCompressorToken*	Token = nullptr;
+
+		// Set after compression, NULL if compression failed
+		ImagePtr				Result;
+		CompressedImageInfo		CompInfo = {};
+	};
+	using ImageCompressorBatch = List<ImageCompressorBatchItem>;
+
 	/**
 	 * \brief BC Image encoder with internal caching.
 	 */
 	class ImageCompressor
 	{
-		struct Region
+		// Prepared source pixels of single mip map
+		struct EncoderMip
 		{
-			pChar SrcPixels;
-			pChar DstPixels;
+			ImagePtr	Image;				// Keeps source pixels alive until mip is encoded
+			pChar		SrcPixels;
+			pChar		DstPixels;
+			u32			SrcRowPitch;
+			u32			DstRowPitch;
+			int			BlockCountX;
+			int			BlockCountY;
+			float		AlphaCoverageScale;
 		};
 
-		// Note: the way this struct is designed, only one mip allowed to be compressed at the time!
-		// No multithreaded mip compression is possible
+		// State of single image compression, shared by all jobs of this image
+		// Only one mip (or the whole tail of small mips) is held in memory, next one is downsampled from it once it is encoded
 		struct EncoderState
 		{
-			ImageCompressorTokenPtr				Token;
-			ImagePtr							Image;
-			ImageInfo							ImageInfo;
-			CompressedImageInfo					EncodeInfo;
-			// Pointer to compressed pixel data buffer
-			pChar								DstPixels;
-			ImagePixelFormat					DstPixelFormat;
-			u32									SrcPixelPitch;
-			u32									DstPixelPitch;
-			u32									SrcRowPitch;
-			u32									DstRowPitch;
-			BlockCompressorImpl					EncoderImpl;
-			// Storage for all regions shared by parallel threads
-			Region								Regions[IMAGE_BC_MULTITHREAD_MAX_REGIONS];
-			int									BlockCountX;
-			int									BlockCountY;
-			int									RegionBlocksCount;
-			float								DesiredAlphaCoverage;
-			float								AlphaCoverageScale;
-			ispc::bc7e_compress_block_params	bc7enc_rdo_params;
+			ImageCompressorBatchItem*				Item;
+			ImageCompressorTokenPtr					Token;
+			CompressedImageInfo						EncodeInfo;
+			Hash128									CacheHash;
+			Timer									CompressTimer;
+			PixelDataOwner							EncodedData;
+			u32										EncodedDataSize;
+			ImagePixelFormat						DstPixelFormat;
+			u32										SrcPixelPitch;
+			u32										DstPixelPitch;
+			BlockCompressorImpl						EncoderImpl;
+			List<EncoderMip>						Mips;				// Mips encoded in current batch, reserved for all mips
+			int										MipIndex;			// Index of the first mip in Mips
+			int										MipCount;
+			pChar									EncodedPixels;		// Encoded pixels of the first mip in EncodedData
+			float									DesiredAlphaCoverage;
+			ispc::bc7e_compress_block_params		bc7enc_rdo_params;
+		};
+		using EncoderStatePtr = amUPtr<EncoderState>;
+
+		// Range of block rows in one mip, the smallest unit of work scheduled on the region worker
+		struct EncoderJob
+		{
+			const EncoderState*	State;
+			const EncoderMip*	Mip;
+			int					BlockRowStart;
+			int					BlockRowCount;
 		};
+		using EncoderJobs = List<EncoderJob>;
+
+		// Post-processing (brightness, contrast, cutout and scaled alpha) is fused into encoding,
+		// it is applied on pixel strips of block group size instead of full resolution mip copies
+		static bool HasStripOperators(const EncoderState& encoderState, const EncoderMip& mip);
+		static void ApplyStripOperators(const EncoderState& encoderState, const EncoderMip& mip, char* pixels, int pixelCount);
 
 		static void CompressBlocks(const EncoderState& encoderState, int numBlocks, char* dstBlocks, char* srcBlocks);
-		static void CompressMipRegion(const EncoderState& encoderState, const Region& region);
-		static void CompressMip(EncoderState& imgEncData);
+		static void CompressJob(const EncoderJob& job);
+
+		// Looks up image in cache and if it's not there, loads pixel data and prepares first mip map for encoding
+		// Returns False if image was found in cache or compression failed, in both cases item result is already set
+		static bool BeginCompress(EncoderState& state);
+		// Adds given image to mips of current batch, RGBA pixels are copied right away because there's nothing to encode
+		static void PrepareMip(EncoderState& state, const ImagePtr& mipImage);
+		// Prepares given mip, if it's in the tail then all remaining mips are downsampled and prepared too
+		static void PrepareMips(EncoderState& state, const ImagePtr& mipImage);
+		// Downsamples last mip of current batch to the next one, pixels of the batch are released
+		// Returns False if all mips were encoded or compression was canceled
+		static bool NextMip(EncoderState& state);
+		// Creates compressed image from encoded pixel data and adds it to cache
+		static void EndCompress(EncoderState& state);
+		// Splits mips of current batch on block row ranges
+		static void CollectJobs(const EncoderState& state, EncoderJobs& jobs);
+		// Encodes all given jobs as one flat list on region worker
+		static void RunJobs(const EncoderJobs& jobs);
+		// Estimated amount of memory image will take during compression, for batch budget
+		static u64 EstimateMemoryUsage(const ImageCompressorBatchItem& item);
 
+	public:
 		// Does not perform actual compression but only computes metadata of (potential) compressed image
 		// NOTE: Either pixelHashOverride or pixelData must be provided!
 		static CompressedImageInfo GetInfoAndHash(
 			const ImageInfo& imgInfo,
 			const ImageCompressorOptions& options,
-			u32& outHash,
-			const u32* pixelHashOverride = nullptr,
+			Hash128& outHash,
+			const Hash128* pixelHashOverride = nullptr,
 			ImagePixelData pixelData = nullptr,
 			u32 pixelDataSize = 0);
 
-		// We have separate from system worker because:
-		// - Need more threads
-		// - Scenario when all system worker threads are used would cause deadlock
-		static BackgroundWorker* sm_RegionWorker;
-
-	public:
 		// Compresses given image with given options and returns newly created image
 		// pixelHashOverride is used to compute the final hash sum of the image, iterating over pixel data is a bit expensive,
 		// so something else (such as hash sum of image modify time + path) can be provided instead, as long as it is unique to the image
 		static ImagePtr Compress(
 			const ImagePtr& img,
 			const ImageCompressorOptions& options,
-			const u32* pixelHashOverride = nullptr,
+			const Hash128* pixelHashOverride = nullptr,
 			CompressedImageInfo* outCompInfo = nullptr,
 			ImageCompressorToken* token = nullptr);
 
+		// Compresses multiple images at once, block rows of the same mip level of all images are encoded as one flat job list,
+		// which keeps all threads busy on small mips instead of dropping to single thread
+		// Images are prepared in waves to fit IMAGE_BC_BATCH_MEMORY_BUDGET
+		// Returns False if at least one image failed to compress
+		static bool CompressBatch(ImageCompressorBatch& batch, const ImageCompressorItemDoneFn& onItemDone = nullptr);
+
 		// Decodes BC pixels to RGBA
 		// If given image format is already RGBA32, a reference to original pixel data will be returned
 		static ImagePtr Decompress(const ImagePtr& img, int mipIndex = 0);
@@ -269,7 +339,8 @@ namespace rageam::graphics
 		// Decodes single block of given format and outputs 4x4 RGBA pixels
 		static void DecompressBlock(const char* inBlock, char* outPixels, ImagePixelFormat fmt);
 
-		static void InitClass();
-		static void ShutdownClass();
+		// Invokes function for every index in [0, count) on main worker, calling thread participates too
+		// Safe to call from worker task, waiting thread executes nested tasks instead of blocking
+		static void ParallelFor(int count, const std::function<void(int index)>& fn);
 	};
 }
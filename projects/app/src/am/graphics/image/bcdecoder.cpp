@@ -0,0 +1,348 @@
+#include "bcdecoder.h"
+
+#include "bc.h"
+#include "am/system/enum.h"
+
+#include <bc7decomp.h>
+#include <immintrin.h>
+
+namespace
+{
+#ifdef AM_IMAGE_USE_AVX2
+	// Shuffle masks that pick 4 pixels from BC1 palette (4 RGBA colors) by one row of 2 bit selectors
+	struct BC1RowShuffleTable
+	{
+		alignas(16) u8 Masks[256][16];
+
+		constexpr BC1RowShuffleTable() : Masks()
+		{
+			for (int selectors = 0; selectors < 256; selectors++)
+			{
+				for (int x = 0; x < 4; x++)
+				{
+					int index = selectors >> (x * 2) & 3;
+					for (int i = 0; i < 4; i++)
+						Masks[selectors][x * 4 + i] = static_cast<u8>(index * 4 + i);
+				}
+			}
+		}
+	};
+
+	// Palette indices of 4 pixels (one per byte) by one row of 3 bit BC4 selectors
+	struct BC4RowIndexTable
+	{
+		u32 Indices[4096];
+
+		constexpr BC4RowIndexTable() : Indices()
+		{
+			for (int selectors = 0; selectors < 4096; selectors++)
+			{
+				for (int x = 0; x < 4; x++)
+					Indices[selectors] |= static_cast<u32>(selectors >> (x * 3) & 7) << (x * 8);
+			}
+		}
+	};
+
+	constexpr BC1RowShuffleTable s_BC1RowShuffle;
+	constexpr BC4RowIndexTable   s_BC4RowIndices;
+
+	// Exact integer division by multiplication, valid for value ranges of BC palettes
+	__m128i Div3(__m128i x) { return _mm_srli_epi32(_mm_mullo_epi32(x, _mm_set1_epi32(43691)), 17); } // x <= 765
+	__m128i Div5(__m128i x) { return _mm_srli_epi32(_mm_mullo_epi32(x, _mm_set1_epi32(13108)), 16); } // x <= 1275
+	__m128i Div7(__m128i x) { return _mm_srli_epi32(_mm_mullo_epi32(x, _mm_set1_epi32(9363)), 16); }  // x <= 1785
+
+	u32 LoadU32(const char* p)
+	{
+		u32 value;
+		memcpy(&value, p, sizeof(u32));
+		return value;
+	}
+
+	// Loads first 32 bits of up to 4 blocks, missing blocks are zero
+	__m128i GatherBlockWords(const char* blocks, u32 blockSize, int count)
+	{
+		alignas(16) u32 words[4] = {};
+		for (int i = 0; i < count; i++)
+			words[i] = LoadU32(blocks + i * blockSize);
+		return _mm_load_si128(reinterpret_cast<const __m128i*>(words));
+	}
+
+	void ExpandRGB565(__m128i color, __m128i& r, __m128i& g, __m128i& b)
+	{
+		const __m128i mask5 = _mm_set1_epi32(31);
+		const __m128i mask6 = _mm_set1_epi32(63);
+		__m128i r5 = _mm_and_si128(_mm_srli_epi32(color, 11), mask5);
+		__m128i g6 = _mm_and_si128(_mm_srli_epi32(color, 5), mask6);
+		__m128i b5 = _mm_and_si128(color, mask5);
+		r = _mm_or_si128(_mm_slli_epi32(r5, 3), _mm_srli_epi32(r5, 2));
+		g = _mm_or_si128(_mm_slli_epi32(g6, 2), _mm_srli_epi32(g6, 4));
+		b = _mm_or_si128(_mm_slli_epi32(b5, 3), _mm_srli_epi32(b5, 2));
+	}
+
+	__m128i PackRGBA(__m128i r, __m128i g, __m128i b, __m128i a)
+	{
+		return _mm_or_si128(
+			_mm_or_si128(r, _mm_slli_epi32(g, 8)),
+			_mm_or_si128(_mm_slli_epi32(b, 16), _mm_slli_epi32(a, 24)));
+	}
+
+	// Computes palettes of 4 BC1 color blocks, same as rgbcx::unpack_bc1_block_colors in ideal mode
+	// Input vectors hold one color of every block, output vectors hold all 4 colors of one block
+	void DecodeBC1Palettes(const char* colorBlocks, u32 blockSize, int count, __m128i palettes[4])
+	{
+		__m128i endpoints = GatherBlockWords(colorBlocks, blockSize, count);
+		__m128i low = _mm_and_si128(endpoints, _mm_set1_epi32(0xFFFF));
+		__m128i high = _mm_srli_epi32(endpoints, 16);
+
+		__m128i r0, g0, b0, r1, g1, b1;
+		ExpandRGB565(low, r0, g0, b0);
+		ExpandRGB565(high, r1, g1, b1);
+
+		// 4 colors if first endpoint is greater, otherwise 3 colors and transparent black
+		__m128i fourColors = _mm_cmpgt_epi32(low, high);
+
+		auto third = [](__m128i a, __m128i b) { return Div3(_mm_add_epi32(_mm_add_epi32(a, a), b)); };
+		auto half = [](__m128i a, __m128i b) { return _mm_srli_epi32(_mm_add_epi32(a, b), 1); };
+
+		__m128i r2 = _mm_blendv_epi8(half(r0, r1), third(r0, r1), fourColors);
+		__m128i g2 = _mm_blendv_epi8(half(g0, g1), third(g0, g1), fourColors);
+		__m128i b2 = _mm_blendv_epi8(half(b0, b1), third(b0, b1), fourColors);
+		__m128i r3 = _mm_and_si128(third(r1, r0), fourColors);
+		__m128i g3 = _mm_and_si128(third(g1, g0), fourColors);
+		__m128i b3 = _mm_and_si128(third(b1, b0), fourColors);
+
+		__m128i opaque = _mm_set1_epi32(255);
+		__m128i c0 = PackRGBA(r0, g0, b0, opaque);
+		__m128i c1 = PackRGBA(r1, g1, b1, opaque);
+		__m128i c2 = PackRGBA(r2, g2, b2, opaque);
+		__m128i c3 = PackRGBA(r3, g3, b3, _mm_and_si128(opaque, fourColors));
+
+		// Transpose
+		__m128i t0 = _mm_unpacklo_epi32(c0, c1);
+		__m128i t1 = _mm_unpacklo_epi32(c2, c3);
+		__m128i t2 = _mm_unpackhi_epi32(c0, c1);
+		__m128i t3 = _mm_unpackhi_epi32(c2, c3);
+		palettes[0] = _mm_unpacklo_epi64(t0, t1);
+		palettes[1] = _mm_unpackhi_epi64(t0, t1);
+		palettes[2] = _mm_unpacklo_epi64(t2, t3);
+		palettes[3] = _mm_unpackhi_epi64(t2, t3);
+	}
+
+	// Computes palettes of 4 BC4 blocks, same as rgbcx::bc4_block::get_block_values
+	// Palette of every block is placed in lower 8 bytes of the vector
+	void DecodeBC4Palettes(const char* blocks, u32 blockSize, int count, __m128i palettes[4])
+	{
+		__m128i endpoints = GatherBlockWords(blocks, blockSize, count);
+		__m128i l = _mm_and_si128(endpoints, _mm_set1_epi32(0xFF));
+		__m128i h = _mm_and_si128(_mm_srli_epi32(endpoints, 8), _mm_set1_epi32(0xFF));
+
+		// 8 values if first endpoint is greater, otherwise 6 values, 0 and 255
+		__m128i eightValues = _mm_cmpgt_epi32(l, h);
+
+		auto mix = [l, h](int wl, int wh)
+		{
+			return _mm_add_epi32(_mm_mullo_epi32(l, _mm_set1_epi32(wl)), _mm_mullo_epi32(h, _mm_set1_epi32(wh)));
+		};
+
+		__m128i v2 = _mm_blendv_epi8(Div5(mix(4, 1)), Div7(mix(6, 1)), eightValues);
+		__m128i v3 = _mm_blendv_epi8(Div5(mix(3, 2)), Div7(mix(5, 2)), eightValues);
+		__m128i v4 = _mm_blendv_epi8(Div5(mix(2, 3)), Div7(mix(4, 3)), eightValues);
+		__m128i v5 = _mm_blendv_epi8(Div5(mix(1, 4)), Div7(mix(3, 4)), eightValues);
+		__m128i v6 = _mm_and_si128(Div7(mix(2, 5)), eightValues);
+		__m128i v7 = _mm_blendv_epi8(_mm_set1_epi32(255), Div7(mix(1, 6)), eightValues);
+
+		__m128i low = PackRGBA(l, h, v2, v3);
+		__m128i high = PackRGBA(v4, v5, v6, v7);
+
+		__m128i t0 = _mm_unpacklo_epi32(low, high); // Blocks 0, 1
+		__m128i t1 = _mm_unpackhi_epi32(low, high); // Blocks 2, 3
+		palettes[0] = t0;
+		palettes[1] = _mm_srli_si128(t0, 8);
+		palettes[2] = t1;
+		palettes[3] = _mm_srli_si128(t1, 8);
+	}
+
+	// Picks 4 rows of 4 pixels from BC1 palette
+	void SelectBC1Pixels(__m128i palette, u32 selectors, __m128i rows[4])
+	{
+		for (int y = 0; y < 4; y++)
+		{
+			const u8* mask = s_BC1RowShuffle.Masks[selectors >> (y * 8) & 0xFF];
+			rows[y] = _mm_shuffle_epi8(palette, _mm_load_si128(reinterpret_cast<const __m128i*>(mask)));
+		}
+	}
+
+	// Picks 16 values from BC4 palette, in pixel order
+	__m128i SelectBC4Values(__m128i palette, const char* block)
+	{
+		u64 selectors;
+		memcpy(&selectors, block, sizeof(u64));
+		selectors >>= 16; // Skip endpoints
+
+		__m128i indices = _mm_setr_epi32(
+			static_cast<int>(s_BC4RowIndices.Indices[selectors & 0xFFF]),
+			static_cast<int>(s_BC4RowIndices.Indices[selectors >> 12 & 0xFFF]),
+			static_cast<int>(s_BC4RowIndices.Indices[selectors >> 24 & 0xFFF]),
+			static_cast<int>(s_BC4RowIndices.Indices[selectors >> 36 & 0xFFF]));
+		return _mm_shuffle_epi8(palette, indices);
+	}
+
+	// Expands 4 bit explicit alpha of BC2 block to 16 bytes, in pixel order
+	__m128i DecodeBC2Alpha(const char* block)
+	{
+		const __m128i lowMask = _mm_set1_epi8(0x0F);
+		__m128i packed = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(block));
+		__m128i low = _mm_and_si128(packed, lowMask);
+		__m128i high = _mm_and_si128(_mm_srli_epi16(packed, 4), lowMask);
+		__m128i nibbles = _mm_unpacklo_epi8(low, high);
+		return _mm_or_si128(nibbles, _mm_slli_epi16(nibbles, 4)); // x * 17
+	}
+
+	// Replaces alpha of 4 pixel rows with given 16 values
+	void ApplyAlpha(__m128i rows[4], __m128i alpha)
+	{
+		alignas(16) u32 alphaRows[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(alphaRows), alpha);
+		for (int y = 0; y < 4; y++)
+		{
+			__m128i rowAlpha = _mm_slli_epi32(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(alphaRows[y]))), 24);
+			rows[y] = _mm_or_si128(_mm_and_si128(rows[y], rageam::graphics::IMAGE_RGBA_RGB_MASK), rowAlpha);
+		}
+	}
+
+	// Values are written to red channel, green and blue are zero and alpha is opaque
+	void RedToPixels(__m128i red, __m128i rows[4])
+	{
+		alignas(16) u32 redRows[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(redRows), red);
+		for (int y = 0; y < 4; y++)
+		{
+			__m128i row = _mm_cvtepu8_epi32(_mm_cvtsi32_si128(static_cast<int>(redRows[y])));
+			rows[y] = _mm_or_si128(row, rageam::graphics::IMAGE_RGBA_ALPHA_MASK);
+		}
+	}
+
+	// Values are written to red and green channels, blue is zero and alpha is opaque
+	void RedGreenToPixels(__m128i red, __m128i green, __m128i rows[4])
+	{
+		alignas(16) u64 redGreenRows[4];
+		_mm_store_si128(reinterpret_cast<__m128i*>(redGreenRows + 0), _mm_unpacklo_epi8(red, green));
+		_mm_store_si128(reinterpret_cast<__m128i*>(redGreenRows + 2), _mm_unpackhi_epi8(red, green));
+		for (int y = 0; y < 4; y++)
+		{
+			__m128i row = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(redGreenRows + y)));
+			rows[y] = _mm_or_si128(row, rageam::graphics::IMAGE_RGBA_ALPHA_MASK);
+		}
+	}
+#endif // AM_IMAGE_USE_AVX2
+
+	void StoreRows(char* dst, u32 dstRowPitch, const __m128i rows[4])
+	{
+		for (int y = 0; y < 4; y++)
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + static_cast<size_t>(y) * dstRowPitch), rows[y]);
+	}
+
+	// Copies decoded 4x4 RGBA block to destination image
+	void StoreBlock(char* dst, u32 dstRowPitch, const char* blockPixels)
+	{
+		__m128i rows[4];
+		for (int y = 0; y < 4; y++)
+			rows[y] = _mm_load_si128(reinterpret_cast<const __m128i*>(blockPixels + y * rageam::graphics::IMAGE_BC_BLOCK_ROW_PITCH));
+		StoreRows(dst, dstRowPitch, rows);
+	}
+}
+
+void rageam::graphics::BCDecodeBlockRow(ImagePixelFormat format, int numBlocks, const char* srcBlocks, char* dstPixels, u32 dstRowPitch)
+{
+	static constexpr u32 DST_BLOCK_ROW_SIZE = IMAGE_BC_BLOCK_ROW_PITCH; // 4 RGBA pixels
+
+	u32 blockSize = BlockFormatToBlockSize[ImagePixelFormatToBlockFormat(format)];
+
+	if (format == ImagePixelFormat_BC7)
+	{
+		alignas(16) bc7decomp::color_rgba blockPixels[16];
+		for (int i = 0; i < numBlocks; i++)
+		{
+			bc7decomp::unpack_bc7(srcBlocks + static_cast<size_t>(i) * blockSize, blockPixels);
+			StoreBlock(dstPixels + static_cast<size_t>(i) * DST_BLOCK_ROW_SIZE, dstRowPitch, reinterpret_cast<const char*>(blockPixels));
+		}
+		return;
+	}
+
+#ifdef AM_IMAGE_USE_AVX2
+	// Palettes are computed for 4 blocks at once
+	for (int i = 0; i < numBlocks; i += 4)
+	{
+		int count = MIN(numBlocks - i, 4);
+
+		const char* blocks = srcBlocks + static_cast<size_t>(i) * blockSize;
+		char*       dst = dstPixels + static_cast<size_t>(i) * DST_BLOCK_ROW_SIZE;
+
+		__m128i colorPalettes[4];
+		__m128i channelPalettes[4];
+		__m128i channel2Palettes[4];
+		switch (format)
+		{
+		case ImagePixelFormat_BC1:
+			DecodeBC1Palettes(blocks, blockSize, count, colorPalettes);
+			break;
+		case ImagePixelFormat_BC2:
+			DecodeBC1Palettes(blocks + 8, blockSize, count, colorPalettes);
+			break;
+		case ImagePixelFormat_BC3:
+			DecodeBC4Palettes(blocks, blockSize, count, channelPalettes);
+			DecodeBC1Palettes(blocks + 8, blockSize, count, colorPalettes);
+			break;
+		case ImagePixelFormat_BC4:
+			DecodeBC4Palettes(blocks, blockSize, count, channelPalettes);
+			break;
+		case ImagePixelFormat_BC5:
+			DecodeBC4Palettes(blocks, blockSize, count, channelPalettes);
+			DecodeBC4Palettes(blocks + 8, blockSize, count, channel2Palettes);
+			break;
+
+		default: AM_UNREACHABLE("BCDecodeBlockRow() -> Unsupported format '%s'", Enum::GetName(format));
+		}
+
+		for (int k = 0; k < count; k++)
+		{
+			const char* block = blocks + static_cast<size_t>(k) * blockSize;
+
+			__m128i rows[4];
+			switch (format)
+			{
+			case ImagePixelFormat_BC1:
+				SelectBC1Pixels(colorPalettes[k], LoadU32(block + 4), rows);
+				break;
+			case ImagePixelFormat_BC2:
+				SelectBC1Pixels(colorPalettes[k], LoadU32(block + 12), rows);
+				ApplyAlpha(rows, DecodeBC2Alpha(block));
+				break;
+			case ImagePixelFormat_BC3:
+				SelectBC1Pixels(colorPalettes[k], LoadU32(block + 12), rows);
+				ApplyAlpha(rows, SelectBC4Values(channelPalettes[k], block));
+				break;
+			case ImagePixelFormat_BC4:
+				RedToPixels(SelectBC4Values(channelPalettes[k], block), rows);
+				break;
+			case ImagePixelFormat_BC5:
+				RedGreenToPixels(
+					SelectBC4Values(channelPalettes[k], block),
+					SelectBC4Values(channel2Palettes[k], block + 8), rows);
+				break;
+
+			default: break;
+			}
+			StoreRows(dst + static_cast<size_t>(k) * DST_BLOCK_ROW_SIZE, dstRowPitch, rows);
+		}
+	}
+#else
+	// Byte shuffle, blend and 32 bit multiply need SSSE3 / SSE4.1 which SSE2 build can't assume, decode block by block
+	alignas(16) char blockPixels[IMAGE_BC_BLOCK_SLICE_PITCH];
+	for (int i = 0; i < numBlocks; i++)
+	{
+		ImageCompressor::DecompressBlock(srcBlocks + static_cast<size_t>(i) * blockSize, blockPixels, format);
+		StoreBlock(dstPixels + static_cast<size_t>(i) * DST_BLOCK_ROW_SIZE, dstRowPitch, blockPixels);
+	}
+#endif // AM_IMAGE_USE_AVX2
+}
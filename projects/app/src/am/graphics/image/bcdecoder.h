@@ -0,0 +1,26 @@
+//
+// File: bcdecoder.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "image.h"
+
+namespace rageam::graphics
+{
+	// Multi-block decoder for BC1, BC2, BC3, BC4, BC5 and BC7
+	//
+	// BC1-BC5 palettes are computed for 4 blocks at once and pixels are picked from palette with byte shuffle,
+	// output is bit-exact with ImageCompressor::DecompressBlock (rgbcx in ideal mode)
+	// Shuffle and blend need SSSE3 / SSE4.1, so this path is only compiled in AVX2 build (AM_IMAGE_USE_AVX2),
+	// SSE2 build decodes every block with ImageCompressor::DecompressBlock
+	// BC7 has too many bit layouts to vectorize, it uses table based bc7decomp instead of reference one
+	//
+	// Pixels are written directly to destination image, there's no intermediate 4x4 block copy
+
+	// Decodes one row of blocks, dstPixels is top left pixel of the first block and dstRowPitch is pitch of single pixel row
+	void BCDecodeBlockRow(ImagePixelFormat format, int numBlocks, const char* srcBlocks, char* dstPixels, u32 dstRowPitch);
+}
@@ -0,0 +1,785 @@
+#include "bcrangefit.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <immintrin.h>
+
+namespace
+{
+	// Thin wrappers over SSE2 / AVX2 float vectors, so the encoder is written only once for both instruction sets
+
+#ifdef AM_IMAGE_USE_AVX2
+	using FloatV = __m256;
+	using IntV = __m256i;
+	constexpr int FLOAT_V_LANES = 8;
+
+	FloatV LoadV(const float* p) { return _mm256_load_ps(p); }
+	void   StoreV(float* p, FloatV v) { _mm256_store_ps(p, v); }
+	FloatV SetV(float f) { return _mm256_set1_ps(f); }
+	FloatV AddV(FloatV a, FloatV b) { return _mm256_add_ps(a, b); }
+	FloatV SubV(FloatV a, FloatV b) { return _mm256_sub_ps(a, b); }
+	FloatV MulV(FloatV a, FloatV b) { return _mm256_mul_ps(a, b); }
+	FloatV MinV(FloatV a, FloatV b) { return _mm256_min_ps(a, b); }
+	FloatV MaxV(FloatV a, FloatV b) { return _mm256_max_ps(a, b); }
+	FloatV AbsV(FloatV a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+	FloatV LessV(FloatV a, FloatV b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+	FloatV SelectV(FloatV mask, FloatV a, FloatV b) { return _mm256_blendv_ps(b, a, mask); } // mask ? a : b
+	IntV   RoundToIntV(FloatV a) { return _mm256_cvtps_epi32(a); }
+	void   StoreIntV(int* p, IntV v) { _mm256_storeu_si256(reinterpret_cast<IntV*>(p), v); }
+	FloatV DivV(FloatV a, FloatV b) { return _mm256_div_ps(a, b); }
+	FloatV ToFloatV(IntV a) { return _mm256_cvtepi32_ps(a); }
+	IntV   TruncToIntV(FloatV a) { return _mm256_cvttps_epi32(a); }
+	IntV   SetIntV(int i) { return _mm256_set1_epi32(i); }
+	IntV   AddIntV(IntV a, IntV b) { return _mm256_add_epi32(a, b); }
+	IntV   AndIntV(IntV a, IntV b) { return _mm256_and_si256(a, b); }
+	IntV   OrIntV(IntV a, IntV b) { return _mm256_or_si256(a, b); }
+	IntV   XorIntV(IntV a, IntV b) { return _mm256_xor_si256(a, b); }
+	IntV   ShlIntV(IntV a, int count) { return _mm256_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+	IntV   ShrIntV(IntV a, int count) { return _mm256_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+	IntV   LessIntV(IntV a, IntV b) { return _mm256_cmpgt_epi32(b, a); }
+	IntV   EqualIntV(IntV a, IntV b) { return _mm256_cmpeq_epi32(a, b); }
+	IntV   SelectIntV(IntV mask, IntV a, IntV b) { return _mm256_blendv_epi8(b, a, mask); } // mask ? a : b
+#else
+	using FloatV = __m128;
+	using IntV = __m128i;
+	constexpr int FLOAT_V_LANES = 4;
+
+	FloatV LoadV(const float* p) { return _mm_load_ps(p); }
+	void   StoreV(float* p, FloatV v) { _mm_store_ps(p, v); }
+	FloatV SetV(float f) { return _mm_set1_ps(f); }
+	FloatV AddV(FloatV a, FloatV b) { return _mm_add_ps(a, b); }
+	FloatV SubV(FloatV a, FloatV b) { return _mm_sub_ps(a, b); }
+	FloatV MulV(FloatV a, FloatV b) { return _mm_mul_ps(a, b); }
+	FloatV MinV(FloatV a, FloatV b) { return _mm_min_ps(a, b); }
+	FloatV MaxV(FloatV a, FloatV b) { return _mm_max_ps(a, b); }
+	FloatV AbsV(FloatV a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+	FloatV LessV(FloatV a, FloatV b) { return _mm_cmplt_ps(a, b); }
+	FloatV SelectV(FloatV mask, FloatV a, FloatV b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+	IntV   RoundToIntV(FloatV a) { return _mm_cvtps_epi32(a); }
+	void   StoreIntV(int* p, IntV v) { _mm_storeu_si128(reinterpret_cast<IntV*>(p), v); }
+	FloatV DivV(FloatV a, FloatV b) { return _mm_div_ps(a, b); }
+	FloatV ToFloatV(IntV a) { return _mm_cvtepi32_ps(a); }
+	IntV   TruncToIntV(FloatV a) { return _mm_cvttps_epi32(a); }
+	IntV   SetIntV(int i) { return _mm_set1_epi32(i); }
+	IntV   AddIntV(IntV a, IntV b) { return _mm_add_epi32(a, b); }
+	IntV   AndIntV(IntV a, IntV b) { return _mm_and_si128(a, b); }
+	IntV   OrIntV(IntV a, IntV b) { return _mm_or_si128(a, b); }
+	IntV   XorIntV(IntV a, IntV b) { return _mm_xor_si128(a, b); }
+	IntV   ShlIntV(IntV a, int count) { return _mm_sll_epi32(a, _mm_cvtsi32_si128(count)); }
+	IntV   ShrIntV(IntV a, int count) { return _mm_srl_epi32(a, _mm_cvtsi32_si128(count)); }
+	IntV   LessIntV(IntV a, IntV b) { return _mm_cmplt_epi32(a, b); }
+	IntV   EqualIntV(IntV a, IntV b) { return _mm_cmpeq_epi32(a, b); }
+	IntV   SelectIntV(IntV mask, IntV a, IntV b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+#endif
+
+	float HorizontalSum(FloatV v)
+	{
+		alignas(32) float lanes[FLOAT_V_LANES];
+		StoreV(lanes, v);
+		float sum = 0.0f;
+		for (float lane : lanes) sum += lane;
+		return sum;
+	}
+
+	float HorizontalMin(FloatV v)
+	{
+		alignas(32) float lanes[FLOAT_V_LANES];
+		StoreV(lanes, v);
+		float value = lanes[0];
+		for (float lane : lanes) value = std::min(value, lane);
+		return value;
+	}
+
+	float HorizontalMax(FloatV v)
+	{
+		alignas(32) float lanes[FLOAT_V_LANES];
+		StoreV(lanes, v);
+		float value = lanes[0];
+		for (float lane : lanes) value = std::max(value, lane);
+		return value;
+	}
+
+	// 4x4 pixel block with channels split to separate arrays for vector processing
+	struct alignas(32) BlockSoA
+	{
+		float R[16];
+		float G[16];
+		float B[16];
+		float A[16];
+	};
+
+	void LoadBlockSoA(const char* src, BlockSoA& block)
+	{
+		// RGBA8 pixel loaded as u32 is 0xAABBGGRR, we split channels by shifting and masking
+#ifdef AM_IMAGE_USE_AVX2
+		const __m256i mask = _mm256_set1_epi32(0xFF);
+		for (int i = 0; i < 16; i += 8)
+		{
+			__m256i pixels = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i * 4));
+			_mm256_store_ps(block.R + i, _mm256_cvtepi32_ps(_mm256_and_si256(pixels, mask)));
+			_mm256_store_ps(block.G + i, _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 8), mask)));
+			_mm256_store_ps(block.B + i, _mm256_cvtepi32_ps(_mm256_and_si256(_mm256_srli_epi32(pixels, 16), mask)));
+			_mm256_store_ps(block.A + i, _mm256_cvtepi32_ps(_mm256_srli_epi32(pixels, 24)));
+		}
+#else
+		const __m128i mask = _mm_set1_epi32(0xFF);
+		for (int i = 0; i < 16; i += 4)
+		{
+			__m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+			_mm_store_ps(block.R + i, _mm_cvtepi32_ps(_mm_and_si128(pixels, mask)));
+			_mm_store_ps(block.G + i, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 8), mask)));
+			_mm_store_ps(block.B + i, _mm_cvtepi32_ps(_mm_and_si128(_mm_srli_epi32(pixels, 16), mask)));
+			_mm_store_ps(block.A + i, _mm_cvtepi32_ps(_mm_srli_epi32(pixels, 24)));
+		}
+#endif
+	}
+
+	void ChannelMinMax(const float* channel, float& outMin, float& outMax)
+	{
+		FloatV vMin = LoadV(channel);
+		FloatV vMax = vMin;
+		for (int i = FLOAT_V_LANES; i < 16; i += FLOAT_V_LANES)
+		{
+			FloatV v = LoadV(channel + i);
+			vMin = MinV(vMin, v);
+			vMax = MaxV(vMax, v);
+		}
+		outMin = HorizontalMin(vMin);
+		outMax = HorizontalMax(vMax);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------
+	// Color (BC1 part of BC1, BC2, BC3)
+	// ---------------------------------------------------------------------------------------------------------------
+
+	struct Color3
+	{
+		float R, G, B;
+
+		Color3() = default;
+		Color3(float r, float g, float b) : R(r), G(g), B(b) {}
+	};
+
+	u16 PackRGB565(const Color3& color)
+	{
+		int r = static_cast<int>(std::clamp(color.R, 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+		int g = static_cast<int>(std::clamp(color.G, 0.0f, 255.0f) * (63.0f / 255.0f) + 0.5f);
+		int b = static_cast<int>(std::clamp(color.B, 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+		return static_cast<u16>(r << 11 | g << 5 | b);
+	}
+
+	// Expands 565 color back to 888 exactly the same way as hardware does
+	Color3 UnpackRGB565(u16 packed)
+	{
+		int r = packed >> 11 & 31;
+		int g = packed >> 5 & 63;
+		int b = packed & 31;
+		return Color3(
+			static_cast<float>(r << 3 | r >> 2),
+			static_cast<float>(g << 2 | g >> 4),
+			static_cast<float>(b << 3 | b >> 2));
+	}
+
+	// Projects every pixel on line between two endpoints and snaps it to one of 4 points (0, 1/3, 2/3, 1)
+	void ComputeColorSteps(const BlockSoA& block, const Color3& c0, const Color3& c1, int outSteps[16])
+	{
+		Color3 dir(c1.R - c0.R, c1.G - c0.G, c1.B - c0.B);
+		float  dirLengthSq = dir.R * dir.R + dir.G * dir.G + dir.B * dir.B;
+		if (dirLengthSq < 1.0f)
+		{
+			std::fill_n(outSteps, 16, 0);
+			return;
+		}
+
+		float  scale = 3.0f / dirLengthSq;
+		FloatV dirR = SetV(dir.R * scale);
+		FloatV dirG = SetV(dir.G * scale);
+		FloatV dirB = SetV(dir.B * scale);
+		FloatV c0R = SetV(c0.R);
+		FloatV c0G = SetV(c0.G);
+		FloatV c0B = SetV(c0.B);
+		FloatV zero = SetV(0.0f);
+		FloatV three = SetV(3.0f);
+		for (int i = 0; i < 16; i += FLOAT_V_LANES)
+		{
+			FloatV t;
+			t = MulV(SubV(LoadV(block.R + i), c0R), dirR);
+			t = AddV(t, MulV(SubV(LoadV(block.G + i), c0G), dirG));
+			t = AddV(t, MulV(SubV(LoadV(block.B + i), c0B), dirB));
+			t = MinV(MaxV(t, zero), three);
+			StoreIntV(outSteps + i, RoundToIntV(t));
+		}
+	}
+
+	// Sum of squared distances between pixels and palette colors they were snapped to
+	float ComputeColorError(const BlockSoA& block, u16 packed0, u16 packed1, const int steps[16])
+	{
+		// Palette must be computed the same way as decoder does it, with integer arithmetic
+		Color3 c0 = UnpackRGB565(packed0);
+		Color3 c1 = UnpackRGB565(packed1);
+		alignas(32) float palR[16], palG[16], palB[16];
+		for (int i = 0; i < 16; i++)
+		{
+			int step = steps[i];
+			palR[i] = static_cast<float>((static_cast<int>(c0.R) * (3 - step) + static_cast<int>(c1.R) * step) / 3);
+			palG[i] = static_cast<float>((static_cast<int>(c0.G) * (3 - step) + static_cast<int>(c1.G) * step) / 3);
+			palB[i] = static_cast<float>((static_cast<int>(c0.B) * (3 - step) + static_cast<int>(c1.B) * step) / 3);
+		}
+
+		FloatV error = SetV(0.0f);
+		for (int i = 0; i < 16; i += FLOAT_V_LANES)
+		{
+			FloatV dR = SubV(LoadV(block.R + i), LoadV(palR + i));
+			FloatV dG = SubV(LoadV(block.G + i), LoadV(palG + i));
+			FloatV dB = SubV(LoadV(block.B + i), LoadV(palB + i));
+			error = AddV(error, AddV(MulV(dR, dR), AddV(MulV(dG, dG), MulV(dB, dB))));
+		}
+		return HorizontalSum(error);
+	}
+
+	// Bounding box of block colors, diagonal is flipped if channels are anti-correlated
+	void FitColorBoundingBox(const BlockSoA& block, Color3& outC0, Color3& outC1)
+	{
+		Color3 cMin, cMax;
+		ChannelMinMax(block.R, cMin.R, cMax.R);
+		ChannelMinMax(block.G, cMin.G, cMax.G);
+		ChannelMinMax(block.B, cMin.B, cMax.B);
+
+		// Check sign of red-green and blue-green covariance relative to box center to pick the right diagonal
+		FloatV centerR = SetV((cMin.R + cMax.R) * 0.5f);
+		FloatV centerG = SetV((cMin.G + cMax.G) * 0.5f);
+		FloatV centerB = SetV((cMin.B + cMax.B) * 0.5f);
+		FloatV covRG = SetV(0.0f);
+		FloatV covBG = SetV(0.0f);
+		for (int i = 0; i < 16; i += FLOAT_V_LANES)
+		{
+			FloatV dG = SubV(LoadV(block.G + i), centerG);
+			covRG = AddV(covRG, MulV(SubV(LoadV(block.R + i), centerR), dG));
+			covBG = AddV(covBG, MulV(SubV(LoadV(block.B + i), centerB), dG));
+		}
+		if (HorizontalSum(covRG) < 0.0f) std::swap(cMin.R, cMax.R);
+		if (HorizontalSum(covBG) < 0.0f) std::swap(cMin.B, cMax.B);
+
+		// Inset box by 1/16 of its size, this reduces error of extreme colors that are usually outliers
+		outC0 = Color3(
+			cMax.R - (cMax.R - cMin.R) / 16.0f,
+			cMax.G - (cMax.G - cMin.G) / 16.0f,
+			cMax.B - (cMax.B - cMin.B) / 16.0f);
+		outC1 = Color3(
+			cMin.R + (cMax.R - cMin.R) / 16.0f,
+			cMin.G + (cMax.G - cMin.G) / 16.0f,
+			cMin.B + (cMax.B - cMin.B) / 16.0f);
+	}
+
+	// Endpoints are extremes of block colors projected on principal axis (found using power iteration)
+	void FitColorPrincipalAxis(const BlockSoA& block, Color3& outC0, Color3& outC1)
+	{
+		// Mean
+		FloatV sumR = LoadV(block.R), sumG = LoadV(block.G), sumB = LoadV(block.B);
+		for (int i = FLOAT_V_LANES; i < 16; i += FLOAT_V_LANES)
+		{
+			sumR = AddV(sumR, LoadV(block.R + i));
+			sumG = AddV(sumG, LoadV(block.G + i));
+			sumB = AddV(sumB, LoadV(block.B + i));
+		}
+		Color3 mean(HorizontalSum(sumR) / 16.0f, HorizontalSum(sumG) / 16.0f, HorizontalSum(sumB) / 16.0f);
+
+		// Covariance matrix
+		FloatV meanR = SetV(mean.R), meanG = SetV(mean.G), meanB = SetV(mean.B);
+		FloatV covRR = SetV(0.0f), covRG = SetV(0.0f), covRB = SetV(0.0f);
+		FloatV covGG = SetV(0.0f), covGB = SetV(0.0f), covBB = SetV(0.0f);
+		for (int i = 0; i < 16; i += FLOAT_V_LANES)
+		{
+			FloatV dR = SubV(LoadV(block.R + i), meanR);
+			FloatV dG = SubV(LoadV(block.G + i), meanG);
+			FloatV dB = SubV(LoadV(block.B + i), meanB);
+			covRR = AddV(covRR, MulV(dR, dR));
+			covRG = AddV(covRG, MulV(dR, dG));
+			covRB = AddV(covRB, MulV(dR, dB));
+			covGG = AddV(covGG, MulV(dG, dG));
+			covGB = AddV(covGB, MulV(dG, dB));
+			covBB = AddV(covBB, MulV(dB, dB));
+		}
+		float cov[6] =
+		{
+			HorizontalSum(covRR), HorizontalSum(covRG), HorizontalSum(covRB),
+			HorizontalSum(covGG), HorizontalSum(covGB), HorizontalSum(covBB),
+		};
+
+		// Power iteration, starting from luminance-like axis converges in few steps on real images
+		Color3 axis(0.299f, 0.587f, 0.114f);
+		for (int k = 0; k < 8; k++)
+		{
+			Color3 next(
+				cov[0] * axis.R + cov[1] * axis.G + cov[2] * axis.B,
+				cov[1] * axis.R + cov[3] * axis.G + cov[4] * axis.B,
+				cov[2] * axis.R + cov[4] * axis.G + cov[5] * axis.B);
+			float length = std::max(std::max(fabsf(next.R), fabsf(next.G)), fabsf(next.B));
+			if (length < 1e-6f) // Solid color block
+				break;
+			axis = Color3(next.R / length, next.G / length, next.B / length);
+		}
+
+		// Project colors on axis to find extremes
+		FloatV axisR = SetV(axis.R), axisG = SetV(axis.G), axisB = SetV(axis.B);
+		FloatV tMin = SetV(FLT_MAX), tMax = SetV(-FLT_MAX);
+		for (int i = 0; i < 16; i += FLOAT_V_LANES)
+		{
+			FloatV t;
+			t = MulV(SubV(LoadV(block.R + i), meanR), axisR);
+			t = AddV(t, MulV(SubV(LoadV(block.G + i), meanG), axisG));
+			t = AddV(t, MulV(SubV(LoadV(block.B + i), meanB), axisB));
+			tMin = MinV(tMin, t);
+			tMax = MaxV(tMax, t);
+		}
+		float axisLengthSq = axis.R * axis.R + axis.G * axis.G + axis.B * axis.B;
+		float t0 = HorizontalMax(tMax) / axisLengthSq;
+		float t1 = HorizontalMin(tMin) / axisLengthSq;
+
+		outC0 = Color3(mean.R + axis.R * t0, mean.G + axis.G * t0, mean.B + axis.B * t0);
+		outC1 = Color3(mean.R + axis.R * t1, mean.G + axis.G * t1, mean.B + axis.B * t1);
+	}
+
+	// Solves least squares problem for endpoints given fixed pixel to palette assignment
+	bool RefineColorEndpoints(const BlockSoA& block, const int steps[16], Color3& outC0, Color3& outC1)
+	{
+		alignas(32) float beta[16];
+		for (int i = 0; i < 16; i++)
+			beta[i] = static_cast<float>(steps[i]) / 3.0f;
+
+		FloatV one = SetV(1.0f);
+		FloatV sumAA = SetV(0.0f), sumBB = SetV(0.0f), sumAB = SetV(0.0f);
+		FloatV sumAR = SetV(0.0f), sumAG = SetV(0.0f), sumAB_ = SetV(0.0f);
+		FloatV sumBR = SetV(0.0f), sumBG = SetV(0.0f), sumBB_ = SetV(0.0f);
+		for (int i = 0; i < 16; i += FLOAT_V_LANES)
+		{
+			FloatV b = LoadV(beta + i);
+			FloatV a = SubV(one, b);
+			FloatV r = LoadV(block.R + i);
+			FloatV g = LoadV(block.G + i);
+			FloatV bl = LoadV(block.B + i);
+			sumAA = AddV(sumAA, MulV(a, a));
+			sumBB = AddV(sumBB, MulV(b, b));
+			sumAB = AddV(sumAB, MulV(a, b));
+			sumAR = AddV(sumAR, MulV(a, r));
+			sumAG = AddV(sumAG, MulV(a, g));
+			sumAB_ = AddV(sumAB_, MulV(a, bl));
+			sumBR = AddV(sumBR, MulV(b, r));
+			sumBG = AddV(sumBG, MulV(b, g));
+			sumBB_ = AddV(sumBB_, MulV(b, bl));
+		}
+
+		float aa = HorizontalSum(sumAA);
+		float bb = HorizontalSum(sumBB);
+		float ab = HorizontalSum(sumAB);
+		float det = aa * bb - ab * ab;
+		if (fabsf(det) < 1e-6f)
+			return false;
+
+		float invDet = 1.0f / det;
+		Color3 x(HorizontalSum(sumAR), HorizontalSum(sumAG), HorizontalSum(sumAB_));
+		Color3 y(HorizontalSum(sumBR), HorizontalSum(sumBG), HorizontalSum(sumBB_));
+		outC0 = Color3(
+			(x.R * bb - y.R * ab) * invDet,
+			(x.G * bb - y.G * ab) * invDet,
+			(x.B * bb - y.B * ab) * invDet);
+		outC1 = Color3(
+			(y.R * aa - x.R * ab) * invDet,
+			(y.G * aa - x.G * ab) * invDet,
+			(y.B * aa - x.B * ab) * invDet);
+		return true;
+	}
+
+	struct ColorFit
+	{
+		u16 Packed0;
+		u16 Packed1;
+		int Steps[16];
+	};
+
+	void QuantizeAndFit(const BlockSoA& block, const Color3& c0, const Color3& c1, ColorFit& fit)
+	{
+		fit.Packed0 = PackRGB565(c0);
+		fit.Packed1 = PackRGB565(c1);
+		ComputeColorSteps(block, UnpackRGB565(fit.Packed0), UnpackRGB565(fit.Packed1), fit.Steps);
+	}
+
+	// Writes 8 byte BC1 color block, color block is always written in 4 color mode
+	void EncodeColorBlock(const BlockSoA& block, char* dst, rageam::graphics::RangeFitQuality quality)
+	{
+		ColorFit fit;
+		Color3 c0, c1;
+		if (quality == rageam::graphics::RangeFitQuality_Preview)
+		{
+			FitColorBoundingBox(block, c0, c1);
+			QuantizeAndFit(block, c0, c1, fit);
+		}
+		else
+		{
+			FitColorPrincipalAxis(block, c0, c1);
+			QuantizeAndFit(block, c0, c1, fit);
+
+			// Refine endpoints using least squares and keep result only if it reduces error
+			ColorFit refinedFit;
+			if (RefineColorEndpoints(block, fit.Steps, c0, c1))
+			{
+				QuantizeAndFit(block, c0, c1, refinedFit);
+				if (ComputeColorError(block, refinedFit.Packed0, refinedFit.Packed1, refinedFit.Steps) <
+					ComputeColorError(block, fit.Packed0, fit.Packed1, fit.Steps))
+				{
+					fit = refinedFit;
+				}
+			}
+		}
+
+		// First endpoint must be greater for 4 color mode, swap endpoints and reverse steps otherwise
+		bool reverse = false;
+		if (fit.Packed0 < fit.Packed1)
+		{
+			std::swap(fit.Packed0, fit.Packed1);
+			reverse = true;
+		}
+
+		// Steps (position on line from first to second endpoint) to BC1 indices
+		static constexpr u32 stepToIndex[] = { 0, 2, 3, 1 };
+
+		u32 indices = 0;
+		if (fit.Packed0 != fit.Packed1) // Solid color otherwise, all indices point to the first endpoint
+		{
+			for (int i = 0; i < 16; i++)
+			{
+				int step = reverse ? 3 - fit.Steps[i] : fit.Steps[i];
+				indices |= stepToIndex[step] << (i * 2);
+			}
+		}
+
+		memcpy(dst + 0, &fit.Packed0, sizeof(u16));
+		memcpy(dst + 2, &fit.Packed1, sizeof(u16));
+		memcpy(dst + 4, &indices, sizeof(u32));
+	}
+
+	static constexpr int SRC_BLOCK_SIZE = 64; // 4x4 RGBA8
+
+	// Loads FLOAT_V_LANES blocks so every vector holds the same pixel of all blocks
+	void LoadPixelsTransposed(const char* srcBlocks, IntV outPixels[16])
+	{
+#ifdef AM_IMAGE_USE_AVX2
+		const __m256i offsets = _mm256_setr_epi32(0, 16, 32, 48, 64, 80, 96, 112); // Block offsets in ints
+		for (int i = 0; i < 16; i++)
+			outPixels[i] = _mm256_i32gather_epi32(reinterpret_cast<const int*>(srcBlocks) + i, offsets, 4);
+#else
+		// Row of 4 pixels from every block, transposed as 4x4 matrix
+		for (int row = 0; row < 4; row++)
+		{
+			__m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBlocks + 0 * SRC_BLOCK_SIZE + row * 16));
+			__m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBlocks + 1 * SRC_BLOCK_SIZE + row * 16));
+			__m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBlocks + 2 * SRC_BLOCK_SIZE + row * 16));
+			__m128i b3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcBlocks + 3 * SRC_BLOCK_SIZE + row * 16));
+			__m128i t0 = _mm_unpacklo_epi32(b0, b1);
+			__m128i t1 = _mm_unpacklo_epi32(b2, b3);
+			__m128i t2 = _mm_unpackhi_epi32(b0, b1);
+			__m128i t3 = _mm_unpackhi_epi32(b2, b3);
+			outPixels[row * 4 + 0] = _mm_unpacklo_epi64(t0, t1);
+			outPixels[row * 4 + 1] = _mm_unpackhi_epi64(t0, t1);
+			outPixels[row * 4 + 2] = _mm_unpacklo_epi64(t2, t3);
+			outPixels[row * 4 + 3] = _mm_unpackhi_epi64(t2, t3);
+		}
+#endif
+	}
+
+	// Same as EncodeColorBlock with preview quality but for FLOAT_V_LANES blocks at once, every vector lane encodes its own block.
+	// Single block encoder spends most of the time on horizontal operations, here there are none
+	// Color block is written to the last 8 bytes of every destination block, so it works for BC1, BC2 and BC3
+	void EncodeColorBlocksPreview(const char* srcBlocks, char* dstBlocks, int dstBlockSize)
+	{
+		IntV pixels[16];
+		LoadPixelsTransposed(srcBlocks, pixels);
+
+		IntV   byteMask = SetIntV(0xFF);
+		FloatV r[16], g[16], b[16];
+		for (int i = 0; i < 16; i++)
+		{
+			IntV pixel = pixels[i];
+			r[i] = ToFloatV(AndIntV(pixel, byteMask));
+			g[i] = ToFloatV(AndIntV(ShrIntV(pixel, 8), byteMask));
+			b[i] = ToFloatV(AndIntV(ShrIntV(pixel, 16), byteMask));
+		}
+
+		// Bounding box, see FitColorBoundingBox
+		FloatV minR = r[0], minG = g[0], minB = b[0];
+		FloatV maxR = r[0], maxG = g[0], maxB = b[0];
+		for (int i = 1; i < 16; i++)
+		{
+			minR = MinV(minR, r[i]); maxR = MaxV(maxR, r[i]);
+			minG = MinV(minG, g[i]); maxG = MaxV(maxG, g[i]);
+			minB = MinV(minB, b[i]); maxB = MaxV(maxB, b[i]);
+		}
+
+		FloatV zero = SetV(0.0f);
+		FloatV half = SetV(0.5f);
+		FloatV centerR = MulV(AddV(minR, maxR), half);
+		FloatV centerG = MulV(AddV(minG, maxG), half);
+		FloatV centerB = MulV(AddV(minB, maxB), half);
+		FloatV covRG = zero;
+		FloatV covBG = zero;
+		for (int i = 0; i < 16; i++)
+		{
+			FloatV dG = SubV(g[i], centerG);
+			covRG = AddV(covRG, MulV(SubV(r[i], centerR), dG));
+			covBG = AddV(covBG, MulV(SubV(b[i], centerB), dG));
+		}
+		FloatV flipR = LessV(covRG, zero);
+		FloatV flipB = LessV(covBG, zero);
+		FloatV hiR = SelectV(flipR, minR, maxR), loR = SelectV(flipR, maxR, minR);
+		FloatV hiB = SelectV(flipB, minB, maxB), loB = SelectV(flipB, maxB, minB);
+
+		FloatV inset = SetV(1.0f / 16.0f);
+		FloatV c0[3] = { SubV(hiR, MulV(SubV(hiR, loR), inset)), SubV(maxG, MulV(SubV(maxG, minG), inset)), SubV(hiB, MulV(SubV(hiB, loB), inset)) };
+		FloatV c1[3] = { AddV(loR, MulV(SubV(hiR, loR), inset)), AddV(minG, MulV(SubV(maxG, minG), inset)), AddV(loB, MulV(SubV(hiB, loB), inset)) };
+
+		// See PackRGB565 and UnpackRGB565
+		FloatV max255 = SetV(255.0f);
+		FloatV scale5 = SetV(31.0f / 255.0f);
+		FloatV scale6 = SetV(63.0f / 255.0f);
+		auto quantize = [&](const FloatV color[3], IntV& outPacked, FloatV outUnpacked[3])
+			{
+				IntV r5 = TruncToIntV(AddV(MulV(MinV(MaxV(color[0], zero), max255), scale5), half));
+				IntV g6 = TruncToIntV(AddV(MulV(MinV(MaxV(color[1], zero), max255), scale6), half));
+				IntV b5 = TruncToIntV(AddV(MulV(MinV(MaxV(color[2], zero), max255), scale5), half));
+				outPacked = OrIntV(OrIntV(ShlIntV(r5, 11), ShlIntV(g6, 5)), b5);
+				outUnpacked[0] = ToFloatV(OrIntV(ShlIntV(r5, 3), ShrIntV(r5, 2)));
+				outUnpacked[1] = ToFloatV(OrIntV(ShlIntV(g6, 2), ShrIntV(g6, 4)));
+				outUnpacked[2] = ToFloatV(OrIntV(ShlIntV(b5, 3), ShrIntV(b5, 2)));
+			};
+		IntV   packed0, packed1;
+		FloatV e0[3], e1[3];
+		quantize(c0, packed0, e0);
+		quantize(c1, packed1, e1);
+
+		// See ComputeColorSteps, solid block gets zero scale and all steps are 0
+		FloatV dirR = SubV(e1[0], e0[0]);
+		FloatV dirG = SubV(e1[1], e0[1]);
+		FloatV dirB = SubV(e1[2], e0[2]);
+		FloatV dirLengthSq = AddV(AddV(MulV(dirR, dirR), MulV(dirG, dirG)), MulV(dirB, dirB));
+		FloatV scale = SelectV(LessV(dirLengthSq, SetV(1.0f)), zero, DivV(SetV(3.0f), dirLengthSq));
+		dirR = MulV(dirR, scale);
+		dirG = MulV(dirG, scale);
+		dirB = MulV(dirB, scale);
+
+		// First endpoint must be greater for 4 color mode, see EncodeColorBlock
+		IntV reverse = LessIntV(packed0, packed1);
+		IntV three = SetIntV(3);
+		IntV one = SetIntV(1);
+		IntV reverseMask = AndIntV(reverse, three);
+
+		FloatV threeF = SetV(3.0f);
+		IntV   indices = SetIntV(0);
+		for (int i = 0; i < 16; i++)
+		{
+			FloatV t;
+			t = MulV(SubV(r[i], e0[0]), dirR);
+			t = AddV(t, MulV(SubV(g[i], e0[1]), dirG));
+			t = AddV(t, MulV(SubV(b[i], e0[2]), dirB));
+			t = MinV(MaxV(t, zero), threeF);
+
+			// 3 - step for reversed endpoints
+			IntV step = XorIntV(RoundToIntV(t), reverseMask);
+
+			// Step to BC1 index (0, 2, 3, 1), computed as ((step + 1) & 3) ^ (step is 0 or 3)
+			IntV isEdge = XorIntV(AndIntV(XorIntV(step, ShrIntV(step, 1)), one), one);
+			IntV index = XorIntV(AndIntV(AddIntV(step, one), three), isEdge);
+			indices = OrIntV(indices, ShlIntV(index, i * 2));
+		}
+		// Solid color, all indices point to the first endpoint
+		indices = SelectIntV(EqualIntV(packed0, packed1), SetIntV(0), indices);
+
+		alignas(32) int outPacked0[FLOAT_V_LANES];
+		alignas(32) int outPacked1[FLOAT_V_LANES];
+		alignas(32) int outIndices[FLOAT_V_LANES];
+		StoreIntV(outPacked0, SelectIntV(reverse, packed1, packed0));
+		StoreIntV(outPacked1, SelectIntV(reverse, packed0, packed1));
+		StoreIntV(outIndices, indices);
+		for (int lane = 0; lane < FLOAT_V_LANES; lane++)
+		{
+			char* dst = dstBlocks + lane * dstBlockSize + dstBlockSize - 8;
+			u16 p0 = static_cast<u16>(outPacked0[lane]);
+			u16 p1 = static_cast<u16>(outPacked1[lane]);
+			memcpy(dst + 0, &p0, sizeof(u16));
+			memcpy(dst + 2, &p1, sizeof(u16));
+			memcpy(dst + 4, &outIndices[lane], sizeof(u32));
+		}
+	}
+
+	// Number of leading blocks that are encoded by EncodeColorBlocksPreview, the rest goes through EncodeColorBlock
+	int GetPreviewBatchedBlockCount(int numBlocks, rageam::graphics::RangeFitQuality quality)
+	{
+		if (quality != rageam::graphics::RangeFitQuality_Preview)
+			return 0;
+		return numBlocks / FLOAT_V_LANES * FLOAT_V_LANES;
+	}
+
+	void EncodeColorBlocksPreviewBatched(int batchedBlocks, char* dstBlocks, const char* srcBlocks, int dstBlockSize)
+	{
+		for (int i = 0; i < batchedBlocks; i += FLOAT_V_LANES)
+			EncodeColorBlocksPreview(srcBlocks + i * SRC_BLOCK_SIZE, dstBlocks + i * dstBlockSize, dstBlockSize);
+	}
+
+	// ---------------------------------------------------------------------------------------------------------------
+	// Alpha / Single channel (BC3 alpha, BC4, BC5)
+	// ---------------------------------------------------------------------------------------------------------------
+
+	// Writes 8 byte BC4 block in 8 value mode
+	void EncodeChannelBlock(const float* channel, char* dst, rageam::graphics::RangeFitQuality quality)
+	{
+		float vMin, vMax;
+		ChannelMinMax(channel, vMin, vMax);
+
+		int a0 = static_cast<int>(vMax + 0.5f);
+		int a1 = static_cast<int>(vMin + 0.5f);
+
+		u64 indices = 0;
+		if (a0 != a1) // Solid value otherwise, all indices point to the first endpoint
+		{
+			alignas(32) int positions[16]; // Position on the line from a1 (0) to a0 (7)
+			if (quality == rageam::graphics::RangeFitQuality_Preview)
+			{
+				FloatV scale = SetV(7.0f / static_cast<float>(a0 - a1));
+				FloatV base = SetV(static_cast<float>(a1));
+				FloatV zero = SetV(0.0f);
+				FloatV seven = SetV(7.0f);
+				for (int i = 0; i < 16; i += FLOAT_V_LANES)
+				{
+					FloatV t = MulV(SubV(LoadV(channel + i), base), scale);
+					t = MinV(MaxV(t, zero), seven);
+					StoreIntV(positions + i, RoundToIntV(t));
+				}
+			}
+			else
+			{
+				// Search for the closest value in exact decoded palette
+				alignas(32) float bestErrors[16];
+				alignas(32) float bestPositions[16] = {};
+				std::fill_n(bestErrors, 16, FLT_MAX);
+				for (int p = 0; p < 8; p++)
+				{
+					FloatV value = SetV(static_cast<float>((a1 * (7 - p) + a0 * p) / 7));
+					FloatV position = SetV(static_cast<float>(p));
+					for (int i = 0; i < 16; i += FLOAT_V_LANES)
+					{
+						FloatV error = AbsV(SubV(LoadV(channel + i), value));
+						FloatV bestError = LoadV(bestErrors + i);
+						FloatV mask = LessV(error, bestError);
+						StoreV(bestErrors + i, SelectV(mask, error, bestError));
+						StoreV(bestPositions + i, SelectV(mask, position, LoadV(bestPositions + i)));
+					}
+				}
+				for (int i = 0; i < 16; i++)
+					positions[i] = static_cast<int>(bestPositions[i]);
+			}
+
+			for (int i = 0; i < 16; i++)
+			{
+				int position = positions[i];
+				u64 index = position == 7 ? 0 : position == 0 ? 1 : 8 - position;
+				indices |= index << (i * 3);
+			}
+		}
+
+		dst[0] = static_cast<char>(a0);
+		dst[1] = static_cast<char>(a1);
+		for (int i = 0; i < 6; i++)
+			dst[2 + i] = static_cast<char>(indices >> (i * 8));
+	}
+
+	// Writes 8 byte BC2 explicit 4-bit alpha block
+	void EncodeExplicitAlphaBlock(const BlockSoA& block, char* dst)
+	{
+		alignas(32) int alpha4[16];
+		FloatV scale = SetV(15.0f / 255.0f);
+		for (int i = 0; i < 16; i += FLOAT_V_LANES)
+			StoreIntV(alpha4 + i, RoundToIntV(MulV(LoadV(block.A + i), scale)));
+
+		u64 bits = 0;
+		for (int i = 0; i < 16; i++)
+			bits |= static_cast<u64>(alpha4[i] & 0xF) << (i * 4);
+		memcpy(dst, &bits, sizeof(u64));
+	}
+}
+
+void rageam::graphics::BCRangeFitEncodeBC1(int numBlocks, char* dstBlocks, const char* srcBlocks, rageam::graphics::RangeFitQuality quality)
+{
+	int batchedBlocks = GetPreviewBatchedBlockCount(numBlocks, quality);
+	EncodeColorBlocksPreviewBatched(batchedBlocks, dstBlocks, srcBlocks, 8);
+	srcBlocks += batchedBlocks * SRC_BLOCK_SIZE;
+	dstBlocks += batchedBlocks * 8;
+
+	BlockSoA block;
+	for (int i = batchedBlocks; i < numBlocks; i++)
+	{
+		LoadBlockSoA(srcBlocks, block);
+		EncodeColorBlock(block, dstBlocks, quality);
+		srcBlocks += SRC_BLOCK_SIZE;
+		dstBlocks += 8;
+	}
+}
+
+void rageam::graphics::BCRangeFitEncodeBC2(int numBlocks, char* dstBlocks, const char* srcBlocks, rageam::graphics::RangeFitQuality quality)
+{
+	int batchedBlocks = GetPreviewBatchedBlockCount(numBlocks, quality);
+	EncodeColorBlocksPreviewBatched(batchedBlocks, dstBlocks, srcBlocks, 16);
+
+	BlockSoA block;
+	for (int i = 0; i < numBlocks; i++)
+	{
+		LoadBlockSoA(srcBlocks, block);
+		EncodeExplicitAlphaBlock(block, dstBlocks);
+		if (i >= batchedBlocks)
+			EncodeColorBlock(block, dstBlocks + 8, quality);
+		srcBlocks += SRC_BLOCK_SIZE;
+		dstBlocks += 16;
+	}
+}
+
+void rageam::graphics::BCRangeFitEncodeBC3(int numBlocks, char* dstBlocks, const char* srcBlocks, rageam::graphics::RangeFitQuality quality)
+{
+	int batchedBlocks = GetPreviewBatchedBlockCount(numBlocks, quality);
+	EncodeColorBlocksPreviewBatched(batchedBlocks, dstBlocks, srcBlocks, 16);
+
+	BlockSoA block;
+	for (int i = 0; i < numBlocks; i++)
+	{
+		LoadBlockSoA(srcBlocks, block);
+		EncodeChannelBlock(block.A, dstBlocks, quality);
+		if (i >= batchedBlocks)
+			EncodeColorBlock(block, dstBlocks + 8, quality);
+		srcBlocks += SRC_BLOCK_SIZE;
+		dstBlocks += 16;
+	}
+}
+
+void rageam::graphics::BCRangeFitEncodeBC4(int numBlocks, char* dstBlocks, const char* srcBlocks, rageam::graphics::RangeFitQuality quality)
+{
+	BlockSoA block;
+	for (int i = 0; i < numBlocks; i++)
+	{
+		LoadBlockSoA(srcBlocks, block);
+		EncodeChannelBlock(block.R, dstBlocks, quality);
+		srcBlocks += SRC_BLOCK_SIZE;
+		dstBlocks += 8;
+	}
+}
+
+void rageam::graphics::BCRangeFitEncodeBC5(int numBlocks, char* dstBlocks, const char* srcBlocks, rageam::graphics::RangeFitQuality quality)
+{
+	BlockSoA block;
+	for (int i = 0; i < numBlocks; i++)
+	{
+		LoadBlockSoA(srcBlocks, block);
+		EncodeChannelBlock(block.R, dstBlocks, quality);
+		EncodeChannelBlock(block.G, dstBlocks + 8, quality);
+		srcBlocks += SRC_BLOCK_SIZE;
+		dstBlocks += 16;
+	}
+}
@@ -0,0 +1,34 @@
+//
+// File: bcrangefit.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "common/types.h"
+
+namespace rageam::graphics
+{
+	// In-tree SIMD block encoder for BC1, BC2, BC3, BC4 and BC5
+	//
+	// Endpoints are picked by fitting a line through block colors (range fit), indices are chosen
+	// by projecting every pixel on that line, which is trivially vectorized with SSE2 / AVX2 (AM_IMAGE_USE_AVX2)
+	//
+	// Doesn't reach quality of bc7enc_rdo or icbc on high settings, but it is the only encoder that supports BC2
+	// and preview tier is many times faster than any other encoder, which makes it suitable for live editing
+
+	enum RangeFitQuality
+	{
+		RangeFitQuality_Preview,	// Bounding box endpoints, single pass, color of several blocks is encoded at once in vector lanes
+		RangeFitQuality_Normal,		// Principal axis endpoints with least squares refinement, exact alpha palette search
+	};
+
+	// Source pixels are 4x4 RGBA blocks placed next to each other (64 bytes per block)
+	void BCRangeFitEncodeBC1(int numBlocks, char* dstBlocks, const char* srcBlocks, RangeFitQuality quality);
+	void BCRangeFitEncodeBC2(int numBlocks, char* dstBlocks, const char* srcBlocks, RangeFitQuality quality);
+	void BCRangeFitEncodeBC3(int numBlocks, char* dstBlocks, const char* srcBlocks, RangeFitQuality quality);
+	void BCRangeFitEncodeBC4(int numBlocks, char* dstBlocks, const char* srcBlocks, RangeFitQuality quality);
+	void BCRangeFitEncodeBC5(int numBlocks, char* dstBlocks, const char* srcBlocks, RangeFitQuality quality);
+}
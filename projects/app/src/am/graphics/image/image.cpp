@@ -4,49 +4,21 @@
 #include "am/file/fileutils.h"
 #include "am/file/pathutils.h"
 #include "am/system/enum.h"
+#include "am/system/trace.h"
+#include "am/system/worker.h"
 #include "helpers/dx11.h"
 #include "imagecache.h"
 #include "bc.h"
+#include "imageresize.h"
 
 #include <webp/decode.h>
 #include <webp/encode.h>
 #include <stb_image_write.h>
-#include <stb_image_resize2.h>
 #include <stb_image.h>
 #include <ddraw.h> // DDS
 #include <lunasvg.h>
 #include <easy/profiler.h>
 
-pVoid rageam::graphics::ImageAlloc(u32 size)
-{
-	return malloc(size);
-}
-
-pVoid rageam::graphics::ImageAllocTemp(u32 size)
-{
-	return ImageAlloc(size);
-}
-
-pVoid rageam::graphics::ImageReAlloc(pVoid block, u32 newSize)
-{
-	return realloc(block, newSize);
-}
-
-pVoid rageam::graphics::ImageReAllocTemp(pVoid block, u32 newSize)
-{
-	return ImageReAlloc(block, newSize);
-}
-
-void rageam::graphics::ImageFree(pVoid block)
-{
-	free(block);
-}
-
-void rageam::graphics::ImageFreeTemp(pVoid block)
-{
-	ImageFree(block);
-}
-
 void rageam::graphics::ImageScaleResolution(int wIn, int hIn, int wTo, int hTo, int& wOut, int& hOut, ResolutionScalingMode mode)
 {
 	// Prevent division by zero
@@ -979,31 +951,14 @@ void rageam::graphics::ImageResize(
 		return;
 	}
 
-	stbir_filter irFilter;
-	switch (filter)
-	{
-	case ResizeFilter_Box:			irFilter = STBIR_FILTER_BOX;			break;
-	case ResizeFilter_Triangle:		irFilter = STBIR_FILTER_TRIANGLE;		break;
-	case ResizeFilter_CubicBSpline: irFilter = STBIR_FILTER_CUBICBSPLINE;	break;
-	case ResizeFilter_CatmullRom:	irFilter = STBIR_FILTER_CATMULLROM;		break;
-	case ResizeFilter_Mitchell:		irFilter = STBIR_FILTER_MITCHELL;		break;
-	case ResizeFilter_Point:		irFilter = STBIR_FILTER_POINT_SAMPLE;	break;
-
-	default: AM_UNREACHABLE("ResizeImagePixels() -> Filter %s is not implemented.", Enum::GetName(filter));
-	}
-
-	stbir_pixel_layout irPixelLayout;
-	switch (fmt)
+	// Exact 2x downscale with box filter (mip maps), simple average of 2x2 pixel quads
+	if (filter == ResizeFilter_Box && xFrom == xTo * 2 && yFrom == yTo * 2)
 	{
-	case ImagePixelFormat_U32:	irPixelLayout = hasAlphaPixels ? STBIR_RGBA : STBIR_4CHANNEL;	break;
-	case ImagePixelFormat_U24:	irPixelLayout = STBIR_RGB;										break;
-	case ImagePixelFormat_U16:	irPixelLayout = hasAlphaPixels ? STBIR_RA : STBIR_2CHANNEL;		break;
-	case ImagePixelFormat_U8:	irPixelLayout = STBIR_1CHANNEL;									break;
-
-	default: AM_UNREACHABLE("ResizeImagePixels() -> Pixel format '%s' is not supported.", Enum::GetName(fmt));
+		ImageDownsampleBox2x2(dst, src, fmt, xFrom, yFrom, hasAlphaPixels);
+		return;
 	}
 
-	stbir_resize(src, xFrom, yFrom, 0, dst, xTo, yTo, 0, irPixelLayout, STBIR_TYPE_UINT8, STBIR_EDGE_CLAMP, irFilter);
+	ImageResampleSeparable(dst, src, filter, fmt, xFrom, yFrom, xTo, yTo, hasAlphaPixels);
 }
 
 char* rageam::graphics::ImageGetPixel(char* pixelData, int x, int y, int width, ImagePixelFormat fmt)
@@ -1227,7 +1182,7 @@ void rageam::graphics::ImageFlipY(char* pixels, int width, int height, ImagePixe
 	EASY_FUNCTION();
 
 	size_t rowPitch = ImageComputeRowPitch(width, fmt);
-	pVoid scanlineBuffer = ImageAlloc(rowPitch);
+	pVoid scanlineBuffer = ImageAllocTemp(rowPitch);
 
 	int halfHeight = height / 2;
 	for (int y = 0; y < halfHeight; y++)
@@ -1240,7 +1195,7 @@ void rageam::graphics::ImageFlipY(char* pixels, int width, int height, ImagePixe
 		memcpy(endLine, scanlineBuffer, rowPitch);
 	}
 
-	ImageFree(scanlineBuffer);
+	ImageFreeTemp(scanlineBuffer);
 }
 
 void rageam::graphics::ImageDoSwizzle(
@@ -1629,6 +1584,13 @@ rageam::graphics::PixelDataOwner rageam::graphics::PixelDataOwner::AllocateWithS
 	return CreateOwned(block);
 }
 
+rageam::graphics::PixelDataOwner rageam::graphics::PixelDataOwner::AllocateTemp(u32 size)
+{
+	// ImageFree ignores arena blocks, so no custom delete function is needed
+	pVoid block = ImageAllocTemp(size);
+	return CreateOwned(block);
+}
+
 rageam::graphics::PixelDataOwner rageam::graphics::PixelDataOwner::AllocateForImage(int width, int height, ImagePixelFormat fmt, int mipCount)
 {
 	u32 totalSize = ImageComputeTotalSizeWithMips(width, height, mipCount, fmt);
@@ -1690,7 +1652,7 @@ rageam::graphics::ImageInfo rageam::graphics::Image::GetInfo() const
 	return info;
 }
 
-u32 rageam::graphics::Image::ComputeHashKey() const
+rageam::Hash128 rageam::graphics::Image::ComputeHashKey() const
 {
 	// Descending by processing time...
 
@@ -1723,7 +1685,7 @@ bool rageam::graphics::Image::EnsurePixelDataLoaded()
 		return true;
 
 	ImageCache* cache = ImageCache::GetInstance();
-	u32			fastHashKey = ImageFactory::GetFastHashKey(m_FilePath);
+	Hash128		fastHashKey = ImageFactory::GetFastHashKey(m_FilePath);
 	ImagePtr	cachedImage = cache->GetFromCache(fastHashKey);
 	if (!cachedImage)
 	{
@@ -1776,11 +1738,12 @@ amPtr<rageam::graphics::Image> rageam::graphics::Image::Resize(int newWidth, int
 	// Resizing is pretty expensive operation, use caching
 	ImageCache* cache = ImageCache::GetInstance();
 
-	u32 hashKey = ComputeHashKey();
-
 	// Mix hash key with new dimensions to get new unique key
-	hashKey = DataHash(&newWidth, sizeof (int), hashKey);
-	hashKey = DataHash(&newHeight, sizeof (int), hashKey);
+	DataHasher hasher;
+	hasher.AddValue(ComputeHashKey());
+	hasher.AddValue(newWidth);
+	hasher.AddValue(newHeight);
+	Hash128 hashKey = hasher.Get128();
 
 	ImagePtr cachedImage = cache->GetFromCache(hashKey);
 	if (cachedImage)
@@ -1806,7 +1769,7 @@ amPtr<rageam::graphics::Image> rageam::graphics::Image::Resize(int newWidth, int
 	return resizedImage;
 }
 
-amPtr<rageam::graphics::Image> rageam::graphics::Image::PadToPowerOfTwo(Vec2S& outUvExtent) const
+amPtr<rageam::graphics::Image> rageam::graphics::Image::PadToPowerOfTwo(Vec2S& outUvExtent, bool temp) const
 {
 	AM_ASSERT(!ImageIsCompressedFormat(m_PixelFormat), "Image::PadToPowerOfTwo() -> Compressed pixel formats are not supported.");
 
@@ -1824,7 +1787,7 @@ amPtr<rageam::graphics::Image> rageam::graphics::Image::PadToPowerOfTwo(Vec2S& o
 	u32 newRowPitch = ImageComputeRowPitch(newWidth, m_PixelFormat);
 	u32 oldRowPitch = ImageComputeRowPitch(m_Width, m_PixelFormat);
 
-	PixelDataOwner bufferOwner = PixelDataOwner::AllocateWithSize(newSlicePitch);
+	PixelDataOwner bufferOwner = temp ? PixelDataOwner::AllocateTemp(newSlicePitch) : PixelDataOwner::AllocateWithSize(newSlicePitch);
 
 	char* buffer = bufferOwner.Data()->Bytes;
 	char* sourcePixels = GetPixelData().Data()->Bytes;
@@ -1867,12 +1830,13 @@ rageam::Vec2S rageam::graphics::Image::ComputePadExtent() const
 	return { x, y };
 }
 
-amPtr<rageam::graphics::Image> rageam::graphics::Image::ConvertPixelFormat(ImagePixelFormat formatTo) const
+amPtr<rageam::graphics::Image> rageam::graphics::Image::ConvertPixelFormat(ImagePixelFormat formatTo, bool temp) const
 {
 	if (m_PixelFormat == formatTo)
 		return ImageFactory::Clone(*this);
 
-	PixelDataOwner dataOwner = PixelDataOwner::AllocateForImage(m_Width, m_Height, formatTo);
+	u32 slicePitch = ImageComputeSlicePitch(m_Width, m_Height, formatTo);
+	PixelDataOwner dataOwner = temp ? PixelDataOwner::AllocateTemp(slicePitch) : PixelDataOwner::AllocateWithSize(slicePitch);
 	ImageConvertPixelFormat(dataOwner.Data(), GetPixelDataBytes(), m_PixelFormat, formatTo, m_Width, m_Height);
 
 	return ImageFactory::Create(dataOwner, formatTo, m_Width, m_Height);
@@ -1880,6 +1844,8 @@ amPtr<rageam::graphics::Image> rageam::graphics::Image::ConvertPixelFormat(Image
 
 amPtr<rageam::graphics::Image> rageam::graphics::Image::GenerateMipMaps(ResizeFilter mipFilter)
 {
+	AM_TRACE_FUNCTION();
+
 	// Image already have mip maps or mips can't be generated (bc formats are loss and meant to be encoded only once)
 	if (ImageIsCompressedFormat(m_PixelFormat) || m_MipCount > 1)
 	{
@@ -1897,6 +1863,15 @@ amPtr<rageam::graphics::Image> rageam::graphics::Image::GenerateMipMaps(ResizeFi
 
 	PixelDataOwner mipPixelData = PixelDataOwner::AllocateForImage(m_Width, m_Height, m_PixelFormat, mipCount);
 	char* mipPixelBytes = mipPixelData.Data()->Bytes;
+
+	// Box filter builds the whole chain from the first mip in a single pass
+	if (mipFilter == ResizeFilter_Box)
+	{
+		memcpy(mipPixelBytes, GetPixelDataBytes(), ComputeSlicePitch());
+		ImageGenerateMipChainBox(mipPixelBytes, m_PixelFormat, m_Width, m_Height, mipCount, hasAlphaPixels);
+		return std::make_shared<Image>(mipPixelData, m_PixelFormat, m_Width, m_Height, mipCount);
+	}
+
 	// We store pointer to previous mip to generate mip from it and not from the largest mip
 	char* prevMipPixelBytes = GetPixelDataBytes();
 
@@ -1964,9 +1939,10 @@ bool rageam::graphics::Image::CreateDX11Resource(
 
 	// Attempt to retrieve view from cache
 	// TODO: Hash is not ideal because two options still may produce the same view
-	u32 viewHash;
-	viewHash = DataHash(m_PixelData.Data()->Bytes, ComputeTotalSizeWithMips());
-	viewHash = DataHash(&options, sizeof ImageDX11ResourceOptions, viewHash);
+	DataHasher viewHasher;
+	viewHasher.AddValue(cache->ComputeImageHash(m_PixelData.Data(), ComputeTotalSizeWithMips()));
+	viewHasher.AddValue(options);
+	Hash128 viewHash = viewHasher.Get128();
 	amComPtr<ID3D11ShaderResourceView> cachedView;
 	amComPtr<ID3D11Texture2D> cachedTex;
 	if (cache->GetFromCacheDX11(viewHash, cachedView, outUV2, &cachedTex))
@@ -2240,7 +2216,7 @@ rageam::graphics::ImagePtr rageam::graphics::ImageFactory::LoadFromPath(ConstWSt
 	ImageCache* imageCache = ImageCache::GetInstance();
 
 	// Try to retrieve image from cache
-	u32 hash = 0;
+	Hash128 hash = {};
 	if (useCache)
 	{
 		hash = GetFastHashKey(path);
@@ -2304,12 +2280,82 @@ rageam::graphics::ImagePtr rageam::graphics::ImageFactory::LoadFromPathAndCompre
 	if (!metaImage)
 		return nullptr;
 
-	u32 fastHash = GetFastHashKey(path);
+	Hash128 fastHash = GetFastHashKey(path);
 
 	ImageCompressor compressor;
 	return compressor.Compress(metaImage, compOptions, &fastHash, outCompInfo, token);
 }
 
+bool rageam::graphics::ImageFactory::LoadFromPathAndCompress(
+	const List<ConstWString>& paths, List<ImageCompressorBatchItem>& batch, const ImageCompressorItemDoneFn& onItemDone)
+{
+	AM_TRACE_FUNCTION();
+
+	AM_ASSERT(paths.GetSize() == batch.GetSize(), "ImageFactory::LoadFromPathAndCompress() -> Path count doesn't match batch size.");
+
+	// Load only metadata of images that need to be compressed, pre-compressed DDS images are loaded as is
+	List<bool> needCompression;
+	needCompression.Resize(paths.GetSize());
+	{
+		Tasks loadTasks;
+		loadTasks.Reserve(paths.GetSize());
+		for (u32 i = 0; i < paths.GetSize(); i++)
+		{
+			loadTasks.Emplace(BackgroundWorker::Run([&, i]
+				{
+					ConstWString path = paths[i];
+					ImageCompressorBatchItem& item = batch[i];
+
+					needCompression[i] = false;
+					if (GetImageKindFromPath(path) == ImageKind_DDS && !item.Options.AllowRecompress)
+					{
+						item.Result = LoadFromPathAndCompress(path, item.Options, &item.CompInfo);
+						return item.Result != nullptr;
+					}
+
+					// We need only metadata so no reason to cache
+					item.Image = LoadFromPath(path, true);
+					if (!item.Image)
+						return false;
+
+					item.PixelHashOverride = GetFastHashKey(path);
+					needCompression[i] = true;
+					return true;
+				}));
+		}
+		BackgroundWorker::WaitFor(loadTasks);
+	}
+
+	// Items are moved to temporary batch, so images that don't need compression are not processed
+	List<ImageCompressorBatchItem> compressBatch;
+	List<u32> compressBatchIndices;
+	bool success = true;
+	for (u32 i = 0; i < batch.GetSize(); i++)
+	{
+		if (needCompression[i])
+		{
+			compressBatch.Add(batch[i]);
+			compressBatchIndices.Add(i);
+			continue;
+		}
+
+		// Loaded as is or failed to load
+		if (!batch[i].Result)
+			success = false;
+		if (onItemDone)
+			onItemDone(i);
+	}
+
+	bool compressed = ImageCompressor::CompressBatch(compressBatch, [&](u32 compressIndex)
+		{
+			u32 index = compressBatchIndices[compressIndex];
+			batch[index] = compressBatch[compressIndex];
+			if (onItemDone)
+				onItemDone(index);
+		});
+	return success && compressed;
+}
+
 bool rageam::graphics::ImageFactory::LoadIco(ConstWString path, List<ImagePtr>& icons)
 {
 	// See https://en.wikipedia.org/wiki/ICO_(file_format)#cite_note-bigSize-7 for format description
@@ -2449,6 +2495,11 @@ rageam::graphics::ImagePtr rageam::graphics::ImageFactory::Create(
 	return std::make_shared<Image>(pixelData, fmt, width, height, 1, copyPixels);
 }
 
+rageam::graphics::ImagePtr rageam::graphics::ImageFactory::Create(const PixelDataOwner& pixelData, const ImageInfo& info, bool copyPixels)
+{
+	return std::make_shared<Image>(pixelData, info, copyPixels);
+}
+
 rageam::graphics::ImagePtr rageam::graphics::ImageFactory::Clone(const Image& image)
 {
 	return std::make_shared<Image>(image.m_PixelData, image.GetInfo(), false);
@@ -2483,13 +2534,12 @@ rageam::graphics::ImagePtr rageam::graphics::ImageFactory::CreateChecker(ColorU3
 	return Create(pixelDataOwner, ImagePixelFormat_U32, size, size);
 }
 
-u32 rageam::graphics::ImageFactory::GetFastHashKey(ConstWString path)
+rageam::Hash128 rageam::graphics::ImageFactory::GetFastHashKey(ConstWString path)
 {
-	u32 hash;
-	u64 fileTime = file::GetFileModifyTime(path);
-	hash = Hash(path);
-	hash = DataHash(&fileTime, sizeof u64, hash);
-	return hash;
+	DataHasher hasher;
+	hasher.Add(path, wcslen(path) * sizeof(wchar_t));
+	hasher.AddValue(file::GetFileModifyTime(path));
+	return hasher.Get128();
 }
 
 bool rageam::graphics::ImageFactory::CanBlockCompressImage(ConstWString path)
@@ -9,15 +9,17 @@
 
 #include "am/system/enum.h"
 #include "am/graphics/color.h"
+#include "am/system/datahash.h"
 #include "am/system/nullable.h"
 #include "am/system/ptr.h"
 #include "am/types.h"
+#include "imagealloc.h"
 
 #include <d3d11.h>
+#include <functional>
 
 // TODO:
 // - HSV / Levels
-// - Large allocator for images, currently we use malloc
 // - Alpha test coverage in encoder is done even if texture has no alpha
 //
 // Formats
@@ -26,11 +28,15 @@
 namespace rageam::graphics
 {
 	struct ImageCompressorToken;
+	struct ImageCompressorBatchItem;
 	struct CompressedImageInfo;
 	struct ImageCompressorOptions;
 	class PixelDataOwner;
 	class Image;
 
+	// Invoked on thread that compresses the batch as soon as item is done (or failed), argument is index of item in the batch
+	using ImageCompressorItemDoneFn = std::function<void(u32 itemIndex)>;
+
 	// Enables mix of SSE and AVX2 image processing
 	// AVX2 (AM_IMAGE_USE_AVX2) is enabled if project is created with --avx2 options
 	// NOTE: Third party libraries will use SSE2 regardless! This option exists only for testing / benchmarking
@@ -41,15 +47,6 @@ namespace rageam::graphics
 	static constexpr size_t IMAGE_RGBA_PITCH = 4;
 	static constexpr size_t IMAGE_RGB_PITCH = 3;
 
-	// We use those memory allocation functions because system heap is limited and not suitable for this
-
-	pVoid ImageAlloc(u32 size);
-	pVoid ImageAllocTemp(u32 size);
-	pVoid ImageReAlloc(pVoid block, u32 newSize);
-	pVoid ImageReAllocTemp(pVoid block, u32 newSize);
-	void  ImageFree(pVoid block);
-	void  ImageFreeTemp(pVoid block);
-
 	enum ImageFileKind
 	{
 		ImageKind_None,
@@ -330,6 +327,8 @@ namespace rageam::graphics
 		static PixelDataOwner CreateOwned(pVoid data);
 
 		static PixelDataOwner AllocateWithSize(u32 size);
+		// Allocates from arena of active image job (see ImageAllocJobScope), pixel data must not outlive the job
+		static PixelDataOwner AllocateTemp(u32 size);
 		static PixelDataOwner AllocateForImage(int width, int height, ImagePixelFormat fmt, int mipCount = 1);
 
 		PixelDataOwner& operator=(const PixelDataOwner& other);
@@ -344,7 +343,7 @@ namespace rageam::graphics
 		friend class ImageFactory;
 
 		wstring			 m_DebugName;
-		Nullable<u32>	 m_FastHashKey;
+		Nullable<Hash128> m_FastHashKey;
 		file::WPath		 m_FilePath;		// In case if image was loaded from file
 		int				 m_Width;
 		int				 m_Height;
@@ -371,7 +370,7 @@ namespace rageam::graphics
 		u32 ComputeSlicePitch() const { return ImageComputeSlicePitch(m_Width, m_Height, m_PixelFormat); }
 		u32 ComputeTotalSizeWithMips() const { return ImageComputeTotalSizeWithMips(m_Width, m_Height, m_MipCount, m_PixelFormat); }
 
-		u32 ComputeHashKey() const;
+		Hash128 ComputeHashKey() const;
 
 		// Set to image file name with extension by default
 		// For memory images, 'None' is default
@@ -414,10 +413,11 @@ namespace rageam::graphics
 		// (which is the case for most regular pictures from for e.g. internet)
 		// the solution is to add empty padding pixels and draw using adjusted UV coordinates
 		// If image is already sized power of two, clone is returned
-		amPtr<Image> PadToPowerOfTwo(Vec2S& outUvExtent) const;
+		// Temp image is allocated from active image job arena, see PixelDataOwner::AllocateTemp
+		amPtr<Image> PadToPowerOfTwo(Vec2S& outUvExtent, bool temp = false) const;
 		Vec2S		 ComputePadExtent() const;
 		// If format matches current, shallow clone is returned
-		amPtr<Image> ConvertPixelFormat(ImagePixelFormat formatTo) const;
+		amPtr<Image> ConvertPixelFormat(ImagePixelFormat formatTo, bool temp = false) const;
 		// Will return existing pixel data if image already have more than 1 mip map or pixels are block compressed
 		amPtr<Image> GenerateMipMaps(ResizeFilter mipFilter = ResizeFilter_Box);
 		// Makes sure that image resolution is smaller equal to given constraint,
@@ -465,6 +465,12 @@ namespace rageam::graphics
 		// NOTE: Pixels loaded from DDS, even uncompressed (for example RGBA) are returned as is, unless ImageCompressorOptions::AllowRecompress is set!
 		static ImagePtr LoadFromPathAndCompress(
 			ConstWString path, const ImageCompressorOptions& compOptions, CompressedImageInfo* outCompInfo = nullptr, ImageCompressorToken* token = nullptr);
+		// Batched version of function above, all images are compressed together using ImageCompressor::CompressBatch
+		// Batch items must be allocated for every path with options set, result and compression info are set by this function
+		// Item is set in the batch before onItemDone is invoked, see ImageCompressorItemDoneFn
+		// Returns False if at least one image failed to load or compress
+		static bool LoadFromPathAndCompress(
+			const List<ConstWString>& paths, List<ImageCompressorBatchItem>& batch, const ImageCompressorItemDoneFn& onItemDone = nullptr);
 
 		// Exists as separate loader because format does not quite fit in existing architecture
 		// Only PNG and 32Bit BMP formats are supported
@@ -474,6 +480,7 @@ namespace rageam::graphics
 
 		// Copying pixels is only reasonable if given buffer data is temporary and may change
 		static ImagePtr Create(const PixelDataOwner& pixelData, ImagePixelFormat fmt, int width, int height, bool copyPixels = false);
+		static ImagePtr Create(const PixelDataOwner& pixelData, const ImageInfo& info, bool copyPixels = false);
 
 		// Creates image with reference on the existing pixel data without copying
 		static ImagePtr Clone(const Image& image);
@@ -486,8 +493,8 @@ namespace rageam::graphics
 		static ImagePtr CreateChecker_Opacity(int size = 512, int tileSize = 8) { return CreateChecker(COLOR_GRAY, COLOR_WHITE, size, tileSize); }
 		static ImagePtr CreateChecker(ColorU32 color0, ColorU32 color1, int size = 512, int tileSize = 8);
 
-		// atStringHash of path mixed with file modify time
-		static u32 GetFastHashKey(ConstWString path);
+		// Hash of path mixed with file modify time
+		static Hash128 GetFastHashKey(ConstWString path);
 
 		static bool CanBlockCompressImage(ConstWString path);
 
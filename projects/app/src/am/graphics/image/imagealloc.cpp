@@ -0,0 +1,434 @@
+#include "imagealloc.h"
+
+#include "am/system/asserts.h"
+
+#include <atomic>
+#include <bit>
+#include <mutex>
+
+namespace rageam::graphics
+{
+	namespace
+	{
+		static constexpr u32 IMAGE_BLOCK_MAGIC = 0x21474D49; // IMG!
+		static constexpr u16 IMAGE_BLOCK_NO_CLASS = 0xFFFF;
+
+		enum ImageBlockFlags_ : u16
+		{
+			ImageBlockFlags_None = 0,
+			ImageBlockFlags_Arena = 1 << 0, // Block is owned by arena, free is ignored
+		};
+
+		// Placed right before every block returned to user, 16 bytes to keep SIMD alignment of malloc
+		struct alignas(16) ImageBlockHeader
+		{
+			u32 Size;		// Requested size
+			u32 Magic;
+			u16 SizeClass;	// IMAGE_BLOCK_NO_CLASS if block is allocated directly with malloc
+			u16 Flags;
+		};
+		static_assert(sizeof(ImageBlockHeader) == 16);
+
+		// 4 size classes per power of two: 1.25, 1.5, 1.75 and 2.0 of previous power of two
+		static constexpr int IMAGE_ALLOC_SUBCLASS_COUNT = 4;
+		static constexpr int IMAGE_ALLOC_MIN_CLASS_EXP = std::bit_width(IMAGE_ALLOC_MIN_CLASS_SIZE) - 1;
+		static constexpr int IMAGE_ALLOC_MAX_CLASS_EXP = std::bit_width(IMAGE_ALLOC_MAX_CLASS_SIZE) - 1;
+		static constexpr int IMAGE_ALLOC_CLASS_COUNT = (IMAGE_ALLOC_MAX_CLASS_EXP - IMAGE_ALLOC_MIN_CLASS_EXP) * IMAGE_ALLOC_SUBCLASS_COUNT;
+
+		u16 GetSizeClass(u32 size)
+		{
+			if (size <= IMAGE_ALLOC_MIN_CLASS_SIZE || size > IMAGE_ALLOC_MAX_CLASS_SIZE)
+				return IMAGE_BLOCK_NO_CLASS;
+
+			u32 value = size - 1;
+			int exp = std::bit_width(value) - 1;
+			int subClass = static_cast<int>((value - (1u << exp)) >> (exp - 2));
+			return static_cast<u16>((exp - IMAGE_ALLOC_MIN_CLASS_EXP) * IMAGE_ALLOC_SUBCLASS_COUNT + subClass);
+		}
+
+		u64 GetClassCapacity(u16 sizeClass)
+		{
+			int exp = IMAGE_ALLOC_MIN_CLASS_EXP + sizeClass / IMAGE_ALLOC_SUBCLASS_COUNT;
+			int subClass = sizeClass % IMAGE_ALLOC_SUBCLASS_COUNT;
+			u64 base = 1ull << exp;
+			return base + (subClass + 1) * (base / IMAGE_ALLOC_SUBCLASS_COUNT);
+		}
+
+		u64 GetBlockCapacity(const ImageBlockHeader* header)
+		{
+			return header->SizeClass == IMAGE_BLOCK_NO_CLASS ? header->Size : GetClassCapacity(header->SizeClass);
+		}
+
+		ImageBlockHeader* GetBlockHeader(pVoid block)
+		{
+			ImageBlockHeader* header = static_cast<ImageBlockHeader*>(block) - 1;
+			AM_ASSERT(header->Magic == IMAGE_BLOCK_MAGIC, "ImageAlloc -> Block %p was not allocated by image allocator!", block);
+			return header;
+		}
+
+		// Free blocks are linked through their (unused) memory
+		ImageBlockHeader*& GetNextFree(ImageBlockHeader* header) { return *reinterpret_cast<ImageBlockHeader**>(header + 1); }
+
+		std::atomic<u64> s_BytesInUse;
+		std::atomic<u64> s_BytesReserved;
+		std::atomic<u64> s_BytesCached;
+		std::atomic<u64> s_BytesArena;
+		std::atomic<u64> s_AllocCount;
+		std::atomic<u64> s_RecycleCount;
+
+		ImageBlockHeader* SystemAlloc(u64 capacity)
+		{
+			ImageBlockHeader* header = static_cast<ImageBlockHeader*>(malloc(sizeof(ImageBlockHeader) + capacity));
+			if (header)
+				s_BytesReserved += capacity;
+			return header;
+		}
+
+		void SystemFree(ImageBlockHeader* header)
+		{
+			s_BytesReserved -= GetBlockCapacity(header);
+			free(header);
+		}
+
+		struct ImageFreeLists
+		{
+			ImageBlockHeader* Heads[IMAGE_ALLOC_CLASS_COUNT] = {};
+			u64				  CachedSize = 0;
+
+			ImageBlockHeader* Pop(u16 sizeClass)
+			{
+				ImageBlockHeader* header = Heads[sizeClass];
+				if (!header)
+					return nullptr;
+				Heads[sizeClass] = GetNextFree(header);
+				CachedSize -= GetClassCapacity(sizeClass);
+				return header;
+			}
+
+			bool TryPush(ImageBlockHeader* header, u64 budget)
+			{
+				u64 capacity = GetClassCapacity(header->SizeClass);
+				if (CachedSize + capacity > budget)
+					return false;
+				GetNextFree(header) = Heads[header->SizeClass];
+				Heads[header->SizeClass] = header;
+				CachedSize += capacity;
+				return true;
+			}
+
+			void ReleaseAll()
+			{
+				for (ImageBlockHeader*& head : Heads)
+				{
+					while (head)
+					{
+						ImageBlockHeader* next = GetNextFree(head);
+						s_BytesCached -= GetClassCapacity(head->SizeClass);
+						SystemFree(head);
+						head = next;
+					}
+				}
+				CachedSize = 0;
+			}
+		};
+
+		struct ImageSharedPool
+		{
+			std::mutex	   Mutex;
+			ImageFreeLists FreeLists;
+		};
+
+		ImageSharedPool& GetSharedPool()
+		{
+			static ImageSharedPool pool;
+			return pool;
+		}
+
+		// Free blocks are first kept on thread that released them, without any locking
+		struct ImageThreadCache
+		{
+			ImageFreeLists FreeLists;
+
+			~ImageThreadCache();
+		};
+
+		// Gives cached blocks to shared pool so other threads can use them
+		void FlushThreadCache(ImageThreadCache& cache)
+		{
+			if (cache.FreeLists.CachedSize == 0)
+				return;
+
+			ImageSharedPool& pool = GetSharedPool();
+			std::unique_lock lock(pool.Mutex);
+			for (ImageBlockHeader*& head : cache.FreeLists.Heads)
+			{
+				while (head)
+				{
+					ImageBlockHeader* next = GetNextFree(head);
+					if (!pool.FreeLists.TryPush(head, IMAGE_ALLOC_POOL_BUDGET))
+					{
+						s_BytesCached -= GetClassCapacity(head->SizeClass);
+						SystemFree(head);
+					}
+					head = next;
+				}
+			}
+			cache.FreeLists.CachedSize = 0;
+		}
+
+		ImageThreadCache::~ImageThreadCache()
+		{
+			FlushThreadCache(*this);
+		}
+
+		thread_local ImageThreadCache tl_ThreadCache;
+		thread_local ImageArena*	  tl_Arena = nullptr;
+
+		ImageBlockHeader* AllocBlock(u32 size)
+		{
+			++s_AllocCount;
+
+			u16 sizeClass = GetSizeClass(size);
+
+			ImageBlockHeader* header;
+			if (sizeClass != IMAGE_BLOCK_NO_CLASS)
+			{
+				header = tl_ThreadCache.FreeLists.Pop(sizeClass);
+				if (!header)
+				{
+					ImageSharedPool& pool = GetSharedPool();
+					std::unique_lock lock(pool.Mutex);
+					header = pool.FreeLists.Pop(sizeClass);
+				}
+
+				if (header)
+				{
+					s_BytesCached -= GetClassCapacity(sizeClass);
+					++s_RecycleCount;
+				}
+				else
+				{
+					header = SystemAlloc(GetClassCapacity(sizeClass));
+				}
+			}
+			else
+			{
+				header = SystemAlloc(size);
+			}
+
+			if (!header)
+				return nullptr;
+
+			header->Size = size;
+			header->Magic = IMAGE_BLOCK_MAGIC;
+			header->SizeClass = sizeClass;
+			header->Flags = ImageBlockFlags_None;
+			s_BytesInUse += size;
+			return header;
+		}
+
+		void FreeBlock(ImageBlockHeader* header)
+		{
+			s_BytesInUse -= header->Size;
+
+			if (header->SizeClass == IMAGE_BLOCK_NO_CLASS)
+			{
+				SystemFree(header);
+				return;
+			}
+
+			u64 capacity = GetClassCapacity(header->SizeClass);
+			if (tl_ThreadCache.FreeLists.TryPush(header, IMAGE_ALLOC_THREAD_CACHE_BUDGET))
+			{
+				s_BytesCached += capacity;
+				return;
+			}
+
+			{
+				ImageSharedPool& pool = GetSharedPool();
+				std::unique_lock lock(pool.Mutex);
+				if (pool.FreeLists.TryPush(header, IMAGE_ALLOC_POOL_BUDGET))
+				{
+					s_BytesCached += capacity;
+					return;
+				}
+			}
+
+			SystemFree(header);
+		}
+	}
+}
+
+pVoid rageam::graphics::ImageAlloc(u32 size)
+{
+	ImageBlockHeader* header = AllocBlock(size);
+	return header ? header + 1 : nullptr;
+}
+
+pVoid rageam::graphics::ImageAllocTemp(u32 size)
+{
+	if (tl_Arena)
+		return tl_Arena->Alloc(size);
+	return ImageAlloc(size);
+}
+
+pVoid rageam::graphics::ImageReAlloc(pVoid block, u32 newSize)
+{
+	if (!block)
+		return ImageAlloc(newSize);
+
+	ImageBlockHeader* header = GetBlockHeader(block);
+
+	// New size still fits in the size class, nothing to do
+	bool isArenaBlock = header->Flags & ImageBlockFlags_Arena;
+	if (!isArenaBlock && header->SizeClass != IMAGE_BLOCK_NO_CLASS && newSize <= GetClassCapacity(header->SizeClass))
+	{
+		s_BytesInUse -= header->Size;
+		s_BytesInUse += newSize;
+		header->Size = newSize;
+		return block;
+	}
+
+	// Blocks reallocated from arena are moved to heap because they may outlive arena
+	pVoid newBlock = ImageAlloc(newSize);
+	if (!newBlock)
+		return nullptr;
+	memcpy(newBlock, block, MIN(header->Size, newSize));
+	ImageFree(block);
+	return newBlock;
+}
+
+pVoid rageam::graphics::ImageReAllocTemp(pVoid block, u32 newSize)
+{
+	if (!block)
+		return ImageAllocTemp(newSize);
+
+	// Arena block that doesn't grow can stay in arena
+	ImageBlockHeader* header = GetBlockHeader(block);
+	if (header->Flags & ImageBlockFlags_Arena && newSize <= header->Size)
+	{
+		header->Size = newSize;
+		return block;
+	}
+
+	if (!tl_Arena)
+		return ImageReAlloc(block, newSize);
+
+	pVoid newBlock = tl_Arena->Alloc(newSize);
+	if (!newBlock)
+		return nullptr;
+	memcpy(newBlock, block, MIN(header->Size, newSize));
+	ImageFree(block);
+	return newBlock;
+}
+
+void rageam::graphics::ImageFree(pVoid block)
+{
+	if (!block)
+		return;
+
+	ImageBlockHeader* header = GetBlockHeader(block);
+	if (header->Flags & ImageBlockFlags_Arena) // Released with arena
+		return;
+
+	FreeBlock(header);
+}
+
+void rageam::graphics::ImageFreeTemp(pVoid block)
+{
+	ImageFree(block);
+}
+
+rageam::graphics::ImageAllocStats rageam::graphics::ImageAllocGetStats()
+{
+	ImageAllocStats stats;
+	stats.BytesInUse = s_BytesInUse;
+	stats.BytesReserved = s_BytesReserved;
+	stats.BytesCached = s_BytesCached;
+	stats.BytesArena = s_BytesArena;
+	stats.AllocCount = s_AllocCount;
+	stats.RecycleCount = s_RecycleCount;
+	return stats;
+}
+
+void rageam::graphics::ImageAllocTrim()
+{
+	tl_ThreadCache.FreeLists.ReleaseAll();
+
+	ImageSharedPool& pool = GetSharedPool();
+	std::unique_lock lock(pool.Mutex);
+	pool.FreeLists.ReleaseAll();
+}
+
+void rageam::graphics::ImageAllocFlushThreadCache()
+{
+	FlushThreadCache(tl_ThreadCache);
+}
+
+rageam::graphics::ImageArena::~ImageArena()
+{
+	Release();
+}
+
+pVoid rageam::graphics::ImageArena::Alloc(u32 size)
+{
+	static constexpr uintptr_t alignMask = IMAGE_ARENA_ALIGNMENT - 1;
+
+	// Block after header must be aligned, not the header itself
+	auto placeBlock = [size](const Chunk& chunk) -> uintptr_t
+		{
+			uintptr_t chunkBegin = reinterpret_cast<uintptr_t>(chunk.Data);
+			uintptr_t block = (chunkBegin + chunk.Used + sizeof(ImageBlockHeader) + alignMask) & ~alignMask;
+			return block + size <= chunkBegin + chunk.Size ? block : 0;
+		};
+
+	// Chunks are only bumped, once block doesn't fit in the last one we start a new chunk
+	uintptr_t block = m_Chunks.Any() ? placeBlock(m_Chunks.Last()) : 0;
+	if (!block)
+	{
+		u32 chunkSize = MAX(IMAGE_ARENA_CHUNK_SIZE, size + static_cast<u32>(sizeof(ImageBlockHeader)) + IMAGE_ARENA_ALIGNMENT);
+		pVoid chunkData = ImageAlloc(chunkSize);
+		if (!chunkData)
+			return nullptr;
+
+		s_BytesArena += chunkSize;
+		m_Chunks.Add(Chunk { static_cast<char*>(chunkData), chunkSize, 0 });
+		block = placeBlock(m_Chunks.Last());
+	}
+
+	Chunk& chunk = m_Chunks.Last();
+	chunk.Used = static_cast<u32>(block + size - reinterpret_cast<uintptr_t>(chunk.Data));
+
+	ImageBlockHeader* header = reinterpret_cast<ImageBlockHeader*>(block) - 1;
+	header->Size = size;
+	header->Magic = IMAGE_BLOCK_MAGIC;
+	header->SizeClass = IMAGE_BLOCK_NO_CLASS;
+	header->Flags = ImageBlockFlags_Arena;
+	return header + 1;
+}
+
+void rageam::graphics::ImageArena::Release()
+{
+	for (Chunk& chunk : m_Chunks)
+	{
+		s_BytesArena -= chunk.Size;
+		ImageFree(chunk.Data);
+	}
+	m_Chunks.Destroy();
+}
+
+rageam::graphics::ImageAllocJobScope::ImageAllocJobScope()
+{
+	m_PreviousArena = tl_Arena;
+	tl_Arena = &m_Arena;
+}
+
+rageam::graphics::ImageAllocJobScope::~ImageAllocJobScope()
+{
+	tl_Arena = m_PreviousArena;
+	m_Arena.Release();
+
+	// Outer job may still allocate, give cache away only when thread is done with image jobs
+	if (!m_PreviousArena)
+		ImageAllocFlushThreadCache();
+}
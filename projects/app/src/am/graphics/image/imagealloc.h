@@ -0,0 +1,102 @@
+//
+// File: imagealloc.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "am/types.h"
+
+namespace rageam::graphics
+{
+	// Large block allocator for image pixel data
+	//
+	// Allocations larger than IMAGE_ALLOC_MIN_CLASS_SIZE are rounded up to size class (4 classes per power of two,
+	// so power of two mip chains fit exactly) and freed blocks are kept in thread local free lists and then in
+	// shared pool for recycling, this removes page faults and heap lock contention when many images are processed in parallel
+	//
+	// Every block has small header, so blocks from any of the functions below can be freed / reallocated by any other
+
+	static constexpr u32 IMAGE_ALLOC_MIN_CLASS_SIZE = 64u << 10;		// Smaller blocks go directly to malloc
+	static constexpr u64 IMAGE_ALLOC_MAX_CLASS_SIZE = 1ull << 30;		// Larger blocks go directly to malloc
+	static constexpr u64 IMAGE_ALLOC_THREAD_CACHE_BUDGET = 64ull << 20;	// Max size of free blocks cached per thread
+	static constexpr u64 IMAGE_ALLOC_POOL_BUDGET = 512ull << 20;		// Max size of free blocks cached in shared pool
+	static constexpr u32 IMAGE_ARENA_CHUNK_SIZE = 1u << 20;				// Larger temp blocks get chunk of their own size
+	static constexpr u32 IMAGE_ARENA_ALIGNMENT = 32;					// Temp blocks are used as AVX2 scratch buffers
+
+	// We use those memory allocation functions because system heap is limited and not suitable for this
+
+	pVoid ImageAlloc(u32 size);
+	// Allocates from arena of active job on this thread if there's one (see ImageAllocJobScope)
+	// Temp blocks must not leave the job, they are all released at once when job ends
+	pVoid ImageAllocTemp(u32 size);
+	pVoid ImageReAlloc(pVoid block, u32 newSize);
+	pVoid ImageReAllocTemp(pVoid block, u32 newSize);
+	void  ImageFree(pVoid block);
+	void  ImageFreeTemp(pVoid block);
+
+	struct ImageAllocStats
+	{
+		u64 BytesInUse;			// Requested size of all live blocks
+		u64 BytesReserved;		// Size of all blocks allocated from system, including cached ones
+		u64 BytesCached;		// Size of free blocks kept for recycling
+		u64 BytesArena;			// Size of arena chunks of active jobs
+		u64 AllocCount;			// Total number of allocations
+		u64 RecycleCount;		// Number of allocations served from free lists
+	};
+	ImageAllocStats ImageAllocGetStats();
+	// Releases free blocks cached in shared pool and on calling thread back to system
+	void ImageAllocTrim();
+
+	// Moves free blocks cached on calling thread to shared pool, blocks that don't fit in pool budget are released to system
+	void ImageAllocFlushThreadCache();
+
+	/**
+	 * \brief Bump allocator for temporary buffers of single job, all memory is released at once.
+	 * \remarks Arena is not thread safe, it must be used only by thread that created it.
+	 */
+	class ImageArena
+	{
+		struct Chunk
+		{
+			char* Data;
+			u32	  Size;
+			u32	  Used;
+		};
+
+		List<Chunk> m_Chunks;
+
+	public:
+		ImageArena() = default;
+		ImageArena(const ImageArena&) = delete;
+		~ImageArena();
+
+		pVoid Alloc(u32 size);
+		// Invalidates all allocated blocks and returns memory to image allocator
+		void  Release();
+
+		ImageArena& operator=(const ImageArena&) = delete;
+	};
+
+	/**
+	 * \brief Scope of single image job (for e.g. preparing mip or encoding block rows) on current thread.
+	 * While scope is alive, ImageAllocTemp allocates from arena of this job and ImageFreeTemp ignores arena blocks,
+	 * arena is released when scope ends. Scopes can be nested, inner job gets its own arena.
+	 * When outermost scope ends, thread cache is flushed (see ImageAllocFlushThreadCache). Worker threads live as long as
+	 * application, without it every worker would hold up to IMAGE_ALLOC_THREAD_CACHE_BUDGET of free blocks after job is done.
+	 */
+	class ImageAllocJobScope
+	{
+		ImageArena	m_Arena;
+		ImageArena* m_PreviousArena;
+
+	public:
+		ImageAllocJobScope();
+		ImageAllocJobScope(const ImageAllocJobScope&) = delete;
+		~ImageAllocJobScope();
+
+		ImageAllocJobScope& operator=(const ImageAllocJobScope&) = delete;
+	};
+}
@@ -1,7 +1,9 @@
 #include "imagecache.h"
 
 #include "am/file/fileutils.h"
+#include "am/system/datahash.h"
 #include "am/system/datamgr.h"
+#include "am/system/trace.h"
 #include "am/xml/doc.h"
 #include "am/xml/iterator.h"
 #include "helpers/format.h"
@@ -11,18 +13,19 @@
 
 #include "imgui.h"
 
-rageam::HashValue rageam::graphics::ImageCache::ComputeImageHash(ImagePixelData imageData, u32 imageDataSize, const CompressedImageInfo& compInfo) const
+rageam::Hash128 rageam::graphics::ImageCache::ComputeImageHash(ImagePixelData imageData, u32 imageDataSize, const CompressedImageInfo& compInfo) const
 {
 	EASY_FUNCTION();
-	u32 hash;
-	hash = rage::atDataHash(imageData, imageDataSize);
-	hash = rage::atDataHash(&compInfo, sizeof CompressedImageInfo, hash);
-	return hash;
+	DataHasher hasher;
+	hasher.AddValue(DataHash128Parallel(imageData, imageDataSize));
+	hasher.AddValue(compInfo);
+	return hasher.Get128();
 }
 
-rageam::HashValue rageam::graphics::ImageCache::ComputeImageHash(ImagePixelData imageData, u32 imageDataSize) const
+rageam::Hash128 rageam::graphics::ImageCache::ComputeImageHash(ImagePixelData imageData, u32 imageDataSize) const
 {
-	return rage::atDataHash(imageData, imageDataSize);
+	AM_TRACE_FUNCTION();
+	return DataHash128Parallel(imageData, imageDataSize);
 }
 
 void rageam::graphics::ImageCache::SaveSettings(const file::WPath& path, const Settings& settings) const
@@ -106,39 +109,97 @@ void rageam::graphics::ImageCache::LoadSettings()
 	}
 }
 
-bool rageam::graphics::ImageCache::GetInfoFromCachedImagePath(const file::WPath& path, u32& hash, u32& imageSize) const
+void rageam::graphics::ImageCache::DeleteLegacyFileStore() const
 {
-	file::WPath fileName = path.GetFileNameWithoutExtension();
-	hash = 0;
-	imageSize = 0;
-	return swscanf_s(fileName.GetCStr(), L"%u_%u", &hash, &imageSize) > 0;
+	file::WPath listPath = m_CacheDirectory / LEGACY_CACHE_LIST_NAME;
+	if (!IsFileExists(listPath))
+		return;
+
+	AM_DEBUGF("ImageCache::DeleteLegacyFileStore() -> Removing images cached by older version");
+
+	try
+	{
+		XmlDoc xCacheList;
+		xCacheList.LoadFromFile(listPath);
+		for (const XmlHandle& item : XmlIterator(xCacheList.Root(), "Item"))
+		{
+			file::WPath filePath = m_CacheDirectory / file::PathConverter::Utf8ToWide(item.GetText());
+			DeleteFileW(filePath);
+		}
+	}
+	catch (const XmlException& ex)
+	{
+		ex.Print();
+	}
+	DeleteFileW(listPath);
 }
 
-rageam::file::WPath rageam::graphics::ImageCache::GetCachedImagePath(u32 hash, u32 imageSize, ImageFileKind kind) const
+bool rageam::graphics::ImageCache::MoveImageToFileSystem(CacheEntry& entry) const
 {
-	file::WPath path = m_CacheDirectory / String::FormatTemp(L"%u_%u", hash, imageSize);
-	if (kind != ImageKind_None)
+	// We don't actually remove images from pack when loading to ram,
+	// writing image is more expensive than keeping it until it is surely not needed anymore
+	bool stored = m_Store->Write(entry.Hash, *entry.Image, entry.ImageSize, entry.ImagePaddingUV2);
+	if (!stored)
 	{
-		path += L".";
-		path += ImageKindToFileExtensionW[kind];
+		AM_ERRF("ImageCache::Cache() -> Failed to store image %016llx%016llx in file system", entry.Hash.High, entry.Hash.Low);
 	}
-	return path;
+
+	// This does not guarantee that image will be unloaded from RAM, it still may be referenced somewhere
+	entry.Image = nullptr;
+	return stored;
 }
 
-void rageam::graphics::ImageCache::MoveImageToFileSystem(CacheEntry& entry, u32 hash) const
+template<typename TEntry>
+TEntry* rageam::graphics::ImageCache::FindEntry(const FlatSet<amUPtr<TEntry>>& entries, const Hash128& hash)
 {
-	// We don't need image kind here because file extension will be set by save function
-	file::WPath cachedImagePath = GetCachedImagePath(hash, entry.ImageSize, ImageKind_DDS);
+	amUPtr<TEntry>* pEntry = entries.TryGetAt(hash.Fold32());
+	if (!pEntry || (*pEntry)->Hash != hash)
+		return nullptr;
+	return pEntry->get();
+}
 
-	// We don't actually remove images from file system cache when loading to ram,
-	// writing file is more expensive than deleting it when it is surely not needed anymore
-	if (!IsFileExists(cachedImagePath) && !ImageFactory::SaveImage(entry.Image, cachedImagePath))
+void rageam::graphics::ImageCache::UnlinkEntry(Shard& shard, CacheEntry* entry)
+{
+	if (entry->Image)
+	{
+		shard.LruRAM.Remove(entry);
+		m_SizeRam -= entry->ImageSize;
+	}
+	else
 	{
-		AM_ERRF(L"ImageCache::Cache() -> Failed to store image in file system '%ls'", cachedImagePath.GetCStr());
+		shard.LruFS.Remove(entry);
+		m_SizeFs -= entry->ImageSize;
 	}
+}
 
-	// This does not guarantee that image will be unloaded from RAM, it still may be referenced somewhere
-	entry.Image = nullptr;
+template<typename TEntry>
+rageam::graphics::ImageCache::Shard* rageam::graphics::ImageCache::LockShardWithOldestEntry(
+	LruList<TEntry> Shard::* list, std::unique_lock<std::mutex>& outLock)
+{
+	while (true)
+	{
+		Shard* oldestShard = nullptr;
+		u64    oldestTick = UINT64_MAX;
+		for (Shard& shard : m_Shards)
+		{
+			std::unique_lock lock(shard.Mutex);
+			TEntry* tail = (shard.*list).Tail;
+			if (tail && tail->LastUseTick < oldestTick)
+			{
+				oldestShard = &shard;
+				oldestTick = tail->LastUseTick;
+			}
+		}
+
+		if (!oldestShard)
+			return nullptr;
+
+		outLock = std::unique_lock(oldestShard->Mutex);
+		// List was emptied by other thread while we were looking at other shards
+		if ((oldestShard->*list).Tail)
+			return oldestShard;
+		outLock.unlock();
+	}
 }
 
 void rageam::graphics::ImageCache::CleanUpOldEntriesToFitBudget()
@@ -146,51 +207,51 @@ void rageam::graphics::ImageCache::CleanUpOldEntriesToFitBudget()
 	// Move oldest image from ram to file system (or just unload if fs cache is not needed)
 	while (m_SizeRam > m_Settings.MemoryStoreBudget)
 	{
-		u32 hash = m_NewToOldEntriesRAM.Last();
-		m_NewToOldEntriesRAM.RemoveLast();
-
-		CacheEntry& entry = m_Entries.GetAt(hash);
+		std::unique_lock<std::mutex> lock;
+		Shard* shard = LockShardWithOldestEntry(&Shard::LruRAM, lock);
+		if (!shard)
+			break;
 
-		m_SizeRam -= entry.ImageSize;
+		CacheEntry* entry = shard->LruRAM.Tail;
+		Hash128 hash = entry->Hash;
+		UnlinkEntry(*shard, entry);
+		++m_EvictionCountRam;
 
-		if (entry.Flags & ImageCacheEntryFlags_StoreInFileSystem)
+		if (entry->Flags & ImageCacheEntryFlags_StoreInFileSystem && MoveImageToFileSystem(*entry))
 		{
-			MoveImageToFileSystem(entry, hash);
-			m_SizeFs += entry.ImageSize;
-			m_NewToOldEntriesFS.Insert(0, hash);
-			IMAGE_CACHE_LOG("ImageCache::Cache() -> Image (hash: %x; size: %x or %s) was unloaded from memory to file",
-				hash, entry.ImageSize, FormatSize(entry.ImageSize));
+			m_SizeFs += entry->ImageSize;
+			// File system list is ordered by time images were moved there
+			entry->LastUseTick = ++m_Tick;
+			shard->LruFS.PushFront(entry);
+			IMAGE_CACHE_LOG("ImageCache::Cache() -> Image (hash: %016llx%016llx; size: %x or %s) was unloaded from memory to file",
+				hash.High, hash.Low, entry->ImageSize, FormatSize(entry->ImageSize));
 		}
 		else
 		{
-			IMAGE_CACHE_LOG("ImageCache::Cache() -> Image (hash: %x; size: %x or %s) was marked as memory only, removing completely",
-				hash, entry.ImageSize, FormatSize(entry.ImageSize));
-			m_Entries.RemoveAt(hash);
+			IMAGE_CACHE_LOG("ImageCache::Cache() -> Image (hash: %016llx%016llx; size: %x or %s) was marked as memory only, removing completely",
+				hash.High, hash.Low, entry->ImageSize, FormatSize(entry->ImageSize));
+			shard->Entries.RemoveAt(hash.Fold32());
 		}
 	}
 
-	// Note that we don't actually remove the file, see comment in MoveImageToFileSystem
+	// Space is reclaimed later by pack compaction
 	while (m_SizeFs > m_Settings.FileSystemStoreBudget)
 	{
-		u32 hash = m_NewToOldEntriesFS.Last();
-		m_NewToOldEntriesFS.RemoveLast();
+		std::unique_lock<std::mutex> lock;
+		Shard* shard = LockShardWithOldestEntry(&Shard::LruFS, lock);
+		if (!shard)
+			break;
 
-		CacheEntry& entry = m_Entries.GetAt(hash);
-		m_SizeFs -= entry.ImageSize;
+		CacheEntry* entry = shard->LruFS.Tail;
+		Hash128 hash = entry->Hash;
+		UnlinkEntry(*shard, entry);
+		++m_EvictionCountFs;
 
-		file::WPath oldImagePath = GetCachedImagePath(hash, entry.ImageSize, entry.ImageKind);
-		if (!DeleteFileW(oldImagePath))
-		{
-			AM_WARNINGF("ImageCache::Cache() -> Image (hash: %x; size: %x or %s) failed to remove from file system",
-				hash, entry.ImageSize, FormatSize(entry.ImageSize));
-		}
-		else
-		{
-			IMAGE_CACHE_LOG("ImageCache::Cache() -> Image (hash: %x; size: %x or %s) was removed from file system",
-				hash, entry.ImageSize, FormatSize(entry.ImageSize));
-		}
+		m_Store->Remove(hash);
+		IMAGE_CACHE_LOG("ImageCache::Cache() -> Image (hash: %016llx%016llx; size: %x or %s) was removed from file system",
+			hash.High, hash.Low, entry->ImageSize, FormatSize(entry->ImageSize));
 
-		m_Entries.RemoveAt(hash);
+		shard->Entries.RemoveAt(hash.Fold32());
 	}
 }
 
@@ -206,55 +267,34 @@ rageam::graphics::ImageCache::ImageCache()
 	AM_ASSERT(CreateDirectoryW(m_CacheDirectory, NULL) != ERROR_PATH_NOT_FOUND,
 		L"ImageCompressorCache::LoadSettings() -> Failed to create cache directory '%ls'", m_CacheDirectory.GetCStr());
 
-	file::WPath listPath = m_CacheDirectory / CACHE_LIST_NAME;
-	// First load, no cache list is stored
-	if (!IsFileExists(listPath))
-		return;
+	DeleteLegacyFileStore();
 
-	// Load images from file system
-	try
-	{
-		XmlDoc xCacheList;
-		xCacheList.LoadFromFile(listPath);
-		XmlHandle xRoot = xCacheList.Root();
-
-		u32 totalSize;
-		xRoot.GetAttribute("TotalSize", totalSize);
+	// Load images from file system, records are ordered from newest to oldest
+	List<ImagePackRecord> records;
+	m_Store = std::make_unique<ImagePackStore>(m_CacheDirectory, m_Settings.FileSystemStoreBudget);
+	m_Store->Load(records);
 
-		for (const XmlHandle& item : XmlIterator(xRoot, "Item"))
-		{
-			ConstString fileName = item.GetText();
-			file::WPath filePath = m_CacheDirectory / file::PathConverter::Utf8ToWide(fileName);
-
-			u32 hash, imageSize;
-			ImageFileKind imageKind = ImageFactory::GetImageKindFromPath(filePath);
-
-			if (imageKind == ImageKind_None || !GetInfoFromCachedImagePath(filePath, hash, imageSize))
-			{
-				AM_ERRF(L"Cache -> File name is invalid '%ls'", filePath.GetCStr());
-				continue;
-			}
-
-			CacheEntry entry = {};
-			entry.ImageKind = imageKind;
-			entry.ImageSize = imageSize;
-			entry.Flags |= ImageCacheEntryFlags_StoreInFileSystem;
-
-			m_Entries.EmplaceAt(hash, std::move(entry));
-			m_NewToOldEntriesFS.Add(hash);
-		}
-
-		m_SizeFs = totalSize;
-
-		// Budget was lower since last load images don't fit anymore...
-		if (m_SizeFs > m_Settings.FileSystemStoreBudget)
-		{
-			CleanUpOldEntriesToFitBudget();
-		}
+	u64 tick = records.GetSize();
+	for (const ImagePackRecord& record : records)
+	{
+		amUPtr<CacheEntry> entry = std::make_unique<CacheEntry>();
+		entry->Hash = record.Hash;
+		entry->ImageSize = record.ImageSize;
+		entry->ImagePaddingUV2 = record.PaddingUV2;
+		entry->Flags |= ImageCacheEntryFlags_StoreInFileSystem;
+		entry->LastUseTick = tick--;
+
+		Shard& shard = GetShard(record.Hash);
+		m_SizeFs += entry->ImageSize;
+		shard.LruFS.PushBack(entry.get());
+		shard.Entries.EmplaceAt(record.Hash.Fold32(), std::move(entry));
 	}
-	catch (const XmlException& ex)
+	m_Tick = records.GetSize();
+
+	// Budget was lower since last load images don't fit anymore...
+	if (m_SizeFs > m_Settings.FileSystemStoreBudget)
 	{
-		ex.Print();
+		CleanUpOldEntriesToFitBudget();
 	}
 }
 
@@ -264,142 +304,134 @@ rageam::graphics::ImageCache::~ImageCache()
 #ifdef DEBUG
 	u64 sizeRam = 0;
 	u64 sizeFs = 0;
-	for (CacheEntry& entry : m_Entries)
+	for (Shard& shard : m_Shards)
 	{
-		if (entry.Image)
-			sizeRam += entry.ImageSize;
-		else
-			sizeFs += entry.ImageSize;
+		for (amUPtr<CacheEntry>& entry : shard.Entries)
+		{
+			if (entry->Image)
+				sizeRam += entry->ImageSize;
+			else
+				sizeFs += entry->ImageSize;
+		}
 	}
 
-	AM_ASSERT(sizeRam == m_SizeRam, "ImageCache~ -> Ram size doesn't match (expected: %llu, actual: %llu)", sizeRam, m_SizeRam);
-	AM_ASSERT(sizeFs == m_SizeFs, "ImageCache~ -> Fs size doesn't match (expected: %llu, actual: %llu)", sizeFs, m_SizeFs);
+	AM_ASSERT(sizeRam == m_SizeRam, "ImageCache~ -> Ram size doesn't match (expected: %llu, actual: %llu)", sizeRam, m_SizeRam.load());
+	AM_ASSERT(sizeFs == m_SizeFs, "ImageCache~ -> Fs size doesn't match (expected: %llu, actual: %llu)", sizeFs, m_SizeFs.load());
 #endif
 
-	// Store all images in file system
-	for (u32 hash : m_NewToOldEntriesRAM)
+	// Store all images in file system, oldest first so pack preserves new/old order
+	List<CacheEntry*> ramEntries;
+	for (Shard& shard : m_Shards)
 	{
-		CacheEntry& entry = m_Entries.GetAt(hash);
+		for (CacheEntry* entry = shard.LruRAM.Head; entry; entry = entry->Next)
+			ramEntries.Add(entry);
+	}
+	ramEntries.Sort([](CacheEntry* const& lhs, CacheEntry* const& rhs) { return lhs->LastUseTick < rhs->LastUseTick; });
 
-		if (entry.Flags & ImageCacheEntryFlags_StoreInFileSystem)
+	for (CacheEntry* entry : ramEntries)
+	{
+		Shard& shard = GetShard(entry->Hash);
+		UnlinkEntry(shard, entry);
+		if (entry->Flags & ImageCacheEntryFlags_StoreInFileSystem && MoveImageToFileSystem(*entry))
 		{
-			MoveImageToFileSystem(entry, hash);
-			m_SizeFs += entry.ImageSize;
-			m_SizeRam -= entry.ImageSize;
-			m_NewToOldEntriesFS.Insert(0, hash);
+			m_SizeFs += entry->ImageSize;
+			shard.LruFS.PushFront(entry);
 		}
-
-		entry.Image = nullptr;
+		entry->Image = nullptr;
 	}
 
-	// We keep list to easily search for cached files and preserve new/old order
-	XmlDoc xCacheList("CacheList");
-	XmlHandle xRoot = xCacheList.Root();
-	xRoot.SetAttribute("Version", CACHE_LIST_VERSION);
-	xRoot.SetAttribute("TotalSize", m_SizeFs); // To see if budget lowered and we need clean up on loading
-	for (u32 hash : m_NewToOldEntriesFS)
-	{
-		CacheEntry& entry = m_Entries.GetAt(hash);
-		file::WPath entryPath = GetCachedImagePath(hash, entry.ImageSize, entry.ImageKind);
-		entryPath = entryPath.GetFileName();
-		xRoot.AddChild("Item", file::PathConverter::WideToUtf8(entryPath));
-	}
-	try
-	{
-		file::WPath listPath = m_CacheDirectory / CACHE_LIST_NAME;
-		xCacheList.SaveToFile(listPath);
-	}
-	catch (const XmlException& ex)
-	{
-		ex.Print();
-	}
+	// Pack writes its index on destruction
+	m_Store = nullptr;
 }
 
-rageam::graphics::ImagePtr rageam::graphics::ImageCache::GetFromCache(u32 hash, Vec2S* outUV2)
+rageam::graphics::ImagePtr rageam::graphics::ImageCache::GetFromCache(const Hash128& hash, Vec2S* outUV2)
 {
-	std::unique_lock lock(m_Mutex);
-
 	if (outUV2) *outUV2 = { 1.0f, 1.0f };
 
-	CacheEntry* entry = m_Entries.TryGetAt(hash);
-	if (!entry)
-		return nullptr;
-
-	entry->LastAccessTime = ImGui::GetTime();
-
-	// Image was unloaded to file system before, load it now
-	if (!entry->Image)
+	ImagePtr image;
+	bool     loadedFromFs = false;
 	{
-		file::WPath cachedImagePath = GetCachedImagePath(hash, entry->ImageSize, entry->ImageKind);
-
-		// Load without using cache here or it will cause recursion...
-		entry->Image = ImageFactory::LoadFromPath(cachedImagePath, false, false);
+		Shard& shard = GetShard(hash);
+		std::unique_lock lock(shard.Mutex);
 
-		// Remove hash entry from file system history
-		for (u32 i = 0; i < m_NewToOldEntriesFS.GetSize(); i++)
+		CacheEntry* entry = FindEntry(shard.Entries, hash);
+		if (!entry)
 		{
-			if (m_NewToOldEntriesFS[i] == hash)
-			{
-				m_NewToOldEntriesFS.RemoveAt(i);
-				break;
-			}
+			++m_MissCount;
+			return nullptr;
 		}
-		m_SizeFs -= entry->ImageSize;
 
-		// Add image back to ram if it was loaded successfully
-		if (entry->Image)
+		entry->LastAccessTime = ImGui::GetTime();
+		entry->LastUseTick = ++m_Tick;
+
+		// Image was unloaded to file system before, load it now
+		if (!entry->Image)
 		{
-			m_SizeRam += entry->ImageSize;
-			m_NewToOldEntriesRAM.Insert(0, hash);
+			UnlinkEntry(shard, entry);
+
+			// Pixels are mapped from pack as is, no decoding is needed
+			entry->Image = m_Store->Read(hash);
+
+			// Add image back to ram if it was loaded successfully
+			if (entry->Image)
+			{
+				m_SizeRam += entry->ImageSize;
+				shard.LruRAM.PushFront(entry);
+				++m_FsLoadCount;
+				loadedFromFs = true;
+			}
+			else
+			{
+				AM_ERRF("ImageCache::GetFromCache() -> Failed to reload image from file system...");
+				m_Store->Remove(hash);
+				shard.Entries.RemoveAt(hash.Fold32());
+				++m_MissCount;
+				return nullptr;
+			}
 		}
+		// Image was already loaded, we have to update it's position in history list
 		else
 		{
-			AM_ERRF("ImageCache::GetFromCache() -> Failed to reload image from file system...");
-			m_Entries.RemoveAt(hash);
-			return nullptr;
+			shard.LruRAM.MoveToFront(entry);
 		}
 
-		// Image was loaded from file system to memory, revalidate budget
-		CleanUpOldEntriesToFitBudget();
-	}
-	// Image was already loaded, we have to update it's position in history list
-	else if (m_NewToOldEntriesFS.Any() && m_NewToOldEntriesFS.First() != hash)
-	{
-		for (u32 i = 0; i < m_NewToOldEntriesFS.GetSize(); i++)
-		{
-			if (m_NewToOldEntriesFS[i] == hash)
-			{
-				m_NewToOldEntriesFS.RemoveAt(i);
-				m_NewToOldEntriesFS.Insert(0, hash);
-				break;
-			}
-		}
+		++m_HitCount;
+		if (outUV2) *outUV2 = entry->ImagePaddingUV2;
+		image = entry->Image;
 	}
 
-	if (outUV2) *outUV2 = entry->ImagePaddingUV2;
-	return entry->Image;
+	// Image was loaded from file system to memory, revalidate budget
+	if (loadedFromFs)
+		CleanUpOldEntriesToFitBudget();
+
+	return image;
 }
 
 bool rageam::graphics::ImageCache::GetFromCacheDX11(
-	u32 hash, amComPtr<ID3D11ShaderResourceView>& outView, Vec2S* outUV2, amComPtr<ID3D11Texture2D>* tex)
+	const Hash128& hash, amComPtr<ID3D11ShaderResourceView>& outView, Vec2S* outUV2, amComPtr<ID3D11Texture2D>* tex)
 {
-	std::unique_lock lock(m_Mutex);
+	Shard& shard = GetShard(hash);
+	std::unique_lock lock(shard.Mutex);
 
-	CacheEntryDX11* entry = m_EntriesDX11.TryGetAt(hash);
-	if (entry)
+	CacheEntryDX11* entry = FindEntry(shard.EntriesDX11, hash);
+	if (!entry)
 	{
-		outView = entry->View;
-		if (tex) *tex = entry->Tex;
-		if (outUV2) *outUV2 = entry->PaddingUV2;
-		return true;
+		++m_DX11MissCount;
+		return false;
 	}
-	return false;
+
+	entry->LastUseTick = ++m_Tick;
+	shard.LruDX11.MoveToFront(entry);
+	++m_DX11HitCount;
+
+	outView = entry->View;
+	if (tex) *tex = entry->Tex;
+	if (outUV2) *outUV2 = entry->PaddingUV2;
+	return true;
 }
 
-void rageam::graphics::ImageCache::Cache(const ImagePtr& image, u32 hash, u32 imageSize, ImageCacheEntryFlags entryFlags, Vec2S uv2)
+void rageam::graphics::ImageCache::Cache(const ImagePtr& image, const Hash128& hash, u32 imageSize, ImageCacheEntryFlags entryFlags, Vec2S uv2)
 {
-	std::unique_lock lock(m_Mutex);
-
 	bool storeFs = entryFlags & ImageCacheEntryFlags_StoreInFileSystem;
 	bool storeTemp = entryFlags & ImageCacheEntryFlags_Temp;
 	if (storeFs && storeTemp)
@@ -407,8 +439,8 @@ void rageam::graphics::ImageCache::Cache(const ImagePtr& image, u32 hash, u32 im
 		AM_UNREACHABLE("ImageCache::Cache() -> Can't store temp entry in file system");
 	}
 
-	IMAGE_CACHE_LOG("ImageCache::Cache() -> Adding to cache, hash: %x; image size: %x or %s; fs store: %i",
-		hash, imageSize, FormatSize(imageSize), entryFlags & ImageCacheEntryFlags_Temp);
+	IMAGE_CACHE_LOG("ImageCache::Cache() -> Adding to cache, hash: %016llx%016llx; image size: %x or %s; fs store: %i",
+		hash.High, hash.Low, imageSize, FormatSize(imageSize), entryFlags & ImageCacheEntryFlags_Temp);
 
 	if (imageSize > m_Settings.MemoryStoreBudget)
 	{
@@ -416,43 +448,83 @@ void rageam::graphics::ImageCache::Cache(const ImagePtr& image, u32 hash, u32 im
 		return;
 	}
 
-	CacheEntry entry;
-	entry.Hash = hash;
-	entry.Image = image;
-	entry.ImageSize = imageSize;
-	entry.ImageKind = ImageIsCompressedFormat(image->GetPixelFormat()) ? ImageKind_DDS : ImageKind_PNG;
-	entry.Flags = entryFlags;
-	entry.ImagePaddingUV2 = uv2;
-	entry.LastAccessTime = ImGui::GetTime();
-	m_Entries.EmplaceAt(hash, std::move(entry));
+	{
+		Shard& shard = GetShard(hash);
+		std::unique_lock lock(shard.Mutex);
 
-	m_SizeRam += imageSize;
-	m_NewToOldEntriesRAM.Remove(hash);
-	m_NewToOldEntriesRAM.Insert(0, hash);
+		// Entry is reused if image is already cached, it is linked in one of the lists
+		CacheEntry* entry;
+		amUPtr<CacheEntry>* pEntry = shard.Entries.TryGetAt(hash.Fold32());
+		if (pEntry)
+		{
+			entry = pEntry->get();
+			UnlinkEntry(shard, entry);
+
+			// Different image in the same bucket is replaced, it may be still stored in file system
+			if (entry->Hash != hash)
+				m_Store->Remove(entry->Hash);
+		}
+		else
+		{
+			entry = shard.Entries.EmplaceAt(hash.Fold32(), std::make_unique<CacheEntry>()).get();
+		}
+
+		entry->Hash = hash;
+		entry->Image = image;
+		entry->ImageSize = imageSize;
+		entry->Flags = entryFlags;
+		entry->ImagePaddingUV2 = uv2;
+		entry->LastAccessTime = ImGui::GetTime();
+		entry->LastUseTick = ++m_Tick;
+
+		m_SizeRam += imageSize;
+		shard.LruRAM.PushFront(entry);
+	}
 
 	CleanUpOldEntriesToFitBudget();
 }
 
-void rageam::graphics::ImageCache::CacheDX11(u32 hash, const amComPtr<ID3D11ShaderResourceView>& view, const amComPtr<ID3D11Texture2D>& tex, Vec2S uv2)
+void rageam::graphics::ImageCache::CacheDX11(const Hash128& hash, const amComPtr<ID3D11ShaderResourceView>& view, const amComPtr<ID3D11Texture2D>& tex, Vec2S uv2)
 {
-	std::unique_lock lock(m_Mutex);
+	IMAGE_CACHE_LOG("ImageCache::CacheDX11() -> Adding to cache, hash: %016llx%016llx", hash.High, hash.Low);
 
-	IMAGE_CACHE_LOG("ImageCache::CacheDX11() -> Adding to cache, hash: %x", hash);
+	{
+		Shard& shard = GetShard(hash);
+		std::unique_lock lock(shard.Mutex);
 
-	CacheEntryDX11 entry;
-	entry.View = view;
-	entry.Tex = tex;
-	entry.PaddingUV2 = uv2;
+		// Different view in the same bucket is replaced
+		CacheEntryDX11* entry;
+		amUPtr<CacheEntryDX11>* pEntry = shard.EntriesDX11.TryGetAt(hash.Fold32());
+		if (pEntry)
+		{
+			entry = pEntry->get();
+			shard.LruDX11.Remove(entry);
+		}
+		else
+		{
+			entry = shard.EntriesDX11.EmplaceAt(hash.Fold32(), std::make_unique<CacheEntryDX11>()).get();
+			++m_DX11ViewCount;
+		}
 
-	m_NewToOldEntriesDX11.Remove(hash);
-	m_NewToOldEntriesDX11.Insert(0, hash);
-	m_EntriesDX11.EmplaceAt(hash, std::move(entry));
+		entry->Hash = hash;
+		entry->View = view;
+		entry->Tex = tex;
+		entry->PaddingUV2 = uv2;
+		entry->LastUseTick = ++m_Tick;
+		shard.LruDX11.PushFront(entry);
+	}
 
-	if (m_NewToOldEntriesDX11.GetSize() > m_Settings.MaxDX11Views)
+	while (m_DX11ViewCount > m_Settings.MaxDX11Views)
 	{
-		u32 oldestHash = m_NewToOldEntriesDX11.Last();
-		m_NewToOldEntriesDX11.RemoveLast();
-		m_EntriesDX11.RemoveAt(oldestHash);
+		std::unique_lock<std::mutex> lock;
+		Shard* shard = LockShardWithOldestEntry(&Shard::LruDX11, lock);
+		if (!shard)
+			break;
+
+		CacheEntryDX11* oldest = shard->LruDX11.Tail;
+		shard->LruDX11.Remove(oldest);
+		shard->EntriesDX11.RemoveAt(oldest->Hash.Fold32());
+		--m_DX11ViewCount;
 	}
 }
 
@@ -463,67 +535,75 @@ void rageam::graphics::ImageCache::DeleteOldEntries()
 		return;
 	m_NextTempEntriesDeleteTime = time + TEMP_DELETE_INTERVAL;
 
-	struct EntryToRemove
+	List<Hash128> hashesToRemove;
+	for (Shard& shard : m_Shards)
 	{
-		u32 Hash, ImageSize;
-	};
+		std::unique_lock lock(shard.Mutex);
 
-	List<EntryToRemove> entriesToRemove;
-	for (CacheEntry& entry : m_Entries)
-	{
-		if (!(entry.Flags & ImageCacheEntryFlags_Temp))
-			continue;
-
-		double deltaTime = time - entry.LastAccessTime;
-		if (deltaTime > TEMP_MIN_INACTIVITY_TIME)
+		hashesToRemove.Clear();
+		for (amUPtr<CacheEntry>& entry : shard.Entries)
 		{
-			EntryToRemove entryToRemove;
-			entryToRemove.Hash = entry.Hash;
-			entryToRemove.ImageSize= entry.ImageSize;
-			entriesToRemove.Add(entryToRemove);
+			if (!(entry->Flags & ImageCacheEntryFlags_Temp))
+				continue;
+
+			double deltaTime = time - entry->LastAccessTime;
+			if (deltaTime > TEMP_MIN_INACTIVITY_TIME)
+				hashesToRemove.Add(entry->Hash);
 		}
-	}
 
-	for (EntryToRemove entry : entriesToRemove)
-	{
-		IMAGE_CACHE_LOG("ImageCache::DeleteOldEntries() -> Removing %u", entry.Hash);
+		for (const Hash128& hash : hashesToRemove)
+		{
+			IMAGE_CACHE_LOG("ImageCache::DeleteOldEntries() -> Removing %016llx%016llx", hash.High, hash.Low);
 
-		m_SizeRam -= entry.ImageSize;
-		m_NewToOldEntriesRAM.Remove(entry.Hash);
-		m_Entries.RemoveAt(entry.Hash);
+			UnlinkEntry(shard, shard.Entries.GetAt(hash.Fold32()).get());
+			shard.Entries.RemoveAt(hash.Fold32());
+		}
 	}
 }
 
 void rageam::graphics::ImageCache::Clear()
 {
-	std::unique_lock lock(m_Mutex);
-
-	for (u32 fsHash : m_NewToOldEntriesFS)
+	for (Shard& shard : m_Shards)
 	{
-		CacheEntry& fsEntry = m_Entries.GetAt(fsHash);
-		file::WPath fsPath = GetCachedImagePath(fsHash, fsEntry.ImageSize, fsEntry.ImageKind);
-		DeleteFileW(fsPath);
+		std::unique_lock lock(shard.Mutex);
+
+		for (amUPtr<CacheEntry>& entry : shard.Entries)
+			UnlinkEntry(shard, entry.get());
+		m_DX11ViewCount -= shard.LruDX11.Count;
+
+		shard.LruRAM.Reset();
+		shard.LruFS.Reset();
+		shard.LruDX11.Reset();
+		shard.EntriesDX11.Destroy();
+		shard.Entries.Destroy();
 	}
+	m_Store->Clear();
 
-	m_EntriesDX11.Destroy();
-	m_Entries.Destroy();
-	m_NewToOldEntriesRAM.Destroy();
-	m_NewToOldEntriesFS.Destroy();
-	m_SizeRam = 0;
-	m_SizeFs = 0;
+	ImageAllocTrim();
 }
 
 rageam::graphics::ImageCacheState rageam::graphics::ImageCache::GetState()
 {
-	std::unique_lock lock(m_Mutex);
-
-	ImageCacheState state;
+	ImageCacheState state = {};
 	state.SizeRamUsed = m_SizeRam;
 	state.SizeRamBudget = m_Settings.MemoryStoreBudget;
 	state.SizeFsUsed = m_SizeFs;
 	state.SizeFsBudget = m_Settings.FileSystemStoreBudget;
-	state.ImageCountRam = m_NewToOldEntriesRAM.GetSize();
-	state.ImageCountFs = m_NewToOldEntriesFS.GetSize();
-	state.DX11ViewCount = m_NewToOldEntriesDX11.GetSize();
+	state.SizeFsOnDisk = m_Store->GetState().SizeOnDisk;
+	for (Shard& shard : m_Shards)
+	{
+		std::unique_lock lock(shard.Mutex);
+		state.ImageCountRam += shard.LruRAM.Count;
+		state.ImageCountFs += shard.LruFS.Count;
+	}
+	state.DX11ViewCount = m_DX11ViewCount;
+	state.HitCount = m_HitCount;
+	state.MissCount = m_MissCount;
+	state.FsLoadCount = m_FsLoadCount;
+	state.EvictionCountRam = m_EvictionCountRam;
+	state.EvictionCountFs = m_EvictionCountFs;
+	state.DX11HitCount = m_DX11HitCount;
+	state.DX11MissCount = m_DX11MissCount;
+	state.Allocator = ImageAllocGetStats();
 	return state;
 }
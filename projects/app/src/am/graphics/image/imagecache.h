@@ -1,8 +1,13 @@
 #pragma once
 
 #include "image.h"
+#include "imagepack.h"
+#include "am/system/datahash.h"
 #include "am/system/singleton.h"
 
+#include <atomic>
+#include <mutex>
+
 namespace rageam::graphics
 {
 	// #define IMAGE_CACHE_ENABLE_LOG
@@ -22,9 +27,18 @@ namespace rageam::graphics
 		u64 SizeRamBudget;
 		u64 SizeFsUsed;
 		u64 SizeFsBudget;
+		u64 SizeFsOnDisk;		// Includes space of removed images that was not compacted yet
 		u32 ImageCountRam;
 		u32 ImageCountFs;
 		u32	DX11ViewCount;
+		u64 HitCount;			// Includes images that were loaded back from file system
+		u64 MissCount;
+		u64 FsLoadCount;		// Images loaded back from file system
+		u64 EvictionCountRam;	// Images unloaded from memory, either moved to file system or removed
+		u64 EvictionCountFs;	// Images removed from file system
+		u64 DX11HitCount;
+		u64 DX11MissCount;
+		ImageAllocStats Allocator;
 	};
 
 	enum ImageCacheEntryFlags_
@@ -36,7 +50,12 @@ namespace rageam::graphics
 	typedef int ImageCacheEntryFlags;
 
 	/**
-	 * \brief Two level image cache - in memory and in file system.
+	 * \brief Two level image cache - in memory and in file system (see ImagePackStore).
+	 * \n Entries are split between shards by hash, every shard has own lock, so compressor threads and
+	 * UI thumbnail loader don't wait on each other. Budgets are shared, when budget is exceeded the oldest
+	 * entry among all shards is evicted.
+	 * \n Entries are keyed by full 128 bit hash, 32 bit fold of it is only used as bucket in shard set.
+	 * Different image in the same bucket is a miss and replaces the entry when cached.
 	 */
 	class ImageCache : public Singleton<ImageCache>
 	{
@@ -45,28 +64,95 @@ namespace rageam::graphics
 		static constexpr u32 DEFAULT_TIME_TO_CACHE_THRESHOLD = 25;						// Milliseconds
 		static constexpr u32 DEFAULT_DX11_VIEWS_MAX = 50;
 		static constexpr u32 SETTINGS_VERSION = 0;
-		static constexpr u32 CACHE_LIST_VERSION = 0;
 		static constexpr ConstWString DEFAULT_CACHE_DIRECTORY_NAME = L"CompressorCache";
-		static constexpr ConstWString CACHE_LIST_NAME = L"List.xml";
+		static constexpr ConstWString LEGACY_CACHE_LIST_NAME = L"List.xml";	// Image per file store, replaced by ImagePackStore
 		static constexpr double TEMP_MIN_INACTIVITY_TIME = 60.0f;	// Temp textures are removed 60 seconds after they're accessed last time
 		static constexpr double TEMP_DELETE_INTERVAL = 10.0f;		// Every 10 seconds
+		static constexpr u32 SHARD_COUNT = 16;
 
 		struct CacheEntry
 		{
-			u32                  Hash;
+			Hash128              Hash;
 			ImagePtr             Image;
 			u32                  ImageSize;
-			ImageFileKind        ImageKind;			// We store kind to get file extension when loading image from file system
 			Vec2S                ImagePaddingUV2;	// In case if image was padded, contains adjusted UV2
 			ImageCacheEntryFlags Flags = ImageCacheEntryFlags_None;
 			double               LastAccessTime = -1.0f;
+			u64                  LastUseTick = 0;	// To compare age of entries from different shards
+			CacheEntry*          Prev = nullptr;	// Newer entry in RAM or FS list
+			CacheEntry*          Next = nullptr;	// Older entry in RAM or FS list
 		};
 
 		struct CacheEntryDX11
 		{
+			Hash128                            Hash;
 			amComPtr<ID3D11ShaderResourceView> View;
 			amComPtr<ID3D11Texture2D>		   Tex;
 			Vec2S							   PaddingUV2;
+			u64                                LastUseTick = 0;
+			CacheEntryDX11*                    Prev = nullptr;
+			CacheEntryDX11*                    Next = nullptr;
+		};
+
+		// Intrusive list of entries ordered from newest (head) to oldest (tail), entry can be only in one list at time
+		template<typename TEntry>
+		struct LruList
+		{
+			TEntry* Head = nullptr;
+			TEntry* Tail = nullptr;
+			u32     Count = 0;
+
+			void PushFront(TEntry* entry)
+			{
+				entry->Prev = nullptr;
+				entry->Next = Head;
+				if (Head) Head->Prev = entry;
+				else Tail = entry;
+				Head = entry;
+				Count++;
+			}
+
+			void PushBack(TEntry* entry)
+			{
+				entry->Prev = Tail;
+				entry->Next = nullptr;
+				if (Tail) Tail->Next = entry;
+				else Head = entry;
+				Tail = entry;
+				Count++;
+			}
+
+			void Remove(TEntry* entry)
+			{
+				if (entry->Prev) entry->Prev->Next = entry->Next;
+				else Head = entry->Next;
+				if (entry->Next) entry->Next->Prev = entry->Prev;
+				else Tail = entry->Prev;
+				entry->Prev = nullptr;
+				entry->Next = nullptr;
+				Count--;
+			}
+
+			void MoveToFront(TEntry* entry)
+			{
+				if (Head == entry)
+					return;
+				Remove(entry);
+				PushFront(entry);
+			}
+
+			void Reset() { Head = Tail = nullptr; Count = 0; }
+		};
+
+		// Entries are heap allocated, list nodes must not move when set is rehashed
+		struct Shard
+		{
+			std::mutex						Mutex;
+			FlatSet<amUPtr<CacheEntry>>		Entries;
+			FlatSet<amUPtr<CacheEntryDX11>>	EntriesDX11;
+			LruList<CacheEntry>				LruRAM;
+			LruList<CacheEntry>				LruFS;
+			LruList<CacheEntryDX11>			LruDX11;
 		};
 
 		struct Settings
@@ -80,17 +166,21 @@ namespace rageam::graphics
 
 		Settings				m_Settings = {};
 		file::WPath				m_CacheDirectory;
-		HashSet<CacheEntry>		m_Entries;
-		HashSet<CacheEntryDX11>	m_EntriesDX11;
-		// Hashes of entries ordered from newest (first) to oldest (last)
-		// Ordered this way because it's easier to remove entries from end than from beginning
-		List<u32>				m_NewToOldEntriesRAM;
-		List<u32>				m_NewToOldEntriesFS;
-		List<u32>				m_NewToOldEntriesDX11;
-		u64						m_SizeRam = 0;			// Bytes taken by images in memory
-		u64						m_SizeFs = 0;			// Bytes taken by images in file system
+		amUPtr<ImagePackStore>	m_Store;
+		Shard					m_Shards[SHARD_COUNT];
+		std::atomic_uint64_t	m_Tick = 0;				// Incremented on every entry access
+		std::atomic_uint64_t	m_SizeRam = 0;			// Bytes taken by images in memory
+		std::atomic_uint64_t	m_SizeFs = 0;			// Bytes taken by images in file system
+		std::atomic_uint32_t	m_DX11ViewCount = 0;
 		double					m_NextTempEntriesDeleteTime = 0.0f;
-		std::mutex				m_Mutex;
+
+		std::atomic_uint64_t	m_HitCount = 0;
+		std::atomic_uint64_t	m_MissCount = 0;
+		std::atomic_uint64_t	m_FsLoadCount = 0;
+		std::atomic_uint64_t	m_EvictionCountRam = 0;
+		std::atomic_uint64_t	m_EvictionCountFs = 0;
+		std::atomic_uint64_t	m_DX11HitCount = 0;
+		std::atomic_uint64_t	m_DX11MissCount = 0;
 
 		u32 BytesToMb(u32 bytes) const { return bytes / (1024u * 1024u); }
 		u32 MbToBytes(u32 mb) const { return mb * 1024u * 1024u; }
@@ -99,31 +189,44 @@ namespace rageam::graphics
 		// Loads settings from app data and if config does not exist yet, creates new one
 		void LoadSettings();
 
-		bool GetInfoFromCachedImagePath(const file::WPath& path, u32& hash, u32& imageSize) const;
-		// If image kind is none, no extension added
-		file::WPath GetCachedImagePath(u32 hash, u32 imageSize, ImageFileKind kind) const;
+		// Removes image files and list left by older versions
+		void DeleteLegacyFileStore() const;
+
+		Shard& GetShard(const Hash128& hash) { return m_Shards[hash.Fold32() % SHARD_COUNT]; }
+
+		// Entry with exactly the same hash, entry of different image in the same bucket is not returned
+		template<typename TEntry>
+		static TEntry* FindEntry(const FlatSet<amUPtr<TEntry>>& entries, const Hash128& hash);
+
+		// Does not account stats, returns false if image failed to write and entry must be removed
+		bool MoveImageToFileSystem(CacheEntry& entry) const;
+		// Removes entry from RAM or FS list and accounts its size, entry itself is not removed
+		void UnlinkEntry(Shard& shard, CacheEntry* entry);
 
-		// Does not account stats
-		void MoveImageToFileSystem(CacheEntry& entry, u32 hash) const;
+		// Locks shard which list has the oldest entry among all shards, null if all lists are empty.
+		// Shards are peeked one by one, so entry may be used again before shard is locked, this is fine for eviction
+		template<typename TEntry>
+		Shard* LockShardWithOldestEntry(LruList<TEntry> Shard::* list, std::unique_lock<std::mutex>& outLock);
 
+		// Must be called without holding any shard lock
 		void CleanUpOldEntriesToFitBudget();
 
 	public:
 		ImageCache();
 		~ImageCache() override;
 
-		ImagePtr GetFromCache(u32 hash, Vec2S* outUV2 = nullptr);
+		ImagePtr GetFromCache(const Hash128& hash, Vec2S* outUV2 = nullptr);
 		// Tex is optional
-		bool GetFromCacheDX11(u32 hash, amComPtr<ID3D11ShaderResourceView>& outView, Vec2S* outUV2 = nullptr, amComPtr<ID3D11Texture2D>* tex = nullptr);
+		bool GetFromCacheDX11(const Hash128& hash, amComPtr<ID3D11ShaderResourceView>& outView, Vec2S* outUV2 = nullptr, amComPtr<ID3D11Texture2D>* tex = nullptr);
 		// If store in file system is set to true, image will be moved to file on disk when ram budget is reached
 		// Image size is used for accounting budget
-		void Cache(const ImagePtr& image, u32 hash, u32 imageSize, ImageCacheEntryFlags entryFlags, Vec2S uv2);
-		void CacheDX11(u32 hash, const amComPtr<ID3D11ShaderResourceView>& view, const amComPtr<ID3D11Texture2D>& tex, Vec2S uv2);
+		void Cache(const ImagePtr& image, const Hash128& hash, u32 imageSize, ImageCacheEntryFlags entryFlags, Vec2S uv2);
+		void CacheDX11(const Hash128& hash, const amComPtr<ID3D11ShaderResourceView>& view, const amComPtr<ID3D11Texture2D>& tex, Vec2S uv2);
 
 		// Computes unique hash based on pixel data and compression options
-		HashValue ComputeImageHash(ImagePixelData imageData, u32 imageDataSize, const CompressedImageInfo& compInfo) const;
+		Hash128 ComputeImageHash(ImagePixelData imageData, u32 imageDataSize, const CompressedImageInfo& compInfo) const;
 		// Computes unique hash based on only pixel data
-		HashValue ComputeImageHash(ImagePixelData	imageData, u32 imageDataSize) const;
+		Hash128 ComputeImageHash(ImagePixelData	imageData, u32 imageDataSize) const;
 		// Checks if given time is greater than threshold
 		bool ShouldStore(u32 elapsedMilliseconds) const { return elapsedMilliseconds >= m_Settings.TimeToCacheThreshold; }
 
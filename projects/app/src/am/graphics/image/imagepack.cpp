@@ -0,0 +1,537 @@
+#include "imagepack.h"
+
+#include "am/file/fileutils.h"
+#include "am/file/iterator.h"
+#include "am/system/trace.h"
+#include "am/system/worker.h"
+#include "helpers/align.h"
+
+
+rageam::graphics::ImagePackStore::SegmentFile::~SegmentFile()
+{
+	if (Handle != INVALID_HANDLE_VALUE)
+		CloseHandle(Handle);
+
+	if (Retired && !DeleteFileW(Path))
+	{
+		AM_WARNINGF(L"ImagePackStore::~SegmentFile() -> Failed to delete retired segment '%ls'", Path.GetCStr());
+	}
+}
+
+rageam::graphics::ImagePackStore::SegmentView::~SegmentView()
+{
+	if (Base) UnmapViewOfFile(Base);
+	if (Mapping) CloseHandle(Mapping);
+}
+
+rageam::file::WPath rageam::graphics::ImagePackStore::GetSegmentPath(u32 index) const
+{
+	return m_Directory / String::FormatTemp(SEGMENT_NAME_FORMAT, index);
+}
+
+rageam::graphics::ImagePackStore::Segment* rageam::graphics::ImagePackStore::OpenSegment(u32 index, bool create)
+{
+	file::WPath path = GetSegmentPath(index);
+
+	// Share delete because retired segment file is deleted while its views may be still mapped
+	HANDLE handle = CreateFileW(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+		create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (handle == INVALID_HANDLE_VALUE)
+	{
+		AM_ERRF(L"ImagePackStore::OpenSegment() -> Failed to open '%ls', last error: %#x", path.GetCStr(), GetLastError());
+		return nullptr;
+	}
+
+	LARGE_INTEGER fileSize = {};
+	GetFileSizeEx(handle, &fileSize);
+
+	Segment segment;
+	segment.Index = index;
+	segment.File = std::make_shared<SegmentFile>();
+	segment.File->Path = path;
+	segment.File->Handle = handle;
+	segment.Size = fileSize.QuadPart;
+	m_SizeOnDisk += segment.Size;
+	return &m_Segments.EmplaceAt(index, std::move(segment));
+}
+
+void rageam::graphics::ImagePackStore::RetireSegment(Segment& segment)
+{
+	AM_ASSERT(segment.LiveSize == 0, "ImagePackStore::RetireSegment() -> Segment %u still has live images!", segment.Index);
+
+	u32 index = segment.Index;
+	if (m_ActiveSegment == index)
+		m_ActiveSegment = INVALID_SEGMENT;
+
+	m_SizeOnDisk -= segment.Size;
+	segment.File->Retired = true;
+	m_Segments.RemoveAt(index);
+}
+
+rageam::graphics::ImagePackStore::Segment* rageam::graphics::ImagePackStore::GetSegmentForWrite(u64 size)
+{
+	Segment* segment = m_Segments.TryGetAt(m_ActiveSegment);
+
+	// Start new segment if this one is full, large images still can be written in empty segment
+	if (segment && segment->Size > 0 && ALIGN(segment->Size, PAYLOAD_ALIGNMENT) + size > SEGMENT_SIZE)
+	{
+		m_ActiveSegment = INVALID_SEGMENT;
+		if (segment->LiveSize == 0)
+			RetireSegment(*segment);
+		segment = nullptr;
+	}
+
+	if (!segment)
+	{
+		segment = OpenSegment(m_NextSegment++, true);
+		if (!segment)
+			return nullptr;
+		m_ActiveSegment = segment->Index;
+	}
+	return segment;
+}
+
+bool rageam::graphics::ImagePackStore::EnsureMapped(Segment& segment, u64 end)
+{
+	if (segment.View && segment.View->Size >= end)
+		return true;
+
+	// Copy-on-write, some image functions (for e.g. Swizzle) alter pixels of the image in place
+	amPtr<SegmentView> view = std::make_shared<SegmentView>();
+	view->File = segment.File;
+	view->Mapping = CreateFileMappingW(segment.File->Handle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+	view->Base = view->Mapping ? static_cast<char*>(MapViewOfFile(view->Mapping, FILE_MAP_COPY, 0, 0, 0)) : nullptr;
+	if (!view->Base)
+	{
+		AM_ERRF("ImagePackStore::EnsureMapped() -> Failed to map segment %u, last error: %#x", segment.Index, GetLastError());
+		return false;
+	}
+	view->Size = segment.Size;
+
+	// Older view is kept alive by images that were read from it
+	segment.View = std::move(view);
+	return true;
+}
+
+bool rageam::graphics::ImagePackStore::Append(const char* data, u32 size, ImagePackRecord& record)
+{
+	Segment* segment = GetSegmentForWrite(size);
+	if (!segment)
+		return false;
+
+	// Hole left by alignment is zero-filled by file system
+	u64 offset = ALIGN(segment->Size, PAYLOAD_ALIGNMENT);
+
+	OVERLAPPED overlapped = {};
+	overlapped.Offset = static_cast<DWORD>(offset);
+	overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+	DWORD written;
+	if (!WriteFile(segment->File->Handle, data, size, &written, &overlapped) || written != size)
+	{
+		AM_ERRF("ImagePackStore::Append() -> Failed to write %u bytes to segment %u, last error: %#x", size, segment->Index, GetLastError());
+		return false;
+	}
+
+	m_SizeOnDisk += offset + size - segment->Size;
+	segment->Size = offset + size;
+	segment->LiveSize += size;
+	m_SizeLive += size;
+
+	record.Segment = segment->Index;
+	record.Offset = offset;
+	record.Size = size;
+	return true;
+}
+
+void rageam::graphics::ImagePackStore::RemoveRecord(const ImagePackRecord& record)
+{
+	Segment* segment = m_Segments.TryGetAt(record.Segment);
+	if (!segment)
+		return;
+
+	segment->LiveSize -= record.Size;
+	m_SizeLive -= record.Size;
+
+	// Nothing to compact, just drop the whole segment
+	if (segment->LiveSize == 0 && segment->Index != m_ActiveSegment)
+		RetireSegment(*segment);
+}
+
+rageam::graphics::ImagePackRecord* rageam::graphics::ImagePackStore::FindRecord(const Hash128& hash) const
+{
+	ImagePackRecord* record = m_Records.TryGetAt(hash.Fold32());
+	if (!record || record->Hash != hash)
+		return nullptr;
+	return record;
+}
+
+void rageam::graphics::ImagePackStore::SaveIndex()
+{
+	AM_TRACE_FUNCTION();
+
+	List<ImagePackRecord> records;
+	records.Reserve(m_Records.GetNumUsedSlots());
+	for (ImagePackRecord& record : m_Records)
+		records.Add(record);
+	records.Sort([](const ImagePackRecord& lhs, const ImagePackRecord& rhs) { return lhs.Sequence > rhs.Sequence; });
+
+	IndexHeader header;
+	header.Magic = INDEX_MAGIC;
+	header.Version = INDEX_VERSION;
+	header.RecordCount = records.GetSize();
+	header.NextSegment = m_NextSegment;
+
+	// Written to temporary file first, previous index is kept if we fail
+	file::WPath indexPath = m_Directory / INDEX_NAME;
+	file::WPath tempPath = indexPath + L".tmp";
+	FILE* fs = file::OpenFileStream(tempPath, L"wb");
+	if (!fs)
+	{
+		AM_ERRF(L"ImagePackStore::SaveIndex() -> Failed to open '%ls' for writing", tempPath.GetCStr());
+		return;
+	}
+
+	bool written =
+		file::WriteFileSteam(&header, sizeof(IndexHeader), fs) &&
+		file::WriteFileSteam(records.GetItems(), sizeof(ImagePackRecord) * records.GetSize(), fs);
+	file::CloseFileStream(fs);
+
+	if (!written || !MoveFileExW(tempPath, indexPath, MOVEFILE_REPLACE_EXISTING))
+	{
+		AM_ERRF("ImagePackStore::SaveIndex() -> Failed to save index, last error: %#x", GetLastError());
+		DeleteFileW(tempPath);
+	}
+}
+
+bool rageam::graphics::ImagePackStore::NeedCompaction(const Segment& segment) const
+{
+	if (segment.Index == m_ActiveSegment)
+		return false;
+
+	// Once budget is exceeded we also compact segments that are mostly used
+	double liveRatio = m_SizeOnDisk > m_Budget ? COMPACT_LIVE_RATIO_OVER_BUDGET : COMPACT_LIVE_RATIO;
+	return segment.LiveSize < segment.Size * liveRatio;
+}
+
+bool rageam::graphics::ImagePackStore::NeedCompaction() const
+{
+	for (const Segment& segment : m_Segments)
+	{
+		if (NeedCompaction(segment))
+			return true;
+	}
+	return false;
+}
+
+void rageam::graphics::ImagePackStore::ScheduleCompaction()
+{
+	if (m_Closing || (m_CompactTask && !m_CompactTask->IsFinished()) || !NeedCompaction())
+		return;
+
+	m_CompactTask = BackgroundWorker::RunWithPriority([this]
+		{
+			Compact();
+			return true;
+		}, TaskPriority_Low);
+}
+
+void rageam::graphics::ImagePackStore::Compact()
+{
+	AM_TRACE_FUNCTION();
+
+	while (!m_Closing)
+	{
+		std::unique_lock lock(m_Mutex);
+
+		// Segment with the least live data gives most space for the least copying
+		Segment* victim = nullptr;
+		for (Segment& segment : m_Segments)
+		{
+			if (segment.Index == m_ActiveSegment)
+				continue;
+			if (!victim || segment.LiveSize * victim->Size < victim->LiveSize * segment.Size)
+				victim = &segment;
+		}
+
+		if (!victim || !NeedCompaction(*victim))
+			break;
+
+		u32 victimIndex = victim->Index;
+		List<Hash128> hashes;
+		for (ImagePackRecord& record : m_Records)
+		{
+			if (record.Segment == victimIndex)
+				hashes.Add(record.Hash);
+		}
+
+		if (!hashes.Any())
+		{
+			RetireSegment(*victim);
+			continue;
+		}
+		lock.unlock();
+
+		// Images are moved one by one, so cache is not blocked for the whole segment
+		for (const Hash128& hash : hashes)
+		{
+			if (m_Closing)
+				return;
+
+			std::unique_lock recordLock(m_Mutex);
+			ImagePackRecord* record = FindRecord(hash);
+			if (!record || record->Segment != victimIndex)
+				continue;
+
+			Segment* segment = m_Segments.TryGetAt(victimIndex);
+			if (!segment || !EnsureMapped(*segment, record->Offset + record->Size))
+				return;
+
+			// Segment pointer is not valid after append, new segment may be added
+			amPtr<SegmentView> view = segment->View;
+			ImagePackRecord moved = *record;
+			if (!Append(view->Base + record->Offset, record->Size, moved))
+				return;
+
+			RemoveRecord(*record); // Retires victim once last image is moved
+			*record = moved;
+		}
+
+		lock.lock();
+		m_CompactionCount++;
+	}
+}
+
+rageam::graphics::ImagePackStore::ImagePackStore(const file::WPath& directory, u64 budget)
+{
+	m_Directory = directory;
+	m_Budget = budget;
+}
+
+rageam::graphics::ImagePackStore::~ImagePackStore()
+{
+	m_Closing = true;
+	if (m_CompactTask)
+		m_CompactTask->Wait();
+
+	std::unique_lock lock(m_Mutex);
+	SaveIndex();
+}
+
+void rageam::graphics::ImagePackStore::Load(List<ImagePackRecord>& outRecords)
+{
+	AM_TRACE_FUNCTION();
+
+	std::unique_lock lock(m_Mutex);
+
+	file::WPath indexPath = m_Directory / INDEX_NAME;
+	HANDLE file = CreateFileW(indexPath, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (file != INVALID_HANDLE_VALUE)
+	{
+		LARGE_INTEGER fileSize = {};
+		GetFileSizeEx(file, &fileSize);
+		HANDLE mapping = fileSize.QuadPart > 0 ? CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+		pConstVoid view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+
+		auto header = static_cast<const IndexHeader*>(view);
+		if (!header ||
+			static_cast<u64>(fileSize.QuadPart) < sizeof(IndexHeader) ||
+			header->Magic != INDEX_MAGIC ||
+			header->Version != INDEX_VERSION ||
+			static_cast<u64>(fileSize.QuadPart) < sizeof(IndexHeader) + sizeof(ImagePackRecord) * header->RecordCount)
+		{
+			AM_WARNINGF("ImagePackStore::Load() -> Index is invalid or has different version, cache is reset");
+		}
+		else
+		{
+			m_NextSegment = header->NextSegment;
+
+			// Records are stored from newest to oldest
+			u32 recordCount = header->RecordCount;
+			auto records = reinterpret_cast<const ImagePackRecord*>(header + 1);
+			for (u32 i = 0; i < recordCount; i++)
+			{
+				const ImagePackRecord& record = records[i];
+				if (m_Records.TryGetAt(record.Hash.Fold32()))
+					continue;
+
+				Segment* segment = m_Segments.TryGetAt(record.Segment);
+				if (!segment && IsFileExists(GetSegmentPath(record.Segment)))
+					segment = OpenSegment(record.Segment, false);
+
+				// Segment was compacted but index was not saved (crash)
+				if (!segment || record.Offset + record.Size > segment->Size)
+				{
+					AM_WARNINGF("ImagePackStore::Load() -> Image %016llx%016llx points outside of segment %u, skipping",
+						record.Hash.High, record.Hash.Low, record.Segment);
+					continue;
+				}
+
+				ImagePackRecord& added = m_Records.InsertAt(record.Hash.Fold32(), record);
+				added.Sequence = recordCount - i;
+				segment->LiveSize += added.Size;
+				m_SizeLive += added.Size;
+				outRecords.Add(added);
+			}
+			m_Sequence = recordCount;
+		}
+
+		if (view) UnmapViewOfFile(view);
+		if (mapping) CloseHandle(mapping);
+		CloseHandle(file);
+	}
+
+	// Delete segments that have nothing useful left, they may remain after crash or if all images were removed
+	file::WPath searchPattern = m_Directory / L"Pack_*.seg";
+	file::Iterator it(searchPattern);
+	file::FindData findData;
+	while (it.Next())
+	{
+		it.GetCurrent(findData);
+
+		u32 index;
+		if (swscanf_s(findData.Path.GetFileName(), SEGMENT_NAME_FORMAT, &index) != 1)
+			continue;
+
+		Segment* segment = m_Segments.TryGetAt(index);
+		if (segment && segment->LiveSize > 0)
+		{
+			m_NextSegment = MAX(m_NextSegment, index + 1);
+			continue;
+		}
+
+		if (segment)
+			RetireSegment(*segment);
+		else
+			DeleteFileW(findData.Path);
+	}
+
+	// Continue writing to the last segment if there's space left, instead of starting new one on every launch
+	Segment* lastSegment = nullptr;
+	for (Segment& segment : m_Segments)
+	{
+		if (!lastSegment || segment.Index > lastSegment->Index)
+			lastSegment = &segment;
+	}
+	if (lastSegment && lastSegment->Size < SEGMENT_SIZE)
+		m_ActiveSegment = lastSegment->Index;
+
+	AM_DEBUGF("ImagePackStore::Load() -> Loaded %u images in %u segments", m_Records.GetNumUsedSlots(), m_Segments.GetNumUsedSlots());
+
+	ScheduleCompaction();
+}
+
+bool rageam::graphics::ImagePackStore::Write(const Hash128& hash, const Image& image, u32 imageSize, Vec2S uv2)
+{
+	AM_TRACE_FUNCTION();
+
+	std::unique_lock lock(m_Mutex);
+
+	ImagePackRecord* existing = m_Records.TryGetAt(hash.Fold32());
+	if (existing && existing->Hash == hash)
+	{
+		existing->Sequence = ++m_Sequence;
+		return true;
+	}
+
+	if (existing)
+	{
+		RemoveRecord(*existing);
+		m_Records.RemoveAt(hash.Fold32());
+	}
+
+	if (!image.HasPixelData())
+		return false;
+
+	ImagePackRecord record = {};
+	record.Hash = hash;
+	record.ImageSize = imageSize;
+	record.Sequence = ++m_Sequence;
+	record.PaddingUV2 = uv2;
+	record.Width = static_cast<u16>(image.GetWidth());
+	record.Height = static_cast<u16>(image.GetHeight());
+	record.PixelFormat = static_cast<u8>(image.GetPixelFormat());
+	record.MipCount = static_cast<u8>(image.GetMipCount());
+	if (!Append(image.GetPixelDataBytes(), image.ComputeTotalSizeWithMips(), record))
+		return false;
+
+	m_Records.InsertAt(hash.Fold32(), record);
+	return true;
+}
+
+rageam::graphics::ImagePtr rageam::graphics::ImagePackStore::Read(const Hash128& hash, Vec2S* outUV2)
+{
+	AM_TRACE_FUNCTION();
+
+	std::unique_lock lock(m_Mutex);
+
+	ImagePackRecord* record = FindRecord(hash);
+	if (!record)
+		return nullptr;
+
+	Segment* segment = m_Segments.TryGetAt(record->Segment);
+	if (!segment || !EnsureMapped(*segment, record->Offset + record->Size))
+		return nullptr;
+
+	// Pixel data is not freed, deleter only holds segment mapping until image is released
+	amPtr<SegmentView> view = segment->View;
+	PixelDataOwner pixelData = PixelDataOwner::CreateOwned(view->Base + record->Offset);
+	pixelData.DeleteFn = [view](pVoid) {};
+
+	ImageInfo info;
+	info.PixelFormat = static_cast<ImagePixelFormat>(record->PixelFormat);
+	info.Width = record->Width;
+	info.Height = record->Height;
+	info.MipCount = record->MipCount;
+
+	if (outUV2) *outUV2 = record->PaddingUV2;
+	return ImageFactory::Create(pixelData, info);
+}
+
+bool rageam::graphics::ImagePackStore::Contains(const Hash128& hash)
+{
+	std::unique_lock lock(m_Mutex);
+	return FindRecord(hash) != nullptr;
+}
+
+void rageam::graphics::ImagePackStore::Remove(const Hash128& hash)
+{
+	std::unique_lock lock(m_Mutex);
+
+	ImagePackRecord* record = FindRecord(hash);
+	if (!record)
+		return;
+
+	RemoveRecord(*record);
+	m_Records.RemoveAt(hash.Fold32());
+
+	ScheduleCompaction();
+}
+
+void rageam::graphics::ImagePackStore::Clear()
+{
+	std::unique_lock lock(m_Mutex);
+
+	List<u32> segments;
+	for (Segment& segment : m_Segments)
+	{
+		segment.LiveSize = 0;
+		segments.Add(segment.Index);
+	}
+	for (u32 index : segments)
+		RetireSegment(m_Segments.GetAt(index));
+
+	m_Records.Clear();
+	m_SizeLive = 0;
+}
+
+rageam::graphics::ImagePackState rageam::graphics::ImagePackStore::GetState()
+{
+	std::unique_lock lock(m_Mutex);
+
+	ImagePackState state;
+	state.SizeOnDisk = m_SizeOnDisk;
+	state.SizeLive = m_SizeLive;
+	state.SegmentCount = m_Segments.GetNumUsedSlots();
+	state.CompactionCount = m_CompactionCount;
+	return state;
+}
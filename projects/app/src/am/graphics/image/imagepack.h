@@ -0,0 +1,161 @@
+//
+// File: imagepack.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "image.h"
+#include "am/file/path.h"
+#include "am/system/datahash.h"
+
+#include <atomic>
+#include <mutex>
+
+namespace rageam
+{
+	class BackgroundTask;
+}
+
+namespace rageam::graphics
+{
+	// Location and metadata of image in pack, written to index file as is
+	struct ImagePackRecord
+	{
+		Hash128 Hash;
+		u32     Segment;
+		u64     Offset;
+		u32     Size;		// Pixel data size, including all mip maps
+		u32     ImageSize;	// Size image was accounted with in cache budget
+		u64     Sequence;	// Order images were written in, higher is newer
+		Vec2S   PaddingUV2;
+		u16     Width;
+		u16     Height;
+		u8      PixelFormat;
+		u8      MipCount;
+		u16     Reserved = 0;
+	};
+
+	struct ImagePackState
+	{
+		u64 SizeOnDisk;		// Including removed images that are not compacted yet
+		u64 SizeLive;
+		u32 SegmentCount;
+		u32 CompactionCount;
+	};
+
+	/**
+	 * \brief Log-structured file system store for image cache.
+	 * \n Raw pixel data (BC or RGBA, with mips) is appended to segment files, images are loaded as copy-on-write views
+	 * of memory mapped segment and don't need to be decoded. Removed images only leave a hole in the segment,
+	 * segments with little live data left are rewritten on background worker.
+	 * \n Index of all records is written on destruction and memory mapped on loading.
+	 * \remarks All functions are thread safe.
+	 */
+	class ImagePackStore
+	{
+		static constexpr u32 INDEX_MAGIC = MAKEFOURCC('I', 'P', 'C', 'K');
+		static constexpr u32 INDEX_VERSION = 2;	// Must be incremented when image hash function or record layout changes
+		static constexpr ConstWString INDEX_NAME = L"Pack.idx";
+		static constexpr ConstWString SEGMENT_NAME_FORMAT = L"Pack_%u.seg";
+		static constexpr u64 SEGMENT_SIZE = 64ull * 1024ull * 1024ull;	// Larger images get segment of their own
+		static constexpr u64 PAYLOAD_ALIGNMENT = 16;					// For aligned SIMD loads in decoders
+		static constexpr double COMPACT_LIVE_RATIO = 0.5;				// Segments that are less than half used are compacted
+		static constexpr double COMPACT_LIVE_RATIO_OVER_BUDGET = 0.9;
+		static constexpr u32 INVALID_SEGMENT = u32(-1);
+
+		struct IndexHeader
+		{
+			u32 Magic;
+			u32 Version;
+			u32 RecordCount;
+			u32 NextSegment;
+		};
+
+		// Deletes the file once last view of retired segment is released
+		struct SegmentFile
+		{
+			file::WPath		 Path;
+			HANDLE			 Handle = INVALID_HANDLE_VALUE;
+			std::atomic_bool Retired = false;
+
+			~SegmentFile();
+		};
+
+		// Mapping of segment at the moment it was created, data appended after that is not visible
+		struct SegmentView
+		{
+			amPtr<SegmentFile> File;
+			HANDLE			   Mapping = NULL;
+			char*			   Base = nullptr;
+			u64				   Size = 0;
+
+			~SegmentView();
+		};
+
+		struct Segment
+		{
+			u32					Index;
+			amPtr<SegmentFile>	File;
+			amPtr<SegmentView>	View;
+			u64					Size = 0;
+			u64					LiveSize = 0;
+		};
+
+		file::WPath				m_Directory;
+		u64						m_Budget;
+		FlatSet<ImagePackRecord>	m_Records;	// Keyed by 32 bit fold of record hash, see FindRecord
+		FlatSet<Segment>		m_Segments;
+		u32						m_NextSegment = 0;
+		u32						m_ActiveSegment = INVALID_SEGMENT;	// New images are appended to this segment
+		u64						m_Sequence = 0;
+		u64						m_SizeOnDisk = 0;
+		u64						m_SizeLive = 0;
+		u32						m_CompactionCount = 0;
+		amPtr<BackgroundTask>	m_CompactTask;
+		std::atomic_bool		m_Closing = false;
+		std::mutex				m_Mutex;
+
+		file::WPath GetSegmentPath(u32 index) const;
+
+		Segment* OpenSegment(u32 index, bool create);
+		void	 RetireSegment(Segment& segment);
+		// Segment that can fit payload of given size, new one is created if active one is full
+		Segment* GetSegmentForWrite(u64 size);
+		// Remaps segment if range is beyond currently mapped part of it
+		bool	 EnsureMapped(Segment& segment, u64 end);
+		bool	 Append(const char* data, u32 size, ImagePackRecord& record);
+		// Record with exactly the same hash, record of different image in the same bucket is not returned
+		ImagePackRecord* FindRecord(const Hash128& hash) const;
+		void	 RemoveRecord(const ImagePackRecord& record);
+
+		// Records are written sorted from newest to oldest
+		void SaveIndex();
+
+		bool NeedCompaction(const Segment& segment) const;
+		bool NeedCompaction() const;
+		void ScheduleCompaction();
+		void Compact();
+
+	public:
+		// Budget is used only to decide when to compact, live size is controlled by cache
+		ImagePackStore(const file::WPath& directory, u64 budget);
+		~ImagePackStore();
+
+		// Maps index and validates records, segment files that have no live records are deleted.
+		// Records are ordered from newest to oldest
+		void Load(List<ImagePackRecord>& outRecords);
+
+		// If image is already stored, only marks it as newest. Different image in the same bucket is replaced
+		bool Write(const Hash128& hash, const Image& image, u32 imageSize, Vec2S uv2);
+		// Image pixels are view of segment memory, no copy is made
+		ImagePtr Read(const Hash128& hash, Vec2S* outUV2 = nullptr);
+		bool Contains(const Hash128& hash);
+		void Remove(const Hash128& hash);
+		void Clear();
+
+		ImagePackState GetState();
+	};
+}
@@ -0,0 +1,683 @@
+#include "imageresize.h"
+
+#include "am/system/asserts.h"
+#include "am/system/enum.h"
+#include "am/system/trace.h"
+#include "bc.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+namespace rageam::graphics
+{
+	namespace
+	{
+		// Added to alpha when color is weighted, so fully transparent areas keep their filtered color instead of black
+		static constexpr float IMAGE_RESIZE_ALPHA_EPSILON = 1.0f / 64.0f;
+
+		// Filter weights for one axis, computed once for every destination pixel
+		struct ResampleAxis
+		{
+			List<int>	First;		// First source pixel that contributes to destination pixel
+			List<int>	Count;		// Number of source pixels with non-zero weight
+			List<float>	Weights;	// TapStride weights per destination pixel, padded with zeros
+			int			TapStride = 0;
+		};
+
+		float FilterSupport(ResizeFilter filter)
+		{
+			switch (filter)
+			{
+			case ResizeFilter_Box:			return 0.5f;
+			case ResizeFilter_Triangle:		return 1.0f;
+			case ResizeFilter_CubicBSpline:
+			case ResizeFilter_CatmullRom:
+			case ResizeFilter_Mitchell:		return 2.0f;
+			case ResizeFilter_Point:		return 0.5f;
+
+			default: AM_UNREACHABLE("ImageResize() -> Filter %s is not implemented.", Enum::GetName(filter));
+			}
+		}
+
+		// Mitchell-Netravali family of cubic filters
+		float FilterCubic(float x, float b, float c)
+		{
+			x = fabsf(x);
+			float x2 = x * x;
+			float x3 = x2 * x;
+			if (x < 1.0f)
+				return ((12.0f - 9.0f * b - 6.0f * c) * x3 + (-18.0f + 12.0f * b + 6.0f * c) * x2 + (6.0f - 2.0f * b)) / 6.0f;
+			if (x < 2.0f)
+				return ((-b - 6.0f * c) * x3 + (6.0f * b + 30.0f * c) * x2 + (-12.0f * b - 48.0f * c) * x + (8.0f * b + 24.0f * c)) / 6.0f;
+			return 0.0f;
+		}
+
+		float FilterWeight(ResizeFilter filter, float x)
+		{
+			switch (filter)
+			{
+			case ResizeFilter_Triangle:		return MAX(0.0f, 1.0f - fabsf(x));
+			case ResizeFilter_CubicBSpline: return FilterCubic(x, 1.0f, 0.0f);
+			case ResizeFilter_CatmullRom:	return FilterCubic(x, 0.0f, 0.5f);
+			case ResizeFilter_Mitchell:		return FilterCubic(x, 1.0f / 3.0f, 1.0f / 3.0f);
+
+			default: return 0.0f;
+			}
+		}
+
+		void ComputeAxis(ResampleAxis& axis, ResizeFilter filter, int srcSize, int dstSize)
+		{
+			float scale = static_cast<float>(dstSize) / static_cast<float>(srcSize);
+			// When downsampling, filter is stretched to cover all source pixels
+			float filterScale = MIN(scale, 1.0f);
+			float radius = FilterSupport(filter) / filterScale;
+			// Box filter covers exactly one destination pixel
+			float boxRadius = 0.5f / scale;
+
+			int maxTaps = static_cast<int>(ceilf(radius * 2.0f)) + 3;
+			axis.TapStride = ALIGN(maxTaps, 4);
+			axis.First.Resize(dstSize);
+			axis.Count.Resize(dstSize);
+			axis.Weights.Resize(dstSize * axis.TapStride);
+
+			for (int i = 0; i < dstSize; i++)
+			{
+				float* weights = axis.Weights.GetItems() + static_cast<size_t>(i) * axis.TapStride;
+				memset(weights, 0, sizeof(float) * axis.TapStride);
+
+				// Pixel centers are at half, source pixel 's' has center at 's + 0.5'
+				float center = (static_cast<float>(i) + 0.5f) / scale;
+
+				if (filter == ResizeFilter_Point)
+				{
+					axis.First[i] = MIN(static_cast<int>(center), srcSize - 1);
+					axis.Count[i] = 1;
+					weights[0] = 1.0f;
+					continue;
+				}
+
+				int lo = static_cast<int>(floorf(center - radius - 0.5f));
+				int hi = static_cast<int>(ceilf(center + radius - 0.5f));
+				int first = std::clamp(lo, 0, srcSize - 1);
+				int last = std::clamp(hi, 0, srcSize - 1);
+				AM_ASSERT(last - first < axis.TapStride, "ImageResize() -> Too many filter taps.");
+
+				// Pixels outside of image are clamped to edge, their weights go to the edge pixel
+				float totalWeight = 0.0f;
+				for (int s = lo; s <= hi; s++)
+				{
+					float weight;
+					if (filter == ResizeFilter_Box)
+					{
+						float overlap = MIN(static_cast<float>(s + 1), center + boxRadius) - MAX(static_cast<float>(s), center - boxRadius);
+						weight = MAX(overlap, 0.0f);
+					}
+					else
+					{
+						weight = FilterWeight(filter, (static_cast<float>(s) + 0.5f - center) * filterScale);
+					}
+
+					weights[std::clamp(s, 0, srcSize - 1) - first] += weight;
+					totalWeight += weight;
+				}
+
+				if (totalWeight != 0.0f)
+				{
+					float invTotalWeight = 1.0f / totalWeight;
+					for (int t = 0; t <= last - first; t++)
+						weights[t] *= invTotalWeight;
+				}
+
+				// Trim zero weights on edges
+				int count = last - first + 1;
+				int skip = 0;
+				while (skip < count - 1 && weights[skip] == 0.0f)
+					skip++;
+				if (skip > 0)
+				{
+					memmove(weights, weights + skip, sizeof(float) * (count - skip));
+					memset(weights + count - skip, 0, sizeof(float) * skip);
+					first += skip;
+					count -= skip;
+				}
+				while (count > 1 && weights[count - 1] == 0.0f)
+					count--;
+
+				axis.First[i] = first;
+				axis.Count[i] = count;
+			}
+		}
+
+		struct ResampleContext
+		{
+			const char*		 Src;
+			char*			 Dst;
+			ImagePixelFormat Format;
+			int				 SrcWidth;
+			int				 DstWidth;
+			u32				 SrcRowPitch;
+			u32				 DstRowPitch;
+			int				 Channels;		// Float channels per pixel, 4 for U32 / U24 / U16 and 1 for U8 / A8
+			bool			 Premultiply;	// Color is multiplied by alpha before filtering
+			ResampleAxis	 Horizontal;
+			ResampleAxis	 Vertical;
+		};
+
+		// Source row to float, with alpha premultiplied if needed
+		void DecodeRow(const ResampleContext& ctx, const char* src, float* dst)
+		{
+			const u8* srcU8 = reinterpret_cast<const u8*>(src);
+			const __m128 inv255 = _mm_set1_ps(1.0f / 255.0f);
+			int width = ctx.SrcWidth;
+
+			switch (ctx.Format)
+			{
+			case ImagePixelFormat_U32:
+				for (int x = 0; x < width; x++)
+				{
+					int pixel;
+					memcpy(&pixel, srcU8 + x * 4, 4);
+					__m128 v = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixel)));
+					if (ctx.Premultiply)
+					{
+						// (a + e, a + e, a + e, 255) / 255
+						__m128 alpha = _mm_add_ps(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3)), _mm_set1_ps(IMAGE_RESIZE_ALPHA_EPSILON));
+						alpha = _mm_blend_ps(alpha, _mm_set1_ps(255.0f), 0b1000);
+						v = _mm_mul_ps(v, _mm_mul_ps(alpha, inv255));
+					}
+					_mm_storeu_ps(dst + x * 4, v);
+				}
+				break;
+
+			case ImagePixelFormat_U24:
+				for (int x = 0; x < width; x++)
+				{
+					const u8* p = srcU8 + x * 3;
+					int pixel = p[0] | p[1] << 8 | p[2] << 16;
+					_mm_storeu_ps(dst + x * 4, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixel))));
+				}
+				break;
+
+			case ImagePixelFormat_U16:
+				for (int x = 0; x < width; x++)
+				{
+					float gray = srcU8[x * 2 + 0];
+					float alpha = srcU8[x * 2 + 1];
+					if (ctx.Premultiply)
+						gray *= (alpha + IMAGE_RESIZE_ALPHA_EPSILON) / 255.0f;
+					_mm_storeu_ps(dst + x * 4, _mm_setr_ps(gray, alpha, 0.0f, 0.0f));
+				}
+				break;
+
+			case ImagePixelFormat_U8:
+			case ImagePixelFormat_A8:
+			{
+				int x = 0;
+				for (; x + 4 <= width; x += 4)
+				{
+					int pixels;
+					memcpy(&pixels, srcU8 + x, 4);
+					_mm_storeu_ps(dst + x, _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_cvtsi32_si128(pixels))));
+				}
+				for (; x < width; x++)
+					dst[x] = srcU8[x];
+				break;
+			}
+
+			default: AM_UNREACHABLE("ImageResize() -> Pixel format '%s' is not supported.", Enum::GetName(ctx.Format));
+			}
+		}
+
+		void FilterRowHorizontal(const ResampleContext& ctx, const float* src, float* dst)
+		{
+			const ResampleAxis& axis = ctx.Horizontal;
+
+			if (ctx.Channels == 4)
+			{
+				// Whole pixel fits in single register
+				for (int x = 0; x < ctx.DstWidth; x++)
+				{
+					const float* weights = axis.Weights.GetItems() + static_cast<size_t>(x) * axis.TapStride;
+					const float* pixels = src + static_cast<size_t>(axis.First[x]) * 4;
+					int count = axis.Count[x];
+
+					__m128 acc0 = _mm_setzero_ps();
+					__m128 acc1 = _mm_setzero_ps();
+					int t = 0;
+					for (; t + 2 <= count; t += 2)
+					{
+						acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_set1_ps(weights[t + 0]), _mm_loadu_ps(pixels + t * 4 + 0)));
+						acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_set1_ps(weights[t + 1]), _mm_loadu_ps(pixels + t * 4 + 4)));
+					}
+					if (t < count)
+						acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(pixels + t * 4)));
+
+					_mm_storeu_ps(dst + x * 4, _mm_add_ps(acc0, acc1));
+				}
+				return;
+			}
+
+			// Single channel, dot product of 4 taps at once, weights and source row are padded with zeros
+			for (int x = 0; x < ctx.DstWidth; x++)
+			{
+				const float* weights = axis.Weights.GetItems() + static_cast<size_t>(x) * axis.TapStride;
+				const float* pixels = src + axis.First[x];
+				int count = ALIGN(axis.Count[x], 4);
+
+				__m128 acc = _mm_setzero_ps();
+				for (int t = 0; t < count; t += 4)
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(weights + t), _mm_loadu_ps(pixels + t)));
+
+				acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+				acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+				dst[x] = _mm_cvtss_f32(acc);
+			}
+		}
+
+		// Filtered source rows are stored one after another, rowStride apart
+		void FilterRowVertical(const float* rows, size_t rowStride, const float* weights, int count, int numFloats, float* dst)
+		{
+			int i = 0;
+#ifdef AM_IMAGE_USE_AVX2
+			for (; i + 8 <= numFloats; i += 8)
+			{
+				__m256 acc = _mm256_setzero_ps();
+				for (int t = 0; t < count; t++)
+					acc = _mm256_add_ps(acc, _mm256_mul_ps(_mm256_set1_ps(weights[t]), _mm256_loadu_ps(rows + t * rowStride + i)));
+				_mm256_storeu_ps(dst + i, acc);
+			}
+#endif
+			for (; i + 4 <= numFloats; i += 4)
+			{
+				__m128 acc = _mm_setzero_ps();
+				for (int t = 0; t < count; t++)
+					acc = _mm_add_ps(acc, _mm_mul_ps(_mm_set1_ps(weights[t]), _mm_loadu_ps(rows + t * rowStride + i)));
+				_mm_storeu_ps(dst + i, acc);
+			}
+			for (; i < numFloats; i++)
+			{
+				float acc = 0.0f;
+				for (int t = 0; t < count; t++)
+					acc += weights[t] * rows[t * rowStride + i];
+				dst[i] = acc;
+			}
+		}
+
+		// Float row back to destination format, alpha is unpremultiplied if needed
+		void EncodeRow(const ResampleContext& ctx, const float* src, char* dst)
+		{
+			u8* dstU8 = reinterpret_cast<u8*>(dst);
+			const __m128 zero = _mm_setzero_ps();
+			const __m128 max = _mm_set1_ps(255.0f);
+			int width = ctx.DstWidth;
+
+			switch (ctx.Format)
+			{
+			case ImagePixelFormat_U32:
+			case ImagePixelFormat_U24:
+			{
+				int pixelSize = ctx.Format == ImagePixelFormat_U32 ? 4 : 3;
+				for (int x = 0; x < width; x++)
+				{
+					__m128 v = _mm_loadu_ps(src + x * 4);
+					if (ctx.Premultiply)
+					{
+						// Weights are normalized, so sum of weighted alphas is filtered alpha + e
+						float alpha = _mm_cvtss_f32(_mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))) + IMAGE_RESIZE_ALPHA_EPSILON;
+						if (alpha > IMAGE_RESIZE_ALPHA_EPSILON * 0.5f)
+						{
+							__m128 scale = _mm_blend_ps(_mm_set1_ps(255.0f / alpha), _mm_set1_ps(1.0f), 0b1000);
+							v = _mm_mul_ps(v, scale);
+						}
+					}
+					v = _mm_min_ps(_mm_max_ps(v, zero), max);
+					__m128i i32 = _mm_cvtps_epi32(v);
+					__m128i i8 = _mm_packus_epi16(_mm_packus_epi32(i32, i32), i32);
+					int pixel = _mm_cvtsi128_si32(i8);
+					memcpy(dstU8 + x * pixelSize, &pixel, pixelSize);
+				}
+				break;
+			}
+
+			case ImagePixelFormat_U16:
+				for (int x = 0; x < width; x++)
+				{
+					float gray = src[x * 4 + 0];
+					float alpha = src[x * 4 + 1];
+					if (ctx.Premultiply && alpha + IMAGE_RESIZE_ALPHA_EPSILON > IMAGE_RESIZE_ALPHA_EPSILON * 0.5f)
+						gray *= 255.0f / (alpha + IMAGE_RESIZE_ALPHA_EPSILON);
+					gray = std::clamp(gray, 0.0f, 255.0f);
+					alpha = std::clamp(alpha, 0.0f, 255.0f);
+					dstU8[x * 2 + 0] = static_cast<u8>(gray + 0.5f);
+					dstU8[x * 2 + 1] = static_cast<u8>(alpha + 0.5f);
+				}
+				break;
+
+			case ImagePixelFormat_U8:
+			case ImagePixelFormat_A8:
+			{
+				int x = 0;
+				for (; x + 16 <= width; x += 16)
+				{
+					__m128i i0 = _mm_cvtps_epi32(_mm_loadu_ps(src + x + 0));
+					__m128i i1 = _mm_cvtps_epi32(_mm_loadu_ps(src + x + 4));
+					__m128i i2 = _mm_cvtps_epi32(_mm_loadu_ps(src + x + 8));
+					__m128i i3 = _mm_cvtps_epi32(_mm_loadu_ps(src + x + 12));
+					// Saturation clamps to 0..255
+					__m128i i8 = _mm_packus_epi16(_mm_packs_epi32(i0, i1), _mm_packs_epi32(i2, i3));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dstU8 + x), i8);
+				}
+				for (; x < width; x++)
+					dstU8[x] = static_cast<u8>(std::clamp(src[x], 0.0f, 255.0f) + 0.5f);
+				break;
+			}
+
+			default: AM_UNREACHABLE("ImageResize() -> Pixel format '%s' is not supported.", Enum::GetName(ctx.Format));
+			}
+		}
+
+		void ResampleBand(const ResampleContext& ctx, int yBegin, int yEnd)
+		{
+			const ResampleAxis& vertical = ctx.Vertical;
+
+			// Range of source rows used by this band
+			int rowFirst = INT_MAX;
+			int rowLast = 0;
+			for (int y = yBegin; y < yEnd; y++)
+			{
+				rowFirst = MIN(rowFirst, vertical.First[y]);
+				rowLast = MAX(rowLast, vertical.First[y] + vertical.Count[y] - 1);
+			}
+			int rowCount = rowLast - rowFirst + 1;
+
+			// Padding allows single channel filter to read whole 4 tap groups
+			u32 decodedFloats = (ctx.SrcWidth + ctx.Horizontal.TapStride) * ctx.Channels;
+			u32 filteredFloats = ctx.DstWidth * ctx.Channels;
+
+			// Band is a job on its own, scratch rows are bumped from its arena and released at once when band is done
+			ImageAllocJobScope allocScope;
+			float* decodedRow = static_cast<float*>(ImageAllocTemp(decodedFloats * sizeof(float)));
+			float* filteredRows = static_cast<float*>(ImageAllocTemp(rowCount * filteredFloats * sizeof(float)));
+			float* outputRow = static_cast<float*>(ImageAllocTemp(filteredFloats * sizeof(float)));
+			memset(decodedRow, 0, decodedFloats * sizeof(float));
+
+			for (int row = 0; row < rowCount; row++)
+			{
+				const char* src = ctx.Src + static_cast<size_t>(rowFirst + row) * ctx.SrcRowPitch;
+				DecodeRow(ctx, src, decodedRow);
+				FilterRowHorizontal(ctx, decodedRow, filteredRows + static_cast<size_t>(row) * filteredFloats);
+			}
+
+			for (int y = yBegin; y < yEnd; y++)
+			{
+				const float* rows = filteredRows + static_cast<size_t>(vertical.First[y] - rowFirst) * filteredFloats;
+				const float* weights = vertical.Weights.GetItems() + static_cast<size_t>(y) * vertical.TapStride;
+				FilterRowVertical(rows, filteredFloats, weights, vertical.Count[y], filteredFloats, outputRow);
+				EncodeRow(ctx, outputRow, ctx.Dst + static_cast<size_t>(y) * ctx.DstRowPitch);
+			}
+
+			ImageFreeTemp(outputRow);
+			ImageFreeTemp(filteredRows);
+			ImageFreeTemp(decodedRow);
+		}
+
+		// Shuffles pairs of horizontally adjacent pixels so channels of both pixels are next to each other,
+		// then pair sums are computed with single multiply-add with ones
+		struct Box2x2Layout
+		{
+			__m128i Shuffle;
+			int		SrcBytes;	// Number of source row bytes processed by one iteration, destination gets half
+		};
+
+		Box2x2Layout GetBox2x2Layout(ImagePixelFormat fmt)
+		{
+			switch (fmt)
+			{
+			case ImagePixelFormat_U32: return { _mm_setr_epi8(0, 4, 1, 5, 2, 6, 3, 7, 8, 12, 9, 13, 10, 14, 11, 15), 16 };
+			case ImagePixelFormat_U24: return { _mm_setr_epi8(0, 3, 1, 4, 2, 5, 6, 9, 7, 10, 8, 11, -1, -1, -1, -1), 12 };
+			case ImagePixelFormat_U16: return { _mm_setr_epi8(0, 2, 1, 3, 4, 6, 5, 7, 8, 10, 9, 11, 12, 14, 13, 15), 16 };
+			case ImagePixelFormat_U8:
+			case ImagePixelFormat_A8:  return { _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15), 16 };
+
+			default: AM_UNREACHABLE("ImageDownsampleBox2x2() -> Pixel format '%s' is not supported.", Enum::GetName(fmt));
+			}
+		}
+
+		void Box2x2Row(const Box2x2Layout& layout, u8* dst, const u8* row0, const u8* row1, int dstWidth, int pixelSize)
+		{
+			const __m128i ones = _mm_set1_epi8(1);
+			const __m128i two = _mm_set1_epi16(2);
+
+			int srcRowBytes = dstWidth * 2 * pixelSize;
+			int dstBytes = layout.SrcBytes / 2;
+
+			// Vector loads are 16 bytes even if layout uses less
+			int offset = 0;
+			for (; offset + 16 <= srcRowBytes; offset += layout.SrcBytes)
+			{
+				__m128i a = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + offset)), layout.Shuffle);
+				__m128i b = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + offset)), layout.Shuffle);
+				__m128i sum = _mm_add_epi16(_mm_maddubs_epi16(a, ones), _mm_maddubs_epi16(b, ones));
+				sum = _mm_srli_epi16(_mm_add_epi16(sum, two), 2);
+				u64 packed = _mm_cvtsi128_si64(_mm_packus_epi16(sum, sum));
+				memcpy(dst + offset / 2, &packed, dstBytes);
+			}
+
+			for (int i = offset / 2; i < dstWidth * pixelSize; i++)
+			{
+				int pixel = i / pixelSize;
+				int channel = i % pixelSize;
+				int s0 = (pixel * 2 + 0) * pixelSize + channel;
+				int s1 = (pixel * 2 + 1) * pixelSize + channel;
+				dst[i] = static_cast<u8>((row0[s0] + row0[s1] + row1[s0] + row1[s1] + 2) >> 2);
+			}
+		}
+
+		// Color is weighted by alpha so fully transparent pixels don't bleed in
+		void Box2x2RowAlphaWeighted(u8* dst, const u8* row0, const u8* row1, int dstWidth, int pixelSize)
+		{
+			if (pixelSize == 4)
+			{
+				const __m128 quarter = _mm_set1_ps(0.25f);
+				for (int x = 0; x < dstWidth; x++)
+				{
+					u64 top, bottom;
+					memcpy(&top, row0 + x * 8, 8);
+					memcpy(&bottom, row1 + x * 8, 8);
+					__m128i topPixels = _mm_cvtsi64_si128(static_cast<long long>(top));
+					__m128i bottomPixels = _mm_cvtsi64_si128(static_cast<long long>(bottom));
+
+					__m128 p0 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(topPixels));
+					__m128 p1 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(topPixels, 4)));
+					__m128 p2 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(bottomPixels));
+					__m128 p3 = _mm_cvtepi32_ps(_mm_cvtepu8_epi32(_mm_srli_si128(bottomPixels, 4)));
+
+					__m128 a0 = _mm_shuffle_ps(p0, p0, _MM_SHUFFLE(3, 3, 3, 3));
+					__m128 a1 = _mm_shuffle_ps(p1, p1, _MM_SHUFFLE(3, 3, 3, 3));
+					__m128 a2 = _mm_shuffle_ps(p2, p2, _MM_SHUFFLE(3, 3, 3, 3));
+					__m128 a3 = _mm_shuffle_ps(p3, p3, _MM_SHUFFLE(3, 3, 3, 3));
+					__m128 alphaSum = _mm_add_ps(_mm_add_ps(a0, a1), _mm_add_ps(a2, a3));
+
+					__m128 average = _mm_mul_ps(_mm_add_ps(_mm_add_ps(p0, p1), _mm_add_ps(p2, p3)), quarter);
+					float alpha = _mm_cvtss_f32(alphaSum);
+					if (alpha > 0.0f)
+					{
+						__m128 weighted = _mm_add_ps(
+							_mm_add_ps(_mm_mul_ps(p0, a0), _mm_mul_ps(p1, a1)),
+							_mm_add_ps(_mm_mul_ps(p2, a2), _mm_mul_ps(p3, a3)));
+						// Alpha itself is regular average
+						average = _mm_blend_ps(_mm_div_ps(weighted, alphaSum), average, 0b1000);
+					}
+
+					__m128i i32 = _mm_cvtps_epi32(average);
+					__m128i i8 = _mm_packus_epi16(_mm_packus_epi32(i32, i32), i32);
+					int pixel = _mm_cvtsi128_si32(i8);
+					memcpy(dst + x * 4, &pixel, 4);
+				}
+				return;
+			}
+
+			// Gray Alpha
+			for (int x = 0; x < dstWidth; x++)
+			{
+				const u8* p[4] = { row0 + x * 4, row0 + x * 4 + 2, row1 + x * 4, row1 + x * 4 + 2 };
+				int alphaSum = p[0][1] + p[1][1] + p[2][1] + p[3][1];
+				int graySum = p[0][0] + p[1][0] + p[2][0] + p[3][0];
+				int gray = (graySum + 2) >> 2;
+				if (alphaSum > 0)
+				{
+					int weighted = p[0][0] * p[0][1] + p[1][0] * p[1][1] + p[2][0] * p[2][1] + p[3][0] * p[3][1];
+					gray = (weighted + alphaSum / 2) / alphaSum;
+				}
+				dst[x * 2 + 0] = static_cast<u8>(gray);
+				dst[x * 2 + 1] = static_cast<u8>((alphaSum + 2) >> 2);
+			}
+		}
+
+		void Box2x2Rows(
+			const Box2x2Layout& layout, ImagePixelFormat fmt, bool alphaWeighted,
+			u8* dst, u32 dstRowPitch, const u8* src, u32 srcRowPitch, int dstWidth, int dstHeight)
+		{
+			int pixelSize = ImagePixelFormatBitsPerPixel[fmt] / 8;
+			for (int y = 0; y < dstHeight; y++)
+			{
+				const u8* row0 = src + static_cast<size_t>(y) * 2 * srcRowPitch;
+				const u8* row1 = row0 + srcRowPitch;
+				u8* dstRow = dst + static_cast<size_t>(y) * dstRowPitch;
+				if (alphaWeighted)
+					Box2x2RowAlphaWeighted(dstRow, row0, row1, dstWidth, pixelSize);
+				else
+					Box2x2Row(layout, dstRow, row0, row1, dstWidth, pixelSize);
+			}
+		}
+
+		bool IsBoxAlphaWeighted(ImagePixelFormat fmt, bool hasAlphaPixels)
+		{
+			return hasAlphaPixels && (fmt == ImagePixelFormat_U32 || fmt == ImagePixelFormat_U16);
+		}
+	}
+}
+
+void rageam::graphics::ImageResampleSeparable(
+	pVoid dst, pVoid src,
+	ResizeFilter filter,
+	ImagePixelFormat fmt,
+	int xFrom, int yFrom,
+	int xTo, int yTo,
+	bool hasAlphaPixels)
+{
+	AM_TRACE_FUNCTION();
+
+	ResampleContext ctx;
+	ctx.Src = static_cast<const char*>(src);
+	ctx.Dst = static_cast<char*>(dst);
+	ctx.Format = fmt;
+	ctx.SrcWidth = xFrom;
+	ctx.DstWidth = xTo;
+	ctx.SrcRowPitch = ImageComputeRowPitch(xFrom, fmt);
+	ctx.DstRowPitch = ImageComputeRowPitch(xTo, fmt);
+	ctx.Channels = fmt == ImagePixelFormat_U8 || fmt == ImagePixelFormat_A8 ? 1 : 4;
+	ctx.Premultiply = hasAlphaPixels && (fmt == ImagePixelFormat_U32 || fmt == ImagePixelFormat_U16);
+	ComputeAxis(ctx.Horizontal, filter, xFrom, xTo);
+	ComputeAxis(ctx.Vertical, filter, yFrom, yTo);
+
+	int rowsPerBand = std::clamp(IMAGE_RESIZE_BAND_MIN_PIXELS / xTo, 1, yTo);
+	int bandCount = (yTo + rowsPerBand - 1) / rowsPerBand;
+	ImageCompressor::ParallelFor(bandCount, [&](int bandIndex)
+		{
+			int yBegin = bandIndex * rowsPerBand;
+			int yEnd = MIN(yBegin + rowsPerBand, yTo);
+			ResampleBand(ctx, yBegin, yEnd);
+		});
+}
+
+void rageam::graphics::ImageDownsampleBox2x2(pVoid dst, pVoid src, ImagePixelFormat fmt, int width, int height, bool hasAlphaPixels)
+{
+	AM_TRACE_FUNCTION();
+
+	AM_ASSERT(width % 2 == 0 && height % 2 == 0, "ImageDownsampleBox2x2() -> Size %ix%i is not even.", width, height);
+
+	Box2x2Layout layout = GetBox2x2Layout(fmt);
+	bool alphaWeighted = IsBoxAlphaWeighted(fmt, hasAlphaPixels);
+	int dstWidth = width / 2;
+	int dstHeight = height / 2;
+	u32 srcRowPitch = ImageComputeRowPitch(width, fmt);
+	u32 dstRowPitch = ImageComputeRowPitch(dstWidth, fmt);
+
+	int rowsPerBand = std::clamp(IMAGE_RESIZE_BAND_MIN_PIXELS / dstWidth, 1, dstHeight);
+	int bandCount = (dstHeight + rowsPerBand - 1) / rowsPerBand;
+	ImageCompressor::ParallelFor(bandCount, [&](int bandIndex)
+		{
+			int yBegin = bandIndex * rowsPerBand;
+			int yEnd = MIN(yBegin + rowsPerBand, dstHeight);
+			Box2x2Rows(layout, fmt, alphaWeighted,
+				static_cast<u8*>(dst) + static_cast<size_t>(yBegin) * dstRowPitch, dstRowPitch,
+				static_cast<const u8*>(src) + static_cast<size_t>(yBegin) * 2 * srcRowPitch, srcRowPitch,
+				dstWidth, yEnd - yBegin);
+		});
+}
+
+void rageam::graphics::ImageGenerateMipChainBox(char* pixels, ImagePixelFormat fmt, int width, int height, int mipCount, bool hasAlphaPixels)
+{
+	AM_TRACE_FUNCTION();
+
+	AM_ASSERT(IS_POWER_OF_TWO(width) && IS_POWER_OF_TWO(height),
+		"ImageGenerateMipChainBox() -> Size %ix%i is not power of two.", width, height);
+
+	if (mipCount <= 1)
+		return;
+
+	char* mips[IMAGE_MAX_MIP_MAPS];
+	u32 rowPitches[IMAGE_MAX_MIP_MAPS];
+	char* mipPixels = pixels;
+	for (int i = 0; i < mipCount; i++)
+	{
+		mips[i] = mipPixels;
+		rowPitches[i] = ImageComputeRowPitch(width >> i, fmt);
+		mipPixels += ImageComputeSlicePitch(width >> i, height >> i, fmt);
+	}
+
+	Box2x2Layout layout = GetBox2x2Layout(fmt);
+	bool alphaWeighted = IsBoxAlphaWeighted(fmt, hasAlphaPixels);
+	int pixelSize = ImagePixelFormatBitsPerPixel[fmt] / 8;
+
+	// Mips that can be built tile by tile, the last tile level must be at least 1x1
+	int tileWidth = MIN(width, IMAGE_MIP_CHAIN_TILE_SIZE);
+	int tileHeight = MIN(height, IMAGE_MIP_CHAIN_TILE_SIZE);
+	int tiledMipCount = MIN(mipCount, BitScanR32(MIN(tileWidth, tileHeight)) + 1);
+	int tilesX = width / tileWidth;
+	int tilesY = height / tileHeight;
+
+	// Every job builds mips for one row of tiles
+	ImageCompressor::ParallelFor(tilesY, [&](int tileY)
+		{
+			for (int tileX = 0; tileX < tilesX; tileX++)
+			{
+				for (int i = 1; i < tiledMipCount; i++)
+				{
+					int srcTileWidth = tileWidth >> (i - 1);
+					int srcTileHeight = tileHeight >> (i - 1);
+					int dstTileWidth = tileWidth >> i;
+					int dstTileHeight = tileHeight >> i;
+
+					const u8* src = reinterpret_cast<const u8*>(mips[i - 1]) +
+						static_cast<size_t>(tileY) * srcTileHeight * rowPitches[i - 1] + static_cast<size_t>(tileX) * srcTileWidth * pixelSize;
+					u8* dst = reinterpret_cast<u8*>(mips[i]) +
+						static_cast<size_t>(tileY) * dstTileHeight * rowPitches[i] + static_cast<size_t>(tileX) * dstTileWidth * pixelSize;
+
+					Box2x2Rows(layout, fmt, alphaWeighted, dst, rowPitches[i], src, rowPitches[i - 1], dstTileWidth, dstTileHeight);
+				}
+			}
+		});
+
+	// Remaining mips are tiny
+	for (int i = tiledMipCount; i < mipCount; i++)
+	{
+		Box2x2Rows(layout, fmt, alphaWeighted,
+			reinterpret_cast<u8*>(mips[i]), rowPitches[i],
+			reinterpret_cast<const u8*>(mips[i - 1]), rowPitches[i - 1],
+			width >> i, height >> i);
+	}
+}
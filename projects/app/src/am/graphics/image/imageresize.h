@@ -0,0 +1,37 @@
+//
+// File: imageresize.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "image.h"
+
+namespace rageam::graphics
+{
+	// Separable resampler for non-compressed formats (U32, U24, U16, U8)
+	//
+	// Filter weights are computed once per destination column / row (polyphase kernel table), then image is filtered
+	// horizontally and vertically in float with SSE / AVX2 (AM_IMAGE_USE_AVX2). Destination rows are split in bands
+	// that are processed in parallel on image compressor worker, every band filters only source rows it needs
+	// Color channels are weighted by alpha if image has alpha pixels, same as stb_image_resize does for RGBA layout
+	//
+	// Box filter with exact 2x downscale (mip maps) is done by averaging 2x2 pixel quads in integer math
+
+	static constexpr int IMAGE_RESIZE_BAND_MIN_PIXELS = 64 * 1024;	// Minimum number of destination pixels processed by single job
+	static constexpr int IMAGE_MIP_CHAIN_TILE_SIZE = 64;			// Tile of the first mip, 16KB for RGBA so the whole tile chain stays in L1
+
+	void ImageResampleSeparable(
+		pVoid dst, pVoid src, ResizeFilter filter, ImagePixelFormat fmt,
+		int xFrom, int yFrom, int xTo, int yTo, bool hasAlphaPixels);
+
+	// Width and height are source image size, both must be even
+	void ImageDownsampleBox2x2(pVoid dst, pVoid src, ImagePixelFormat fmt, int width, int height, bool hasAlphaPixels);
+
+	// Fills mip maps 1..mipCount-1 from first mip (which must be already set) with 2x2 box filter,
+	// mips are stored one after another as in PixelDataOwner. Width and height must be power of two
+	// Image is processed in tiles and whole mip chain of tile is built while tile is still in cache
+	void ImageGenerateMipChainBox(char* pixels, ImagePixelFormat fmt, int width, int height, int mipCount, bool hasAlphaPixels);
+}
@@ -0,0 +1,404 @@
+#include "meshoptimizer.h"
+
+#include "am/system/asserts.h"
+#include "am/system/trace.h"
+#include "rage/math/math.h"
+
+#include <algorithm>
+
+namespace
+{
+	// Triangles adjacent to every vertex, in compressed (offset + count) form
+	struct VertexTriangleAdjacency
+	{
+		List<u32> Offsets;		// Vertex -> first triangle in Triangles, Offsets[vertexCount] is the end
+		List<u32> Triangles;
+
+		void Build(const u32* indices, u32 indexCount, u32 vertexCount)
+		{
+			Offsets.Resize(vertexCount + 1);
+			memset(Offsets.GetItems(), 0, sizeof(u32) * (vertexCount + 1));
+			for (u32 i = 0; i < indexCount; i++)
+				Offsets[indices[i] + 1]++;
+			for (u32 i = 0; i < vertexCount; i++)
+				Offsets[i + 1] += Offsets[i];
+
+			List<u32> fill;
+			fill.Resize(vertexCount);
+			memcpy(fill.GetItems(), Offsets.GetItems(), sizeof(u32) * vertexCount);
+
+			Triangles.Resize(indexCount);
+			for (u32 i = 0; i < indexCount; i++)
+				Triangles[fill[indices[i]]++] = i / 3;
+		}
+	};
+
+	struct ClusterSortKey
+	{
+		u32	  Cluster;
+		float Key;
+	};
+}
+
+rageam::graphics::VertexCacheStats rageam::graphics::MeshOptimizer::AnalyzeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount, u32 cacheSize)
+{
+	VertexCacheStats stats = {};
+	if (indexCount == 0 || vertexCount == 0)
+		return stats;
+
+	// Vertex is in the FIFO cache while less than 'cacheSize' other vertices were loaded after it
+	List<u32> timestamps;
+	timestamps.Resize(vertexCount);
+	memset(timestamps.GetItems(), 0, sizeof(u32) * vertexCount);
+
+	u32 time = cacheSize + 1;
+	u32 misses = 0;
+	for (u32 i = 0; i < indexCount; i++)
+	{
+		u32 index = indices[i];
+		if (time - timestamps[index] > cacheSize)
+		{
+			timestamps[index] = time++;
+			misses++;
+		}
+	}
+
+	u32 uniqueVertices = 0;
+	for (u32 timestamp : timestamps)
+	{
+		if (timestamp != 0)
+			uniqueVertices++;
+	}
+
+	stats.ACMR = static_cast<float>(misses) / static_cast<float>(indexCount / 3);
+	stats.ATVR = static_cast<float>(misses) / static_cast<float>(uniqueVertices);
+	return stats;
+}
+
+void rageam::graphics::MeshOptimizer::OptimizeVertexCache(u32* indices, u32 indexCount, u32 vertexCount, List<u32>* outClusters)
+{
+	AM_TRACE_FUNCTION();
+
+	AM_ASSERT(indexCount % 3 == 0, "MeshOptimizer::OptimizeVertexCache() -> Non triangle mesh with %u indices", indexCount);
+
+	if (outClusters)
+		outClusters->Clear();
+
+	u32 triangleCount = indexCount / 3;
+	if (triangleCount == 0)
+		return;
+
+	VertexTriangleAdjacency adjacency;
+	adjacency.Build(indices, indexCount, vertexCount);
+
+	// Number of not yet emitted triangles that use vertex
+	List<u32> liveTriangles;
+	liveTriangles.Resize(vertexCount);
+	for (u32 i = 0; i < vertexCount; i++)
+		liveTriangles[i] = adjacency.Offsets[i + 1] - adjacency.Offsets[i];
+
+	List<u32> cacheTimestamps;
+	cacheTimestamps.Resize(vertexCount);
+	memset(cacheTimestamps.GetItems(), 0, sizeof(u32) * vertexCount);
+
+	List<bool> emitted;
+	emitted.Resize(triangleCount);
+	memset(emitted.GetItems(), 0, sizeof(bool) * triangleCount);
+
+	List<u32> deadEnd;		// Recently referenced vertices, used to pick next fanning vertex when there are no good candidates
+	List<u32> candidates;	// Vertices of triangles emitted in the last fan
+	List<u32> result;
+	deadEnd.Reserve(indexCount);
+	candidates.Reserve(64);
+	result.Reserve(indexCount);
+
+	u32 cacheSize = MESH_OPTIMIZER_CACHE_SIZE;
+	u32 time = cacheSize + 1;
+	u32 inputCursor = 0;	// Next vertex in input order to check when dead end stack is empty
+
+	auto isInCache = [&](u32 vertex) { return time - cacheTimestamps[vertex] <= cacheSize; };
+
+	auto skipDeadEnd = [&]() -> s64
+		{
+			while (deadEnd.Any())
+			{
+				u32 vertex = deadEnd.Last();
+				deadEnd.RemoveLast();
+				if (liveTriangles[vertex] > 0)
+					return vertex;
+			}
+
+			while (inputCursor < vertexCount)
+			{
+				u32 vertex = inputCursor++;
+				if (liveTriangles[vertex] > 0)
+					return vertex;
+			}
+			return -1;
+		};
+
+	s64 fanningVertex = skipDeadEnd();
+	while (fanningVertex != -1)
+	{
+		u32 vertex = static_cast<u32>(fanningVertex);
+
+		// Cache was flushed, the rest of the mesh can be drawn in any order relatively to this point
+		if (outClusters && !isInCache(vertex))
+			outClusters->Add(result.GetSize() / 3);
+
+		// Emit all triangles of fanning vertex
+		candidates.Clear();
+		for (u32 i = adjacency.Offsets[vertex]; i < adjacency.Offsets[vertex + 1]; i++)
+		{
+			u32 triangle = adjacency.Triangles[i];
+			if (emitted[triangle])
+				continue;
+
+			for (u32 k = 0; k < 3; k++)
+			{
+				u32 index = indices[triangle * 3 + k];
+				result.Add(index);
+				deadEnd.Add(index);
+				candidates.Add(index);
+				liveTriangles[index]--;
+				if (!isInCache(index))
+					cacheTimestamps[index] = time++;
+			}
+			emitted[triangle] = true;
+		}
+
+		// Pick the next fanning vertex, the one that will stay in cache longest after emitting all its triangles
+		s64 bestVertex = -1;
+		s64 bestPriority = -1;
+		for (u32 candidate : candidates)
+		{
+			if (liveTriangles[candidate] == 0)
+				continue;
+
+			// Vertex can be evicted before all its triangles are emitted, prefer it only if it's the only option
+			s64 priority = 0;
+			u32 age = time - cacheTimestamps[candidate];
+			if (age + 2 * liveTriangles[candidate] <= cacheSize)
+				priority = age;
+
+			if (priority > bestPriority)
+			{
+				bestPriority = priority;
+				bestVertex = candidate;
+			}
+		}
+
+		fanningVertex = bestVertex != -1 ? bestVertex : skipDeadEnd();
+	}
+
+	AM_ASSERT(result.GetSize() == indexCount, "MeshOptimizer::OptimizeVertexCache() -> Emitted %u indices out of %u", result.GetSize(), indexCount);
+	memcpy(indices, result.GetItems(), sizeof(u32) * indexCount);
+}
+
+void rageam::graphics::MeshOptimizer::OptimizeOverdraw(
+	u32* indices, u32 indexCount, const List<u32>& clusters,
+	const char* vertices, u32 vertexStride, u32 positionOffset, u32 vertexCount,
+	float threshold)
+{
+	AM_TRACE_FUNCTION();
+
+	u32 triangleCount = indexCount / 3;
+	if (triangleCount == 0 || !clusters.Any())
+		return;
+
+	auto getPosition = [&](u32 index)
+		{
+			return reinterpret_cast<const float*>(vertices + static_cast<size_t>(index) * vertexStride + positionOffset);
+		};
+
+	// Split hard clusters at points where ACMR of the part is not much worse than ACMR of the whole cluster
+	List<u32> timestamps;
+	timestamps.Resize(vertexCount);
+	memset(timestamps.GetItems(), 0, sizeof(u32) * vertexCount);
+	u32 cacheSize = MESH_OPTIMIZER_CACHE_SIZE;
+	u32 time = cacheSize + 1;
+	auto countMisses = [&](u32 triangle)
+		{
+			u32 misses = 0;
+			for (u32 k = 0; k < 3; k++)
+			{
+				u32 index = indices[triangle * 3 + k];
+				if (time - timestamps[index] > cacheSize)
+				{
+					timestamps[index] = time++;
+					misses++;
+				}
+			}
+			return misses;
+		};
+	auto flushCache = [&] { time += cacheSize + 1; };
+
+	List<u32> softClusters;
+	softClusters.Reserve(clusters.GetSize() * 2);
+	for (u32 i = 0; i < clusters.GetSize(); i++)
+	{
+		u32 start = clusters[i];
+		u32 end = i + 1 < clusters.GetSize() ? clusters[i + 1] : triangleCount;
+
+		flushCache();
+		u32 clusterMisses = 0;
+		for (u32 k = start; k < end; k++)
+			clusterMisses += countMisses(k);
+		float targetACMR = static_cast<float>(clusterMisses) / static_cast<float>(end - start) * threshold;
+
+		flushCache();
+		softClusters.Add(start);
+		u32 partStart = start;
+		u32 partMisses = 0;
+		for (u32 k = start; k < end; k++)
+		{
+			partMisses += countMisses(k);
+			if (k + 1 < end && static_cast<float>(partMisses) <= static_cast<float>(k + 1 - partStart) * targetACMR)
+			{
+				softClusters.Add(k + 1);
+				partStart = k + 1;
+				partMisses = 0;
+				flushCache();
+			}
+		}
+	}
+
+	// Sort clusters by how much they face outwards from the mesh center, such clusters are more likely to occlude the rest
+	float meshCentroid[3] = {};
+	float meshArea = 0.0f;
+	List<float> clusterData; // Centroid, normal, area for every cluster
+	clusterData.Resize(softClusters.GetSize() * 7);
+	for (u32 i = 0; i < softClusters.GetSize(); i++)
+	{
+		u32 start = softClusters[i];
+		u32 end = i + 1 < softClusters.GetSize() ? softClusters[i + 1] : triangleCount;
+
+		float centroid[3] = {};
+		float normal[3] = {};
+		float area = 0.0f;
+		for (u32 k = start; k < end; k++)
+		{
+			const float* p0 = getPosition(indices[k * 3 + 0]);
+			const float* p1 = getPosition(indices[k * 3 + 1]);
+			const float* p2 = getPosition(indices[k * 3 + 2]);
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float cross[3] =
+			{
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0],
+			};
+			float triangleArea = sqrtf(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+
+			// Weighted by area, length of cross product is twice the triangle area
+			for (int axis = 0; axis < 3; axis++)
+			{
+				centroid[axis] += (p0[axis] + p1[axis] + p2[axis]) * (triangleArea / 3.0f);
+				normal[axis] += cross[axis];
+			}
+			area += triangleArea;
+		}
+
+		for (int axis = 0; axis < 3; axis++)
+			meshCentroid[axis] += centroid[axis];
+		meshArea += area;
+
+		float invArea = area > 0.0f ? 1.0f / area : 0.0f;
+		float normalLength = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+		float invNormalLength = normalLength > 0.0f ? 1.0f / normalLength : 0.0f;
+		float* data = &clusterData[i * 7];
+		for (int axis = 0; axis < 3; axis++)
+		{
+			data[axis] = centroid[axis] * invArea;
+			data[3 + axis] = normal[axis] * invNormalLength;
+		}
+		data[6] = area;
+	}
+
+	float invMeshArea = meshArea > 0.0f ? 1.0f / meshArea : 0.0f;
+	for (float& axis : meshCentroid)
+		axis *= invMeshArea;
+
+	List<ClusterSortKey> sortKeys;
+	sortKeys.Resize(softClusters.GetSize());
+	for (u32 i = 0; i < softClusters.GetSize(); i++)
+	{
+		const float* data = &clusterData[i * 7];
+		float key = 0.0f;
+		for (int axis = 0; axis < 3; axis++)
+			key += (data[axis] - meshCentroid[axis]) * data[3 + axis];
+		sortKeys[i] = { i, key };
+	}
+	std::stable_sort(sortKeys.begin(), sortKeys.end(), [](const ClusterSortKey& left, const ClusterSortKey& right)
+		{
+			return left.Key > right.Key;
+		});
+
+	List<u32> result;
+	result.Reserve(indexCount);
+	for (const ClusterSortKey& sortKey : sortKeys)
+	{
+		u32 start = softClusters[sortKey.Cluster];
+		u32 end = sortKey.Cluster + 1 < softClusters.GetSize() ? softClusters[sortKey.Cluster + 1] : triangleCount;
+		for (u32 k = start * 3; k < end * 3; k++)
+			result.Add(indices[k]);
+	}
+	memcpy(indices, result.GetItems(), sizeof(u32) * indexCount);
+}
+
+u32 rageam::graphics::MeshOptimizer::OptimizeVertexFetch(char* vertices, u32 vertexStride, u32* indices, u32 indexCount, u32 vertexCount)
+{
+	AM_TRACE_FUNCTION();
+
+	static constexpr u32 UNMAPPED = u32(-1);
+
+	List<u32> remap;
+	remap.Resize(vertexCount);
+	memset(remap.GetItems(), 0xFF, sizeof(u32) * vertexCount);
+
+	u32 newVertexCount = 0;
+	for (u32 i = 0; i < indexCount; i++)
+	{
+		u32& newIndex = remap[indices[i]];
+		if (newIndex == UNMAPPED)
+			newIndex = newVertexCount++;
+		indices[i] = newIndex;
+	}
+
+	List<char> newVertices;
+	newVertices.Resize(newVertexCount * vertexStride);
+	for (u32 i = 0; i < vertexCount; i++)
+	{
+		if (remap[i] == UNMAPPED)
+			continue;
+
+		memcpy(newVertices.GetItems() + static_cast<size_t>(remap[i]) * vertexStride,
+			vertices + static_cast<size_t>(i) * vertexStride, vertexStride);
+	}
+	memcpy(vertices, newVertices.GetItems(), static_cast<size_t>(newVertexCount) * vertexStride);
+
+	return newVertexCount;
+}
+
+u32 rageam::graphics::MeshOptimizer::Optimize(
+	char* vertices, u32 vertexStride, u32 positionOffset, u32 vertexCount, u32* indices, u32 indexCount,
+	VertexCacheStats* outStatsBefore, VertexCacheStats* outStatsAfter)
+{
+	AM_TRACE_FUNCTION();
+
+	if (outStatsBefore)
+		*outStatsBefore = AnalyzeVertexCache(indices, indexCount, vertexCount);
+
+	List<u32> clusters;
+	OptimizeVertexCache(indices, indexCount, vertexCount, &clusters);
+	if (positionOffset != u32(-1))
+		OptimizeOverdraw(indices, indexCount, clusters, vertices, vertexStride, positionOffset, vertexCount);
+	vertexCount = OptimizeVertexFetch(vertices, vertexStride, indices, indexCount, vertexCount);
+
+	if (outStatsAfter)
+		*outStatsAfter = AnalyzeVertexCache(indices, indexCount, vertexCount);
+
+	return vertexCount;
+}
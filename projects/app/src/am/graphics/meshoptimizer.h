@@ -0,0 +1,54 @@
+//
+// File: meshoptimizer.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "am/types.h"
+#include "common/types.h"
+
+namespace rageam::graphics
+{
+	static constexpr u32 MESH_OPTIMIZER_CACHE_SIZE = 16;				// Size of simulated post-transform vertex cache (FIFO)
+	static constexpr float MESH_OPTIMIZER_OVERDRAW_THRESHOLD = 1.05f;	// How much ACMR may degrade when splitting clusters for overdraw sorting
+
+	struct VertexCacheStats
+	{
+		float ACMR; // Average cache miss ratio, transformed vertices per triangle. 3.0 is the worst, ~0.5 is the best possible
+		float ATVR; // Average transformed vertex ratio, transformed vertices per unique vertex. 1.0 is the best possible
+	};
+
+	/**
+	 * \brief Reorders triangles and vertices of indexed triangle list to reduce GPU vertex shading, overdraw and fetch cost.
+	 */
+	class MeshOptimizer
+	{
+	public:
+		// Simulates FIFO post-transform cache of given size
+		static VertexCacheStats AnalyzeVertexCache(const u32* indices, u32 indexCount, u32 vertexCount, u32 cacheSize = MESH_OPTIMIZER_CACHE_SIZE);
+
+		// Reorders triangles for vertex cache locality (Tipsify, Sander et al. 2007), optionally outputs first triangle of every cluster,
+		// cluster starts at point where cache has to be refilled and can be reordered without large impact on cache efficiency
+		static void OptimizeVertexCache(u32* indices, u32 indexCount, u32 vertexCount, List<u32>* outClusters = nullptr);
+
+		// Splits clusters even further while ACMR is within threshold and sorts them to draw triangles facing outwards the mesh first
+		// Position must be float3
+		static void OptimizeOverdraw(
+			u32* indices, u32 indexCount, const List<u32>& clusters,
+			const char* vertices, u32 vertexStride, u32 positionOffset, u32 vertexCount,
+			float threshold = MESH_OPTIMIZER_OVERDRAW_THRESHOLD);
+
+		// Reorders vertices in order they're referenced by indices and remaps indices, unreferenced vertices are removed
+		// Returns new vertex count
+		static u32 OptimizeVertexFetch(char* vertices, u32 vertexStride, u32* indices, u32 indexCount, u32 vertexCount);
+
+		// Runs all optimizations on the mesh, overdraw optimization is skipped if position offset is -1
+		// Returns new vertex count
+		static u32 Optimize(
+			char* vertices, u32 vertexStride, u32 positionOffset, u32 vertexCount, u32* indices, u32 indexCount,
+			VertexCacheStats* outStatsBefore = nullptr, VertexCacheStats* outStatsAfter = nullptr);
+	};
+}
@@ -0,0 +1,147 @@
+#include "meshsplitter.h"
+
+#include "am/system/asserts.h"
+#include "am/system/trace.h"
+#include "am/types.h"
+
+
+rage::atArray<rageam::graphics::MeshChunk> rageam::graphics::MeshSplitter::Split(pVoid vertices, u32 vtxStride, const u32* indices, u32 idxCount)
+{
+	AM_TRACE_FUNCTION();
+
+	AM_ASSERT(idxCount % 3 == 0, "MeshSplitter::Split() -> Non triangle mesh with %u indices", idxCount);
+
+	rage::atArray<MeshChunk> chunks;
+	u32 triangleCount = idxCount / 3;
+	if (triangleCount == 0)
+		return chunks;
+
+	u32 vertexCount = 0;
+	for (u32 i = 0; i < idxCount; i++)
+		vertexCount = MAX(vertexCount, indices[i] + 1);
+
+	// Triangles adjacent to every vertex, in compressed (offset + count) form
+	List<u32> adjacencyOffsets;
+	List<u32> adjacencyTriangles;
+	adjacencyOffsets.Resize(vertexCount + 1);
+	memset(adjacencyOffsets.GetItems(), 0, sizeof(u32) * (vertexCount + 1));
+	for (u32 i = 0; i < idxCount; i++)
+		adjacencyOffsets[indices[i] + 1]++;
+	for (u32 i = 0; i < vertexCount; i++)
+		adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+	{
+		List<u32> fill;
+		fill.Resize(vertexCount);
+		memcpy(fill.GetItems(), adjacencyOffsets.GetItems(), sizeof(u32) * vertexCount);
+		adjacencyTriangles.Resize(idxCount);
+		for (u32 i = 0; i < idxCount; i++)
+			adjacencyTriangles[fill[indices[i]]++] = i / 3;
+	}
+
+	// Vertex belongs to current chunk if its stamp matches chunk generation, so remap never has to be cleared
+	List<u32> vertexGeneration;
+	List<u16> vertexRemap;
+	vertexGeneration.Resize(vertexCount);
+	vertexRemap.Resize(vertexCount);
+	memset(vertexGeneration.GetItems(), 0, sizeof(u32) * vertexCount);
+
+	List<bool> emitted;
+	emitted.Resize(triangleCount);
+	memset(emitted.GetItems(), 0, sizeof(bool) * triangleCount);
+
+	List<u32> chunkSourceVertices;	// Old vertex index for every chunk vertex
+	List<u16> chunkIndices;
+	List<u32> triangleQueue;		// Triangles adjacent to chunk vertices, in order they were reached
+	chunkSourceVertices.Reserve(MAX_CHUNK_VERTICES);
+
+	u32 generation = 0;
+	u32 emittedCount = 0;
+	u32 seedTriangle = 0; // Next triangle in index order to start growing from when region is closed
+
+	auto tryAddTriangle = [&](u32 triangle)
+		{
+			const u32* triangleIndices = indices + static_cast<size_t>(triangle) * 3;
+
+			u32 newVertexCount = 0;
+			for (u32 k = 0; k < 3; k++)
+			{
+				if (vertexGeneration[triangleIndices[k]] != generation)
+					newVertexCount++;
+			}
+			if (chunkSourceVertices.GetSize() + newVertexCount > MAX_CHUNK_VERTICES)
+				return false;
+
+			for (u32 k = 0; k < 3; k++)
+			{
+				u32 vertex = triangleIndices[k];
+				if (vertexGeneration[vertex] != generation)
+				{
+					vertexGeneration[vertex] = generation;
+					vertexRemap[vertex] = static_cast<u16>(chunkSourceVertices.GetSize());
+					chunkSourceVertices.Add(vertex);
+
+					// Grow region through triangles of the new vertex
+					for (u32 i = adjacencyOffsets[vertex]; i < adjacencyOffsets[vertex + 1]; i++)
+					{
+						u32 adjacentTriangle = adjacencyTriangles[i];
+						if (!emitted[adjacentTriangle])
+							triangleQueue.Add(adjacentTriangle);
+					}
+				}
+				chunkIndices.Add(vertexRemap[vertex]);
+			}
+
+			emitted[triangle] = true;
+			emittedCount++;
+			return true;
+		};
+
+	while (emittedCount < triangleCount)
+	{
+		generation++;
+		chunkSourceVertices.Clear();
+		chunkIndices.Clear();
+		triangleQueue.Clear();
+
+		u32 queueHead = 0;
+		while (true)
+		{
+			// Add triangles adjacent to the chunk while there's space, ones that didn't fit will go in the next chunks
+			while (queueHead < triangleQueue.GetSize())
+			{
+				u32 triangle = triangleQueue[queueHead++];
+				if (!emitted[triangle])
+					tryAddTriangle(triangle);
+			}
+
+			// Region is closed, continue from the next triangle that wasn't added yet
+			while (seedTriangle < triangleCount && emitted[seedTriangle])
+				seedTriangle++;
+
+			if (seedTriangle == triangleCount || !tryAddTriangle(seedTriangle))
+				break;
+		}
+
+		u32 chunkVertexCount = chunkSourceVertices.GetSize();
+		u32 chunkIndexCount = chunkIndices.GetSize();
+
+		char* chunkVertices = new char[static_cast<size_t>(chunkVertexCount) * vtxStride];
+		for (u32 i = 0; i < chunkVertexCount; i++)
+		{
+			char* src = static_cast<char*>(vertices) + static_cast<size_t>(chunkSourceVertices[i]) * vtxStride;
+			char* dst = chunkVertices + static_cast<size_t>(i) * vtxStride;
+			memcpy(dst, src, vtxStride);
+		}
+
+		u16* chunkIndexBuffer = new u16[chunkIndexCount];
+		memcpy(chunkIndexBuffer, chunkIndices.GetItems(), sizeof(u16) * chunkIndexCount);
+
+		MeshChunk chunk{
+			amUniquePtr<char>(chunkVertices),
+			amUniquePtr<u16>(chunkIndexBuffer),
+			chunkVertexCount, chunkIndexCount };
+		chunks.Emplace(std::move(chunk));
+	}
+
+	return chunks;
+}
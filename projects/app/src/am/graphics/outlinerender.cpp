@@ -9,6 +9,8 @@
 #include "rage/grm/model.h"
 #include "rage/grm/shadergroup.h"
 
+#include <easy/profiler.h>
+
 void rageam::graphics::OutlineRender::CreateDeviceObjects()
 {
 	AM_DEBUGF("OutlineRender::CreateDeviceObjects() -> For %ux%u", m_Width, m_Height);
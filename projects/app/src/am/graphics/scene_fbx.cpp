@@ -1,7 +1,10 @@
 #include "scene_fbx.h"
 
 #include "am/system/enum.h"
-#include "helpers/bitarray.h"
+#include "am/system/trace.h"
+#include "am/system/worker.h"
+
+#include <algorithm>
 
 void rageam::graphics::SceneMaterialFbx::ScanTextures()
 {
@@ -41,34 +44,49 @@ ConstString rageam::graphics::SceneMaterialFbx::GetTextureName(eMaterialTexture
 	}
 }
 
-u32 rageam::graphics::SceneGeometryFbx::ComputeVertexCount() const
+namespace
 {
-	// We don't know total vertex count yet but it will be less or equal to index count
-	u32 indexCount = m_UMesh->num_triangles * 3;
-	BitArray processedVerts;
-	processedVerts.Allocate(indexCount);
-
-	u32 totalNumVerts = 0;
-	for (u32& faceIndex : m_UMeshMat->face_indices)
+	/**
+	 * \brief Scratch buffers for building geometry attributes, shared by all geometries built on the same thread.
+	 * Mesh vertex is mapped in current geometry if its stamp matches current generation,
+	 * so the table is sized to the largest mesh once and never has to be cleared between geometries.
+	 */
+	struct SceneFbxBuildScratch
 	{
-		ufbx_face& face = m_UMesh->faces[faceIndex];
-		for (u32 i = 0; i < face.num_indices; i++)
+		List<u32> VertexGeneration;	// Per mesh vertex
+		List<u32> VertexToLocal;	// Per mesh vertex, index in geometry attribute buffers
+		List<u32> LocalToIndex;		// Per geometry vertex, index of vertex index in ufbx_mesh::vertex_indices
+		List<u32> TriIndices;		// Long enough to fit any triangulated face of the mesh
+		u32		  Generation = 0;
+
+		void BeginGeometry(u32 meshVertexCount)
 		{
-			// Faces share same vertices with other faces, we need only unique vertices
-			// For example a quad will have 4 vertices and two triangles, those two
-			// triangles with share 2 vertices, giving us total 6 indices
-			u32 vertIndex = m_UMesh->vertex_indices[face.index_begin + i];
-			if (processedVerts.IsSet(vertIndex))
-				continue;
-			processedVerts.Set(vertIndex);
-			totalNumVerts++;
+			u32 oldSize = VertexGeneration.GetSize();
+			if (oldSize < meshVertexCount)
+			{
+				VertexGeneration.Resize(meshVertexCount);
+				VertexToLocal.Resize(meshVertexCount);
+				memset(VertexGeneration.GetItems() + oldSize, 0, sizeof(u32) * (meshVertexCount - oldSize));
+			}
+
+			// Wrapped around, stamps from previous geometries may match again
+			if (++Generation == 0)
+			{
+				memset(VertexGeneration.GetItems(), 0, sizeof(u32) * VertexGeneration.GetSize());
+				Generation = 1;
+			}
+
+			LocalToIndex.Clear();
 		}
-	}
-	return totalNumVerts;
+	};
+
+	thread_local SceneFbxBuildScratch tl_BuildScratch;
 }
 
 void rageam::graphics::SceneGeometryFbx::TriangulateAndBuildAttributes()
 {
+	AM_ASSERT(!m_AttributesBuilt, "SceneGeometryFbx::TriangulateAndBuildAttributes() -> Attributes were already built.");
+
 	ufbx_skin_deformer* skin = nullptr;
 	if (m_UMesh->skin_deformers.count > 0) // Has skinning
 	{
@@ -84,21 +102,51 @@ void rageam::graphics::SceneGeometryFbx::TriangulateAndBuildAttributes()
 		}
 	}
 
-	m_PositionBound = { rage::S_MAX, rage::S_MIN };
+	SceneFbxBuildScratch& scratch = tl_BuildScratch;
+	scratch.BeginGeometry(static_cast<u32>(m_UMesh->num_vertices));
+
+	if (m_UseShortIndices)	m_Indices16 = amUniquePtr<u16[]>(new u16[m_IndexCount]);
+	else					m_Indices32 = amUniquePtr<u32[]>(new u32[m_IndexCount]);
+
+	// Maximum number of triangles in a mesh face, for quad plane mesh with 1 face and 4 vertices it will be 2
+	u32 maxFaceTris = static_cast<u32>(m_UMesh->max_face_triangles);
+	// Long enough to fit any triangulated face, for 2 triangles we need 2 * 3 = 6 indices
+	u32 maxFaceTriIndices = maxFaceTris * 3;
+	scratch.TriIndices.Resize(maxFaceTriIndices);
+
+	// Triangulate every face in mesh and assign local index to every unique vertex,
+	// vertex count is not known until all faces are processed so attributes are copied after
+	u32 currentIndex = 0;
+	for (u32& faceIndex : m_UMeshMat->face_indices)
+	{
+		ufbx_face& face = m_UMesh->faces[faceIndex];
 
-	// In this geometry
-	u32 localNumTris = m_UMeshMat->num_triangles;
-	u32 localNumIndices = localNumTris * 3;
-	u32 localNumVerts = ComputeVertexCount();
+		u32 numTris = ufbx_triangulate_face(scratch.TriIndices.GetItems(), maxFaceTriIndices, m_UMesh, face);
+		u32 numVerts = numTris * 3;
 
-	// In whole mesh
-	u32 totalNumVerts = m_UMesh->num_vertices;
+		for (u32 i = 0; i < numVerts; i++)
+		{
+			u32 vertIndex = scratch.TriIndices[i];			// Index of vertex index in m_UMesh->vertex_indices! A bit confusing
+			u32 vert = m_UMesh->vertex_indices[vertIndex]; // Actual vertex index
+
+			// Faces share same vertices with other faces, we add only unique vertices to buffer, indices are added regardless
+			if (scratch.VertexGeneration[vert] != scratch.Generation)
+			{
+				scratch.VertexGeneration[vert] = scratch.Generation;
+				scratch.VertexToLocal[vert] = scratch.LocalToIndex.GetSize();
+				scratch.LocalToIndex.Add(vertIndex);
+			}
+
+			u32 localVert = scratch.VertexToLocal[vert];
+			if (m_UseShortIndices)	m_Indices16[currentIndex] = static_cast<u16>(localVert);
+			else					m_Indices32[currentIndex] = localVert;
+			currentIndex++;
+		}
+	}
 
-	m_IndexCount = localNumIndices;
+	u32 localNumVerts = scratch.LocalToIndex.GetSize();
 	m_VertexCount = localNumVerts;
-	m_UseShortIndices = localNumIndices < UINT16_MAX;
-	if (m_UseShortIndices)	m_Indices16 = amUniquePtr<u16[]>(new u16[localNumIndices]);
-	else					m_Indices32 = amUniquePtr<u32[]>(new u32[localNumIndices]);
+	m_PositionBound = { rage::S_MAX, rage::S_MIN };
 
 	// Allocate buffers for every geometry vertex attribute
 	if (m_UMesh->vertex_position.exists) m_Positions = amUniquePtr<rage::Vector3[]>(new rage::Vector3[localNumVerts]);
@@ -127,116 +175,71 @@ void rageam::graphics::SceneGeometryFbx::TriangulateAndBuildAttributes()
 		m_BlendWeights = amUniquePtr<rage::Vector4[]>(new rage::Vector4[localNumVerts]);
 	}
 
-	// Mesh vertex index to index in m_Positions or any other attribute
-	auto vertexToLocal = amUniquePtr<u32[]>(new u32[totalNumVerts]{}); // TODO: Can we share it between geometries during building?
-	for (u32 i = 0; i < totalNumVerts; i++)
-		vertexToLocal[i] = u32(-1);
-
-	// Maximum number of triangles in a mesh face, for quad plane mesh with 1 face and 4 vertices it will be 2
-	size_t maxFaceTris = m_UMesh->max_face_triangles;
-	// Long enough to fit any triangulated face, for 2 triangles we need 2 * 3 = 6 indices
-	size_t maxFaceTriIndices = maxFaceTris * 3;
-	auto triIndices = amUniquePtr<u32[]>(new u32[maxFaceTriIndices]);
-
-	// Triangulate every face in mesh
-	u32 currentVertex = 0;
-	u32 currentIndex = 0;
-	for (u32& faceIndex : m_UMeshMat->face_indices)
+	// Copy vertex attributes
+	for (u32 localVert = 0; localVert < localNumVerts; localVert++)
 	{
-		ufbx_face& face = m_UMesh->faces[faceIndex];
-
-		u32 numTris = ufbx_triangulate_face(triIndices.get(), maxFaceTriIndices, m_UMesh, face);
-		u32 numVerts = numTris * 3;
+		u32 vertIndex = scratch.LocalToIndex[localVert];
+		u32 vert = m_UMesh->vertex_indices[vertIndex];
 
-		// Fill the attribute data from the vertex
-		for (u32 i = 0; i < numVerts; i++)
+		// Position
+		if (m_UMesh->vertex_position.exists)
 		{
-			u32 vertIndex = triIndices[i];					// Index of vertex index in m_UMesh->vertex_indices! A bit confusing
-			u32 vert = m_UMesh->vertex_indices[vertIndex]; // Actual vertex index
-			u32 localVert;
-
-			bool isNewVertex = vertexToLocal[vert] == u32(-1);
-			if (isNewVertex)
-			{
-				vertexToLocal[vert] = currentVertex;
-				localVert = currentVertex;
-			}
-			else
-			{
-				// Retrieve unique local vertex index
-				localVert = vertexToLocal[vert];
-			}
-
-			if (m_UseShortIndices)	m_Indices16[currentIndex] = static_cast<u16>(localVert);
-			else					m_Indices32[currentIndex] = localVert;
-			currentIndex++;
-
-			// We add only unique vertices to buffer, indices are added regardless
-			if (!isNewVertex)
-				continue;
-
-			// Copy vertex attributes
+			rage::Vec3V pos = UVecToV(ufbx_get_vertex_vec3(&m_UMesh->vertex_position, vertIndex));
+			m_PositionBound = m_PositionBound.AddPoint(pos); // Extend bounding box to new position
+			m_Positions[localVert] = pos;
+		}
 
-			// Position
-			if (m_UMesh->vertex_position.exists)
-			{
-				rage::Vec3V pos = UVecToV(ufbx_get_vertex_vec3(&m_UMesh->vertex_position, vertIndex));
-				m_PositionBound = m_PositionBound.AddPoint(pos); // Extend bounding box to new position
-				m_Positions[currentVertex] = pos;
-			}
+		// Normals
+		if (m_UMesh->vertex_normal.exists)
+		{
+			m_Normals[localVert] = UVecToS(ufbx_get_vertex_vec3(&m_UMesh->vertex_normal, vertIndex));
+		}
 
-			// Normals
-			if (m_UMesh->vertex_normal.exists)
+		// UV / Tangents
+		for (ufbx_uv_set& uvSet : m_UMesh->uv_sets)
+		{
+			if (uvSet.index < rage::TEXCOORD_MAX)
 			{
-				m_Normals[currentVertex] = UVecToS(ufbx_get_vertex_vec3(&m_UMesh->vertex_normal, vertIndex));
+				if (uvSet.vertex_uv.exists) m_Texcoords[uvSet.index][localVert] = UVecToS(ufbx_get_vertex_vec2(&uvSet.vertex_uv, vertIndex));
 			}
 
-			// UV / Tangents
-			for (ufbx_uv_set& uvSet : m_UMesh->uv_sets)
+			if (uvSet.index < rage::TANGENT_MAX)
 			{
-				if (uvSet.index < rage::TEXCOORD_MAX)
-				{
-					if (uvSet.vertex_uv.exists) m_Texcoords[uvSet.index][currentVertex] = UVecToS(ufbx_get_vertex_vec2(&uvSet.vertex_uv, vertIndex));
-				}
-
-				if (uvSet.index < rage::TANGENT_MAX)
+				if (uvSet.vertex_tangent.exists)
 				{
-					if (uvSet.vertex_tangent.exists)
-					{
-						rage::Vector3 tangent = UVecToS(ufbx_get_vertex_vec3(&uvSet.vertex_tangent, vertIndex));
-						m_Tangents[uvSet.index][currentVertex] = rage::Vector4(tangent.X, tangent.Y, tangent.Z, 1.0f);
-					}
+					rage::Vector3 tangent = UVecToS(ufbx_get_vertex_vec3(&uvSet.vertex_tangent, vertIndex));
+					m_Tangents[uvSet.index][localVert] = rage::Vector4(tangent.X, tangent.Y, tangent.Z, 1.0f);
 				}
 			}
+		}
 
-			// Colors
-			for (ufbx_color_set& colorSet : m_UMesh->color_sets)
-			{
-				if (colorSet.index < rage::COLOR_MAX)
-					m_Colors[colorSet.index][currentVertex] = UVecToS(ufbx_get_vertex_vec4(&colorSet.vertex_color, vertIndex));
-			}
+		// Colors
+		for (ufbx_color_set& colorSet : m_UMesh->color_sets)
+		{
+			if (colorSet.index < rage::COLOR_MAX)
+				m_Colors[colorSet.index][localVert] = UVecToS(ufbx_get_vertex_vec4(&colorSet.vertex_color, vertIndex));
+		}
 
-			// Skinning
-			if (skin)
-			{
-				ufbx_skin_vertex& skinVertex = skin->vertices[vert];
+		// Skinning
+		if (skin)
+		{
+			ufbx_skin_vertex& skinVertex = skin->vertices[vert];
 
-				u32 blendIndices = 0;
-				rage::Vector4 blendWeights(0.0f);
-				for (int k = 0; k < static_cast<int>(skinVertex.num_weights); k++)
-				{
-					u32 skinWeightIndex = skinVertex.weight_begin + k;
-					ufbx_skin_weight& skinWeight = skin->weights[skinWeightIndex];
-					blendWeights[k] = skinWeight.weight;
-					blendIndices |= skinWeight.cluster_index << (k * 8);
-				}
-				m_BlendIndices[currentVertex] = blendIndices;
-				m_BlendWeights[currentVertex] = blendWeights;
+			u32 blendIndices = 0;
+			rage::Vector4 blendWeights(0.0f);
+			for (int k = 0; k < static_cast<int>(skinVertex.num_weights); k++)
+			{
+				u32 skinWeightIndex = skinVertex.weight_begin + k;
+				ufbx_skin_weight& skinWeight = skin->weights[skinWeightIndex];
+				blendWeights[k] = skinWeight.weight;
+				blendIndices |= skinWeight.cluster_index << (k * 8);
 			}
-
-			currentVertex++;
+			m_BlendIndices[localVert] = blendIndices;
+			m_BlendWeights[localVert] = blendWeights;
 		}
 	}
+
+	m_AttributesBuilt = true;
 }
 
 rageam::graphics::SceneGeometryFbx::SceneGeometryFbx(
@@ -252,7 +255,11 @@ rageam::graphics::SceneGeometryFbx::SceneGeometryFbx(
 	else
 		m_MaterialIndex = parent->GetScene()->GetMaterialDefault()->GetIndex();
 
-	TriangulateAndBuildAttributes();
+	// Index count is known from material, vertex count requires triangulation
+	m_IndexCount = static_cast<u32>(m_UMeshMat->num_triangles) * 3;
+	m_VertexCount = 0;
+	m_UseShortIndices = m_IndexCount < UINT16_MAX;
+	m_PositionBound = { rage::S_MAX, rage::S_MIN };
 }
 
 void rageam::graphics::SceneGeometryFbx::GetIndices(SceneData& data) const
@@ -415,6 +422,7 @@ rageam::graphics::SceneNodeFbx* rageam::graphics::SceneFbx::AddNodesRecurse(ufbx
 		u16 nodeIndex = m_Nodes.GetSize();
 		SceneNodeFbx* node = new SceneNodeFbx(this, parent, nodeIndex, uChildNode);
 		m_Nodes.Construct(node);
+		m_UNodeToNode.InsertAt(uChildNode->element_id, node);
 
 		node->m_FirstChild = AddNodesRecurse(uChildNode, node);
 		// Set next sibling as current node to previous node
@@ -427,7 +435,37 @@ rageam::graphics::SceneNodeFbx* rageam::graphics::SceneFbx::AddNodesRecurse(ufbx
 	return firstNode;
 }
 
-bool rageam::graphics::SceneFbx::ConstructScene()
+void rageam::graphics::SceneFbx::BuildGeometries() const
+{
+	AM_TRACE_FUNCTION();
+
+	List<SceneGeometryFbx*> geometries;
+	for (const amUniquePtr<SceneNodeFbx>& node : m_Nodes)
+	{
+		if (!node->m_Mesh)
+			continue;
+
+		for (amUniquePtr<SceneGeometryFbx>& geometry : node->m_Mesh->m_Geometries)
+			geometries.Add(geometry.get());
+	}
+
+	if (!geometries.Any())
+		return;
+
+	// Heaviest geometries first so they don't end up last on single worker, indices are taken in order
+	std::sort(geometries.begin(), geometries.end(), [](const SceneGeometryFbx* lhs, const SceneGeometryFbx* rhs)
+		{
+			return lhs->GetTriangleCount() > rhs->GetTriangleCount();
+		});
+
+	// Calling thread builds geometries too, so loading from worker thread can't get stuck if the rest of workers are busy
+	BackgroundWorker::ParallelFor(geometries.GetSize(), [&geometries](u32 index)
+		{
+			geometries[index]->TriangulateAndBuildAttributes();
+		});
+}
+
+bool rageam::graphics::SceneFbx::ConstructScene(const SceneLoadOptions& loadOptions)
 {
 	for (size_t i = 0; i < m_UScene->materials.count; i++)
 	{
@@ -454,8 +492,13 @@ bool rageam::graphics::SceneFbx::ConstructScene()
 	}
 outsideLoop:
 
+	m_UNodeToNode.Reserve(static_cast<u32>(m_UScene->nodes.count));
 	m_FirstNode = AddNodesRecurse(m_UScene->root_node, nullptr);
 
+	// Metadata-only load, nothing is triangulated
+	if (!loadOptions.SkipMeshData)
+		BuildGeometries();
+
 	return true;
 }
 
@@ -488,7 +531,7 @@ bool rageam::graphics::SceneFbx::Load(ConstWString path, SceneLoadOptions& loadO
 		return false;
 	}
 
-	if (!ConstructScene())
+	if (!ConstructScene(loadOptions))
 	{
 		AM_TRACEF("SceneFbx::Load() -> Failed to construct scene.");
 		return false;
@@ -508,11 +551,8 @@ ConstString rageam::graphics::SceneFbx::GetTypeName()
 
 rageam::graphics::SceneNodeFbx* rageam::graphics::SceneFbx::GetNodeFromUNode(const ufbx_node* uNode) const
 {
-	// Simply do linear search, although we can use map...
-	for (amUniquePtr<SceneNodeFbx>& node : m_Nodes)
-	{
-		if (node->m_UNode == uNode)
-			return node.get();
-	}
+	SceneNodeFbx** node = m_UNodeToNode.TryGetAt(uNode->element_id);
+	if (node)
+		return *node;
 	AM_UNREACHABLE("SceneFbx::GetNodeFromUNode() -> Given node does not belong to this scene.");
 }
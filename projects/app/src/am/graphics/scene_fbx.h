@@ -77,14 +77,19 @@ namespace rageam::graphics
 		u16								m_MaterialIndex;
 		bool							m_UseShortIndices;
 		rage::spdAABB					m_PositionBound;
-
-		// Computes num vertices used by material
-		u32 ComputeVertexCount() const;
-		void TriangulateAndBuildAttributes();
+		bool							m_AttributesBuilt = false;
 
 	public:
+		// Attributes are not built until TriangulateAndBuildAttributes is called
 		SceneGeometryFbx(SceneMesh* parent, u16 index, u16 materialIndex, ufbx_mesh* uMesh, ufbx_mesh_material* uMeshMat);
 
+		// Thread-safe as long as every geometry is built only once, called by SceneFbx from worker threads
+		void TriangulateAndBuildAttributes();
+		bool AreAttributesBuilt() const { return m_AttributesBuilt; }
+
+		// Number of triangles in this geometry, known without building attributes
+		u32 GetTriangleCount() const { return static_cast<u32>(m_UMeshMat->num_triangles); }
+
 		u16 GetMaterialIndex() const override { return m_MaterialIndex; }
 		u32 GetVertexCount() const override { return m_VertexCount; }
 		u32 GetIndexCount() const override { return m_IndexCount; }
@@ -97,6 +102,8 @@ namespace rageam::graphics
 
 	class SceneMeshFbx : public SceneMesh
 	{
+		friend class SceneFbx;
+
 		List<amUniquePtr<SceneGeometryFbx>> m_Geometries;
 		ufbx_mesh* m_UMesh;
 
@@ -180,9 +187,12 @@ namespace rageam::graphics
 		List<amUniquePtr<SceneMaterial>> m_Materials;
 		List<amUniquePtr<SceneNodeFbx>> m_Nodes;
 		SceneNodeFbx* m_FirstNode = nullptr;
+		FlatSet<SceneNodeFbx*> m_UNodeToNode; // Key is ufbx_node::element_id
 
 		SceneNodeFbx* AddNodesRecurse(ufbx_node* uNode, SceneNodeFbx* parent);
-		bool ConstructScene();
+		// Triangulates geometries of all meshes in parallel on background worker
+		void BuildGeometries() const;
+		bool ConstructScene(const SceneLoadOptions& loadOptions);
 
 	public:
 		SceneFbx() = default;
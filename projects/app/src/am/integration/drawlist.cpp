@@ -10,6 +10,7 @@
 #include "am/graphics/render.h"
 
 #include <d3dcompiler.h>
+#include <easy/profiler.h>
 
 bool rageam::integration::DrawList::VerifyBufferFitLine() const
 {
@@ -607,6 +607,16 @@ void rageam::integration::ModelInspector::DrawMaterialGroup()
 
 void rageam::integration::ModelInspector::OnRender()
 {
+	if (m_LoadRequest)
+	{
+		if (!m_LoadRequest->IsFinished())
+		{
+			ImGui::Text("Loading...");
+			return;
+		}
+		FinishLoading();
+	}
+
 	// In case if drawable failed to load...
 	if (!m_Drawable)
 		return;
@@ -665,29 +675,32 @@ void rageam::integration::ModelInspector::OnRender()
 	}
 }
 
-void rageam::integration::ModelInspector::LoadFromPath(ConstWString path)
+rageam::integration::ModelInspector::~ModelInspector()
 {
-	AM_ASSERTS(file::MatchExtension(path, L"ydr"));
+	// Loading thread must not write to request after we're gone, resource is not placed and can't be freed
+	if (m_LoadRequest)
+		m_LoadRequest->Wait();
+}
 
+void rageam::integration::ModelInspector::FinishLoading()
+{
 	static constexpr ConstString ASSET_NAME = "amInspectorArchetype";
 	static constexpr u32 ASSET_NAME_HASH = rage::atStringHash(ASSET_NAME);
 
-	if (!file::IsFileExists(path))
+	rage::pgRscLoadRequestPtr request = std::move(m_LoadRequest);
+	if (!request->Root)
 	{
-		AM_ERRF(L"ModelInspector::LoadFromPath() -> File doesn't exists! '%ls'", path);
+		AM_ERRF("ModelInspector::FinishLoading() -> Failed to load '%s'", m_LoadPath.GetCStr());
 		return;
 	}
 
-	file::Path pathA = file::PathConverter::WideToUtf8(path);
+	rage::datResourceMap& map = request->Map;
+	rage::datResourceInfo& info = request->Info;
 
 	// We're using game place function, we must also use game allocator to not blow up things
 	rage::sysMemUseGameAllocators(true);
 
-	rage::datResourceMap map;
-	rage::datResourceInfo info;
-	rage::pgBase* root = rage::pgRscBuilder::LoadBuild(pathA, 165, map, info);
-
-	m_Drawable = gtaDrawablePtr((gtaDrawable*) root);
+	m_Drawable = gtaDrawablePtr((gtaDrawable*) request->Root);
 
 	// Place drawable using native game function
 	static auto placeFn = gmAddress::Scan(
@@ -701,7 +714,7 @@ void rageam::integration::ModelInspector::LoadFromPath(ConstWString path)
 	// Minimize resource building scope, we use game loader functions for now,
 	// although we may want to add switch to verify that our loading code is working properly
 	{
-		rage::datResource rsc(map, pathA);
+		rage::datResource rsc(map, m_LoadPath);
 
 		static auto datResourceCtor = gmAddress::Scan(
 #if APP_BUILD_2699_16_RELEASE_NO_OPT
@@ -722,7 +735,7 @@ void rageam::integration::ModelInspector::LoadFromPath(ConstWString path)
 #endif
 			.ToFunc<void(rage::datResource*)>();
 
-		datResourceCtor(&rsc, &map, pathA, false);
+		datResourceCtor(&rsc, &map, m_LoadPath, false);
 		placeFn(m_Drawable.Get(), &rsc);
 		datResourceDctor(&rsc);
 	}
@@ -730,7 +743,6 @@ void rageam::integration::ModelInspector::LoadFromPath(ConstWString path)
 	// End of the scope...
 	rage::sysMemUseGameAllocators(false);
 
-	m_FileSize = file::GetFileSize(path);
 	m_VirtualSize = info.ComputeVirtualSize();
 	m_PhysicalSize = info.ComputePhysicalSize();
 	m_ResourceSize = m_VirtualSize + m_PhysicalSize;
@@ -748,4 +760,28 @@ void rageam::integration::ModelInspector::LoadFromPath(ConstWString path)
 	GetEntity()->SetEntityWasAllocatedByGame(true); // Ensure that drawable will be destroyed with game allocator in TLS
 }
 
+void rageam::integration::ModelInspector::LoadFromPath(ConstWString path)
+{
+	AM_ASSERTS(file::MatchExtension(path, L"ydr"));
+
+	if (!file::IsFileExists(path))
+	{
+		AM_ERRF(L"ModelInspector::LoadFromPath() -> File doesn't exists! '%ls'", path);
+		return;
+	}
+
+	// Previous request must be placed before we can start a new one
+	if (m_LoadRequest)
+	{
+		m_LoadRequest->Wait();
+		FinishLoading();
+	}
+
+	m_LoadPath = file::PathConverter::WideToUtf8(path);
+	m_FileSize = file::GetFileSize(path);
+
+	// We're using game place function, chunks must be allocated by game allocator too
+	m_LoadRequest = rage::pgRscBuilder::LoadBuildAsync(m_LoadPath, 165, nullptr, true);
+}
+
 #endif
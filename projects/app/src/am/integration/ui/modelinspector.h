@@ -14,17 +14,19 @@
 #include "game/modelinfo/basemodelinfo.h"
 #include "am/ui/font_icons/icons_am.h"
 #include "sceneingame.h"
+#include "am/file/path.h"
+#include "rage/paging/builder/builder.h"
 
 #include <ImGui.h>
 
-// TODO: Async model loading
-
 namespace rageam::integration
 {
 	class ModelInspector : public SceneInGame
 	{
 		amPtr<CBaseArchetypeDef> m_ArchetypeDef;
 		gtaDrawablePtr           m_Drawable;
+		rage::pgRscLoadRequestPtr m_LoadRequest; // Resource that is being read on background thread
+		file::Path               m_LoadPath;
 		u32                      m_FileSize = 0;
 		u32                      m_VirtualSize = 0;
 		u32                      m_PhysicalSize = 0;
@@ -57,10 +59,13 @@ namespace rageam::integration
 		void DrawLodGroup();
 		void DrawShaderParams(const rage::grmShader* shader, rage::grcEffect* effect);
 		void DrawMaterialGroup();
+		// Places resource once background loading is done and creates entity, must be called from main thread
+		void FinishLoading();
 		void OnRender() override;
 		
 	public:
 		ModelInspector() = default;
+		~ModelInspector() override;
 
 		ConstString GetName() const override { return "Inspector"; }
 		ConstString GetModelName() const override { return m_Drawable ? m_Drawable->GetName() : nullptr; }
@@ -0,0 +1,268 @@
+#include "datahash.h"
+
+#include "am/system/trace.h"
+#include "am/system/worker.h"
+
+#include <immintrin.h>
+#include <intrin.h>
+#include <cstring>
+
+namespace
+{
+	constexpr u64 PRIME32_1 = 0x9E3779B1u;
+	constexpr u64 PRIME32_2 = 0x85EBCA77u;
+	constexpr u64 PRIME32_3 = 0xC2B2AE3Du;
+	constexpr u64 PRIME64_1 = 0x9E3779B185EBCA87ull;
+	constexpr u64 PRIME64_2 = 0xC2B2AE3D27D4EB4Full;
+	constexpr u64 PRIME64_3 = 0x165667B19E3779F9ull;
+	constexpr u64 PRIME64_4 = 0x85EBCA77C2B2AE63ull;
+	constexpr u64 PRIME64_5 = 0x27D4EB2F165667C5ull;
+
+	constexpr u32 PARALLEL_CHUNK_SIZE = 1024u * 1024u; // 1MB
+
+	// Key material that is mixed with the input, generated with splitmix64 instead of storing table of random bytes
+	struct Secret
+	{
+		alignas(64) u8 Bytes[rageam::DataHasher::SECRET_SIZE];
+
+		constexpr Secret() : Bytes()
+		{
+			u64 state = PRIME64_1;
+			for (u32 i = 0; i < rageam::DataHasher::SECRET_SIZE; i += 8)
+			{
+				state += 0x9E3779B97F4A7C15ull;
+				u64 z = state;
+				z = (z ^ z >> 30) * 0xBF58476D1CE4E5B9ull;
+				z = (z ^ z >> 27) * 0x94D049BB133111EBull;
+				z ^= z >> 31;
+				for (u32 k = 0; k < 8; k++)
+					Bytes[i + k] = static_cast<u8>(z >> k * 8);
+			}
+		}
+	};
+	constexpr Secret SECRET;
+
+	u64 Read64(const u8* data)
+	{
+		u64 value;
+		memcpy(&value, data, sizeof(u64));
+		return value;
+	}
+
+	u64 Mul128Fold64(u64 lhs, u64 rhs)
+	{
+		u64 high;
+		u64 low = _umul128(lhs, rhs, &high);
+		return low ^ high;
+	}
+
+	u64 Avalanche(u64 hash)
+	{
+		hash ^= hash >> 37;
+		hash *= 0x165667919E3779F9ull;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	// Every lane gets product of low and high halves of (data ^ secret), data itself is added to the neighbour lane
+	// so input is not lost when key happens to cancel it out
+	void AccumulateStripe(u64* acc, const u8* data, const u8* secret)
+	{
+#ifdef __AVX2__
+		for (u32 i = 0; i < 2; i++)
+		{
+			__m256i* pAcc = reinterpret_cast<__m256i*>(acc) + i;
+			__m256i dataVec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data) + i);
+			__m256i keyVec = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i);
+			__m256i dataKey = _mm256_xor_si256(dataVec, keyVec);
+			__m256i dataKeyHi = _mm256_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+			__m256i product = _mm256_mul_epu32(dataKey, dataKeyHi);
+			__m256i dataSwap = _mm256_shuffle_epi32(dataVec, _MM_SHUFFLE(1, 0, 3, 2));
+			__m256i sum = _mm256_add_epi64(_mm256_load_si256(pAcc), dataSwap);
+			_mm256_store_si256(pAcc, _mm256_add_epi64(sum, product));
+		}
+#else
+		for (u32 i = 0; i < 4; i++)
+		{
+			__m128i* pAcc = reinterpret_cast<__m128i*>(acc) + i;
+			__m128i dataVec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data) + i);
+			__m128i keyVec = _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i);
+			__m128i dataKey = _mm_xor_si128(dataVec, keyVec);
+			__m128i dataKeyHi = _mm_shuffle_epi32(dataKey, _MM_SHUFFLE(0, 3, 0, 1));
+			__m128i product = _mm_mul_epu32(dataKey, dataKeyHi);
+			__m128i dataSwap = _mm_shuffle_epi32(dataVec, _MM_SHUFFLE(1, 0, 3, 2));
+			__m128i sum = _mm_add_epi64(_mm_load_si128(pAcc), dataSwap);
+			_mm_store_si128(pAcc, _mm_add_epi64(sum, product));
+		}
+#endif
+	}
+
+	// acc = (acc ^ (acc >> 47) ^ secret) * PRIME32_1, 64 bit multiply is done as two 32x32 multiplies
+	void ScrambleAcc(u64* acc, const u8* secret)
+	{
+#ifdef __AVX2__
+		const __m256i prime = _mm256_set1_epi32(static_cast<int>(PRIME32_1));
+		for (u32 i = 0; i < 2; i++)
+		{
+			__m256i* pAcc = reinterpret_cast<__m256i*>(acc) + i;
+			__m256i accVec = _mm256_load_si256(pAcc);
+			accVec = _mm256_xor_si256(accVec, _mm256_srli_epi64(accVec, 47));
+			accVec = _mm256_xor_si256(accVec, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+			__m256i accHi = _mm256_shuffle_epi32(accVec, _MM_SHUFFLE(0, 3, 0, 1));
+			__m256i productLo = _mm256_mul_epu32(accVec, prime);
+			__m256i productHi = _mm256_mul_epu32(accHi, prime);
+			_mm256_store_si256(pAcc, _mm256_add_epi64(productLo, _mm256_slli_epi64(productHi, 32)));
+		}
+#else
+		const __m128i prime = _mm_set1_epi32(static_cast<int>(PRIME32_1));
+		for (u32 i = 0; i < 4; i++)
+		{
+			__m128i* pAcc = reinterpret_cast<__m128i*>(acc) + i;
+			__m128i accVec = _mm_load_si128(pAcc);
+			accVec = _mm_xor_si128(accVec, _mm_srli_epi64(accVec, 47));
+			accVec = _mm_xor_si128(accVec, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+			__m128i accHi = _mm_shuffle_epi32(accVec, _MM_SHUFFLE(0, 3, 0, 1));
+			__m128i productLo = _mm_mul_epu32(accVec, prime);
+			__m128i productHi = _mm_mul_epu32(accHi, prime);
+			_mm_store_si128(pAcc, _mm_add_epi64(productLo, _mm_slli_epi64(productHi, 32)));
+		}
+#endif
+	}
+
+	u64 MergeAcc(const u64* acc, const u8* secret, u64 start)
+	{
+		u64 result = start;
+		for (u32 i = 0; i < rageam::DataHasher::LANE_COUNT / 2; i++)
+		{
+			result += Mul128Fold64(
+				acc[i * 2 + 0] ^ Read64(secret + i * 16 + 0),
+				acc[i * 2 + 1] ^ Read64(secret + i * 16 + 8));
+		}
+		return Avalanche(result);
+	}
+}
+
+void rageam::DataHasher::ConsumeStripes(const u8* data, u64 stripeCount)
+{
+	for (u64 i = 0; i < stripeCount; i++)
+	{
+		AccumulateStripe(m_Acc, data + i * STRIPE_SIZE, SECRET.Bytes + m_StripeIndex * 8);
+		if (++m_StripeIndex == STRIPES_PER_BLOCK)
+		{
+			ScrambleAcc(m_Acc, SECRET.Bytes + SECRET_SIZE - STRIPE_SIZE);
+			m_StripeIndex = 0;
+		}
+	}
+}
+
+void rageam::DataHasher::GetFinalAcc(u64* acc) const
+{
+	memcpy(acc, m_Acc, sizeof m_Acc);
+
+	// Zero padded tail, total size is mixed in on merge so padding can't collide with actual zeros
+	if (m_BufferSize > 0)
+	{
+		u8 stripe[STRIPE_SIZE] = {};
+		memcpy(stripe, m_Buffer, m_BufferSize);
+		AccumulateStripe(acc, stripe, SECRET.Bytes + m_StripeIndex * 8);
+	}
+}
+
+void rageam::DataHasher::Reset(u64 seed)
+{
+	m_Acc[0] = PRIME32_3 + seed;
+	m_Acc[1] = PRIME64_1 - seed;
+	m_Acc[2] = PRIME64_2 + seed;
+	m_Acc[3] = PRIME64_3 - seed;
+	m_Acc[4] = PRIME64_4 + seed;
+	m_Acc[5] = PRIME32_2 - seed;
+	m_Acc[6] = PRIME64_5 + seed;
+	m_Acc[7] = PRIME32_1 - seed;
+	m_BufferSize = 0;
+	m_StripeIndex = 0;
+	m_TotalSize = 0;
+}
+
+void rageam::DataHasher::Add(pConstVoid data, size_t size)
+{
+	auto bytes = static_cast<const u8*>(data);
+	m_TotalSize += size;
+
+	// Complete stripe that was started by previous call
+	if (m_BufferSize > 0)
+	{
+		u32 fillSize = static_cast<u32>(MIN(static_cast<size_t>(STRIPE_SIZE - m_BufferSize), size));
+		memcpy(m_Buffer + m_BufferSize, bytes, fillSize);
+		m_BufferSize += fillSize;
+		bytes += fillSize;
+		size -= fillSize;
+
+		if (m_BufferSize < STRIPE_SIZE)
+			return;
+
+		ConsumeStripes(m_Buffer, 1);
+		m_BufferSize = 0;
+	}
+
+	u64 stripeCount = size / STRIPE_SIZE;
+	ConsumeStripes(bytes, stripeCount);
+	bytes += stripeCount * STRIPE_SIZE;
+	size -= stripeCount * STRIPE_SIZE;
+
+	memcpy(m_Buffer, bytes, size);
+	m_BufferSize = static_cast<u32>(size);
+}
+
+u64 rageam::DataHasher::Get64() const
+{
+	alignas(32) u64 acc[LANE_COUNT];
+	GetFinalAcc(acc);
+	return MergeAcc(acc, SECRET.Bytes + 11, m_TotalSize * PRIME64_1);
+}
+
+rageam::Hash128 rageam::DataHasher::Get128() const
+{
+	alignas(32) u64 acc[LANE_COUNT];
+	GetFinalAcc(acc);
+
+	Hash128 hash;
+	hash.Low = MergeAcc(acc, SECRET.Bytes + 11, m_TotalSize * PRIME64_1);
+	hash.High = MergeAcc(acc, SECRET.Bytes + SECRET_SIZE - STRIPE_SIZE - 11, ~(m_TotalSize * PRIME64_2));
+	return hash;
+}
+
+u64 rageam::DataHash64(pConstVoid data, size_t size, u64 seed)
+{
+	DataHasher hasher(seed);
+	hasher.Add(data, size);
+	return hasher.Get64();
+}
+
+rageam::Hash128 rageam::DataHash128(pConstVoid data, size_t size, u64 seed)
+{
+	DataHasher hasher(seed);
+	hasher.Add(data, size);
+	return hasher.Get128();
+}
+
+rageam::Hash128 rageam::DataHash128Parallel(pConstVoid data, size_t size, u64 seed)
+{
+	AM_TRACE_FUNCTION();
+
+	u32 chunkCount = static_cast<u32>((size + PARALLEL_CHUNK_SIZE - 1) / PARALLEL_CHUNK_SIZE);
+	chunkCount = MAX(chunkCount, 1u);
+
+	List<Hash128> chunkHashes;
+	chunkHashes.Resize(chunkCount);
+	BackgroundWorker::ParallelFor(chunkCount, [&](u32 index)
+		{
+			size_t offset = static_cast<size_t>(index) * PARALLEL_CHUNK_SIZE;
+			size_t chunkSize = MIN(size - offset, static_cast<size_t>(PARALLEL_CHUNK_SIZE));
+			chunkHashes[index] = DataHash128(static_cast<const char*>(data) + offset, chunkSize, seed);
+		}, TaskPriority_High);
+
+	DataHasher hasher(seed);
+	hasher.Add(chunkHashes.GetItems(), sizeof(Hash128) * chunkCount);
+	hasher.AddValue(static_cast<u64>(size));
+	return hasher.Get128();
+}
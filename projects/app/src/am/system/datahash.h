@@ -0,0 +1,74 @@
+//
+// File: datahash.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "common/types.h"
+
+namespace rageam
+{
+	struct Hash128
+	{
+		u64 Low;
+		u64 High;
+
+		// For containers keyed by 32 bit hash
+		u32 Fold32() const
+		{
+			u64 hash = Low ^ High;
+			return static_cast<u32>(hash ^ hash >> 32);
+		}
+
+		bool operator==(const Hash128& other) const = default;
+	};
+
+	/**
+	 * \brief Streaming 64/128 bit content hash, built the same way as XXH3 long hash - 64 byte stripes are accumulated
+	 * in 8 lanes with 32x32->64 bit multiplies (SSE2 or AVX2), lanes are scrambled after every block of 16 stripes.
+	 * \n Result does not depend on instruction set or on how data is split between Add calls, so hashing can be done
+	 * while file is still being read.
+	 * \remarks Output is not compatible with reference xxHash. Use atStringHash for anything game-facing,
+	 * this is meant for cache keys of large buffers (pixel data, asset sources) where atDataHash is way too slow.
+	 */
+	class DataHasher
+	{
+	public:
+		static constexpr u32 STRIPE_SIZE = 64;
+		static constexpr u32 LANE_COUNT = 8;
+		static constexpr u32 SECRET_SIZE = 192;
+		static constexpr u32 STRIPES_PER_BLOCK = (SECRET_SIZE - STRIPE_SIZE) / 8;
+
+	private:
+		alignas(32) u64 m_Acc[LANE_COUNT];
+		u8				m_Buffer[STRIPE_SIZE];	// Tail that doesn't fill whole stripe yet
+		u32				m_BufferSize;
+		u32				m_StripeIndex;			// In current block
+		u64				m_TotalSize;
+
+		void ConsumeStripes(const u8* data, u64 stripeCount);
+		// Accumulates buffered tail into copy of accumulators, hasher state remains untouched
+		void GetFinalAcc(u64* acc) const;
+
+	public:
+		DataHasher(u64 seed = 0) { Reset(seed); }
+
+		void Reset(u64 seed = 0);
+
+		void Add(pConstVoid data, size_t size);
+		template<typename T>
+		void AddValue(const T& value) { Add(&value, sizeof(T)); }
+
+		u64		Get64() const;
+		Hash128 Get128() const;
+	};
+
+	u64		DataHash64(pConstVoid data, size_t size, u64 seed = 0);
+	Hash128 DataHash128(pConstVoid data, size_t size, u64 seed = 0);
+	// Splits buffer in 1MB chunks that are hashed on background worker, and hashes list of chunk hashes.
+	// Value is different from DataHash128 for the same data, don't mix them
+	Hash128 DataHash128Parallel(pConstVoid data, size_t size, u64 seed = 0);
+}
@@ -77,6 +77,8 @@ AM_NOINLINE void rageam::ErrorDisplay::Assert(ConstWString error, ConstString as
 	AM_ERRF(L"%hs, %ls", assert, error);
 	AM_TRACE(stack);
 	options.Set(LOG_OPTION_NO_PREFIX, false);
+	// Debugger break freezes log writer thread
+	Logger::Flush();
 
 	// Show task dialog with assert
 	TASKDIALOG_BUTTON buttons[1];
@@ -102,6 +104,7 @@ void rageam::ErrorDisplay::GameError(ConstWString error, u32 frameSkip)
 	AM_ERRF("%ls", error);
 	AM_TRACE(stack);
 	options.Set(LOG_OPTION_NO_PREFIX, false);
+	Logger::Flush();
 
 	TASKDIALOG_BUTTON buttons[1];
 	buttons[0].nButtonID = 0;
@@ -133,6 +136,7 @@ void rageam::ErrorDisplay::ImAssert(ConstString assert, u32 frameSkip)
 	AM_ERRF("%s", assert);
 	AM_TRACE(stack);
 	options.Set(LOG_OPTION_NO_PREFIX, false);
+	Logger::Flush();
 
 	TASKDIALOG_BUTTON buttons[1];
 	buttons[0].nButtonID = 0;
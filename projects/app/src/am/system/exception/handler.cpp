@@ -1,6 +1,7 @@
 #include "handler.h"
 
 #include "stacktrace.h"
+#include "common/logger.h"
 #include "am/system/debugger.h"
 #include "am/system/errordisplay.h"
 
@@ -50,6 +51,9 @@ rageam::ExceptionHandler::Context::Context(const _EXCEPTION_POINTERS* exInfo)
 
 AM_NOINLINE void rageam::ExceptionHandler::HandleException(const EXCEPTION_POINTERS* exInfo, bool isHandled)
 {
+	// Log writer thread won't get a chance to write what was logged right before the crash
+	Logger::FlushOnCrash();
+
 	Context ctx(exInfo);
 	ErrorDisplay::Exception(ctx, isHandled);
 	Debugger::BreakIfAttached(); // If debugger wasn't attached, dialog gives you a great time to do it
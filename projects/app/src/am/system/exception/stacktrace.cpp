@@ -127,6 +127,19 @@ AM_NOINLINE u16 rageam::StackTracer::CaptureCurrent(u32 frameSkip)
 	return frameCount;
 }
 
+AM_NOINLINE u16 rageam::StackTracer::CaptureFrames(u64* frames, u32 maxFrames, u32 frameSkip)
+{
+	u16 frameCount = RtlCaptureStackBackTrace(
+		frameSkip + 1 /* This */, maxFrames,
+		reinterpret_cast<PVOID*>(frames), NULL);
+
+	// Same as in ::CaptureCurrent
+	for (u16 i = 0; i < frameCount; i++)
+		frames[i] -= 5;
+
+	return frameCount;
+}
+
 u16 rageam::StackTracer::CaptureFromContext(ExceptionHandler::Context& context)
 {
 	u16 frameCount = 0;
@@ -154,6 +154,27 @@ namespace rageam
 			FreeSymbols();
 		}
 
+		/**
+		 * \brief Captures return addresses of current thread stack without resolving symbols, that's cheap enough
+		 * to be done on every allocation. Use WriteFramesTo to resolve them later.
+		 * \returns Number of captured frames.
+		 */
+		AM_NOINLINE static u16 CaptureFrames(u64* frames, u32 maxFrames, u32 frameSkip = 0);
+
+		/**
+		 * \brief Writes stack captured by CaptureFrames with resolved symbol names to buffer.
+		 */
+		static void WriteFramesTo(const u64* frames, u16 frameCount, char* buffer, u32 bufferSize)
+		{
+			rage::sysCriticalSectionLock lock(sm_Mutex);
+			RequestSymbols();
+			if (frameCount > STACKTRACE_MAX_FRAMES)
+				frameCount = STACKTRACE_MAX_FRAMES;
+			memcpy(sm_Frames, frames, sizeof(u64) * frameCount);
+			WriteTo(frameCount, buffer, bufferSize);
+			FreeSymbols();
+		}
+
 		AM_NOINLINE static void Print()
 		{
 			thread_local char buffer[STACKTRACE_BUFFER_SIZE];
@@ -0,0 +1,538 @@
+//
+// File: flatset.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "am/system/asserts.h"
+#include "common/types.h"
+#include "helpers/ranges.h"
+#include "rage/atl/map.h"
+#include "rage/system/new.h"
+
+#include <emmintrin.h>
+#include <intrin.h>
+
+namespace rageam
+{
+	/**
+	 * \brief Default hash function for FlatSet, forwards to atMapHashFn of the argument type.
+	 * Allows heterogeneous lookup - set of atString can be searched with ConstString without creating a string.
+	 */
+	struct FlatSetHashFn
+	{
+		template<typename T>
+		u32 operator()(const T& value) const { return rage::atMapHashFn<T>()(value); }
+	};
+
+	template<typename TValue, typename THashFn>
+	class FlatSetIterator;
+
+	/**
+	 * \brief Open addressing hash table with SSE2 group probing (SwissTable-like layout), values are stored in a single flat array.
+	 * Interface is the same as atMap one - values are identified by 32 bit hash, but there's no per-node allocation,
+	 * capacity is 32 bit and probing checks 16 slots at once.
+	 * \remarks Tool-side only! atMap must be used for anything that goes into paged resources.
+	 */
+	template<typename TValue, typename THashFn = FlatSetHashFn>
+	class FlatSet
+	{
+		using Iterator = FlatSetIterator<TValue, THashFn>;
+
+		friend Iterator;
+
+		static constexpr u32 GROUP_WIDTH = 16;
+		static constexpr u32 MIN_CAPACITY = GROUP_WIDTH;
+
+		// Full slot control byte holds 7 bits of hash, so the high bit is set only for empty and deleted slots
+		static constexpr s8 CTRL_EMPTY = -128;
+		static constexpr s8 CTRL_DELETED = -2;
+
+		s8*     m_Ctrl = nullptr;	// Capacity + GROUP_WIDTH bytes, first group is mirrored after the end so group load never wraps
+		u32*    m_Hashes = nullptr;
+		TValue* m_Values = nullptr;	// Not constructed unless slot is full
+		u32     m_Capacity = 0;		// Always power of two
+		u32     m_Size = 0;
+		u32     m_GrowthLeft = 0;	// Empty slots that can be taken before rehash, deleted slots are not returned back
+
+		// Hash is user-provided and often weak (integer keys are hashed as is), bits have to be spread
+		// to use both as start position (H1) and as 7 bit tag in control byte (H2)
+		static u32 MixHash(u32 hash)
+		{
+			hash ^= hash >> 16;
+			hash *= 0x85EBCA6B;
+			hash ^= hash >> 13;
+			hash *= 0xC2B2AE35;
+			hash ^= hash >> 16;
+			return hash;
+		}
+		static u32 H1(u32 mixed) { return mixed >> 7; }
+		static s8  H2(u32 mixed) { return static_cast<s8>(mixed & 0x7F); }
+
+		// Max count of full and deleted slots, 7/8 load factor
+		static u32 GetMaxLoad(u32 capacity) { return capacity - capacity / 8; }
+
+		static u32 LowestBit(u32 mask)
+		{
+			unsigned long index;
+			_BitScanForward(&index, mask);
+			return index;
+		}
+
+		static u32 MatchGroup(const s8* group, s8 ctrl)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+			return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(ctrl)));
+		}
+		static u32 MatchEmptyOrDeleted(const s8* group)
+		{
+			__m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(group));
+			return _mm_movemask_epi8(bytes);
+		}
+
+		u32 GetHash(const TValue& value) const
+		{
+			THashFn fn{};
+			return fn(value);
+		}
+
+		bool IsFull(u32 slot) const { return m_Ctrl[slot] >= 0; }
+
+		void SetCtrl(u32 slot, s8 ctrl)
+		{
+			m_Ctrl[slot] = ctrl;
+			// Mirror first group
+			if (slot < GROUP_WIDTH)
+				m_Ctrl[m_Capacity + slot] = ctrl;
+		}
+
+		void Allocate(u32 capacity)
+		{
+			m_Capacity = capacity;
+			m_Size = 0;
+			m_GrowthLeft = GetMaxLoad(capacity);
+			m_Ctrl = static_cast<s8*>(rage_malloc(capacity + GROUP_WIDTH));
+			m_Hashes = static_cast<u32*>(rage_malloc(sizeof(u32) * capacity));
+			m_Values = static_cast<TValue*>(rage_malloc(sizeof(TValue) * capacity, MAX(alignof(TValue), 16)));
+			memset(m_Ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+		}
+
+		void Free()
+		{
+			rage_free(m_Ctrl);
+			rage_free(m_Hashes);
+			rage_free(m_Values);
+			m_Ctrl = nullptr;
+			m_Hashes = nullptr;
+			m_Values = nullptr;
+			m_Capacity = 0;
+			m_Size = 0;
+			m_GrowthLeft = 0;
+		}
+
+		// Returns slot index or capacity if there's no value with given hash
+		u32 FindSlot(u32 hash) const
+		{
+			if (m_Size == 0)
+				return m_Capacity;
+
+			u32 mixed = MixHash(hash);
+			s8  h2 = H2(mixed);
+			u32 mask = m_Capacity - 1;
+			u32 pos = H1(mixed) & mask;
+			for (u32 probe = GROUP_WIDTH; ; probe += GROUP_WIDTH)
+			{
+				const s8* group = m_Ctrl + pos;
+				u32 match = MatchGroup(group, h2);
+				while (match)
+				{
+					u32 slot = (pos + LowestBit(match)) & mask;
+					if (m_Hashes[slot] == hash)
+						return slot;
+					match &= match - 1;
+				}
+
+				// Value would've been placed in this empty slot, probing stops here
+				if (MatchGroup(group, CTRL_EMPTY))
+					return m_Capacity;
+
+				pos = (pos + probe) & mask; // Triangular probing visits every group when capacity is power of two
+			}
+		}
+
+		// First empty or deleted slot in probe sequence of the hash
+		u32 FindInsertSlot(u32 mixed) const
+		{
+			u32 mask = m_Capacity - 1;
+			u32 pos = H1(mixed) & mask;
+			for (u32 probe = GROUP_WIDTH; ; probe += GROUP_WIDTH)
+			{
+				u32 match = MatchEmptyOrDeleted(m_Ctrl + pos);
+				if (match)
+					return (pos + LowestBit(match)) & mask;
+				pos = (pos + probe) & mask;
+			}
+		}
+
+		// Finds slot for new value (rehashing if needed) and marks it as full, value must be constructed by caller
+		u32 AllocateSlot(u32 hash)
+		{
+			if (m_Capacity == 0)
+				Rehash(MIN_CAPACITY);
+
+			u32 mixed = MixHash(hash);
+			u32 slot = FindInsertSlot(mixed);
+			if (m_GrowthLeft == 0 && m_Ctrl[slot] == CTRL_EMPTY)
+			{
+				// Table is filled with deleted slots - clean them up in place, otherwise grow
+				if (m_Size * 32 <= m_Capacity * 25)
+					Rehash(m_Capacity);
+				else
+					Rehash(m_Capacity * 2);
+				slot = FindInsertSlot(mixed);
+			}
+
+			if (m_Ctrl[slot] == CTRL_EMPTY)
+				m_GrowthLeft--;
+			SetCtrl(slot, H2(mixed));
+			m_Hashes[slot] = hash;
+			m_Size++;
+			return slot;
+		}
+
+		// Finds existing value to replace (destructing it) or allocates new slot
+		u32 AllocateSlotOrFindExisting(u32 hash)
+		{
+			u32 slot = FindSlot(hash);
+			if (slot != m_Capacity)
+			{
+				m_Values[slot].~TValue();
+				return slot;
+			}
+			return AllocateSlot(hash);
+		}
+
+		void RemoveSlot(u32 slot)
+		{
+			m_Values[slot].~TValue();
+			SetCtrl(slot, CTRL_DELETED);
+			m_Size--;
+		}
+
+	public:
+		FlatSet() = default;
+		FlatSet(const std::initializer_list<TValue>& list)
+		{
+			Reserve(static_cast<u32>(list.size()));
+			for (const TValue& value : list)
+				Insert(value);
+		}
+		FlatSet(const FlatSet& other)
+		{
+			CopyFrom(other);
+		}
+		FlatSet(FlatSet&& other) noexcept
+		{
+			Swap(other);
+		}
+		~FlatSet()
+		{
+			Destroy();
+		}
+
+		/*
+		 *	------------------ Initializers / Destructors ------------------
+		 */
+
+		void Swap(FlatSet& other)
+		{
+			std::swap(m_Ctrl, other.m_Ctrl);
+			std::swap(m_Hashes, other.m_Hashes);
+			std::swap(m_Values, other.m_Values);
+			std::swap(m_Capacity, other.m_Capacity);
+			std::swap(m_Size, other.m_Size);
+			std::swap(m_GrowthLeft, other.m_GrowthLeft);
+		}
+
+		void CopyFrom(const FlatSet& other)
+		{
+			Destroy();
+			if (other.m_Capacity == 0)
+				return;
+
+			// Same capacity keeps exact same layout, no need to rehash
+			Allocate(other.m_Capacity);
+			memcpy(m_Ctrl, other.m_Ctrl, m_Capacity + GROUP_WIDTH);
+			memcpy(m_Hashes, other.m_Hashes, sizeof(u32) * m_Capacity);
+			for (u32 i = 0; i < m_Capacity; i++)
+			{
+				if (IsFull(i))
+					new (&m_Values[i]) TValue(other.m_Values[i]);
+			}
+			m_Size = other.m_Size;
+			m_GrowthLeft = other.m_GrowthLeft;
+		}
+
+		// Destructs all values and frees memory
+		void Destroy()
+		{
+			if (!m_Ctrl)
+				return;
+
+			for (u32 i = 0; i < m_Capacity; i++)
+			{
+				if (IsFull(i))
+					m_Values[i].~TValue();
+			}
+			Free();
+		}
+
+		// Destructs all values but keeps memory, unlike atMap
+		void Clear()
+		{
+			if (!m_Ctrl)
+				return;
+
+			for (u32 i = 0; i < m_Capacity; i++)
+			{
+				if (IsFull(i))
+					m_Values[i].~TValue();
+			}
+			memset(m_Ctrl, CTRL_EMPTY, m_Capacity + GROUP_WIDTH);
+			m_Size = 0;
+			m_GrowthLeft = GetMaxLoad(m_Capacity);
+		}
+
+		/*
+		 *	------------------ Altering size ------------------
+		 */
+
+		// Ensures that given number of values can be added without rehashing
+		void Reserve(u32 count)
+		{
+			u32 capacity = MIN_CAPACITY;
+			while (GetMaxLoad(capacity) < count)
+				capacity *= 2;
+
+			if (capacity > m_Capacity || count > m_Size + m_GrowthLeft)
+				Rehash(MAX(capacity, m_Capacity));
+		}
+
+		// Moves all values in newly allocated table, also removes deleted slots. Capacity is rounded up to power of two
+		void Rehash(u32 newCapacity)
+		{
+			u32 capacity = MIN_CAPACITY;
+			while (capacity < newCapacity || GetMaxLoad(capacity) < m_Size)
+				capacity *= 2;
+
+			FlatSet newSet;
+			newSet.Allocate(capacity);
+			for (u32 i = 0; i < m_Capacity; i++)
+			{
+				if (!IsFull(i))
+					continue;
+
+				u32 slot = newSet.AllocateSlot(m_Hashes[i]);
+				new (&newSet.m_Values[slot]) TValue(std::move(m_Values[i]));
+			}
+			Swap(newSet);
+		}
+
+		/*
+		 *	------------------ Adding / Removing items ------------------
+		 */
+
+		TValue& InsertAt(u32 hash, const TValue& value)
+		{
+			u32 slot = AllocateSlotOrFindExisting(hash);
+			new (&m_Values[slot]) TValue(value);
+			return m_Values[slot];
+		}
+
+		TValue& Insert(const TValue& value)
+		{
+			return InsertAt(GetHash(value), value);
+		}
+
+		template<typename... TArgs>
+		TValue& ConstructAt(u32 hash, TArgs&&... args)
+		{
+			u32 slot = AllocateSlotOrFindExisting(hash);
+			new (&m_Values[slot]) TValue(std::forward<TArgs>(args)...);
+			return m_Values[slot];
+		}
+
+		TValue& EmplaceAt(u32 hash, TValue&& value)
+		{
+			u32 slot = AllocateSlotOrFindExisting(hash);
+			new (&m_Values[slot]) TValue(std::move(value));
+			return m_Values[slot];
+		}
+
+		TValue& Emplace(TValue&& value)
+		{
+			u32 hash = GetHash(value);
+			return EmplaceAt(hash, std::move(value));
+		}
+
+		void RemoveAtIterator(const Iterator& it);
+
+		// Returns false if there's no value with given hash
+		bool TryRemoveAt(u32 hash)
+		{
+			u32 slot = FindSlot(hash);
+			if (slot == m_Capacity)
+				return false;
+
+			RemoveSlot(slot);
+			return true;
+		}
+
+		void RemoveAt(u32 hash)
+		{
+			bool removed = TryRemoveAt(hash);
+			AM_ASSERT(removed, "FlatSet::RemoveAt() -> Slot with key hash %u is not allocated.", hash);
+		}
+
+		template<typename TKey = TValue>
+		void Remove(const TKey& key)
+		{
+			RemoveAt(THashFn()(key));
+		}
+
+		/*
+		 *	------------------ Getters / Operators ------------------
+		 */
+
+		Iterator FindByHash(u32 hash) const;
+
+		template<typename TKey = TValue>
+		Iterator Find(const TKey& key) const { return FindByHash(THashFn()(key)); }
+
+		TValue* TryGetAt(u32 hash) const
+		{
+			u32 slot = FindSlot(hash);
+			if (slot == m_Capacity)
+				return nullptr;
+			return &m_Values[slot];
+		}
+
+		TValue& GetAt(u32 hash) const
+		{
+			TValue* value = TryGetAt(hash);
+			AM_ASSERT(value, "FlatSet::GetAt() -> Value with hash %u is not present.", hash);
+			return *value;
+		}
+
+		// Heterogeneous lookup, key is hashed with THashFn
+		template<typename TKey>
+		TValue* TryGet(const TKey& key) const { return TryGetAt(THashFn()(key)); }
+
+		bool Equals(const FlatSet& other) const
+		{
+			if (m_Size != other.m_Size)
+				return false;
+
+			for (u32 i = 0; i < m_Capacity; i++)
+			{
+				if (IsFull(i) && !other.ContainsAt(m_Hashes[i]))
+					return false;
+			}
+			return true;
+		}
+
+		rage::atArray<TValue> ToArray() const
+		{
+			rage::atArray<TValue> result;
+			result.Reserve(m_Size);
+			for (const TValue& value : *this)
+				result.Add(value);
+			return result;
+		}
+
+		bool Any() const { return m_Size > 0; }
+		template<typename TKey = TValue>
+		bool Contains(const TKey& key) const { return FindSlot(THashFn()(key)) != m_Capacity; }
+		bool ContainsAt(u32 hash) const { return FindSlot(hash) != m_Capacity; }
+		u32  GetCapacity() const { return m_Capacity; }
+		u32  GetNumUsedSlots() const { return m_Size; }
+
+		FlatSet& operator=(const FlatSet& other) // NOLINT(bugprone-unhandled-self-assignment)
+		{
+			if (this != &other)
+				CopyFrom(other);
+			return *this;
+		}
+
+		FlatSet& operator=(FlatSet&& other) noexcept
+		{
+			Swap(other);
+			return *this;
+		}
+
+		bool operator==(const FlatSet& other) const { return Equals(other); }
+
+		Iterator begin() const { return Iterator(this, 0); }
+		Iterator end() const { return Iterator(this, m_Capacity); }
+	};
+
+	/**
+	 * \brief Iterates full slots of FlatSet, iterator is invalidated by insertion (may rehash) but not by removal.
+	 */
+	template<typename TValue, typename THashFn = FlatSetHashFn>
+	class FlatSetIterator
+	{
+		using Set = FlatSet<TValue, THashFn>;
+
+		friend Set;
+
+		const Set* m_Set;
+		u32        m_Slot;
+
+		void SkipNonFull()
+		{
+			while (m_Slot < m_Set->m_Capacity && !m_Set->IsFull(m_Slot))
+				m_Slot++;
+		}
+
+	public:
+		FlatSetIterator(const Set* set, u32 slot) : m_Set(set), m_Slot(slot)
+		{
+			SkipNonFull();
+		}
+
+		FlatSetIterator& operator++()
+		{
+			m_Slot++;
+			SkipNonFull();
+			return *this;
+		}
+
+		TValue& operator*() const { return m_Set->m_Values[m_Slot]; }
+		TValue* operator->() const { return &m_Set->m_Values[m_Slot]; }
+		TValue& GetValue() const { return m_Set->m_Values[m_Slot]; }
+		u32     GetHash() const { return m_Set->m_Hashes[m_Slot]; }
+		bool    HasValue() const { return m_Slot < m_Set->m_Capacity; }
+
+		bool operator==(const FlatSetIterator& other) const { return m_Set == other.m_Set && m_Slot == other.m_Slot; }
+		bool operator!=(const FlatSetIterator& other) const { return !(*this == other); }
+	};
+
+	// Implementation of functions in FlatSet that depend on FlatSetIterator
+
+	template<typename TValue, typename THashFn>
+	void FlatSet<TValue, THashFn>::RemoveAtIterator(const Iterator& it)
+	{
+		AM_ASSERT(it.HasValue(), "FlatSet::RemoveAtIterator() -> Invalid iterator!");
+		RemoveSlot(it.m_Slot);
+	}
+
+	template<typename TValue, typename THashFn>
+	typename FlatSet<TValue, THashFn>::Iterator FlatSet<TValue, THashFn>::FindByHash(u32 hash) const
+	{
+		return Iterator(this, FindSlot(hash));
+	}
+}
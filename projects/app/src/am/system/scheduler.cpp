@@ -0,0 +1,272 @@
+#include "scheduler.h"
+
+#include "helpers/ranges.h"
+
+void rageam::TaskScheduler::WorkerProc(u32 workerIndex)
+{
+	tl_Scheduler = this;
+	tl_WorkerIndex = workerIndex;
+
+	while (!m_Closing)
+	{
+		TaskFn task;
+		if (TryTakeAny(task))
+		{
+			Execute(task);
+			continue;
+		}
+
+		std::unique_lock lock(m_SleepMutex);
+		m_SleepCondition.wait(lock, [this] { return m_QueuedCount > 0 || m_Closing; });
+	}
+}
+
+bool rageam::TaskScheduler::TryPopBack(TaskQueue& queue, TaskFn& outTask)
+{
+	std::unique_lock lock(queue.Mutex);
+	if (queue.Tasks.empty())
+		return false;
+
+	outTask = std::move(queue.Tasks.back());
+	queue.Tasks.pop_back();
+	return true;
+}
+
+bool rageam::TaskScheduler::TryPopFront(TaskQueue& queue, TaskFn& outTask)
+{
+	std::unique_lock lock(queue.Mutex);
+	if (queue.Tasks.empty())
+		return false;
+
+	outTask = std::move(queue.Tasks.front());
+	queue.Tasks.pop_front();
+	return true;
+}
+
+bool rageam::TaskScheduler::TryTakeShared(eTaskPriority priority, TaskFn& outTask)
+{
+	return TryPopFront(m_SharedQueues[priority], outTask);
+}
+
+bool rageam::TaskScheduler::TryTakeNested(TaskFn& outTask)
+{
+	u32 threadCount = GetThreadCount();
+
+	// Newest task of own deque is most likely to have its data in cache
+	u32 startIndex = 0;
+	if (IsWorkerThread())
+	{
+		if (TryPopBack(m_LocalQueues[tl_WorkerIndex], outTask))
+			return true;
+		startIndex = tl_WorkerIndex + 1;
+	}
+
+	// Steal oldest task, it is usually the biggest piece of work
+	for (u32 i = 0; i < threadCount; i++)
+	{
+		u32 victim = (startIndex + i) % threadCount;
+		if (IsWorkerThread() && victim == tl_WorkerIndex)
+			continue;
+
+		if (TryPopFront(m_LocalQueues[victim], outTask))
+			return true;
+	}
+	return false;
+}
+
+bool rageam::TaskScheduler::TryTakeAny(TaskFn& outTask)
+{
+	// Nested tasks are preferred over new batch work, they belong to tasks that already started
+	// and hold their memory, finishing them first keeps memory usage bounded
+	return
+		TryTakeShared(TaskPriority_High, outTask) ||
+		TryTakeNested(outTask) ||
+		TryTakeShared(TaskPriority_Normal, outTask) ||
+		TryTakeShared(TaskPriority_Low, outTask);
+}
+
+void rageam::TaskScheduler::Execute(TaskFn& task)
+{
+	--m_QueuedCount;
+	task();
+}
+
+rageam::TaskScheduler::TaskScheduler(u32 threadCount, const std::function<void(u32 workerIndex)>& onThreadStart)
+{
+	threadCount = MAX(threadCount, 1u);
+
+	m_ThreadCount = threadCount;
+	m_LocalQueues = std::make_unique<TaskQueue[]>(threadCount);
+	m_Threads.reserve(threadCount);
+	for (u32 i = 0; i < threadCount; i++)
+	{
+		m_Threads.emplace_back([this, i, onThreadStart]
+			{
+				if (onThreadStart)
+					onThreadStart(i);
+				WorkerProc(i);
+			});
+	}
+}
+
+rageam::TaskScheduler::~TaskScheduler()
+{
+	{
+		std::unique_lock lock(m_SleepMutex);
+		m_Closing = true;
+	}
+	m_SleepCondition.notify_all();
+
+	// Workers finish tasks they are executing now, the rest is discarded
+	for (std::thread& thread : m_Threads)
+		thread.join();
+}
+
+void rageam::TaskScheduler::Submit(TaskFn task, eTaskPriority priority)
+{
+	TaskQueue& queue = IsWorkerThread() ? m_LocalQueues[tl_WorkerIndex] : m_SharedQueues[priority];
+	{
+		std::unique_lock lock(queue.Mutex);
+		queue.Tasks.emplace_back(std::move(task));
+	}
+
+	// Counter is incremented before taking sleep lock, so worker can't miss the notification
+	++m_QueuedCount;
+	{
+		std::unique_lock lock(m_SleepMutex);
+	}
+	m_SleepCondition.notify_one();
+}
+
+void rageam::TaskScheduler::ParallelForRange(
+	u32 count, u32 grainSize, const std::function<void(u32 begin, u32 end)>& fn,
+	eTaskPriority priority, const CancellationToken& token)
+{
+	if (count == 0)
+		return;
+
+	grainSize = MAX(grainSize, 1u);
+	u32 batchCount = (count + grainSize - 1) / grainSize;
+	if (batchCount == 1)
+	{
+		fn(0, count);
+		return;
+	}
+
+	// Helper tasks may start after all batches were taken (and this function returned), so state
+	// must outlive this scope. Function itself is accessed only while there are batches left
+	struct BatchQueue
+	{
+		const std::function<void(u32, u32)>& Fn;
+		CancellationToken					 Token;
+		u32									 Count;
+		u32									 GrainSize;
+		u32									 BatchCount;
+		std::atomic_uint					 Next = 0;
+		u32									 Done = 0;
+		std::mutex							 DoneMutex;
+		std::condition_variable				 Finished;
+
+		BatchQueue(const std::function<void(u32, u32)>& fn, const CancellationToken& token, u32 count, u32 grainSize, u32 batchCount)
+			: Fn(fn), Token(token), Count(count), GrainSize(grainSize), BatchCount(batchCount) {}
+	};
+	auto queue = std::make_shared<BatchQueue>(fn, token, count, grainSize, batchCount);
+
+	auto drainQueue = [](BatchQueue& q)
+		{
+			u32 batch;
+			u32 doneCount = 0;
+			while ((batch = q.Next++) < q.BatchCount)
+			{
+				// Cancelled batches are still marked as done, so waiting thread is released
+				if (!q.Token.IsCancelled())
+				{
+					u32 begin = batch * q.GrainSize;
+					q.Fn(begin, MIN(begin + q.GrainSize, q.Count));
+				}
+				doneCount++;
+			}
+
+			if (doneCount == 0)
+				return;
+
+			std::unique_lock lock(q.DoneMutex);
+			q.Done += doneCount;
+			if (q.Done == q.BatchCount)
+				q.Finished.notify_all();
+		};
+
+	// Calling thread takes batches too, so we need one helper less
+	u32 helperCount = MIN(batchCount - 1, GetThreadCount());
+	for (u32 i = 0; i < helperCount; i++)
+	{
+		Submit([queue, drainQueue]
+			{
+				drainQueue(*queue);
+			}, priority);
+	}
+
+	drainQueue(*queue);
+
+	// All batches are taken at this point, only wait for ones that helpers are still executing
+	// (but not for helper tasks themselves, they might not have even started)
+	std::unique_lock lock(queue->DoneMutex);
+	queue->Finished.wait(lock, [&queue] { return queue->Done == queue->BatchCount; });
+}
+
+void rageam::TaskScheduler::ParallelFor(
+	u32 count, const std::function<void(u32 index)>& fn, eTaskPriority priority, const CancellationToken& token)
+{
+	ParallelForRange(count, 1, [&fn](u32 begin, u32 end)
+		{
+			for (u32 i = begin; i < end; i++)
+				fn(i);
+		}, priority, token);
+}
+
+bool rageam::TaskGroup::RunOne(State& state)
+{
+	TaskFn task;
+	{
+		std::unique_lock lock(state.Mutex);
+		if (state.Tasks.empty())
+			return false;
+
+		task = std::move(state.Tasks.front());
+		state.Tasks.pop_front();
+	}
+
+	if (!state.Token.IsCancelled())
+		task();
+
+	// Group may be destroyed right after this. Task itself is destroyed later, when group
+	// is already released, because it may hold the last reference to the group owner
+	std::unique_lock lock(state.Mutex);
+	if (--state.Pending == 0)
+		state.Finished.notify_all();
+	return true;
+}
+
+void rageam::TaskGroup::Run(TaskFn task)
+{
+	{
+		std::unique_lock lock(m_State->Mutex);
+		m_State->Tasks.emplace_back(std::move(task));
+		++m_State->Pending;
+	}
+
+	// Runner finds queue empty if waiting thread already executed the task
+	m_Scheduler->Submit([state = m_State]
+		{
+			RunOne(*state);
+		}, m_Priority);
+}
+
+void rageam::TaskGroup::Wait()
+{
+	while (RunOne(*m_State)) {}
+
+	// Remaining tasks are executed by other threads
+	std::unique_lock lock(m_State->Mutex);
+	m_State->Finished.wait(lock, [this] { return m_State->Pending == 0; });
+}
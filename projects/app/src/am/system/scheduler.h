@@ -0,0 +1,161 @@
+//
+// File: scheduler.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "common/types.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace rageam
+{
+	enum eTaskPriority
+	{
+		TaskPriority_High,		// Work that user is actively waiting for, for e.g. UI previews
+		TaskPriority_Normal,
+		TaskPriority_Low,		// Batch work, for e.g. asset compilation
+
+		TaskPriority_Count,
+	};
+
+	/**
+	 * \brief Cancellation flag shared between all copies of the token, default constructed token can't be cancelled.
+	 */
+	class CancellationToken
+	{
+		std::shared_ptr<std::atomic_bool> m_Cancelled;
+
+	public:
+		CancellationToken() = default;
+
+		static CancellationToken Create()
+		{
+			CancellationToken token;
+			token.m_Cancelled = std::make_shared<std::atomic_bool>(false);
+			return token;
+		}
+
+		void Cancel() const { if (m_Cancelled) *m_Cancelled = true; }
+		bool IsCancelled() const { return m_Cancelled && *m_Cancelled; }
+		bool CanBeCancelled() const { return m_Cancelled != nullptr; }
+	};
+
+	using TaskFn = std::function<void()>;
+
+	/**
+	 * \brief Work-stealing thread pool, uses only standard library so it can be tested on any platform.
+	 * Tasks submitted from worker threads go to the local deque of that worker (owner takes newest, thieves take oldest),
+	 * tasks submitted from other threads go to shared queue of given priority.
+	 * Waiting thread executes only work it waits for (batches of own ParallelFor, tasks of own TaskGroup) that no other
+	 * thread started yet, then blocks until the rest is finished. So tasks can wait on tasks they spawned without deadlocking
+	 * and without spawning additional pools, and waiting never picks up unrelated (possibly long or low priority) work.
+	 */
+	class TaskScheduler
+	{
+		struct TaskQueue
+		{
+			std::mutex			Mutex;
+			std::deque<TaskFn>	Tasks;
+		};
+
+		std::vector<std::thread>		m_Threads;
+		u32								m_ThreadCount;	// Set before threads start, vector is not safe to read while it is filled
+		std::unique_ptr<TaskQueue[]>	m_LocalQueues;	// One per worker
+		TaskQueue						m_SharedQueues[TaskPriority_Count];
+		std::mutex						m_SleepMutex;
+		std::condition_variable			m_SleepCondition;
+		std::atomic_uint				m_QueuedCount = 0;
+		std::atomic_bool				m_Closing = false;
+
+		static inline thread_local TaskScheduler*	tl_Scheduler = nullptr;	// Scheduler that current thread is worker of
+		static inline thread_local u32				tl_WorkerIndex = 0;
+
+		void WorkerProc(u32 workerIndex);
+
+		static bool TryPopBack(TaskQueue& queue, TaskFn& outTask);
+		static bool TryPopFront(TaskQueue& queue, TaskFn& outTask);
+
+		bool TryTakeShared(eTaskPriority priority, TaskFn& outTask);
+		// Own deque first, then steals from other workers
+		bool TryTakeNested(TaskFn& outTask);
+		bool TryTakeAny(TaskFn& outTask);
+		void Execute(TaskFn& task);
+
+	public:
+		// Thread start callback is invoked on every worker thread before it takes any task, use it to name threads
+		TaskScheduler(u32 threadCount, const std::function<void(u32 workerIndex)>& onThreadStart = nullptr);
+		~TaskScheduler();
+
+		TaskScheduler(const TaskScheduler&) = delete;
+		TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+		void Submit(TaskFn task, eTaskPriority priority = TaskPriority_Normal);
+
+		// Invokes function for every index in range [0, count) in parallel, calling thread participates too.
+		// Indices are taken in batches of grain size, cancelled token stops taking new batches
+		void ParallelForRange(
+			u32 count, u32 grainSize, const std::function<void(u32 begin, u32 end)>& fn,
+			eTaskPriority priority = TaskPriority_Normal, const CancellationToken& token = {});
+
+		void ParallelFor(
+			u32 count, const std::function<void(u32 index)>& fn,
+			eTaskPriority priority = TaskPriority_Normal, const CancellationToken& token = {});
+
+		u32  GetThreadCount() const { return m_ThreadCount; }
+		// Whether current thread is worker thread of this scheduler
+		bool IsWorkerThread() const { return tl_Scheduler == this; }
+	};
+
+	/**
+	 * \brief Set of tasks that can be waited together, waiting thread executes tasks of this group that didn't start yet.
+	 * \remarks Destructor waits for all tasks.
+	 */
+	class TaskGroup
+	{
+		// Scheduler runners only pull tasks from here, they may start after group was destroyed so state is shared
+		struct State
+		{
+			std::mutex				Mutex;
+			std::condition_variable	Finished;
+			std::deque<TaskFn>		Tasks;			// Not started yet
+			u32						Pending = 0;	// Not started and running
+			CancellationToken		Token;
+		};
+
+		TaskScheduler*			m_Scheduler;
+		eTaskPriority			m_Priority;
+		std::shared_ptr<State>	m_State;
+
+		// Executes oldest task that didn't start yet, returns false if there's none left
+		static bool RunOne(State& state);
+
+	public:
+		TaskGroup(TaskScheduler* scheduler, eTaskPriority priority = TaskPriority_Normal, const CancellationToken& token = {})
+			: m_Scheduler(scheduler), m_Priority(priority), m_State(std::make_shared<State>())
+		{
+			m_State->Token = token;
+		}
+		~TaskGroup() { Wait(); }
+
+		TaskGroup(const TaskGroup&) = delete;
+		TaskGroup& operator=(const TaskGroup&) = delete;
+
+		// Task is skipped if group token is cancelled before task is started
+		void Run(TaskFn task);
+		void Wait();
+		void Cancel() const { m_State->Token.Cancel(); }
+
+		const CancellationToken& GetToken() const { return m_State->Token; }
+	};
+}
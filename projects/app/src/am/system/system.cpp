@@ -7,6 +7,7 @@
 #include "am/xml/doc.h"
 #include "rage/grcore/fvf.h"
 #include "exception/handler.h"
+#include "helpers/ranges.h"
 
 #include <easy/profiler.h>
 
@@ -78,7 +79,7 @@ void rageam::System::Destroy()
 	if (!m_Initialized)
 		return;
 
-	m_ImGlue->KillAllApps();
+	if (m_ImGlue) m_ImGlue->KillAllApps();
 	// Integration manages game update thread, so imglue/integration depend on each other
 	// We first kill all apps that hold UpdateComponent's, and then safely shutdown integration
 	AM_INTEGRATED_ONLY(m_Integration = nullptr);
@@ -87,8 +88,8 @@ void rageam::System::Destroy()
 	rage::grcVertexDeclaration::CleanUpCache();
 
 	// Cache GPU devices to report live objects after destruction
-	amComPtr<ID3D11Device> dxDevice = DXDEVICE;
-	amComPtr<ID3D11DeviceContext> dxContext = DXCONTEXT;
+	amComPtr<ID3D11Device> dxDevice = m_Render ? DXDEVICE : nullptr;
+	amComPtr<ID3D11DeviceContext> dxContext = m_Render ? DXCONTEXT : nullptr;
 
 	// We must unhook WndProc safely before ImGui is destroyed
 	AM_INTEGRATED_ONLY(m_PlatformWindow->LockWndProc()); // Synchronize to make sure that WndProc is safe to unhook
@@ -123,7 +124,6 @@ void rageam::System::Destroy()
 	asset::TxdAsset::ShutdownClass();
 	asset::AssetFactory::Shutdown();
 	ui::AssetWindowFactory::Shutdown();
-	graphics::ImageCompressor::ShutdownClass();
 	m_MainWorker = nullptr;
 	ExceptionHandler::Shutdown();
 
@@ -134,11 +134,16 @@ void rageam::System::Destroy()
 
 	rage::SystemHeap::Shutdown();
 
+	// Must be stopped before DLL is unloaded, writer thread can't be joined from DllMain
+	Logger::Shutdown();
+
 	m_Initialized = false;
 }
 
-void rageam::System::Init(bool withUI)
+void rageam::System::Init(bool withUI, bool withRender)
 {
+	AM_ASSERT(withRender || !withUI, "System::Init() -> UI can't be drawn without render.");
+
 	Timer timer = Timer::StartNew();
 
 	// In standalone there is only single main thread and it calls this function
@@ -150,7 +155,8 @@ void rageam::System::Init(bool withUI)
 	AM_STANDALONE_ONLY(EASY_THREAD("Main Thread"));
 
 	// Core
-	m_MainWorker = std::make_unique<BackgroundWorker>("System", 8);
+	Logger::StartAsync();
+	m_MainWorker = std::make_unique<BackgroundWorker>("System", MAX(std::thread::hardware_concurrency(), 4u));
 	BackgroundWorker::SetMainInstance(m_MainWorker.get());
 	AM_INTEGRATED_ONLY(Hook::Init());
 	AM_INTEGRATED_ONLY(m_AddressCache = std::make_unique<gmAddressCache>());
@@ -158,7 +164,6 @@ void rageam::System::Init(bool withUI)
 	LoadDataFromXML();
 	ExceptionHandler::Init();
 	asset::AssetFactory::Init();
-	graphics::ImageCompressor::InitClass();
 	m_ImageCache = std::make_unique<graphics::ImageCache>();
 
 	// Not a render thread in integrated mode, because called from Init launcher function
@@ -166,7 +171,8 @@ void rageam::System::Init(bool withUI)
 	// Window (UI) + Render
 	if (withUI)
 		m_PlatformWindow = std::make_unique<graphics::Window>();
-	m_Render = std::make_unique<graphics::Render>();
+	if (withRender)
+		m_Render = std::make_unique<graphics::Render>();
 	if (withUI)
 	{
 		m_ImGlue = std::make_unique<ui::ImGlue>();
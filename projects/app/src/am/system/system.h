@@ -74,8 +74,9 @@ namespace rageam
 		~System() override { Destroy(); }
 
 		void Destroy();
-		// Non ui option available if we want command line application
-		void Init(bool withUI);
+		// Non ui option available if we want command line application,
+		// render can be omitted for commands that don't need GPU (resources are placed without uploading)
+		void Init(bool withUI, bool withRender = true);
 
 		void Update() const;
 
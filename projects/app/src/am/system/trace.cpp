@@ -0,0 +1,399 @@
+#include "trace.h"
+
+#include "am/file/fileutils.h"
+#include "am/file/json.h"
+#include "am/string/string.h"
+#include "common/logger.h"
+
+#include <Windows.h>
+
+std::mutex rageam::Tracer::sm_RegistryMutex;
+std::mutex rageam::Tracer::sm_CaptureMutex;
+
+namespace rageam
+{
+	// Marks buffer as dead once thread exits, it is freed on next capture
+	struct TraceThreadBufferOwner
+	{
+		Tracer::ThreadBuffer* Buffer = nullptr;
+
+		~TraceThreadBufferOwner()
+		{
+			if (Buffer)
+				Tracer::ReleaseThreadBuffer(Buffer);
+		}
+	};
+}
+
+namespace
+{
+	thread_local rageam::TraceThreadBufferOwner t_BufferOwner;
+}
+
+void rageam::Tracer::ThreadBuffer::Free()
+{
+	FreeChunks(FirstChunk, Strings);
+	FirstChunk = nullptr;
+	LastChunk = nullptr;
+	Strings = nullptr;
+}
+
+void rageam::Tracer::ThreadBuffer::Retire()
+{
+	if (LastChunk)
+	{
+		LastChunk->Next = sm_RetiredEvents;
+		sm_RetiredEvents = FirstChunk;
+	}
+	if (Strings)
+	{
+		StringChunk* lastStrings = Strings;
+		while (lastStrings->Next)
+			lastStrings = lastStrings->Next;
+		lastStrings->Next = sm_RetiredStrings;
+		sm_RetiredStrings = Strings;
+	}
+	FirstChunk = nullptr;
+	LastChunk = nullptr;
+	Strings = nullptr;
+}
+
+void rageam::Tracer::FreeChunks(EventChunk* events, StringChunk* strings)
+{
+	while (events)
+	{
+		EventChunk* next = events->Next;
+		delete events;
+		events = next;
+	}
+
+	while (strings)
+	{
+		StringChunk* next = strings->Next;
+		delete strings;
+		strings = next;
+	}
+}
+
+rageam::Tracer::ThreadBuffer* rageam::Tracer::GetThreadBuffer()
+{
+	if (t_BufferOwner.Buffer)
+		return t_BufferOwner.Buffer;
+
+	ThreadBuffer* buffer = new ThreadBuffer();
+	buffer->ThreadID = GetCurrentThreadId();
+	sprintf_s(buffer->Name, sizeof(buffer->Name), "Thread %u", buffer->ThreadID);
+	{
+		std::unique_lock lock(sm_RegistryMutex);
+		buffer->Next = sm_Buffers;
+		sm_Buffers = buffer;
+	}
+	t_BufferOwner.Buffer = buffer;
+	return buffer;
+}
+
+rageam::Tracer::ThreadBuffer* rageam::Tracer::GetCaptureBuffer(u32 epoch)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	if (buffer->Epoch.load(std::memory_order_relaxed) != epoch)
+	{
+		std::unique_lock lock(sm_RegistryMutex);
+		buffer->Retire();
+		buffer->Epoch.store(epoch, std::memory_order_release);
+	}
+	return buffer;
+}
+
+void rageam::Tracer::PushEvent(const TraceEvent& event, u32 epoch)
+{
+	if (epoch == 0 || epoch != GetCaptureEpoch())
+		return;
+
+	ThreadBuffer* buffer = GetCaptureBuffer(epoch);
+	EventChunk* chunk = buffer->LastChunk;
+	u32 count = chunk ? chunk->Count.load(std::memory_order_relaxed) : 0;
+	if (!chunk || count == CHUNK_EVENT_COUNT)
+	{
+		if (sm_ChunkCount.fetch_add(1) >= MAX_CHUNKS)
+		{
+			--sm_ChunkCount;
+			++sm_DroppedCount;
+			return;
+		}
+
+		EventChunk* newChunk = new EventChunk();
+		if (chunk)
+			chunk->Next.store(newChunk, std::memory_order_release);
+		else
+			buffer->FirstChunk.store(newChunk, std::memory_order_release);
+		buffer->LastChunk = newChunk;
+		chunk = newChunk;
+		count = 0;
+	}
+
+	chunk->Events[count] = event;
+	chunk->Count.store(count + 1, std::memory_order_release);
+}
+
+void rageam::Tracer::ReleaseThreadBuffer(ThreadBuffer* buffer)
+{
+	std::unique_lock lock(sm_RegistryMutex);
+	buffer->Alive = false;
+}
+
+void rageam::Tracer::BeginCapture()
+{
+	std::unique_lock captureLock(sm_CaptureMutex);
+	if (IsCapturing())
+		return;
+
+	// Buffers of alive threads are reset by owners themselves, see GetCaptureBuffer.
+	// Exited threads can't write anything, their buffers are freed right away
+	{
+		std::unique_lock lock(sm_RegistryMutex);
+		ThreadBuffer** link = &sm_Buffers;
+		while (*link)
+		{
+			ThreadBuffer* buffer = *link;
+			if (buffer->Alive)
+			{
+				link = &buffer->Next;
+				continue;
+			}
+			*link = buffer->Next;
+			buffer->Free();
+			delete buffer;
+		}
+	}
+
+	sm_ChunkCount = 0;
+	sm_DroppedCount = 0;
+	sm_CaptureStart = GetTimestamp();
+	sm_CaptureEnd = sm_CaptureStart;
+
+	// Start time must be set before scopes can see new epoch
+	u32 epoch = sm_Epoch + 1;
+	if (epoch == 0) epoch = 1; // Reserved for stopped capture
+	sm_Epoch = epoch;
+	sm_ActiveEpoch.store(epoch, std::memory_order_release);
+}
+
+void rageam::Tracer::EndCapture()
+{
+	std::unique_lock captureLock(sm_CaptureMutex);
+	if (!IsCapturing())
+		return;
+
+	sm_ActiveEpoch = 0;
+	sm_CaptureEnd = GetTimestamp();
+
+	// Chunks were retired by owners during this capture, they're not written anymore
+	{
+		std::unique_lock lock(sm_RegistryMutex);
+		FreeChunks(sm_RetiredEvents, sm_RetiredStrings);
+		sm_RetiredEvents = nullptr;
+		sm_RetiredStrings = nullptr;
+	}
+
+	if (sm_DroppedCount > 0)
+		AM_WARNINGF("Tracer::EndCapture() -> Capture memory limit reached, %llu event(s) were dropped.", sm_DroppedCount.load());
+}
+
+bool rageam::Tracer::ExportChromeJson(ConstWString path)
+{
+	std::unique_lock captureLock(sm_CaptureMutex);
+	if (IsCapturing())
+	{
+		AM_ERRF("Tracer::ExportChromeJson() -> Capture is still active.");
+		return false;
+	}
+
+	file::FSHandle fs = file::OpenFileStream(path, L"w");
+	if (!fs)
+	{
+		AM_ERRF(L"Tracer::ExportChromeJson() -> Failed to open '%ls' for writing.", path);
+		return false;
+	}
+
+	LARGE_INTEGER frequency;
+	QueryPerformanceFrequency(&frequency);
+	double ticksToUs = 1000000.0 / static_cast<double>(frequency.QuadPart);
+	u32 pid = GetCurrentProcessId();
+
+	fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", fs.Get());
+	fprintf(fs.Get(), "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%u,\"args\":{\"name\":\"rageAm\"}}", pid);
+
+	std::unique_lock lock(sm_RegistryMutex);
+	u32 eventCount = 0;
+	for (ThreadBuffer* buffer = sm_Buffers; buffer; buffer = buffer->Next)
+	{
+		// Thread didn't write anything since previous capture
+		EventChunk* firstChunk = buffer->FirstChunk.load(std::memory_order_acquire);
+		if (!firstChunk || buffer->Epoch.load(std::memory_order_acquire) != sm_Epoch)
+			continue;
+
+		fprintf(fs.Get(), ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%u,\"tid\":%u,\"args\":{\"name\":", pid, buffer->ThreadID);
+		file::WriteJsonString(fs.Get(), buffer->Name);
+		fputs("}}", fs.Get());
+
+		for (EventChunk* chunk = firstChunk; chunk; chunk = chunk->Next.load(std::memory_order_acquire))
+		{
+			u32 count = chunk->Count.load(std::memory_order_acquire);
+			for (u32 i = 0; i < count; i++)
+			{
+				const TraceEvent& event = chunk->Events[i];
+				// Scope added with explicit start time may begin before capture
+				u64 start = event.Start > sm_CaptureStart ? event.Start - sm_CaptureStart : 0;
+				double ts = static_cast<double>(start) * ticksToUs;
+
+				fputs(",\n{\"name\":", fs.Get());
+				file::WriteJsonString(fs.Get(), event.Name);
+				fprintf(fs.Get(), ",\"cat\":\"am\",\"pid\":%u,\"tid\":%u,\"ts\":%.3f", pid, buffer->ThreadID, ts);
+				switch (event.Type)
+				{
+				case TraceEvent_Scope:
+					fprintf(fs.Get(), ",\"ph\":\"X\",\"dur\":%.3f", static_cast<double>(event.Duration) * ticksToUs);
+					if (event.Detail)
+					{
+						fputs(",\"args\":{\"detail\":", fs.Get());
+						file::WriteJsonString(fs.Get(), event.Detail);
+						fputc('}', fs.Get());
+					}
+					break;
+				case TraceEvent_Instant:
+					fputs(",\"ph\":\"i\",\"s\":\"t\"", fs.Get());
+					break;
+				case TraceEvent_Counter:
+					fprintf(fs.Get(), ",\"ph\":\"C\",\"args\":{\"value\":%g}", event.Value);
+					break;
+				case TraceEvent_FlowBegin:
+					fprintf(fs.Get(), ",\"ph\":\"s\",\"id\":%llu", event.FlowID);
+					break;
+				case TraceEvent_FlowEnd:
+					// Binds to the enclosing scope, not to the next one
+					fprintf(fs.Get(), ",\"ph\":\"f\",\"bp\":\"e\",\"id\":%llu", event.FlowID);
+					break;
+				}
+				fputc('}', fs.Get());
+				eventCount++;
+			}
+		}
+	}
+
+	fputs("\n]}\n", fs.Get());
+
+	double duration = static_cast<double>(sm_CaptureEnd - sm_CaptureStart) * ticksToUs / 1000.0;
+	AM_TRACEF(L"Tracer::ExportChromeJson() -> Written %u events (%.2f ms) to '%ls'", eventCount, duration, path);
+	return true;
+}
+
+u64 rageam::Tracer::GetTimestamp()
+{
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
+	return counter.QuadPart;
+}
+
+ConstString rageam::Tracer::CopyString(ConstString str)
+{
+	u32 epoch = GetCaptureEpoch();
+	if (epoch == 0 || !str)
+		return nullptr;
+
+	u32 size = static_cast<u32>(strlen(str)) + 1;
+	if (size > STRING_CHUNK_SIZE)
+		size = STRING_CHUNK_SIZE;
+
+	ThreadBuffer* buffer = GetCaptureBuffer(epoch);
+	StringChunk* chunk = buffer->Strings;
+	if (!chunk || chunk->Used + size > STRING_CHUNK_SIZE)
+	{
+		chunk = new StringChunk();
+		chunk->Next = buffer->Strings;
+		buffer->Strings = chunk;
+	}
+
+	char* copy = chunk->Data + chunk->Used;
+	memcpy(copy, str, size - 1);
+	copy[size - 1] = '\0';
+	chunk->Used += size;
+	return copy;
+}
+
+ConstString rageam::Tracer::CopyString(ConstWString str)
+{
+	if (!IsCapturing() || !str)
+		return nullptr;
+
+	return CopyString(String::ToUtf8Temp(str));
+}
+
+void rageam::Tracer::AddScope(ConstString name, ConstString detail, u64 start, u64 end)
+{
+	AddScope(name, detail, start, end, GetCaptureEpoch());
+}
+
+void rageam::Tracer::AddScope(ConstString name, ConstString detail, u64 start, u64 end, u32 epoch)
+{
+	TraceEvent event;
+	event.Start = start;
+	event.Duration = end - start;
+	event.Name = name;
+	event.Detail = detail;
+	event.Type = TraceEvent_Scope;
+	PushEvent(event, epoch);
+}
+
+void rageam::Tracer::AddInstant(ConstString name)
+{
+	TraceEvent event;
+	event.Start = GetTimestamp();
+	event.Duration = 0;
+	event.Name = name;
+	event.Detail = nullptr;
+	event.Type = TraceEvent_Instant;
+	PushEvent(event, GetCaptureEpoch());
+}
+
+void rageam::Tracer::AddCounter(ConstString name, double value)
+{
+	TraceEvent event;
+	event.Start = GetTimestamp();
+	event.Duration = 0;
+	event.Name = name;
+	event.Value = value;
+	event.Type = TraceEvent_Counter;
+	PushEvent(event, GetCaptureEpoch());
+}
+
+void rageam::Tracer::AddFlow(ConstString name, u64 id, bool begin)
+{
+	TraceEvent event;
+	event.Start = GetTimestamp();
+	event.Duration = 0;
+	event.Name = name;
+	event.FlowID = id;
+	event.Type = begin ? TraceEvent_FlowBegin : TraceEvent_FlowEnd;
+	PushEvent(event, GetCaptureEpoch());
+}
+
+void rageam::Tracer::SetThreadName(ConstString name)
+{
+	ThreadBuffer* buffer = GetThreadBuffer();
+	strncpy_s(buffer->Name, sizeof(buffer->Name), name, _TRUNCATE);
+}
+
+u32 rageam::Tracer::GetEventCount()
+{
+	std::unique_lock lock(sm_RegistryMutex);
+	u32 count = 0;
+	for (ThreadBuffer* buffer = sm_Buffers; buffer; buffer = buffer->Next)
+	{
+		if (buffer->Epoch.load(std::memory_order_acquire) != sm_Epoch)
+			continue;
+
+		for (EventChunk* chunk = buffer->FirstChunk.load(std::memory_order_acquire); chunk; chunk = chunk->Next.load(std::memory_order_acquire))
+			count += chunk->Count.load(std::memory_order_acquire);
+	}
+	return count;
+}
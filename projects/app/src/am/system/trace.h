@@ -0,0 +1,194 @@
+//
+// File: trace.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "common/types.h"
+#include "helpers/macro.h"
+
+#include <atomic>
+#include <mutex>
+#include <easy/profiler.h>
+
+namespace rageam
+{
+	enum eTraceEventType : u8
+	{
+		TraceEvent_Scope,		// Slice with duration
+		TraceEvent_Instant,
+		TraceEvent_Counter,
+		TraceEvent_FlowBegin,	// Arrow from enclosing scope to the scope where flow with the same ID ends
+		TraceEvent_FlowEnd,
+	};
+
+	struct TraceEvent
+	{
+		u64			Start;		// Performance counter ticks
+		u64			Duration;
+		ConstString	Name;		// Must be string literal, only pointer is stored
+		union
+		{
+			ConstString	Detail;	// Copy in thread string storage, may be null
+			double		Value;
+			u64			FlowID;
+		};
+		eTraceEventType Type;
+	};
+
+	/**
+	 * \brief Hierarchical tracer, events are recorded only while capture is active and exported to Chrome trace JSON
+	 * (chrome://tracing or ui.perfetto.dev).
+	 * \n Every thread appends events to its own chunked buffer without any locking, scopes are recorded as single
+	 * complete event when they end. Capture memory is limited to MAX_CHUNKS, events past that are dropped.
+	 * \n Every capture has own epoch, events and scopes are stamped with epoch they were started in and dropped if capture
+	 * was restarted since then. Buffer is only ever reset by its owner thread, when it writes first event of the new capture.
+	 * \remarks Use AM_TRACE_### macros, they compile to nothing unless built with AM_TRACING.
+	 * Export must not be called while capture is active.
+	 */
+	class Tracer
+	{
+		static constexpr u32 CHUNK_EVENT_COUNT = 8192;
+		static constexpr u32 STRING_CHUNK_SIZE = 64 * 1024;
+		static constexpr u32 MAX_CHUNKS = 256; // 80MB of events
+
+		struct EventChunk
+		{
+			TraceEvent				 Events[CHUNK_EVENT_COUNT];
+			std::atomic<u32>		 Count = 0;
+			std::atomic<EventChunk*> Next = nullptr;
+		};
+
+		struct StringChunk
+		{
+			char		 Data[STRING_CHUNK_SIZE];
+			u32			 Used = 0;
+			StringChunk* Next = nullptr;
+		};
+
+		// Only owner thread writes events. When owner sees that capture was restarted, it moves chunks of the previous one
+		// to retired list, they are freed on the next EndCapture. Other threads may still read them until then
+		struct ThreadBuffer
+		{
+			u32							ThreadID = 0;
+			char						Name[64] = {};
+			std::atomic<EventChunk*>	FirstChunk = nullptr;
+			EventChunk*					LastChunk = nullptr;
+			StringChunk*				Strings = nullptr;
+			std::atomic<u32>			Epoch = 0;		// Capture that chunks belong to
+			bool						Alive = true;	// Buffers of exited threads are kept until next capture
+			ThreadBuffer*				Next = nullptr;
+
+			void Free();
+			// Must be called with registry mutex locked
+			void Retire();
+		};
+
+		static inline std::atomic<u32>	sm_ActiveEpoch = 0;		// Epoch of active capture, 0 if capture is stopped
+		static inline std::atomic<u32>	sm_Epoch = 0;			// Epoch of the last started capture, it is exported
+		static inline std::atomic<u32>	sm_ChunkCount = 0;		// Allocated in the last started capture
+		static inline std::atomic<u64>	sm_DroppedCount = 0;
+		static inline u64				sm_CaptureStart = 0;
+		static inline u64				sm_CaptureEnd = 0;
+		static inline ThreadBuffer*		sm_Buffers = nullptr;	// Guarded by registry mutex
+		static inline EventChunk*		sm_RetiredEvents = nullptr;
+		static inline StringChunk*		sm_RetiredStrings = nullptr;
+		static std::mutex				sm_RegistryMutex;
+		static std::mutex				sm_CaptureMutex;		// Serializes begin, end and export
+
+		static void FreeChunks(EventChunk* events, StringChunk* strings);
+		static ThreadBuffer* GetThreadBuffer();
+		// Thread buffer with chunks of previous capture retired
+		static ThreadBuffer* GetCaptureBuffer(u32 epoch);
+		// Event is dropped if capture was stopped or restarted since epoch, or out of memory
+		static void PushEvent(const TraceEvent& event, u32 epoch);
+		static void ReleaseThreadBuffer(ThreadBuffer* buffer);
+		friend struct TraceThreadBufferOwner;
+
+	public:
+		static void BeginCapture();
+		static void EndCapture();
+		static bool IsCapturing() { return sm_ActiveEpoch.load(std::memory_order_relaxed) != 0; }
+		// Epoch of active capture, 0 if capture is stopped
+		static u32 GetCaptureEpoch() { return sm_ActiveEpoch.load(std::memory_order_acquire); }
+
+		// Writes last capture in Chrome trace event format
+		static bool ExportChromeJson(ConstWString path);
+
+		static u64 GetTimestamp();
+		// Copies string to thread storage so it can be used as event detail, returns null if capture is not active
+		static ConstString CopyString(ConstString str);
+		static ConstString CopyString(ConstWString str);
+
+		static void AddScope(ConstString name, ConstString detail, u64 start, u64 end);
+		// Scope is dropped if capture was restarted since given epoch, detail and start time belong to previous capture then
+		static void AddScope(ConstString name, ConstString detail, u64 start, u64 end, u32 epoch);
+		static void AddInstant(ConstString name);
+		static void AddCounter(ConstString name, double value);
+		static void AddFlow(ConstString name, u64 id, bool begin);
+		// Name shown in exported trace, copied
+		static void SetThreadName(ConstString name);
+
+		static u64 GetDroppedCount() { return sm_DroppedCount; }
+		static u32 GetEventCount();
+	};
+
+	/**
+	 * \brief Records scope from construction to destruction, if capture was active when scope started.
+	 */
+	class TraceScope
+	{
+		ConstString	m_Name;
+		ConstString	m_Detail = nullptr;
+		u64			m_Start = 0;
+		u32			m_Epoch;	// 0 if capture was not active
+
+	public:
+		TraceScope(ConstString name) : m_Name(name)
+		{
+			m_Epoch = Tracer::GetCaptureEpoch();
+			if (m_Epoch) m_Start = Tracer::GetTimestamp();
+		}
+
+		template<typename TChar>
+		TraceScope(ConstString name, const TChar* detail) : TraceScope(name)
+		{
+			if (m_Epoch) m_Detail = Tracer::CopyString(detail);
+		}
+
+		~TraceScope()
+		{
+			if (m_Epoch) Tracer::AddScope(m_Name, m_Detail, m_Start, Tracer::GetTimestamp(), m_Epoch);
+		}
+
+		TraceScope(const TraceScope&) = delete;
+		TraceScope& operator=(const TraceScope&) = delete;
+	};
+}
+
+#define AM_TRACE_CONCAT_IMPL(a, b) a##b
+#define AM_TRACE_CONCAT(a, b) AM_TRACE_CONCAT_IMPL(a, b)
+
+// Scopes are forwarded to EasyProfiler too, its macros are empty unless built with it
+#ifdef AM_TRACING
+#define AM_TRACE_SCOPE(name)				EASY_BLOCK(name); rageam::TraceScope AM_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define AM_TRACE_SCOPE_DETAIL(name, detail)	EASY_BLOCK(name); rageam::TraceScope AM_TRACE_CONCAT(traceScope_, __LINE__)(name, detail)
+#define AM_TRACE_FUNCTION()					EASY_FUNCTION(); rageam::TraceScope AM_TRACE_CONCAT(traceScope_, __LINE__)(__FUNCTION__)
+#define AM_TRACE_EVENT(name)				EASY_EVENT(name); rageam::Tracer::AddInstant(name)
+#define AM_TRACE_COUNTER(name, value)		rageam::Tracer::AddCounter(name, static_cast<double>(value))
+#define AM_TRACE_FLOW_BEGIN(name, id)		rageam::Tracer::AddFlow(name, id, true)
+#define AM_TRACE_FLOW_END(name, id)			rageam::Tracer::AddFlow(name, id, false)
+#define AM_TRACE_THREAD(name)				EASY_THREAD(name); rageam::Tracer::SetThreadName(name)
+#else
+#define AM_TRACE_SCOPE(name)				EASY_BLOCK(name); MACRO_END
+#define AM_TRACE_SCOPE_DETAIL(name, detail)	EASY_BLOCK(name); MACRO_END
+#define AM_TRACE_FUNCTION()					EASY_FUNCTION(); MACRO_END
+#define AM_TRACE_EVENT(name)				EASY_EVENT(name); MACRO_END
+#define AM_TRACE_COUNTER(name, value)		MACRO_END
+#define AM_TRACE_FLOW_BEGIN(name, id)		MACRO_END
+#define AM_TRACE_FLOW_END(name, id)			MACRO_END
+#define AM_TRACE_THREAD(name)				EASY_THREAD(name); MACRO_END
+#endif
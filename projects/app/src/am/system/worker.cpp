@@ -1,117 +1,117 @@
 #include "worker.h"
 #include "am/system/timer.h"
+#include "am/system/trace.h"
+#include "helpers/ranges.h"
 
 #include <utility>
-#include <easy/profiler.h>
 
 thread_local rage::atFixedArray<rageam::BackgroundWorker*, 8> rageam::BackgroundWorker::sm_Stack;
 
-DWORD rageam::BackgroundWorker::ThreadProc(LPVOID lpParam)
+void rageam::BackgroundTask::Wait() const
 {
-	ThreadProcArg*     arg = static_cast<ThreadProcArg*>(lpParam);
-	BackgroundWorker*  worker = arg->Instance;
-	int				   workerID = arg->WorkerID;
-	delete arg;
-	arg = nullptr;
+	if (m_Group)
+		m_Group->Wait();
+}
 
+void rageam::BackgroundWorker::OnThreadStart(u32 workerIndex) const
+{
 	// Add thread name so it can be seen in debugger
-	{
-		wchar_t nameBuffer[64];
-		swprintf_s(nameBuffer, 64, L"[RAGEAM] Worker %hs [%i]", worker->m_Name, workerID);
-		(void) SetThreadDescription(GetCurrentThread(), nameBuffer);
+	wchar_t nameBuffer[64];
+	swprintf_s(nameBuffer, 64, L"[RAGEAM] Worker %hs [%u]", m_Name, workerIndex);
+	(void) SetThreadDescription(GetCurrentThread(), nameBuffer);
 
-		EASY_THREAD(String::ToAnsiTemp(nameBuffer));
-	}
+	AM_TRACE_THREAD(String::ToAnsiTemp(nameBuffer));
+}
 
-	while (!worker->m_WeAreClosing)
+void rageam::BackgroundWorker::ExecuteTask(BackgroundTask& task, const TLambda& lambda, ConstWString name, u64 taskID) const
+{
+	AM_TRACE_SCOPE_DETAIL("BackgroundWorker::ExecuteTask", name);
+	AM_TRACE_FLOW_END("BackgroundWorker::Task", taskID);
+
+	if (task.m_Token.IsCancelled())
 	{
-		// Wait for the next job
-		amUPtr<BackgroundJob> job;
-		{
-			std::unique_lock lock(worker->m_Mutex);
-			worker->m_Condition.wait(lock, [&]
-				{
-					return worker->m_Jobs.Any() || worker->m_WeAreClosing;
-				});
-
-			if (worker->m_WeAreClosing)
-				break;
-
-			job = std::move(worker->m_Jobs.First());
-			worker->m_Jobs.RemoveAt(0);
-		}
-
-		Timer timer = Timer::StartNew();
-		auto& task = job->GetTask();
-		task->m_WorkerID = workerID;
-		task->m_State = TASK_STATE_RUNNING;
-		bool success = job->GetLambda()();
-		task->m_Result = std::move(tl_Result);
-		task->m_State = success ? TASK_STATE_SUCCESS : TASK_STATE_FAILED;
-		timer.Stop();
-
-		wchar_t buffer[256];
-		if (String::IsNullOrEmpty(job->GetName()))
-			swprintf_s(buffer, 256, L"%hs, %llu ms", success ? "OK" : "FAIL", timer.GetElapsedMilliseconds());
-		else
-			swprintf_s(buffer, 256, L"[%ls] %hs, %llu ms", job->GetName(), success ? "OK" : "FAIL", timer.GetElapsedMilliseconds());
+		task.m_State = TASK_STATE_CANCELLED;
+		return;
+	}
+
+	// Waiting worker may execute nested task in the middle of another one, save state of the outer task
+	std::any                 outerResult = std::move(tl_Result);
+	const CancellationToken* outerToken = tl_Token;
+	tl_Result.reset();
+	tl_Token = &task.m_Token;
+
+	Timer timer = Timer::StartNew();
+	task.m_State = TASK_STATE_RUNNING;
+	bool success = lambda();
+	task.m_Result = std::move(tl_Result);
+	task.m_State = success ? TASK_STATE_SUCCESS : TASK_STATE_FAILED;
+	timer.Stop();
+
+	tl_Result = std::move(outerResult);
+	tl_Token = outerToken;
+
+	wchar_t buffer[256];
+	if (String::IsNullOrEmpty(name))
+		swprintf_s(buffer, 256, L"%hs, %llu ms", success ? "OK" : "FAIL", timer.GetElapsedMilliseconds());
+	else
+		swprintf_s(buffer, 256, L"[%ls] %hs, %llu ms", name, success ? "OK" : "FAIL", timer.GetElapsedMilliseconds());
 
 #ifdef WORKER_ENABLE_LOGGING
-		 AM_TRACEF(L"[W: %hs] wID:%i, %s", worker->m_Name, workerID, buffer);
+	AM_TRACEF(L"[W: %hs] %s", m_Name, buffer);
 #endif
 
-		 if (worker->TaskCallback)
-		 	worker->TaskCallback(buffer);
-	}
-	return 0;
+	if (TaskCallback)
+		TaskCallback(buffer);
 }
 
-amPtr<rageam::BackgroundTask> rageam::BackgroundWorker::RunVA(const TLambda& lambda, ConstWString fmt, va_list args)
+amPtr<rageam::BackgroundTask> rageam::BackgroundWorker::RunVA(
+	const TLambda& lambda, eTaskPriority priority, const CancellationToken& token, ConstWString fmt, va_list args)
 {
-	std::unique_lock lock(m_Mutex);
-
 	amPtr<BackgroundTask> task = std::make_shared<BackgroundTask>();
 	task->m_State = TASK_STATE_PENDING;
+	task->m_Group = std::make_unique<TaskGroup>(m_Scheduler.get(), priority);
+	task->m_Token = token;
 
 	wchar_t buffer[256];
 	vswprintf_s(buffer, 256, fmt, args);
 
-	m_Jobs.Construct(new BackgroundJob(task, lambda, buffer));
+	u64 taskID = sm_NextTaskID++;
+	AM_TRACE_FLOW_BEGIN("BackgroundWorker::Task", taskID);
+	++m_PendingTaskCount;
+	AM_TRACE_COUNTER("BackgroundWorker::PendingTasks", m_PendingTaskCount.load());
+
+	task->m_Group->Run([this, task, lambda, name = std::wstring(buffer), taskID]
+		{
+			--m_PendingTaskCount;
+			AM_TRACE_COUNTER("BackgroundWorker::PendingTasks", m_PendingTaskCount.load());
+			ExecuteTask(*task, lambda, name.c_str(), taskID);
+		});
 
-	m_Condition.notify_one();
 	return task;
 }
 
 rageam::BackgroundWorker::BackgroundWorker(ConstString name, int threadCount)
 {
+	if (threadCount <= 0)
+		threadCount = static_cast<int>(std::thread::hardware_concurrency());
+
 	m_Name = name;
-	m_ThreadPool.Resize(threadCount);
-	for (u64 i = 0; i < threadCount; i++)
-	{
-		ThreadProcArg* arg = new ThreadProcArg(this, i);
-		HANDLE thread = CreateThread(NULL, 0, ThreadProc, arg, 0, NULL);
-		AM_ASSERT(thread, "BackgroundWorker::Init() -> Failed to create thread, last error: %x", GetLastError());
-		m_ThreadPool[i] = thread;
-	}
+	m_Scheduler = std::make_unique<TaskScheduler>(threadCount, [this](u32 workerIndex)
+		{
+			OnThreadStart(workerIndex);
+		});
 }
 
 rageam::BackgroundWorker::~BackgroundWorker()
 {
-	m_WeAreClosing = true;
-	m_Condition.notify_all();
-
-	for (HANDLE thread : m_ThreadPool)
-	{
-		WaitForSingleObject(thread, INFINITE);
-		CloseHandle(thread);
-	}
+	m_Scheduler = nullptr;
 }
 
 amPtr<rageam::BackgroundTask> rageam::BackgroundWorker::Run(const TLambda& lambda, ConstString fmt, ...)
 {
 	va_list args;
 	va_start(args, fmt);
-	amPtr<BackgroundTask> result = GetInstance()->RunVA(lambda, String::ToWideTemp(fmt), args);
+	amPtr<BackgroundTask> result = GetInstance()->RunVA(lambda, TaskPriority_Normal, {}, String::ToWideTemp(fmt), args);
 	va_end(args);
 	return result;
 }
@@ -120,7 +120,7 @@ amPtr<rageam::BackgroundTask> rageam::BackgroundWorker::Run(const TLambda& lambd
 {
 	va_list args;
 	va_start(args, fmt);
-	amPtr<BackgroundTask> result = GetInstance()->RunVA(lambda, fmt, args);
+	amPtr<BackgroundTask> result = GetInstance()->RunVA(lambda, TaskPriority_Normal, {}, fmt, args);
 	va_end(args);
 	return result;
 }
@@ -130,6 +130,22 @@ amPtr<rageam::BackgroundTask> rageam::BackgroundWorker::Run(const TLambda& lambd
 	return Run(lambda, L"");
 }
 
+amPtr<rageam::BackgroundTask> rageam::BackgroundWorker::RunWithPriority(
+	const TLambda& lambda, eTaskPriority priority, const CancellationToken& token, ConstWString fmt, ...)
+{
+	va_list args;
+	va_start(args, fmt);
+	amPtr<BackgroundTask> result = GetInstance()->RunVA(lambda, priority, token, fmt, args);
+	va_end(args);
+	return result;
+}
+
+amPtr<rageam::BackgroundTask> rageam::BackgroundWorker::RunWithPriority(
+	const TLambda& lambda, eTaskPriority priority, const CancellationToken& token)
+{
+	return RunWithPriority(lambda, priority, token, L"");
+}
+
 bool rageam::BackgroundWorker::WaitFor(const Tasks& tasks)
 {
 	bool success = true;
@@ -141,3 +157,18 @@ bool rageam::BackgroundWorker::WaitFor(const Tasks& tasks)
 	}
 	return success;
 }
+
+void rageam::BackgroundWorker::ParallelFor(u32 count, const std::function<void(u32 index)>& fn, eTaskPriority priority)
+{
+	AM_TRACE_SCOPE("BackgroundWorker::ParallelFor");
+
+	// Main worker is not created (for e.g. in unit tests)
+	if (!sm_MainInstance)
+	{
+		for (u32 i = 0; i < count; i++)
+			fn(i);
+		return;
+	}
+
+	GetInstance()->m_Scheduler->ParallelFor(count, fn, priority);
+}
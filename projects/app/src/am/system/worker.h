@@ -9,10 +9,10 @@
 
 #include "am/string/string.h"
 #include "am/system/ptr.h"
+#include "am/system/scheduler.h"
 #include "am/types.h"
 
 #include <functional>
-#include <mutex>
 #include <Windows.h>
 #include <any>
 
@@ -26,6 +26,7 @@ namespace rageam
 		TASK_STATE_RUNNING,
 		TASK_STATE_SUCCESS,
 		TASK_STATE_FAILED,
+		TASK_STATE_CANCELLED,	// Token was cancelled before task started
 	};
 
 	/**
@@ -40,14 +41,21 @@ namespace rageam
 		std::any m_Result;
 		// For debugging
 		int m_WorkerID = -1;
+		// Group of this single task, waiting thread executes the task itself if it didn't start yet
+		amUPtr<TaskGroup> m_Group;
+		CancellationToken m_Token;
 
 	public:
 		eBackgroundTaskState GetState() const { return m_State; }
 
-		bool IsSuccess()  const { return m_State == TASK_STATE_SUCCESS; }
-		bool IsFinished() const { return m_State == TASK_STATE_SUCCESS || m_State == TASK_STATE_FAILED; }
+		bool IsSuccess()   const { return m_State == TASK_STATE_SUCCESS; }
+		bool IsCancelled() const { return m_State == TASK_STATE_CANCELLED; }
+		bool IsFinished()  const { return m_State == TASK_STATE_SUCCESS || m_State == TASK_STATE_FAILED || m_State == TASK_STATE_CANCELLED; }
 
-		void Wait() const { while (!IsFinished()) { /* ... */ } }
+		// Executes the task on calling thread if no worker took it yet, so it is safe to wait for nested task from worker thread
+		void Wait() const;
+		// Task that didn't start yet won't be executed, running task can check BackgroundWorker::IsCancellationRequested
+		void Cancel() const { m_Token.Cancel(); }
 
 		// This value can be safely accessed if IsSuccess returns True.
 		template<typename T>
@@ -65,72 +73,58 @@ namespace rageam
 	using Tasks = List<BackgroundTaskPtr>;
 
 	/**
-	 * \brief Dispatcher of long-running background tasks.
+	 * \brief Dispatcher of long-running background tasks, built on top of work-stealing TaskScheduler.
 	 */
 	class BackgroundWorker
 	{
 		using TLambda = std::function<bool()>;
 
-		class BackgroundJob
-		{
-			static constexpr u32 TASK_NAME_MAX = 256;
-
-			amPtr<BackgroundTask> m_Task;
-			TLambda               m_Lambda;
-			wchar_t               m_Name[TASK_NAME_MAX];
-
-		public:
-			BackgroundJob(amPtr<BackgroundTask> task, TLambda lambda, ConstWString name)
-				: m_Task(std::move(task)), m_Lambda(std::move(lambda))
-			{
-				String::Copy(m_Name, TASK_NAME_MAX, name);
-			}
-
-			amPtr<BackgroundTask>& GetTask() { return m_Task; }
-			TLambda&               GetLambda() { return m_Lambda; }
-			ConstWString           GetName() const { return m_Name; }
-		};
-
-		struct ThreadProcArg
-		{
-			BackgroundWorker* Instance;
-			int				  WorkerID;
-		};
-
-		ConstString					m_Name;
-		List<HANDLE>                m_ThreadPool;
-		List<amUPtr<BackgroundJob>> m_Jobs;
-		std::mutex                  m_Mutex;
-		std::condition_variable     m_Condition;
-		std::atomic_bool			m_WeAreClosing = false;
+		ConstString				 m_Name;
+		amUPtr<TaskScheduler>	 m_Scheduler;
+		std::atomic<u32>		 m_PendingTaskCount = 0;
 
 		static thread_local rage::atFixedArray<BackgroundWorker*, 8> sm_Stack;
 		static inline thread_local std::any tl_Result; // Per-worker unique result value, set from lambda function
+		static inline thread_local const CancellationToken* tl_Token = nullptr; // Token of task that is currently executed
 		static inline BackgroundWorker* sm_MainInstance = nullptr;
+		static inline std::atomic<u64> sm_NextTaskID = 1; // Links submitter and worker in trace
 
-		static DWORD ThreadProc(LPVOID lpParam);
-		amPtr<BackgroundTask> RunVA(const TLambda& lambda, ConstWString fmt, va_list args);
+		void OnThreadStart(u32 workerIndex) const;
+		void ExecuteTask(BackgroundTask& task, const TLambda& lambda, ConstWString name, u64 taskID) const;
+		amPtr<BackgroundTask> RunVA(const TLambda& lambda, eTaskPriority priority, const CancellationToken& token, ConstWString fmt, va_list args);
 
 	public:
-		BackgroundWorker(ConstString name, int threadCount);
+		// Thread count of 0 uses all hardware threads
+		BackgroundWorker(ConstString name, int threadCount = 0);
 		~BackgroundWorker();
 
 		WPRINTF_ATTR(2, 3) static amPtr<BackgroundTask> Run(const TLambda& lambda, ConstString  fmt, ...);
 		PRINTF_ATTR(2, 3)  static amPtr<BackgroundTask> Run(const TLambda& lambda, ConstWString fmt, ...);
 		static amPtr<BackgroundTask>                    Run(const TLambda& lambda);
+		// Tasks with higher priority are taken first by free threads, lambda is not invoked if token is cancelled before task started
+		PRINTF_ATTR(4, 5)  static amPtr<BackgroundTask> RunWithPriority(const TLambda& lambda, eTaskPriority priority, const CancellationToken& token, ConstWString fmt, ...);
+		static amPtr<BackgroundTask>                    RunWithPriority(const TLambda& lambda, eTaskPriority priority, const CancellationToken& token = {});
 
 		/**
-		 * \brief Pauses current thread until given list of tasks ran to completion state (either TASK_STATE_SUCCESS or TASK_STATE_FAILED).
-		 * \return True if all tasks were finished with TASK_STATE_SUCCESS or False if either of the tasks was finished with TASK_STATE_FAILED.
+		 * \brief Pauses current thread until given list of tasks ran to completion state (either TASK_STATE_SUCCESS, TASK_STATE_FAILED or TASK_STATE_CANCELLED).
+		 * Tasks that didn't start yet are executed on calling thread, so it can be called from worker thread.
+		 * \return True if all tasks were finished with TASK_STATE_SUCCESS or False if either of the tasks was failed or cancelled.
 		 */
 		static bool WaitFor(const Tasks& tasks);
 
+		// Invokes function for every index in [0, count) on worker threads, calling thread participates too
+		static void ParallelFor(u32 count, const std::function<void(u32 index)>& fn, eTaskPriority priority = TaskPriority_Normal);
+
 		// Call it from lambda function to set BackgroundTask::GetResult, must be allocated via operator new
 		template<typename T>
 		static void SetCurrentResult(T& object) { tl_Result = std::move(object); }
+		// Call it from lambda function to stop long operation early after BackgroundTask::Cancel
+		static bool IsCancellationRequested() { return tl_Token && tl_Token->IsCancelled(); }
 
 		std::function<void(const wchar_t*)> TaskCallback; // Used for UI status bar
 
+		TaskScheduler* GetScheduler() const { return m_Scheduler.get(); }
+
 		static void Push(BackgroundWorker* worker) { sm_Stack.Add(worker); }
 		static void Pop() { sm_Stack.RemoveLast(); }
 		static BackgroundWorker* GetInstance()
@@ -144,6 +138,7 @@ namespace rageam
 
 			return sm_Stack.Last();
 		}
+		static BackgroundWorker* GetMainInstance() { return sm_MainInstance; }
 		static void SetMainInstance(BackgroundWorker* worker) { sm_MainInstance = worker; }
 	};
 }
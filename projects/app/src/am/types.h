@@ -7,6 +7,7 @@
 #include "rage/atl/string.h"
 #include "rage/framework/nameregistrar.h"
 #include "rage/framework/pool.h"
+#include "system/flatset.h"
 #include "system/ptr.h"
 #include "rage/math/vec.h"
 #include "rage/math/vecv.h"
@@ -45,7 +46,7 @@ namespace rageam
 	template<typename TKey, typename TValue, typename THashFn = rage::atMapHashFn<TKey>>
 	using Dictionary = rage::fwNameRegistrar<TKey, TValue, THashFn>;
 
-	// Value set
+	// Value set, game-compatible; for tool-side sets that are not part of paged resources FlatSet is faster
 	template<typename TValue, typename THashFn = rage::atMapHashFn<TValue>>
 	using HashSet = rage::atMap<TValue, THashFn>;
 
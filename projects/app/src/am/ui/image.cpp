@@ -112,14 +112,15 @@ bool rageam::ui::ImImage::LoadInternal(const file::WPath& path, int maxResolutio
 
 void rageam::ui::ImImage::Load(const file::WPath& path, int maxResolution)
 {
-	m_LoadTask = BackgroundWorker::Run([=, this]
+	// Preview is visible to user right now, take it before batch work
+	m_LoadTask = BackgroundWorker::RunWithPriority([=, this]
 		{
 			m_IsLoading = true;
 			bool success = LoadInternal(path, maxResolution);
 			m_FailedToLoad = !success;
 			m_IsLoading = false;
 			return success;
-		}, L"UI Image %ls", path.GetCStr());
+		}, TaskPriority_High, {}, L"UI Image %ls", path.GetCStr());
 }
 
 void rageam::ui::ImImage::Set(const graphics::ImagePtr& image, int maxResolution)
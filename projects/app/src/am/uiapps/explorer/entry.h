@@ -158,7 +158,7 @@ namespace rageam::ui
 		List<u16> m_SortedIndexToEntry;
 
 		// u32 -> u32 map, can be used to store indices
-		HashSet<u32> m_UserData;
+		FlatSet<u32> m_UserData;
 
 		ExplorerEntryFlags m_Flags = ExplorerEntryFlags_None;
 
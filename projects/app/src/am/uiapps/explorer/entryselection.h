@@ -8,7 +8,7 @@
 #pragma once
 
 #include "entry.h"
-#include "rage/atl/map.h"
+#include "am/system/flatset.h"
 
 namespace rageam::ui
 {
@@ -19,7 +19,7 @@ namespace rageam::ui
 	{
 		using Entry = ExplorerEntryPtr;
 
-		HashSet<Entry, ExplorerEntryPtrHashFn> m_Selections;
+		FlatSet<Entry, ExplorerEntryPtrHashFn> m_Selections;
 	public:
 		EntrySelection() = default;
 		EntrySelection(const std::initializer_list<Entry>& list) : m_Selections(list) {}
@@ -28,7 +28,7 @@ namespace rageam::ui
 
 		void AllocateForDirectory(const Entry& entry)
 		{
-			m_Selections.Resize(entry->GetChildCount());
+			m_Selections.Reserve(entry->GetChildCount());
 		}
 
 		void ClearSelection()
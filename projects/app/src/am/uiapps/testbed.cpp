@@ -4,6 +4,8 @@
 #include "am/asset/ui/assetwindowfactory.h"
 #include "am/graphics/geomprimitives.h"
 #include "am/gizmo/gizmo.h"
+#include "am/graphics/image/bc.h"
+#include "am/graphics/image/bcrangefit.h"
 #include "am/graphics/image/imagecache.h"
 #include "am/integration/memory/hook.h"
 #include "am/ui/imglue.h"
@@ -16,12 +18,16 @@
 #include "am/integration/im3d.h"
 #include "am/integration/script/core.h"
 #include "am/system/datetime.h"
+#include "am/system/trace.h"
 #include "am/ui/extensions.h"
 #include "easy/profiler.h"
 #include "game/viewport.h"
 #include "rage/grcore/txd.h"
 #include "rage/paging/builder/builder.h"
 
+#include <rgbcx.h>
+#include <random>
+
 #ifdef AM_INTEGRATED
 #include "am/integration/ui/modelscene.h"
 #include "am/integration/ui/starbar.h"
@@ -107,6 +113,32 @@ void rageam::ui::TestbedApp::OnRender()
 		}
 	}
 #endif
+#ifdef AM_TRACING
+	if (ImGui::Button(Tracer::IsCapturing() ? "Stop Trace " : "Start Trace"))
+	{
+		if (!Tracer::IsCapturing())
+		{
+			Tracer::BeginCapture();
+			AM_TRACEF(L"Tracer: started capture...");
+		}
+		else
+		{
+			Tracer::EndCapture();
+
+			DateTime time = DateTime::Now();
+
+			char formattedTime[32];
+			time.Format(formattedTime, std::size(formattedTime), "yyyy-MM-dd_HH-mm-ss.json");
+
+			wchar_t traceName[128];
+			swprintf_s(traceName, std::size(traceName), L"trace_%hs", formattedTime);
+
+			file::WPath profilesFolder = DataManager::GetProfilesFolder();
+			CreateDirectoryW(profilesFolder, NULL);
+			Tracer::ExportChromeJson(profilesFolder / traceName);
+		}
+	}
+#endif
 
 #if 0
 #ifdef AM_INTEGRATED
@@ -298,16 +330,88 @@ void rageam::ui::TestbedApp::OnRender()
 		graphics::ImageCacheState ics = imageCache->GetState();
 
 		ImGui::BulletText("RAM: %s/%s", FormatSize(ics.SizeRamUsed), FormatSize(ics.SizeRamBudget));
-		ImGui::BulletText("FS: %s/%s", FormatSize(ics.SizeFsUsed), FormatSize(ics.SizeFsBudget));
+		ImGui::BulletText("FS: %s/%s (%s on disk)", FormatSize(ics.SizeFsUsed), FormatSize(ics.SizeFsBudget), FormatSize(ics.SizeFsOnDisk));
 		ImGui::BulletText("Image counts:");
 		ImGui::Indent();
 		ImGui::Text("- RAM: %u", ics.ImageCountRam);
 		ImGui::Text("- FS: %u", ics.ImageCountFs);
 		ImGui::Text("- DX11 Views: %u", ics.DX11ViewCount);
+		ImGui::Unindent();
+		ImGui::BulletText("Lookups:");
+		ImGui::Indent();
+		ImGui::Text("- Hits: %llu (%llu loaded from FS)", ics.HitCount, ics.FsLoadCount);
+		ImGui::Text("- Misses: %llu", ics.MissCount);
+		ImGui::Text("- Evicted: %llu RAM, %llu FS", ics.EvictionCountRam, ics.EvictionCountFs);
+		ImGui::Text("- DX11: %llu hits, %llu misses", ics.DX11HitCount, ics.DX11MissCount);
+		ImGui::Unindent();
+		const graphics::ImageAllocStats& alloc = ics.Allocator;
+		ImGui::BulletText("Allocator:");
+		ImGui::Indent();
+		ImGui::Text("- In use: %s/%s", FormatSize(alloc.BytesInUse), FormatSize(alloc.BytesReserved));
+		ImGui::Text("- Cached: %s", FormatSize(alloc.BytesCached));
+		ImGui::Text("- Arena: %s", FormatSize(alloc.BytesArena));
+		ImGui::Text("- Recycled: %llu/%llu", alloc.RecycleCount, alloc.AllocCount);
 		if (ImGui::Button("Clear"))
 			imageCache->Clear();
 		ImGui::Unindent();
 	}
 
+	// Timings depend on machine and build, they're only reported in log instead of being asserted in unit tests
+	if (ImGui::CollapsingHeader("Benchmarks"))
+	{
+		// Range fit preview tier is meant to be at least 5x faster than the fastest default encoder, see IMAGE_BC_PREVIEW_QUALITY
+		if (ImGui::Button("BC1 Preview vs rgbcx"))
+		{
+			static constexpr int BLOCK_COUNT = 1024 * 1024; // 4K texture
+			static constexpr int BLOCK_GROUP_SIZE = 64;		// Same as ImageCompressor
+
+			// Every block is gradient between two random colors
+			std::mt19937 rng(0);
+			List<char> blocks;
+			blocks.Resize(BLOCK_COUNT * graphics::IMAGE_BC_BLOCK_SLICE_PITCH);
+			u8* pixel = reinterpret_cast<u8*>(blocks.GetItems());
+			for (int i = 0; i < BLOCK_COUNT; i++)
+			{
+				u8 from[4], to[4];
+				for (int c = 0; c < 4; c++)
+				{
+					from[c] = static_cast<u8>(rng());
+					to[c] = static_cast<u8>(rng());
+				}
+				for (int p = 0; p < 16; p++)
+				{
+					for (int c = 0; c < 4; c++)
+						*pixel++ = static_cast<u8>(from[c] + (to[c] - from[c]) * p / 15);
+				}
+			}
+			List<char> encoded;
+			encoded.Resize(BLOCK_COUNT * graphics::IMAGE_BC_1_4_BLOCK_SIZE);
+
+			rgbcx::init();
+
+			// Same settings as ImageCompressor uses for bc7enc_rdo BC1 on quality 0
+			Timer timer = Timer::StartNew();
+			for (int i = 0; i < BLOCK_COUNT; i++)
+			{
+				rgbcx::encode_bc1(0, encoded.GetItems() + static_cast<size_t>(i) * graphics::IMAGE_BC_1_4_BLOCK_SIZE,
+					reinterpret_cast<const u8*>(blocks.GetItems()) + static_cast<size_t>(i) * graphics::IMAGE_BC_BLOCK_SLICE_PITCH, true, false);
+			}
+			timer.Stop();
+			u64 rgbcxTime = timer.GetElapsedMicroseconds();
+
+			timer = Timer::StartNew();
+			for (int i = 0; i < BLOCK_COUNT; i += BLOCK_GROUP_SIZE)
+			{
+				graphics::BCRangeFitEncodeBC1(BLOCK_GROUP_SIZE, encoded.GetItems() + static_cast<size_t>(i) * graphics::IMAGE_BC_1_4_BLOCK_SIZE,
+					blocks.GetItems() + static_cast<size_t>(i) * graphics::IMAGE_BC_BLOCK_SLICE_PITCH, graphics::RangeFitQuality_Preview);
+			}
+			timer.Stop();
+			u64 previewTime = timer.GetElapsedMicroseconds();
+
+			AM_TRACEF("BC1 4K: range fit preview %lluus, rgbcx level 0 %lluus (%.1fx faster)",
+				previewTime, rgbcxTime, static_cast<double>(rgbcxTime) / static_cast<double>(MAX(previewTime, 1ull)));
+		}
+	}
+
 	ImGui::End();
 }
@@ -34,6 +34,12 @@ public:
 	void LoadFromFile(const rageam::file::WPath& path);
 	void SaveToFile(const rageam::file::WPath& path);
 
+	// Prints document to memory, text is owned by printer
+	void Print(tinyxml2::XMLPrinter& printer) const
+	{
+		m_Doc.Print(&printer);
+	}
+
 	// Prints document to standard output stream
 	void DebugPrint() const
 	{
@@ -24,12 +24,9 @@
 rageam::file::WPath rageam::Logger::sm_LogDirectory;
 thread_local rageam::Logger* rageam::Logger::sm_Stack[STACK_SIZE]{};
 
-// To prevent initialization fiasco
-static std::recursive_mutex& GetMutex()
-{
-	static std::recursive_mutex mutex;
-	return mutex;
-}
+// Format buffers, message is copied to log queue so they can be reused right away
+static thread_local char s_FormatBuffer[2048];
+static thread_local wchar_t s_FormatBufferW[2048];
 
 void rageam::Logger::FindAndRemoveOldLogFolders()
 {
@@ -88,7 +85,13 @@ void rageam::Logger::FindAndRemoveOldLogFolders()
 
 void rageam::Logger::EnsureInitialized()
 {
-	static bool initialized = false;
+	static std::atomic_bool initialized = false;
+	if (initialized)
+		return;
+
+	// To prevent initialization fiasco
+	static std::recursive_mutex mutex;
+	std::unique_lock lock(mutex);
 	if (initialized)
 		return;
 
@@ -122,10 +125,10 @@ void rageam::Logger::EnsureInitialized()
 	}
 	CompressDirectory(sm_LogDirectory);
 
-	initialized = true;
-
 	FindAndRemoveOldLogFolders();
 #endif
+
+	initialized = true;
 }
 
 void rageam::Logger::EnsureThreadInitialized(Logger* defaultLogger)
@@ -168,6 +171,9 @@ rageam::Logger::Logger(ConstString name, FlagSet<eLogOptions> options)
 
 rageam::Logger::~Logger()
 {
+	// Queue may still have records that reference this logger
+	Flush();
+
 #ifdef AM_ENABLE_FILE_LOG
 	m_Stream.close();
 #endif
@@ -182,25 +188,23 @@ rageam::Logger::~Logger()
 #endif
 }
 
-void rageam::Logger::Log(eLogLevel level, ConstWString msg)
+void rageam::Logger::Write(eLogLevel level, FlagSet<eLogOptions> options, u64 timestamp, ConstWString msg)
 {
-	std::unique_lock lock(GetMutex());
-
 	WORD oldColor = SetConsoleColor(sm_LevelColors[level]);
 
-	if (!m_Options.IsSet(LOG_OPTION_NO_PREFIX))
+	if (!options.IsSet(LOG_OPTION_NO_PREFIX))
 	{
 		// LEVEL, HH:mm:ss
 		wchar_t prefix[48];
 
 		char timeFormatted[32];
-		DateTime now = DateTime::Now();
-		now.Format(timeFormatted, 32, "T");
+		DateTime time = DateTime(timestamp).ToLocalTime();
+		time.Format(timeFormatted, 32, "T");
 
 		swprintf_s(prefix, 48, L"%hs, %hs ", sm_LevelNames[level], timeFormatted);
 
 		// Console output have extra prefix with logger name
-		if (!m_Options.IsSet(LOG_OPTION_FILE_ONLY))
+		if (!options.IsSet(LOG_OPTION_FILE_ONLY))
 		{
 			wprintf(L"[%hs] %ls", m_Name, prefix);
 		}
@@ -211,9 +215,9 @@ void rageam::Logger::Log(eLogLevel level, ConstWString msg)
 
 	SetConsoleColor(oldColor);
 
-	bool sameLine = m_Options.IsSet(LOG_OPTION_SAME_LINE);
+	bool sameLine = options.IsSet(LOG_OPTION_SAME_LINE);
 
-	if (!m_Options.IsSet(LOG_OPTION_FILE_ONLY))
+	if (!options.IsSet(LOG_OPTION_FILE_ONLY))
 	{
 		wprintf(L"%s", msg);
 		if (!sameLine)
@@ -225,71 +229,102 @@ void rageam::Logger::Log(eLogLevel level, ConstWString msg)
 	if (!sameLine)
 		m_Stream << L"\n";
 #endif
-	}
+}
 
-void rageam::Logger::Log(eLogLevel level, const char* msg)
+void rageam::Logger::Log(eLogLevel level, ConstWString msg)
 {
-	std::unique_lock lock(GetMutex());
+	LogRecord header = {};
+	header.PayloadSize = static_cast<u32>((wcslen(msg) + 1) * sizeof(wchar_t));
+	header.Timestamp = GetTimestamp();
+	header.Target = this;
+	header.Options = m_Options.Value;
+	header.Level = level;
+	LogQueue::GetInstance().Push(header, msg);
+}
 
-	static wchar_t buffer[2048];
-	String::ToWide(buffer, 2048, msg);
-	Log(level, buffer);
+void rageam::Logger::Log(eLogLevel level, const char* msg)
+{
+	String::ToWide(s_FormatBufferW, 2048, msg);
+	Log(level, s_FormatBufferW);
 }
 
 void rageam::Logger::LogFormat(eLogLevel level, ConstString fmt, ...)
 {
-	std::unique_lock lock(GetMutex());
-
-	static char buffer[2048];
 	va_list args;
 	va_start(args, fmt);
-	vsprintf_s(buffer, 2048, fmt, args);
+	vsprintf_s(s_FormatBuffer, 2048, fmt, args);
 	va_end(args);
 
-	LogFormat(level, L"%hs", buffer);
+	LogFormat(level, L"%hs", s_FormatBuffer);
 }
 
 void rageam::Logger::LogFormat(eLogLevel level, ConstWString fmt, ...)
 {
-	std::unique_lock lock(GetMutex());
-
-	static wchar_t buffer[2048];
 	va_list args;
 	va_start(args, fmt);
-	vswprintf_s(buffer, 2048, fmt, args);
+	vswprintf_s(s_FormatBufferW, 2048, fmt, args);
 	va_end(args);
 
-	Log(level, buffer);
+	Log(level, s_FormatBufferW);
 }
 
-const rageam::file::WPath& rageam::Logger::GetLogsDirectory()
+void rageam::Logger::LogDeferred(LogDeferredFn fn, pConstVoid payload, u32 payloadSize, eLogLevel level)
+{
+	LogRecord header = {};
+	header.PayloadSize = payloadSize;
+	header.Timestamp = GetTimestamp();
+	header.DeferredFn = fn;
+	header.Level = level;
+	LogQueue::GetInstance().Push(header, payload);
+}
+
+void rageam::Logger::StartAsync()
+{
+	LogQueue::GetInstance().Start();
+}
+
+void rageam::Logger::Shutdown()
+{
+	LogQueue::GetInstance().Stop();
+}
+
+void rageam::Logger::Flush()
 {
-	std::unique_lock lock(GetMutex());
+	LogQueue::GetInstance().Flush();
+}
 
+void rageam::Logger::FlushOnCrash()
+{
+	LogQueue::GetInstance().FlushOnCrash();
+}
+
+u64 rageam::Logger::GetTimestamp()
+{
+	FILETIME time;
+	GetSystemTimePreciseAsFileTime(&time);
+	return TODWORD64(time.dwLowDateTime, time.dwHighDateTime);
+}
+
+const rageam::file::WPath& rageam::Logger::GetLogsDirectory()
+{
 	EnsureInitialized();
 	return sm_LogDirectory;
 }
 
 void rageam::Logger::Push(Logger* logger)
 {
-	std::unique_lock lock(GetMutex());
-
 	AM_ASSERT(sm_StackSize + 1 != STACK_SIZE, "Logger::Push() -> Stack is corrupted.");
 	sm_Stack[sm_StackSize++] = logger;
 }
 
 void rageam::Logger::Pop()
 {
-	std::unique_lock lock(GetMutex());
-
 	AM_ASSERT(sm_StackSize != 0, "Logger::Pop() -> Stack is corrupted.");
 	sm_StackSize--;
 }
 
 rageam::Logger* rageam::Logger::GetInstance()
 {
-	std::unique_lock lock(GetMutex());
-
 	EnsureInitialized();
 	static Logger general("general");
 	EnsureThreadInitialized(&general);
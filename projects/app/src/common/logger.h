@@ -11,6 +11,7 @@
 #include <mutex>
 
 #include "types.h"
+#include "logqueue.h"
 #include "am/file/path.h"
 #include "helpers/flagset.h"
 #include "helpers/resharper.h"
@@ -37,9 +38,15 @@ enum eLogOptions : u32
 
 namespace rageam
 {
-
+	/**
+	 * \brief Named log with console and (optionally) file output.
+	 * \n Once async logging is started, records are formatted on the calling thread and pushed to LogQueue,
+	 * console and file are written from the log writer thread.
+	 */
 	class Logger
 	{
+		friend class LogQueue;
+
 		// Each launch we create new log folder so we have to maintain how much folders there can be
 		static constexpr u32 MAX_LOG_FOLDERS = 8;
 
@@ -78,6 +85,10 @@ namespace rageam
 #ifndef AM_STANDALONE
 		FILE* m_ConsoleFile = nullptr;
 #endif
+
+		// Does actual console and file output, called by LogQueue
+		void Write(eLogLevel level, FlagSet<eLogOptions> options, u64 timestamp, ConstWString msg);
+
 	public:
 		Logger(ConstString name, FlagSet<eLogOptions> options = LOG_OPTION_NONE);
 		~Logger();
@@ -90,6 +101,38 @@ namespace rageam
 
 		FlagSet<eLogOptions>& GetOptions() { return m_Options; }
 
+		/**
+		 * \brief Pushes record that is formatted later on log writer thread, for logs that are too expensive
+		 * to format in place (memory operation log with stack traces).
+		 * \remarks Payload is copied, it must not contain pointers to temporary data.
+		 * Level only decides what happens when queue is full, see LogQueue.
+		 */
+		static void LogDeferred(LogDeferredFn fn, pConstVoid payload, u32 payloadSize, eLogLevel level = LOG_TRACE);
+
+		/**
+		 * \brief Starts log writer thread, all logs before this call are written synchronously.
+		 */
+		static void StartAsync();
+
+		/**
+		 * \brief Writes out all pending logs and stops log writer thread.
+		 */
+		static void Shutdown();
+
+		/**
+		 * \brief Blocks until all logs made before this call are written out.
+		 */
+		static void Flush();
+
+		/**
+		 * \brief Writes out pending logs on the current thread and switches logger to synchronous mode,
+		 * to be invoked from exception handler.
+		 */
+		static void FlushOnCrash();
+
+		// Current time in UTC file time ticks, as written in log records
+		static u64 GetTimestamp();
+
 		/**
 		 * \brief Gets relative path to directory where all logs are written to.
 		 */
@@ -0,0 +1,343 @@
+#include "logqueue.h"
+
+#include "logger.h"
+#include "helpers/align.h"
+
+#include <new>
+
+namespace
+{
+	// Releases ring once thread exits so it can be picked up by another thread
+	struct ThreadRingOwner
+	{
+		rageam::LogRing* Ring = nullptr;
+
+		~ThreadRingOwner()
+		{
+			if (Ring)
+				Ring->Owned.store(false, std::memory_order_release);
+		}
+	};
+
+	thread_local ThreadRingOwner t_RingOwner;
+}
+
+bool rageam::LogRing::Write(const LogRecord& header, pConstVoid payload)
+{
+	u32 size = ALIGN(static_cast<u32>(sizeof(LogRecord)) + header.PayloadSize, 8u);
+	u64 writePos = m_WritePos.load(std::memory_order_relaxed);
+	u64 readPos = m_ReadPos.load(std::memory_order_acquire);
+
+	u32 offset = static_cast<u32>(writePos % CAPACITY);
+	u32 tailSize = CAPACITY - offset;
+	u32 paddingSize = tailSize < size ? tailSize : 0;
+	if (writePos + paddingSize + size - readPos > CAPACITY)
+		return false;
+
+	// Tail is at least 8 bytes because records are aligned, that's enough for size and marker
+	if (paddingSize != 0)
+	{
+		LogRecord* padding = reinterpret_cast<LogRecord*>(m_Data + offset);
+		padding->Size = paddingSize;
+		padding->PayloadSize = LogRecord::PADDING;
+		offset = 0;
+	}
+
+	LogRecord* record = reinterpret_cast<LogRecord*>(m_Data + offset);
+	*record = header;
+	record->Size = size;
+	memcpy(record + 1, payload, header.PayloadSize);
+
+	m_WritePos.store(writePos + paddingSize + size, std::memory_order_release);
+	return true;
+}
+
+const rageam::LogRecord* rageam::LogRing::Peek()
+{
+	u64 readPos = m_ReadPos.load(std::memory_order_relaxed);
+	u64 writePos = m_WritePos.load(std::memory_order_acquire);
+	if (readPos == writePos)
+		return nullptr;
+
+	auto record = reinterpret_cast<const LogRecord*>(m_Data + readPos % CAPACITY);
+	if (record->PayloadSize != LogRecord::PADDING)
+		return record;
+
+	readPos += record->Size;
+	m_ReadPos.store(readPos, std::memory_order_release);
+	if (readPos == writePos)
+		return nullptr;
+
+	return reinterpret_cast<const LogRecord*>(m_Data);
+}
+
+void rageam::LogRing::Pop(const LogRecord* record)
+{
+	m_ReadPos.store(m_ReadPos.load(std::memory_order_relaxed) + record->Size, std::memory_order_release);
+}
+
+DWORD rageam::LogQueue::WriterEntry(LPVOID param)
+{
+	LogQueue* queue = static_cast<LogQueue*>(param);
+	while (!queue->m_ExitRequested)
+	{
+		WaitForSingleObject(queue->m_WakeEvent, WRITER_INTERVAL_MS);
+
+		std::unique_lock lock(queue->m_WriteMutex);
+		queue->Drain();
+	}
+	return 0;
+}
+
+rageam::LogRing* rageam::LogQueue::AcquireRing()
+{
+	// Reuse ring of thread that exited
+	for (LogRing* ring = m_Rings.load(std::memory_order_acquire); ring; ring = ring->Next)
+	{
+		bool owned = false;
+		if (ring->Owned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+		{
+			ring->ThreadId = GetCurrentThreadId();
+			return ring;
+		}
+	}
+
+	if (m_RingCount.fetch_add(1) >= MAX_RINGS)
+	{
+		--m_RingCount;
+		return nullptr;
+	}
+
+	// Logger is used by allocators, ring memory must not come from them
+	pVoid memory = VirtualAlloc(NULL, sizeof(LogRing), MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+	if (!memory)
+	{
+		--m_RingCount;
+		return nullptr;
+	}
+
+	LogRing* ring = new (memory) LogRing();
+	ring->Owned = true;
+	ring->ThreadId = GetCurrentThreadId();
+	ring->Next = m_Rings.load(std::memory_order_relaxed);
+	while (!m_Rings.compare_exchange_weak(ring->Next, ring, std::memory_order_release, std::memory_order_relaxed)) {}
+	return ring;
+}
+
+rageam::LogRing* rageam::LogQueue::GetThreadRing()
+{
+	if (!t_RingOwner.Ring)
+		t_RingOwner.Ring = AcquireRing();
+	return t_RingOwner.Ring;
+}
+
+void rageam::LogQueue::Drain()
+{
+	// Record being written may log something synchronously, it must not be written again
+	if (m_Draining)
+		return;
+	m_Draining = true;
+
+	// Merge rings by timestamp so records from different threads keep their order
+	while (true)
+	{
+		LogRing* oldestRing = nullptr;
+		const LogRecord* oldest = nullptr;
+		for (LogRing* ring = m_Rings.load(std::memory_order_acquire); ring; ring = ring->Next)
+		{
+			const LogRecord* record = ring->Peek();
+			if (record && (!oldest || record->Timestamp < oldest->Timestamp))
+			{
+				oldestRing = ring;
+				oldest = record;
+			}
+		}
+
+		if (!oldest)
+			break;
+
+		WriteRecord(*oldest, oldest->GetPayload());
+		oldestRing->Pop(oldest);
+	}
+
+	for (LogRing* ring = m_Rings.load(std::memory_order_acquire); ring; ring = ring->Next)
+		WriteDroppedCount(ring);
+
+	m_Draining = false;
+}
+
+void rageam::LogQueue::WriteDroppedCount(LogRing* ring) const
+{
+	u32 droppedCount = ring->DroppedCount.exchange(0);
+	if (droppedCount == 0)
+		return;
+
+	wchar_t message[96];
+	swprintf_s(message, 96, L"LogQueue -> %u record(s) from thread %u were dropped, ring was full.", droppedCount, ring->ThreadId);
+
+	Logger* logger = Logger::GetInstance();
+	LogRecord header = {};
+	header.PayloadSize = static_cast<u32>((wcslen(message) + 1) * sizeof(wchar_t));
+	header.Timestamp = Logger::GetTimestamp();
+	header.Target = logger;
+	header.Options = logger->GetOptions().Value;
+	header.Level = LOG_WARNING;
+	WriteRecord(header, message);
+}
+
+void rageam::LogQueue::WriteRecord(const LogRecord& header, pConstVoid payload)
+{
+	if (header.DeferredFn)
+		header.DeferredFn(payload, header.PayloadSize);
+	else
+		header.Target->Write(static_cast<eLogLevel>(header.Level), header.Options, header.Timestamp, static_cast<ConstWString>(payload));
+}
+
+void rageam::LogQueue::Start()
+{
+	std::unique_lock lock(m_WriteMutex);
+
+	if (m_Thread)
+		return;
+
+	m_ExitRequested = false;
+	m_WakeEvent = CreateEventW(NULL, FALSE, FALSE, NULL);
+	m_Thread = CreateThread(NULL, 0, WriterEntry, this, 0, &m_ThreadId);
+	if (!m_Thread)
+	{
+		CloseHandle(m_WakeEvent);
+		m_WakeEvent = NULL;
+		return;
+	}
+	(void)SetThreadDescription(m_Thread, L"[RAGEAM] Log Writer");
+
+	m_Running = true;
+}
+
+void rageam::LogQueue::Stop()
+{
+	if (!m_Thread)
+		return;
+
+	m_Running = false;
+	m_ExitRequested = true;
+	SetEvent(m_WakeEvent);
+	WaitForSingleObject(m_Thread, INFINITE);
+	CloseHandle(m_Thread);
+	CloseHandle(m_WakeEvent);
+	m_Thread = NULL;
+	m_WakeEvent = NULL;
+	m_ThreadId = 0;
+
+	std::unique_lock lock(m_WriteMutex);
+	Drain();
+}
+
+void rageam::LogQueue::Flush()
+{
+	// Writer is already draining, waiting on itself would dead lock
+	if (IsWriterThread())
+		return;
+
+	if (!m_Running)
+	{
+		std::unique_lock lock(m_WriteMutex);
+		Drain();
+		return;
+	}
+
+	struct RingPos
+	{
+		LogRing* Ring;
+		u64		 WritePos;
+	};
+	RingPos positions[MAX_RINGS];
+	u32 ringCount = 0;
+	for (LogRing* ring = m_Rings.load(std::memory_order_acquire); ring && ringCount < MAX_RINGS; ring = ring->Next)
+		positions[ringCount++] = { ring, ring->GetWritePos() };
+
+	auto isFlushed = [&]
+		{
+			for (u32 i = 0; i < ringCount; i++)
+			{
+				if (positions[i].Ring->GetReadPos() < positions[i].WritePos)
+					return false;
+			}
+			return true;
+		};
+
+	while (m_Running && !isFlushed())
+	{
+		SetEvent(m_WakeEvent);
+		Sleep(1);
+	}
+
+	// Writer was stopped while we were waiting
+	if (!m_Running)
+	{
+		std::unique_lock lock(m_WriteMutex);
+		Drain();
+	}
+}
+
+void rageam::LogQueue::FlushOnCrash()
+{
+	m_Running = false;
+
+	// Writer thread might have crashed in the middle of draining, holding the mutex
+	bool locked;
+	u64 deadline = GetTickCount64() + CRASH_FLUSH_TIMEOUT_MS;
+	while (!(locked = m_WriteMutex.try_lock()) && GetTickCount64() < deadline)
+		Sleep(1);
+
+	m_Draining = false;
+	Drain();
+
+	if (locked)
+		m_WriteMutex.unlock();
+}
+
+void rageam::LogQueue::Push(const LogRecord& header, pConstVoid payload)
+{
+	u32 size = static_cast<u32>(sizeof(LogRecord)) + header.PayloadSize;
+	LogRing* ring = m_Running && size <= LogRing::CAPACITY / 4 ? GetThreadRing() : nullptr;
+	if (ring)
+	{
+		if (ring->Write(header, payload))
+		{
+			// Don't wait for the next interval if ring is filling up fast
+			if (ring->GetUsedSize() > LogRing::CAPACITY / 2)
+				SetEvent(m_WakeEvent);
+			return;
+		}
+
+		// Ring is full; Writer can't wait for itself
+		if (header.Level >= LOG_WARNING && !IsWriterThread())
+		{
+			u64 deadline = GetTickCount64() + FULL_WAIT_MS;
+			while (m_Running && GetTickCount64() < deadline)
+			{
+				SetEvent(m_WakeEvent);
+				Sleep(1);
+				if (ring->Write(header, payload))
+					return;
+			}
+		}
+
+		++ring->DroppedCount;
+		++m_DroppedCount;
+		return;
+	}
+
+	// No writer or more threads than rings, write synchronously after everything that is already queued
+	std::unique_lock lock(m_WriteMutex);
+	Drain();
+	WriteRecord(header, payload);
+}
+
+rageam::LogQueue& rageam::LogQueue::GetInstance()
+{
+	alignas(LogQueue) static char s_Storage[sizeof(LogQueue)];
+	static LogQueue* s_Instance = new (s_Storage) LogQueue();
+	return *s_Instance;
+}
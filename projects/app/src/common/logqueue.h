@@ -0,0 +1,125 @@
+//
+// File: logqueue.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include <atomic>
+#include <mutex>
+
+#include "types.h"
+#include "helpers/win32.h"
+
+namespace rageam
+{
+	class Logger;
+
+	// Formats payload of deferred record, invoked on log writer thread
+	using LogDeferredFn = void(*)(pConstVoid payload, u32 payloadSize);
+
+	struct LogRecord
+	{
+		static constexpr u32 PADDING = u32(-1); // Marks unused space at the end of the ring
+
+		u32				Size;			// Including header and padding
+		u32				PayloadSize;
+		u64				Timestamp;		// UTC file time
+		Logger*			Target;			// Null for deferred records
+		LogDeferredFn	DeferredFn;
+		u32				Options;		// Logger options at the moment record was made
+		u32				Level;			// ::eLogLevel
+
+		pConstVoid GetPayload() const { return this + 1; }
+	};
+
+	/**
+	 * \brief Single producer / single consumer ring of log records, owned by one thread at a time.
+	 * \n Positions grow monotonically, record is always contiguous - if it doesn't fit before the end,
+	 * the tail is filled with padding record.
+	 */
+	class LogRing
+	{
+	public:
+		static constexpr u32 CAPACITY = 256 * 1024;
+
+	private:
+		alignas(64) std::atomic<u64> m_WritePos = 0;
+		alignas(64) std::atomic<u64> m_ReadPos = 0;
+		alignas(64) char			 m_Data[CAPACITY];
+
+	public:
+		LogRing*			Next = nullptr;
+		std::atomic_bool	Owned = false;
+		std::atomic<u32>	DroppedCount = 0;
+		u32					ThreadId = 0;
+
+		// Returns false if there's no space left for the record
+		bool Write(const LogRecord& header, pConstVoid payload);
+		// Returns null if ring is empty, padding is skipped
+		const LogRecord* Peek();
+		void			 Pop(const LogRecord* record);
+
+		u64 GetWritePos() const { return m_WritePos.load(std::memory_order_acquire); }
+		u64 GetReadPos() const { return m_ReadPos.load(std::memory_order_acquire); }
+		u64 GetUsedSize() const { return GetWritePos() - GetReadPos(); }
+	};
+
+	/**
+	 * \brief Asynchronous backend of the logger.
+	 * \n Every thread gets lock-free ring where records (raw timestamp, level and formatted message or deferred
+	 * payload) are pushed, rings are drained in timestamp order by writer thread that does console and file IO.
+	 * \n Memory is bounded - there's fixed number of rings, ring is reused once thread that owned it exits.
+	 * If ring is full, trace and debug records are dropped right away, others wait for the writer a bit.
+	 * \remarks Until writer thread is started (and after it is stopped, or crash) all records are written synchronously.
+	 */
+	class LogQueue
+	{
+		static constexpr u32 MAX_RINGS = 64;
+		static constexpr u32 WRITER_INTERVAL_MS = 10;
+		static constexpr u32 FULL_WAIT_MS = 100;			// How long warnings and errors wait for space in full ring
+		static constexpr u32 CRASH_FLUSH_TIMEOUT_MS = 500;
+
+		std::recursive_mutex	m_WriteMutex;		// Held by whoever writes records out, writer thread or synchronous logging
+		std::atomic<LogRing*>	m_Rings = nullptr;	// Intrusive list, rings are never freed
+		std::atomic<u32>		m_RingCount = 0;
+		std::atomic<u64>		m_DroppedCount = 0;
+		HANDLE					m_Thread = NULL;
+		DWORD					m_ThreadId = 0;
+		HANDLE					m_WakeEvent = NULL;
+		std::atomic_bool		m_Running = false;
+		std::atomic_bool		m_ExitRequested = false;
+		bool					m_Draining = false;	// Guarded by write mutex
+
+		static DWORD WINAPI WriterEntry(LPVOID param);
+
+		LogRing* AcquireRing();
+		LogRing* GetThreadRing();
+		// Outputs all pending records, caller must hold write mutex
+		void Drain();
+		void WriteDroppedCount(LogRing* ring) const;
+		static void WriteRecord(const LogRecord& header, pConstVoid payload);
+
+		bool IsWriterThread() const { return GetCurrentThreadId() == m_ThreadId; }
+
+	public:
+		void Start();
+		// Writes out pending records and stops writer thread, further records are written synchronously
+		void Stop();
+		// Blocks until all records made before the call are written out
+		void Flush();
+		// Drains queue on the current thread without waiting for writer (it might be the one that crashed),
+		// further records are written synchronously
+		void FlushOnCrash();
+
+		void Push(const LogRecord& header, pConstVoid payload);
+
+		bool IsRunning() const { return m_Running; }
+		u64	 GetDroppedCount() const { return m_DroppedCount; }
+
+		// Never destroyed, loggers flush the queue in destructor and may outlive function static
+		static LogQueue& GetInstance();
+	};
+}
@@ -4,25 +4,132 @@
 
 #include "am/manifest.h"
 #include "am/asset/factory.h"
+#include "am/asset/resourcevalidator.h"
 #include "am/asset/types/txd.h"
+#include "am/asset/workspacebuilder.h"
 #include "am/file/iterator.h"
 #include "am/system/system.h"
 #include "am/system/cli.h"
+#include "am/system/trace.h"
 #include "helpers/compiler.h"
 #include "rage/paging/builder/builder.h"
 
 #ifdef AM_STANDALONE
 namespace cli
 {
+	// Set by options preceding build commands
+	rageam::asset::WorkspaceBuildOptions s_BuildOptions;
+
 	void Compile(ConstWString projectDir)
 	{
 		rageam::asset::AssetPtr asset = rageam::asset::AssetFactory::LoadFromPath(projectDir);
 		if (!asset)
 			return;
 
+		asset->CompressionPreset = s_BuildOptions.CompressionPreset;
+		asset->OptimizeResourcePacking = s_BuildOptions.OptimizeResourcePacking;
 		asset->CompileToFile();
 	}
 
+	bool SetCompressionPreset(ConstWString name)
+	{
+		static constexpr std::pair<ConstWString, rage::pgRscCompressionPreset> s_Presets[] =
+		{
+			{ L"fastest", rage::pgRscCompressFastest },
+			{ L"fast", rage::pgRscCompressFast },
+			{ L"default", rage::pgRscCompressDefault },
+			{ L"smallest", rage::pgRscCompressSmallest },
+		};
+
+		for (auto& [presetName, preset] : s_Presets)
+		{
+			if (String::Equals(name, presetName, true))
+			{
+				s_BuildOptions.CompressionPreset = preset;
+				return true;
+			}
+		}
+		AM_ERRF(L"--compression -> Unknown preset '%ls', expected fastest, fast, default or smallest.", name);
+		return false;
+	}
+
+	// JSON report of the next command is written there, stdout can't be used because it is wide (see Logger) and has log in it
+	rageam::file::WPath s_ReportPath;
+
+	void SetReportPath(ConstWString path)
+	{
+		s_ReportPath = path;
+	}
+
+	// Compiles all assets in workspace, writes JSON timing report if it was requested
+	bool BuildWorkspace(ConstWString workspaceDir)
+	{
+		rageam::asset::WorkspaceBuilder builder(workspaceDir, s_BuildOptions);
+		bool success = builder.Build();
+		if (!s_ReportPath.IsEmpty())
+			success &= builder.WriteReport(s_ReportPath);
+		s_ReportPath = L"";
+		return success;
+	}
+
+	// Validates resource file or all resources in directory, writes JSON report if it was requested
+	bool ValidateResources(ConstWString path)
+	{
+		rageam::asset::ResourceValidator validator(path);
+		bool success = validator.Validate();
+		if (!s_ReportPath.IsEmpty())
+			success &= validator.WriteReport(s_ReportPath);
+		s_ReportPath = L"";
+		return success;
+	}
+
+#ifdef AM_TRACING
+	rageam::file::WPath s_TracePath;
+#endif
+
+	// Starts capturing trace, it is written to given path once all commands are executed
+	void BeginTrace(ConstWString path)
+	{
+#ifdef AM_TRACING
+		s_TracePath = path;
+		rageam::Tracer::BeginCapture();
+#else
+		AM_WARNINGF(L"--trace -> Ignoring '%ls', built without tracing (--tracing premake option).", path);
+#endif
+	}
+
+	void EndTrace()
+	{
+#ifdef AM_TRACING
+		if (!rageam::Tracer::IsCapturing())
+			return;
+		rageam::Tracer::EndCapture();
+		rageam::Tracer::ExportChromeJson(s_TracePath);
+#endif
+	}
+
+	// Resource validation is the only command that doesn't need GPU
+	bool IsRenderRequired(int argc, wchar_t** argv)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (String::Equals(argv[i], L"--trace") || String::Equals(argv[i], L"-tr") ||
+				String::Equals(argv[i], L"--report") || String::Equals(argv[i], L"-rep"))
+			{
+				i++; // Skip path
+				continue;
+			}
+			if (String::Equals(argv[i], L"--validate") || String::Equals(argv[i], L"-val"))
+			{
+				i++; // Skip path
+				continue;
+			}
+			if (argv[i][0] == L'-')
+				return true;
+		}
+		return false;
+	}
+
 	void ExportYtds(ConstWString searchDir, ConstWString outDir)
 	{
 		/*rageam::file::WPath path = searchDir;
@@ -46,7 +153,8 @@ namespace cli
 	}
 }
 
-void ParseAndExecuteArguments(int argc, wchar_t** argv)
+// Returns false if any command failed
+bool ParseAndExecuteArguments(int argc, wchar_t** argv)
 {
 	enum State
 	{
@@ -54,6 +162,7 @@ void ParseAndExecuteArguments(int argc, wchar_t** argv)
 		STATE_BUILDING,
 	};
 	State state = STATE_LOOP;
+	bool success = true;
 
 	rageam::ConsoleArguments args(argv, argc);
 	while (args.Next())
@@ -63,6 +172,79 @@ void ParseAndExecuteArguments(int argc, wchar_t** argv)
 			AM_TRACEF("--help");
 			AM_TRACEF("-b, --build\t\tCompiles assets passed in the next arguments.");
 			AM_TRACEF("-txde, --txdexport\t\tExports YTD's located in dir specified by #1 arg to #2 arg dir");
+			AM_TRACEF("-bws, --buildws\t\tCompiles all assets in workspace specified by the next argument.");
+			AM_TRACEF("-rep, --report\t\tWrites JSON report of the following --buildws or --validate command to file specified by the next argument.");
+			AM_TRACEF("-val, --validate\t\tValidates resource (ytd, ydr, ybn) or all resources in directory specified by the next argument.");
+			AM_TRACEF("-cmp, --compression\t\tSets resource compression preset (fastest, fast, default, smallest) for the following build commands.");
+			AM_TRACEF("-opk, --optimizepacking\t\tSearches for resource chunk layout that takes the least memory in the following build commands, slower.");
+			AM_TRACEF("-tr, --trace\t\tRecords trace of the following commands to JSON file specified by the next argument (chrome://tracing, ui.perfetto.dev).");
+			continue;
+		}
+
+		if (args.Current() == L"--trace" || args.Current() == L"-tr")
+		{
+			if (!args.Next())
+			{
+				AM_ERRF("--trace -> Output path is not specified.");
+				return false;
+			}
+
+			cli::BeginTrace(args.Current());
+			continue;
+		}
+
+		if (args.Current() == L"--compression" || args.Current() == L"-cmp")
+		{
+			if (!args.Next())
+			{
+				AM_ERRF("--compression -> Preset is not specified.");
+				return false;
+			}
+
+			if (!cli::SetCompressionPreset(args.Current()))
+				return false;
+			continue;
+		}
+
+		if (args.Current() == L"--optimizepacking" || args.Current() == L"-opk")
+		{
+			cli::s_BuildOptions.OptimizeResourcePacking = true;
+			continue;
+		}
+
+		if (args.Current() == L"--report" || args.Current() == L"-rep")
+		{
+			if (!args.Next())
+			{
+				AM_ERRF("--report -> Output path is not specified.");
+				return false;
+			}
+
+			cli::SetReportPath(args.Current());
+			continue;
+		}
+
+		if (args.Current() == L"--buildws" || args.Current() == L"-bws")
+		{
+			if (!args.Next())
+			{
+				AM_ERRF("--buildws -> Workspace path is not specified.");
+				return false;
+			}
+
+			success &= cli::BuildWorkspace(args.Current());
+			continue;
+		}
+
+		if (args.Current() == L"--validate" || args.Current() == L"-val")
+		{
+			if (!args.Next())
+			{
+				AM_ERRF("--validate -> Path is not specified.");
+				return false;
+			}
+
+			success &= cli::ValidateResources(args.Current());
 			continue;
 		}
 
@@ -95,6 +277,7 @@ void ParseAndExecuteArguments(int argc, wchar_t** argv)
 			cli::Compile(args.Current());
 		}
 	}
+	return success;
 }
 
 int wmain(int argc, wchar_t** argv)
@@ -104,13 +287,17 @@ int wmain(int argc, wchar_t** argv)
 	// We either execute CLI or UI mode depending on if there's any argument was passed
 	if (argc > 1) // First argument is always executable path
 	{
-		system.Init(false);
-		ParseAndExecuteArguments(argc, argv);
+		system.Init(false, cli::IsRenderRequired(argc, argv));
+		bool success = ParseAndExecuteArguments(argc, argv);
+		cli::EndTrace();
+		if (!success)
+			return 1;
 	}
 	else
 	{
 		system.Init(true);
 	}
+	return 0;
 }
 #else
 
@@ -328,6 +328,10 @@ rage::grcVertexBufferD3D11::grcVertexBufferD3D11(const datResource& rsc) : grcVe
 	if (!m_VertexData)
 		return;
 
+	// Placed without GPU, see grcTextureDX11(const datResource&)
+	if (!rageam::graphics::Render::GetInstance())
+		return;
+
 	if (m_Flags & (FlagReadWrite | FlagDynamic))
 	{
 		CreateInternal(grcsBufferCreate_ReadWrite, grcsBufferSync_Mutex, false);
@@ -402,6 +406,9 @@ rage::grcIndexBufferD3D11::grcIndexBufferD3D11()
 // ReSharper disable once CppPossiblyUninitializedMember
 rage::grcIndexBufferD3D11::grcIndexBufferD3D11(const datResource& rsc) : grcIndexBuffer(rsc)
 {
+	if (!rageam::graphics::Render::GetInstance())
+		return;
+
 	m_Buffer.Initialize(
 		GetIndexCount(), sizeof grcIndex_t, grcBindIndexBuffer, grcsBufferCreate_ReadOnly, grcsBufferSync_None, m_IndexData);
 }
@@ -189,6 +189,7 @@ namespace rage
 		grcIndexBuffer(const grcIndexBuffer& other);
 
 		u32 GetIndexCount() const { return m_IndexCountAndFlags & IDX_COUNT_MASK; }
+		const u16* GetIndexData() const { return m_IndexData; }
 	};
 
 	class grcIndexBufferD3D11 : public grcIndexBuffer
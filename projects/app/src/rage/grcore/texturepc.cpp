@@ -540,6 +540,10 @@ rage::grcTextureDX11::grcTextureDX11(const datResource& rsc) : grcTexturePC(rsc)
 	m_Format = static_cast<u32>(TranslateDX9ToDX11Format(m_Format, m_InfoBits.IsSRGB));
 	AM_ASSERT(m_Format != DXGI_FORMAT_UNKNOWN, "grcTextureDX11() -> Unknown DX9 format '%u' in resource file.", formatDX9);
 
+	// Resource is placed without GPU (for e.g. offline validation), only CPU data is used then
+	if (!rageam::graphics::Render::GetInstance())
+		return;
+
 	grcTextureDX11::CreateFromBackingStore(false);
 	grcTextureDX11::SetPrivateData();
 }
@@ -9,7 +9,6 @@
 
 #include "quatv.h"
 #include "vecv.h"
-#include <easy/profiler.h>
 
 namespace rage
 {
@@ -54,17 +53,14 @@ namespace rage
 
 		Mat44V Multiply(const Mat44V& other) const
 		{
-			EASY_BLOCK("Mat44V::Multiply");
 			return XMMatrixMultiply(M, other.M);
 		}
 		Mat44V Inverse() const
 		{
-			EASY_BLOCK("Mat44V::Inverse");
 			return XMMatrixInverse(NULL, M);
 		}
 		bool Decompose(Vec3V* translation, Vec3V* scale, QuatV* rotation) const
 		{
-			EASY_BLOCK("Mat44V::Decompose");
 			Vec3V t, s;
 			QuatV r;
 			bool result = XMMatrixDecompose(&s.M, &r.M, &t.M, M);
@@ -78,7 +74,6 @@ namespace rage
 		Mat44V operator*(const Mat44V& other) const { return Multiply(other); }
 		Mat44V& operator*=(const Mat44V& other)
 		{
-			EASY_BLOCK("Mat44V::operator*=");
 			M = XMMatrixMultiply(M, other.M); return *this;
 		}
 
@@ -112,7 +107,6 @@ namespace rage
 
 		static Mat44V Transform(const Vec3V& scale, const QuatV& rotation, const Vec3V& translation)
 		{
-			EASY_BLOCK("Mat44V::Transform");
 			return DirectX::XMMatrixTransformation(
 				S_ZERO, QUAT_IDENTITY, scale,
 				S_ZERO, rotation,
@@ -1,9 +1,58 @@
 #include "builder.h"
 
+#include "am/system/trace.h"
+#include "rage/file/device/local.h"
 #include "rage/paging/resourceheader.h"
+#include "rage/system/allocator.h"
 #include "rage/system/systemheap.h"
 #include "rage/zlib/stream.h"
 
+#include <string>
+
+bool rage::pgRscBuilder::DecompressChunks(datResourceMap& map, pConstVoid data, u64 dataSize)
+{
+	AM_TRACE_FUNCTION();
+
+	u64 totalChunkSize = 0;
+	for (u32 i = 0; i < map.GetChunkCount(); i++)
+		totalChunkSize += map.Chunks[i].Size;
+
+	// Deflate always adds block headers, so data of the exact resource size can only be stored uncompressed
+	if (dataSize == totalChunkSize)
+	{
+		const char* chunkData = static_cast<const char*>(data);
+		for (u32 i = 0; i < map.GetChunkCount(); i++)
+		{
+			datResourceChunk& chunk = map.Chunks[i];
+			memcpy(chunk.GetAllocatedAddress(), chunkData, chunk.Size);
+			chunkData += chunk.Size;
+		}
+		return true;
+	}
+
+	if (dataSize > UINT_MAX)
+	{
+		AM_ERRF("pgRscBuilder::DecompressChunks() -> Compressed data is larger than 4GB.");
+		return false;
+	}
+
+	// Whole compressed data is given at once, every chunk is inflated in a single call
+	zLibDecompressor decompressor;
+	for (u32 i = 0; i < map.GetChunkCount(); i++)
+	{
+		datResourceChunk& chunk = map.Chunks[i];
+
+		u32 remaining;
+		if (!decompressor.Decompress(
+			chunk.GetAllocatedAddress(), static_cast<u32>(chunk.Size), const_cast<pVoid>(data), static_cast<u32>(dataSize), remaining))
+		{
+			AM_ERRF("pgRscBuilder::DecompressChunks() -> Compressed data ended before chunk %u was decompressed.", i);
+			return false;
+		}
+	}
+	return true;
+}
+
 bool rage::pgRscBuilder::ReadAndDecompressChunks(datResourceMap& map, fiDevice* device, ConstString path)
 {
 	u64 offset;
@@ -56,12 +105,55 @@ bool rage::pgRscBuilder::ReadAndDecompressChunks(datResourceMap& map, fiDevice*
 	return true;
 }
 
-bool rage::pgRscBuilder::PerformReadInMainThread(ConstString path, u32 version, datResourceMap& map, datResourceInfo& info)
+bool rage::pgRscBuilder::ReadMappedChunks(datResourceMap& map, fiDevice* device, ConstString path)
+{
+	AM_TRACE_FUNCTION();
+
+	u64 offset;
+	fiHandle_t file = device->OpenBulk(path, offset);
+	if (file == FI_INVALID_HANDLE)
+	{
+		AM_ERRF("pgRscBuilder::ReadMappedChunks() -> Unable to open file for reading...");
+		return false;
+	}
+	offset += sizeof datResourceHeader;
+
+	u64 fileSize = device->Size64(file);
+	HANDLE mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	pConstVoid view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if (!view)
+	{
+		AM_ERRF("pgRscBuilder::ReadMappedChunks() -> Failed to map file, last error: %#x", GetLastError());
+		if (mapping) CloseHandle(mapping);
+		device->CloseBulk(file);
+		return false;
+	}
+
+	AM_DEBUGF("pgRscBuilder::ReadMappedChunks() -> Processing %u chunks (Virtual: %u, Physical: %u)",
+		map.GetChunkCount(), map.VirtualChunkCount, map.PhysicalChunkCount);
+
+	pConstVoid data = static_cast<const char*>(view) + offset;
+	u64 dataSize = fileSize - offset;
+
+	// Ask OS to read whole file ahead asynchronously, inflate then finds pages
+	// already resident instead of faulting them in one by one
+	WIN32_MEMORY_RANGE_ENTRY range = { const_cast<pVoid>(data), dataSize };
+	(void) PrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+
+	bool success = DecompressChunks(map, data, dataSize);
+
+	UnmapViewOfFile(view);
+	CloseHandle(mapping);
+	device->CloseBulk(file);
+	return success;
+}
+
+bool rage::pgRscBuilder::PerformRead(ConstString path, u32 version, datResourceMap& map, datResourceInfo& info)
 {
 	fiDevice* device = fiDevice::GetDeviceImpl(path);
 	if (device->GetResourceInfo(path, info) != version)
 	{
-		AM_ERRF("pgRscBuilder::PerformReadInMainThread() -> File is not a valid resource, unable to read header.");
+		AM_ERRF("pgRscBuilder::PerformRead() -> File is not a valid resource, unable to read header.");
 		return false;
 	}
 
@@ -69,11 +161,17 @@ bool rage::pgRscBuilder::PerformReadInMainThread(ConstString path, u32 version,
 
 	if (!AllocateMap(map))
 	{
-		AM_ERRF("pgRscBuilder::PerformReadInMainThread() -> Failed to allocate map.");
+		AM_ERRF("pgRscBuilder::PerformRead() -> Failed to allocate map.");
 		return false;
 	}
 
-	if (!ReadAndDecompressChunks(map, device, path))
+	// Only our local device gives us file handle that can be mapped
+	bool success;
+	if (device == fiDeviceLocal::GetInstance())
+		success = ReadMappedChunks(map, device, path);
+	else
+		success = ReadAndDecompressChunks(map, device, path);
+	if (!success)
 		return false;
 
 	map.MainChunk = static_cast<pgBase*>(map.Chunks[map.MainChunkIndex].GetAllocatedAddress());
@@ -93,12 +191,35 @@ rage::pgBase* rage::pgRscBuilder::LoadBuild(ConstString path, u32 version, datRe
 	char fullName[256];
 	ConstructName(fullName, 256, path);
 
-	if (!PerformReadInMainThread(fullName, version, map, info))
+	if (!PerformRead(fullName, version, map, info))
 		return nullptr;
 
 	return map.MainChunk;
 }
 
+rage::pgRscLoadRequestPtr rage::pgRscBuilder::LoadBuildAsync(
+	ConstString path, u32 version, const pgRscLoadCallback& onLoaded, bool useGameAllocators)
+{
+	pgRscLoadRequestPtr request = std::make_shared<pgRscLoadRequest>();
+	request->Task = rageam::BackgroundWorker::Run([request, onLoaded, path = std::string(path), version, useGameAllocators]
+		{
+			// Allocator is selected per thread, only chunks must be allocated from game heap
+#ifdef AM_INTEGRATED
+			sysMemUseGameAllocators(useGameAllocators);
+#endif
+			request->Root = LoadBuild(path.c_str(), version, request->Map, request->Info);
+#ifdef AM_INTEGRATED
+			sysMemUseGameAllocators(false);
+#endif
+			if (onLoaded)
+				onLoaded(*request);
+
+			return request->Root != nullptr;
+		}, "Load resource %s", path);
+
+	return request;
+}
+
 void rage::pgRscBuilder::Cleanup(const datResourceMap& map)
 {
 	sysMemAllocator* allocator = GetMultiAllocator()->GetAllocator(ALLOC_TYPE_PHYSICAL);
@@ -127,8 +248,11 @@ bool rage::pgRscBuilder::AllocateMap(datResourceMap& map)
 		// Failed to allocate one of the chunks, we'll have to free all previously allocated ones...
 		if (!block)
 		{
-			for (u32 j = 0; j <= i; j++)
+			for (u32 j = 0; j < i; j++)
+			{
 				allocator->Free(reinterpret_cast<pVoid>(map.Chunks[j].DestAddr));
+				map.Chunks[j].DestAddr = 0;
+			}
 			return false;
 		}
 
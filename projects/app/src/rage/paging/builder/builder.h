@@ -13,24 +13,55 @@
 #include "am/system/asserts.h"
 #include "am/system/timer.h"
 #include "rage/file/device.h"
+#include "am/system/worker.h"
 #include "common/logger.h"
 
 namespace rage
 {
+	/**
+	 * \brief State of resource loaded by pgRscBuilder::LoadBuildAsync.
+	 */
+	struct pgRscLoadRequest
+	{
+		datResourceMap	Map = {};
+		datResourceInfo	Info = {};
+		pgBase*			Root = nullptr; // Not placed yet, null if loading failed
+
+		amPtr<rageam::BackgroundTask> Task;
+
+		bool IsFinished() const { return Task->IsFinished(); }
+		void Wait() const { Task->Wait(); }
+	};
+	using pgRscLoadRequestPtr = amPtr<pgRscLoadRequest>;
+	using pgRscLoadCallback = std::function<void(pgRscLoadRequest& request)>;
+
 	class pgRscBuilder
 	{
 		static constexpr u32 READ_BUFFER_SIZE = 0x1000000; // 16MB
 
 		// Native implementation uses pgReader which does resource reading in parallel thread,
-		// we don't need that yet (because we are not streaming resources in real-time) so we can read resource in caller thread.
+		// we do the same with LoadBuildAsync, synchronous functions read resource in caller thread.
 
-		static bool PerformReadInMainThread(ConstString path, u32 version, datResourceMap& map, datResourceInfo& info);
+		static bool PerformRead(ConstString path, u32 version, datResourceMap& map, datResourceInfo& info);
 		static void ConstructName(char* buffer, u32 bufferSize, const char* path);
 
+		// Inflates chunks from compressed data in memory, or copies them if resource is not compressed
+		static bool DecompressChunks(datResourceMap& map, pConstVoid data, u64 dataSize);
+
 	public:
+		// Streams file through read buffer, used for devices that are not backed by local file (for e.g. packfiles)
 		static bool ReadAndDecompressChunks(datResourceMap& map, fiDevice* device, ConstString path);
+		// Memory maps local file and inflates chunks straight from the mapping, there's no intermediate read buffer
+		static bool ReadMappedChunks(datResourceMap& map, fiDevice* device, ConstString path);
 
 		static pgBase* LoadBuild(ConstString path, u32 version, datResourceMap& map, datResourceInfo& info);
+		/**
+		 * \brief Loads resource on background worker, callback is invoked from the loading thread once chunks are
+		 * read (or loading failed), resource is not placed.
+		 * \param useGameAllocators	Allocate chunks from game heap, only has effect in integrated mode.
+		 */
+		static pgRscLoadRequestPtr LoadBuildAsync(
+			ConstString path, u32 version, const pgRscLoadCallback& onLoaded = nullptr, bool useGameAllocators = false);
 		/**
 		 * \brief Frees up physical chunks.
 		 */
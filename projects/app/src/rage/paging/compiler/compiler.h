@@ -13,6 +13,7 @@
 
 #include "common/logger.h"
 #include "am/system/timer.h"
+#include "am/system/trace.h"
 
 namespace rage
 {
@@ -57,7 +58,10 @@ namespace rage
 
 			// Step 1: Make snapshot of all structures to virtual / physical allocators.
 			ReportProgress(L"Performing memory snapshot", 0.0);
-			DoSnapshot(pPaged);
+			{
+				AM_TRACE_SCOPE("pgRscCompiler::Snapshot");
+				DoSnapshot(pPaged);
+			}
 
 			// Step 2: Pack all allocations (allocator chunks) to pages.
 			ReportProgress(L"Packing chunks", 0.3);
@@ -66,23 +70,30 @@ namespace rage
 
 			// Possible fail reasons:
 			//  - Block size is larger than 100MB (pgStreamer limit)
-			pgRscPacker virtualPacker(virtualAllocator, 0);
-			if (success && !virtualPacker.Pack(data.VirtualChunks)) success = false;
+			{
+				AM_TRACE_SCOPE("pgRscCompiler::Pack");
+				pgRscPacker virtualPacker(virtualAllocator, 0, OptimizePacking);
+				if (success && !virtualPacker.Pack(data.VirtualChunks)) success = false;
 
-			pgRscPacker physicalPacker(physicalAllocator, data.VirtualChunks.ChunkCount);
-			if (success && !physicalPacker.Pack(data.PhysicalChunks)) success = false;
+				pgRscPacker physicalPacker(physicalAllocator, data.VirtualChunks.ChunkCount, OptimizePacking);
+				if (success && !physicalPacker.Pack(data.PhysicalChunks)) success = false;
+			}
 
 			if (success)
 			{
 				// Step 3: Now order of memory blocks finalized and will remain unchanged,
 				// we have to replace pointer addresses on file offsets
 				ReportProgress(L"Fixing up pointers", 0.7);
-				FixupReferences(data.VirtualChunks, virtualAllocator);
-				FixupReferences(data.PhysicalChunks, physicalAllocator);
+				{
+					AM_TRACE_SCOPE("pgRscCompiler::FixupReferences");
+					FixupReferences(data.VirtualChunks, virtualAllocator);
+					FixupReferences(data.PhysicalChunks, physicalAllocator);
+				}
 
 				// Step 4: Compress and write data to file.
 				ReportProgress(L"Writing to file", 0.9);
-				pgRscWriter writer;
+				AM_TRACE_SCOPE("pgRscCompiler::Write");
+				pgRscWriter writer(CompressionPreset);
 
 				// Possible fail reasons:
 				//  - Unable to open file for writing
@@ -99,6 +110,10 @@ namespace rage
 		// This function is thread-safe (invoked only from caller thread)
 		std::function<ResourceCompileCallback> CompileCallback;
 
+		pgRscCompressionPreset CompressionPreset = pgRscCompressDefault;
+		// Searches for chunk layout with the smallest allocated size, slower than default greedy packing
+		bool OptimizePacking = false;
+
 		void ReportProgress(ConstWString message, double progress) const
 		{
 			if (!CompileCallback)
@@ -1,8 +1,10 @@
 #include "packer.h"
 
 #include "snapshotallocator.h"
+#include "am/system/worker.h"
 #include "rage/math/math.h"
 #include "rage/paging/resourceinfo.h"
+#include "helpers/format.h"
 
 void rage::pgRscPacker::GetInitialBucketAndSizeShift(u32 largestBlock, u8& bucket, u8& shift)
 {
@@ -173,6 +175,10 @@ void rage::pgRscPacker::CalculateChunkCountInBuckets(datPackedChunks& pack) cons
 
 u8 rage::pgRscPacker::TryPack(u8 startBucket, u8 sizeShift)
 {
+	// Retrying with next size shift ran out of allowed chunk sizes, blocks can't be packed with this strategy
+	if ((static_cast<u64>(PG_MIN_CHUNK_SIZE) << sizeShift >> startBucket) >= PG_MAX_CHUNK_SIZE)
+		return 255;
+
 	ResetBuckets();
 
 	u8 bucket = startBucket;
@@ -278,10 +284,234 @@ u8 rage::pgRscPacker::TryPack(u8 startBucket, u8 sizeShift)
 	return sizeShift;
 }
 
-rage::pgRscPacker::pgRscPacker(const pgSnapshotAllocator& allocator, u32 reservedChunks) : m_SortedBlocks(0)
+u32 rage::pgRscPacker::ComputeAllocSize(u8 sizeShift) const
+{
+	u32 allocSize = 0;
+	u32 chunkSize = PG_MIN_CHUNK_SIZE << sizeShift;
+	for (u8 i = 0; i < PG_MAX_BUCKETS; i++)
+	{
+		for (const auto& chunk : m_Buckets[i])
+		{
+			if (chunk.Any()) allocSize += chunkSize;
+			else break;
+		}
+		chunkSize /= 2;
+	}
+	return allocSize;
+}
+
+void rage::pgRscPacker::EvaluateCandidate(PackCandidate& candidate) const
+{
+	candidate.Valid = false;
+	candidate.AllocSize = 0;
+	candidate.Bins.Clear();
+
+	u32 maxBins = PG_MAX_CHUNKS - m_ReservedChunks;
+	candidate.Bins.Reserve(maxBins);
+
+	u32 baseChunkSize = PG_MIN_CHUNK_SIZE << candidate.SizeShift;
+	auto getChunkSize = [baseChunkSize](int bucket) { return baseChunkSize >> bucket; };
+
+	// Range of buckets with chunk sizes we're allowed to use
+	int firstBucket = 0;
+	while (firstBucket < PG_MAX_BUCKETS && getChunkSize(firstBucket) >= PG_MAX_CHUNK_SIZE)
+		firstBucket++;
+	int lastBucket = PG_MAX_BUCKETS - 1;
+	while (lastBucket > firstBucket && getChunkSize(lastBucket) < PG_MIN_CHUNK_SIZE)
+		lastBucket--;
+	if (firstBucket == PG_MAX_BUCKETS)
+		return;
+
+	u8 chunkCounts[PG_MAX_BUCKETS] = {};
+
+	// Picks bucket for new chunk that fits given size, -1 if there's none left
+	auto findBucket = [&](u32 size, int minBucket)
+		{
+			// The smallest chunk that fits
+			int bucket = -1;
+			for (int i = lastBucket; i >= minBucket; i--)
+			{
+				if (getChunkSize(i) >= size)
+				{
+					bucket = i;
+					break;
+				}
+			}
+			if (bucket == -1)
+				return -1;
+
+			if (candidate.LargerBins && bucket > minBucket)
+				bucket--;
+
+			// All chunks in bucket are used, take larger one
+			while (bucket >= minBucket && chunkCounts[bucket] == datResourceInfo::GetMaxChunkCountInBucket(bucket))
+				bucket--;
+			return bucket >= minBucket ? bucket : -1;
+		};
+
+	auto openBin = [&](int bucket)
+		{
+			PackedBin& bin = candidate.Bins.Construct();
+			bin.Bucket = static_cast<u8>(bucket);
+			bin.FreeSize = getChunkSize(bucket);
+			candidate.AllocSize += bin.FreeSize;
+			chunkCounts[bucket]++;
+			return candidate.Bins.GetSize() - 1;
+		};
+
+	int minBucket = firstBucket;
+	u16 startBlock = 0;
+	if (m_IsVirtual)
+	{
+		// Main block must be at the beginning of the first chunk,
+		// so it gets chunk of the largest size used in layout and no larger chunk can be opened after
+		int topBucket = findBucket(m_LargestBlock, firstBucket);
+		if (topBucket == -1)
+			return;
+
+		PackedBin& bin = candidate.Bins[openBin(topBucket)];
+		bin.Blocks.Add(m_SortedBlocks[0].Index);
+		bin.FreeSize -= m_SortedBlocks[0].Size;
+
+		minBucket = topBucket;
+		startBlock = 1;
+	}
+
+	// Indices of remaining sorted blocks in candidate order
+	u16 blockCount = static_cast<u16>(m_SortedBlocks.GetSize());
+	atArray<u16> order;
+	order.Reserve(blockCount - startBlock);
+	switch (candidate.Order)
+	{
+	case PackOrder_Descending:
+	case PackOrder_Allocation:
+		for (u16 i = startBlock; i < blockCount; i++)
+			order.Add(i);
+		if (candidate.Order == PackOrder_Allocation)
+			std::ranges::sort(order, [this](u16 left, u16 right) { return m_SortedBlocks[left].Index < m_SortedBlocks[right].Index; });
+		break;
+	case PackOrder_Alternating:
+		for (u16 left = startBlock, right = blockCount; left < right;)
+		{
+			order.Add(left++);
+			if (left < right)
+				order.Add(--right);
+		}
+		break;
+	default:
+		break;
+	}
+
+	for (u16 sortedIndex : order)
+	{
+		const SortedBlock& block = m_SortedBlocks[sortedIndex];
+
+		int binIndex = -1;
+		for (u32 k = 0; k < candidate.Bins.GetSize(); k++)
+		{
+			u32 freeSize = candidate.Bins[k].FreeSize;
+			if (freeSize < block.Size)
+				continue;
+
+			if (binIndex == -1 || freeSize < candidate.Bins[binIndex].FreeSize)
+				binIndex = static_cast<int>(k);
+
+			if (candidate.FirstFit)
+				break;
+		}
+
+		if (binIndex == -1)
+		{
+			if (candidate.Bins.GetSize() == maxBins)
+				return;
+
+			int bucket = findBucket(block.Size, minBucket);
+			if (bucket == -1)
+				return;
+
+			binIndex = static_cast<int>(openBin(bucket));
+		}
+
+		PackedBin& bin = candidate.Bins[binIndex];
+		bin.Blocks.Add(block.Index);
+		bin.FreeSize -= block.Size;
+	}
+
+	candidate.Valid = true;
+}
+
+void rage::pgRscPacker::OptimizePack(u8 greedySizeShift, u8& outSizeShift)
+{
+	outSizeShift = greedySizeShift;
+	u32 greedyAllocSize = greedySizeShift != 255 ? ComputeAllocSize(greedySizeShift) : UINT_MAX;
+
+	// Bucket 0 chunk can't be smaller than the largest block, larger size shifts give larger choice of big chunks
+	static constexpr u32 sizeShiftCandidates = 5;
+	u32 minSizeShift = Max<u32>(PG_MIN_SIZE_SHIFT, datResourceInfo::GetChunkSizeShift(datResourceInfo::GetChunkSize(m_LargestBlock)));
+
+	atArray<PackCandidate> candidates;
+	for (u32 shift = minSizeShift; shift < minSizeShift + sizeShiftCandidates && shift <= PG_MIN_SIZE_SHIFT + 0xF; shift++)
+	{
+		for (int order = 0; order < PackOrder_Count; order++)
+		{
+			for (int rules = 0; rules < 4; rules++)
+			{
+				PackCandidate& candidate = candidates.Construct();
+				candidate.SizeShift = static_cast<u8>(shift);
+				candidate.Order = static_cast<ePackOrder>(order);
+				candidate.LargerBins = rules & 1;
+				candidate.FirstFit = rules & 2;
+			}
+		}
+	}
+
+	// Candidates are independent, evaluate them in parallel
+	rageam::BackgroundWorker::ParallelFor(candidates.GetSize(), [&](u32 index)
+		{
+			EvaluateCandidate(candidates[index]);
+		});
+
+	const PackCandidate* best = nullptr;
+	for (const PackCandidate& candidate : candidates)
+	{
+		if (!candidate.Valid)
+			continue;
+
+		if (!best || candidate.AllocSize < best->AllocSize ||
+			(candidate.AllocSize == best->AllocSize && candidate.Bins.GetSize() < best->Bins.GetSize()))
+			best = &candidate;
+	}
+
+	if (!best || best->AllocSize >= greedyAllocSize)
+	{
+		AM_DEBUG("pgRscPacker::OptimizePack() -> Greedy layout is already the smallest one");
+		return;
+	}
+
+	AM_DEBUGF("pgRscPacker::OptimizePack() -> Picked size shift %u (order: %u, larger bins: %i, first fit: %i), %s -> %s",
+		best->SizeShift, best->Order, best->LargerBins, best->FirstFit,
+		greedySizeShift != 255 ? FormatSize(greedyAllocSize) : "-", FormatSize(best->AllocSize));
+
+	// Copy best layout to buckets, chunks are ordered by opening order within bucket
+	ResetBuckets();
+	u8 chunkIndices[PG_MAX_BUCKETS] = {};
+	for (const PackedBin& bin : best->Bins)
+	{
+		atArray<u16>& chunk = m_Buckets[bin.Bucket][chunkIndices[bin.Bucket]++];
+		for (u16 blockIndex : bin.Blocks)
+			chunk.Add(blockIndex);
+	}
+	m_BucketsDirty = true;
+
+	outSizeShift = best->SizeShift;
+}
+
+rage::pgRscPacker::pgRscPacker(const pgSnapshotAllocator& allocator, u32 reservedChunks, bool optimize) : m_SortedBlocks(0)
 {
 	m_Allocator = &allocator;
 	m_ReservedChunks = reservedChunks;
+	m_Optimize = optimize;
+	m_IsVirtual = allocator.IsVirtual();
 
 	CopyAndSortBlocks(allocator);
 }
@@ -291,6 +521,8 @@ bool rage::pgRscPacker::Pack(datPackedChunks& outPack)
 	outPack.Buckets = m_Buckets;
 	outPack.SizeShift = PG_MIN_SIZE_SHIFT;
 	outPack.IsEmpty = true;
+	outPack.UsedSize = 0;
+	outPack.AllocSize = 0;
 
 	// Physical allocator often has nothing to pack whatsoever, handle that properly
 	if (!m_SortedBlocks.Any())
@@ -316,6 +548,9 @@ bool rage::pgRscPacker::Pack(datPackedChunks& outPack)
 	// Do packing and calculate number of chunks in every bucket
 	u8 resultSizeShift = TryPack(startBucket, startShift);
 
+	if (m_Optimize)
+		OptimizePack(resultSizeShift, resultSizeShift);
+
 	if (!AM_VERIFY(resultSizeShift != 255, "pgRscPacker::Pack() -> Resource cannot be packed because largest chunk size exceeds 100MB limit."))
 		return false;
 
@@ -323,8 +558,15 @@ bool rage::pgRscPacker::Pack(datPackedChunks& outPack)
 
 	CalculateChunkCountInBuckets(outPack);
 
+	for (const SortedBlock& block : m_SortedBlocks)
+		outPack.UsedSize += block.Size;
+	outPack.AllocSize = ComputeAllocSize(outPack.SizeShift);
+
 	AM_DEBUGF("pgRscPacker::Pack() -> Packed with size shift: %u (%x)",
 		outPack.SizeShift, PG_MIN_CHUNK_SIZE << outPack.SizeShift);
+	AM_TRACEF("pgRscPacker(%s) -> Used: %s, Allocated: %s, Waste: %.1f%%, Chunks: %u",
+		m_Allocator->GetDebugName(), FormatSize(outPack.UsedSize), FormatSize(outPack.AllocSize),
+		outPack.GetWasteRatio() * 100.0, outPack.ChunkCount);
 
 	PrintPackedInfo(outPack);
 	return true;
@@ -23,6 +23,12 @@ namespace rage
 		u8 ChunkCount;
 
 		bool IsEmpty; // Whether there's any packed block
+
+		u32 UsedSize;		// Sum of packed block sizes
+		u32 AllocSize;		// Sum of used chunk sizes, this is how much buddy allocator memory resource takes
+
+		// Part of allocated memory that is not used by blocks (internal fragmentation), 0.0 - 1.0
+		double GetWasteRatio() const { return AllocSize > 0 ? 1.0 - static_cast<double>(UsedSize) / static_cast<double>(AllocSize) : 0.0; }
 	};
 
 	/**
@@ -44,6 +50,35 @@ namespace rage
 			u16 Index;
 		};
 
+		// Chunk opened by optimizing packer
+		struct PackedBin
+		{
+			u8			 Bucket;
+			u32			 FreeSize;
+			atArray<u16> Blocks;
+		};
+
+		// Order in which optimizing packer places blocks
+		enum ePackOrder : u8
+		{
+			PackOrder_Descending,	// Largest first, same as greedy packer
+			PackOrder_Alternating,	// Largest and smallest remaining in turn, small blocks fill gaps in large chunks early
+			PackOrder_Allocation,	// Order of allocation, blocks that are allocated together end up in the same chunk
+			PackOrder_Count,
+		};
+
+		// Layout evaluated by optimizing packer
+		struct PackCandidate
+		{
+			u8				   SizeShift = 0;
+			ePackOrder		   Order = PackOrder_Descending;
+			bool			   LargerBins = false;	// Opens chunks one bucket larger than required, uses less chunks
+			bool			   FirstFit = false;	// Puts block in the first chunk that fits instead of the tightest one
+			bool			   Valid = false;
+			u32				   AllocSize = 0;
+			atArray<PackedBin> Bins;
+		};
+
 		static constexpr u8 sm_BucketAndSizeShift[] =
 		{
 			// Index is the most significant bit starting from 0x2000, see ::GetInitialBucketAndSizeShift
@@ -107,6 +142,8 @@ namespace rage
 			atArray<atArray<u16>>(1),
 		};
 		bool m_BucketsDirty = false; // To clear all indices before re-packing
+		bool m_Optimize;
+		bool m_IsVirtual;
 
 		void ResetBuckets();
 		void CopyAndSortBlocks(const pgSnapshotAllocator& allocator);
@@ -123,8 +160,18 @@ namespace rage
 		// Tries to pack blocks with given min chunk size, if not successful, retries with larger min chunk size.
 		// Returns packed size shift, or 255 if wasn't able to pack.
 		u8 TryPack(u8 startBucket, u8 sizeShift);
+
+		// Sum of used chunk sizes in current buckets
+		u32 ComputeAllocSize(u8 sizeShift) const;
+
+		// Best-fit decreasing bin packing with given size shift and chunk opening rules
+		void EvaluateCandidate(PackCandidate& candidate) const;
+		// Evaluates candidate layouts in parallel and replaces packed buckets with the smallest one,
+		// if it takes less memory than current (greedy) one
+		void OptimizePack(u8 greedySizeShift, u8& outSizeShift);
 	public:
-		pgRscPacker(const pgSnapshotAllocator& allocator, u32 reservedChunks);
+		// In optimizing mode, several size shifts, block orders and packing rules are tried and layout with the smallest allocated size is picked
+		pgRscPacker(const pgSnapshotAllocator& allocator, u32 reservedChunks, bool optimize = false);
 
 		bool Pack(datPackedChunks& outPack);
 	};
@@ -6,6 +6,7 @@
 #include "helpers/format.h"
 #include "rage/system/tls.h"
 #include "rage/zlib/stream.h"
+#include "rage/zlib/parallel.h"
 
 #include "snapshotallocator.h"
 #include "am/file/fileutils.h"
@@ -20,6 +21,13 @@ rage::datResourceHeader rage::datCompileData::GetHeader() const
 	return datResourceHeader(MAGIC_RSC, Version, info);
 }
 
+rage::pgRscWriter::pgRscWriter(pgRscCompressionPreset preset)
+{
+	m_Preset = preset;
+	if (preset == pgRscCompressSmallest)
+		m_Compressor = std::make_unique<zLibCompressor>(30 * 1024u * 1024u, 9); // 30MB~ buffer
+}
+
 u32 rage::pgRscWriter::ComputeUsedSize(const datPackedChunks& packedPage) const
 {
 	// Accumulate allocation size, simply add up chunk sizes
@@ -102,13 +110,34 @@ bool rage::pgRscWriter::CompressAndWrite(pVoid data, u32 dataSize)
 {
 	DWORD dwBytesWritten;
 
+	if (!m_Compressor)
+	{
+		int level;
+		switch (m_Preset)
+		{
+		case pgRscCompressFastest:	level = 1;						break;
+		case pgRscCompressFast:		level = 3;						break;
+		default:					level = ZLIB_COMPRESSION_LEVEL; break;
+		}
+
+		zLibParallelCompressor compressor(level);
+		return compressor.Compress(data, dataSize, [&](pVoid compressedBuffer, u32 compressedSize)
+			{
+				m_FileSize += compressedSize;
+				WriteFile(m_File, compressedBuffer, compressedSize, &dwBytesWritten, NULL);
+				return AM_VERIFY(dwBytesWritten == compressedSize,
+					"pgRscWriter::CompressAndWrite() -> Tried to write %u bytes, but only %u been written!",
+					compressedSize, dwBytesWritten);
+			});
+	}
+
 	bool done = false;
 	while (!done)
 	{
 		pVoid compressedBuffer;
 		u32	compressedSize;
 
-		done = m_Compressor.Compress(data, dataSize, compressedBuffer, compressedSize);
+		done = m_Compressor->Compress(data, dataSize, compressedBuffer, compressedSize);
 		m_FileSize += compressedSize;
 		AM_DEBUGF("pgRscWriter::CompressAndWrite() -> Compressed %u to %u", dataSize, compressedSize);
 
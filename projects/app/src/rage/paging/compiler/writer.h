@@ -17,6 +17,14 @@ namespace rage
 {
 	class pgSnapshotAllocator;
 
+	enum pgRscCompressionPreset
+	{
+		pgRscCompressFastest,	// Level 1, multithreaded
+		pgRscCompressFast,		// Level 3, multithreaded
+		pgRscCompressDefault,	// ZLIB_COMPRESSION_LEVEL, multithreaded
+		pgRscCompressSmallest,	// Level 9, single stream compressed on one thread
+	};
+
 	/**
 	 * \brief Contains resource version and packed chunks.
 	 */
@@ -46,7 +54,9 @@ namespace rage
 
 		HANDLE m_File;
 
-		zLibCompressor m_Compressor = { 30 * 1024u * 1024u }; // 30MB~ buffer
+		pgRscCompressionPreset m_Preset;
+		// Only for single threaded preset, multithreaded one compresses in independent blocks
+		amUPtr<zLibCompressor> m_Compressor;
 
 		const datCompileData* m_WriteData;
 		const wchar_t* m_Path;
@@ -62,7 +72,7 @@ namespace rage
 		void ResetWriteStats();
 		void PrintWriteStats() const;
 	public:
-		pgRscWriter() = default;
+		pgRscWriter(pgRscCompressionPreset preset = pgRscCompressDefault);
 
 		bool Write(const wchar_t* path, const datCompileData& writeData);
 	};
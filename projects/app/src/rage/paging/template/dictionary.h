@@ -32,7 +32,8 @@ namespace rage
 	template<typename T>
 	class pgDictionary : public pgBase
 	{
-		static inline pgDictionary* sm_Current = nullptr;
+		// Resources are placed in parallel, every thread has its own stack
+		static inline thread_local pgDictionary* sm_Current = nullptr;
 
 		// For pgTextureDictionary - parent from CTxdRelationship
 		pgPtr<pgDictionary> m_Parent;
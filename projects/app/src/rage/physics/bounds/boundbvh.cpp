@@ -59,7 +59,7 @@ rage::phPrimitive& rage::phBoundBVH::GetPrimitive(int index) const
 	return m_Polygons.Get()[index].GetPrimitive();
 }
 
-void rage::phBoundBVH::BuildBVH()
+void rage::phBoundBVH::BuildBVH(phBvhBuildMode mode)
 {
 	m_BVH = new phOptimizedBvh();
 	m_BVH->SetExtents(GetBoundingBox());
@@ -153,7 +153,7 @@ void rage::phBoundBVH::BuildBVH()
 	}
 
 	// This is where the tree is built
-	m_BVH->BuildFromPrimitiveData(primitiveDatas.get(), primitiveCount, 4);
+	m_BVH->BuildFromPrimitiveData(primitiveDatas.get(), primitiveCount, 4, mode);
 
 	// BVH sorts primitives internaly for faster access (they're indexed by start position and count)
 	// We have to manually remap bounds:
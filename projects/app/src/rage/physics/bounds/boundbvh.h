@@ -36,7 +36,8 @@ namespace rage
 		phPrimitive& GetPrimitive(int index) const;
 		int GetPrimitiveCount() const { return GetPolygonCount(); }
 
-		void BuildBVH();
+		// SAH builder is used by default, it produces trees with cheaper traversal and builds large trees faster
+		void BuildBVH(phBvhBuildMode mode = PH_BVH_BUILD_SAH);
 
 		phOptimizedBvh* GetBVH() const { return m_BVH.Get(); }
 
@@ -3,10 +3,254 @@
 #include "am/graphics/buffereditor.h"
 #include "am/graphics/shapetest.h"
 #include "am/integration/memory/address.h"
+#include "am/system/trace.h"
+#include "am/system/worker.h"
 #include "rage/atl/string.h"
 #include "rage/math/math.h"
 #include "rage/math/mathv.h"
 
+#include <algorithm>
+#include <atomic>
+
+namespace
+{
+	using namespace rage;
+
+	static constexpr u32 SHRINK_TEST_BATCH_SIZE = 256;	// Number of vertices tested by single job
+	static constexpr u32 SHRINK_TEST_LEAF_SIZE = 4;		// Max triangles in BVH leaf
+	static constexpr u32 SHRINK_TEST_MAX_DEPTH = 64;
+	static constexpr float SHRINK_TEST_BOX_EPSILON = 0.0001f;
+
+	// Decompressed original and shrunk vertices in SoA layout
+	struct ShrinkTestVertices
+	{
+		List<float> X, Y, Z;
+
+		void Resize(u32 count) { X.Resize(count); Y.Resize(count); Z.Resize(count); }
+		void Set(u32 index, const Vec3V& v) { X[index] = v.X(); Y[index] = v.Y(); Z[index] = v.Z(); }
+		Vec3V Get(u32 index) const { return Vec3V(X[index], Y[index], Z[index]); }
+	};
+
+	// Transient bounding volume hierarchy over original and shrunk polygons of phBoundGeometry,
+	// built once per shrink attempt to avoid testing every vertex segment against every polygon
+	class ShrinkTestBvh
+	{
+		struct Triangle
+		{
+			u32 Indices[3];		// In ShrinkTestVertices
+			u16 Source[3];		// Vertex indices in the bound, to skip polygons sharing tested vertex
+		};
+
+		struct Node
+		{
+			float Min[3];
+			float Max[3];
+			u32	  Start;		// Child index for inner node, first triangle for leaf
+			u32	  Count;		// Zero for inner node, right child is always Start + 1
+		};
+
+		List<Triangle>	m_Triangles;
+		List<Node>		m_Nodes;
+
+		void ComputeBounds(Node& node, const ShrinkTestVertices& vertices, const List<float>& centroids, float* centroidMin, float* centroidMax) const
+		{
+			for (int axis = 0; axis < 3; axis++)
+			{
+				node.Min[axis] = centroidMin[axis] = FLT_MAX;
+				node.Max[axis] = centroidMax[axis] = -FLT_MAX;
+			}
+
+			const List<float>* coords[] = { &vertices.X, &vertices.Y, &vertices.Z };
+			for (u32 i = node.Start; i < node.Start + node.Count; i++)
+			{
+				const Triangle& triangle = m_Triangles[i];
+				for (int axis = 0; axis < 3; axis++)
+				{
+					for (u32 index : triangle.Indices)
+					{
+						float value = (*coords[axis])[index];
+						node.Min[axis] = Min(node.Min[axis], value);
+						node.Max[axis] = Max(node.Max[axis], value);
+					}
+					float centroid = centroids[i * 3 + axis];
+					centroidMin[axis] = Min(centroidMin[axis], centroid);
+					centroidMax[axis] = Max(centroidMax[axis], centroid);
+				}
+			}
+
+			// Triangle test has tolerance, expand box slightly to not miss hits on the edges
+			for (int axis = 0; axis < 3; axis++)
+			{
+				node.Min[axis] -= SHRINK_TEST_BOX_EPSILON;
+				node.Max[axis] += SHRINK_TEST_BOX_EPSILON;
+			}
+		}
+
+		void BuildNode(u32 nodeIndex, const ShrinkTestVertices& vertices, List<float>& centroids, u32 depth)
+		{
+			float centroidMin[3];
+			float centroidMax[3];
+			ComputeBounds(m_Nodes[nodeIndex], vertices, centroids, centroidMin, centroidMax);
+
+			u32 start = m_Nodes[nodeIndex].Start;
+			u32 count = m_Nodes[nodeIndex].Count;
+			if (count <= SHRINK_TEST_LEAF_SIZE || depth == SHRINK_TEST_MAX_DEPTH)
+				return;
+
+			// Median split along the longest axis of centroid bounds
+			int axis = 0;
+			for (int i = 1; i < 3; i++)
+			{
+				if (centroidMax[i] - centroidMin[i] > centroidMax[axis] - centroidMin[axis])
+					axis = i;
+			}
+
+			List<u32> order;
+			order.Resize(count);
+			for (u32 i = 0; i < count; i++)
+				order[i] = start + i;
+
+			u32 half = count / 2;
+			std::nth_element(order.begin(), order.begin() + half, order.end(), [&](u32 left, u32 right)
+				{
+					return centroids[left * 3 + axis] < centroids[right * 3 + axis];
+				});
+
+			// Reorder triangles and their centroids in the node range
+			List<Triangle> triangles;
+			List<float> triangleCentroids;
+			triangles.Reserve(count);
+			triangleCentroids.Reserve(count * 3);
+			for (u32 index : order)
+			{
+				triangles.Add(m_Triangles[index]);
+				for (int k = 0; k < 3; k++)
+					triangleCentroids.Add(centroids[index * 3 + k]);
+			}
+			memcpy(m_Triangles.GetItems() + start, triangles.GetItems(), sizeof(Triangle) * count);
+			memcpy(centroids.GetItems() + start * 3, triangleCentroids.GetItems(), sizeof(float) * count * 3);
+
+			u32 childIndex = m_Nodes.GetSize();
+			m_Nodes[nodeIndex].Start = childIndex;
+			m_Nodes[nodeIndex].Count = 0;
+
+			Node& left = m_Nodes.Construct();
+			left.Start = start;
+			left.Count = half;
+			Node& right = m_Nodes.Construct();
+			right.Start = start + half;
+			right.Count = count - half;
+
+			BuildNode(childIndex, vertices, centroids, depth + 1);
+			BuildNode(childIndex + 1, vertices, centroids, depth + 1);
+		}
+
+	public:
+		void Build(const phBoundGeometry& bound, const ShrinkTestVertices& vertices)
+		{
+			u32 numVertices = vertices.X.GetSize() / 2;
+			u32 numPolygons = bound.GetPolygonCount();
+
+			m_Triangles.Reserve(numPolygons * 2);
+			List<float> centroids;
+			centroids.Reserve(numPolygons * 2 * 3);
+			for (u32 i = 0; i < numPolygons; i++)
+			{
+				const phPolygon& poly = bound.GetPolygon(static_cast<u16>(i));
+
+				// Original polygon and the shrunk one
+				for (u32 offset : { 0u, numVertices })
+				{
+					Triangle& triangle = m_Triangles.Construct();
+					for (u32 k = 0; k < 3; k++)
+					{
+						triangle.Source[k] = poly.GetVertexIndex(k);
+						triangle.Indices[k] = offset + triangle.Source[k];
+					}
+					centroids.Add((vertices.X[triangle.Indices[0]] + vertices.X[triangle.Indices[1]] + vertices.X[triangle.Indices[2]]) / 3.0f);
+					centroids.Add((vertices.Y[triangle.Indices[0]] + vertices.Y[triangle.Indices[1]] + vertices.Y[triangle.Indices[2]]) / 3.0f);
+					centroids.Add((vertices.Z[triangle.Indices[0]] + vertices.Z[triangle.Indices[1]] + vertices.Z[triangle.Indices[2]]) / 3.0f);
+				}
+			}
+
+			// Binary tree with leaves of at least one triangle has less than 2N nodes
+			m_Nodes.Reserve(m_Triangles.GetSize() * 2);
+			Node& root = m_Nodes.Construct();
+			root.Start = 0;
+			root.Count = m_Triangles.GetSize();
+			BuildNode(0, vertices, centroids, 0);
+		}
+
+		// Tests segment from shrunk vertex to original one against all polygons that don't share the vertex
+		bool SegmentIntersects(const ShrinkTestVertices& vertices, u32 vertexIndex) const
+		{
+			u32 numVertices = vertices.X.GetSize() / 2;
+
+			Vec3V vertex = vertices.Get(vertexIndex);
+			Vec3V segmentPos = vertices.Get(numVertices + vertexIndex);
+			Vec3V segmentDir = vertex - segmentPos;
+			ScalarV segmentLength = segmentDir.Length();
+			float maxDistance = segmentLength.Get();
+
+			// Vertex wasn't moved at all
+			if (maxDistance == 0.0f)
+				return false;
+
+			segmentDir /= segmentLength;
+
+			float origin[3] = { segmentPos.X(), segmentPos.Y(), segmentPos.Z() };
+			float invDir[3] = { 1.0f / segmentDir.X(), 1.0f / segmentDir.Y(), 1.0f / segmentDir.Z() };
+
+			u32 stack[SHRINK_TEST_MAX_DEPTH + 2];
+			u32 stackSize = 0;
+			stack[stackSize++] = 0;
+			while (stackSize > 0)
+			{
+				const Node& node = m_Nodes[stack[--stackSize]];
+
+				// Slab test, NaN (zero direction on the box plane) fails comparisons and keeps the node
+				float tMin = 0.0f;
+				float tMax = maxDistance;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					float t1 = (node.Min[axis] - origin[axis]) * invDir[axis];
+					float t2 = (node.Max[axis] - origin[axis]) * invDir[axis];
+					if (t1 > t2) std::swap(t1, t2);
+					if (t1 > tMin) tMin = t1;
+					if (t2 < tMax) tMax = t2;
+				}
+				if (tMin > tMax)
+					continue;
+
+				if (node.Count == 0)
+				{
+					stack[stackSize++] = node.Start;
+					stack[stackSize++] = node.Start + 1;
+					continue;
+				}
+
+				for (u32 i = node.Start; i < node.Start + node.Count; i++)
+				{
+					const Triangle& triangle = m_Triangles[i];
+
+					// Intersection test is done against other polygons, so we must exclude polygons that share current vertex
+					if (triangle.Source[0] == vertexIndex || triangle.Source[1] == vertexIndex || triangle.Source[2] == vertexIndex)
+						continue;
+
+					float distance;
+					if (!rageam::graphics::ShapeTest::RayIntersectsTriangle(segmentPos, segmentDir,
+						vertices.Get(triangle.Indices[0]), vertices.Get(triangle.Indices[1]), vertices.Get(triangle.Indices[2]), distance))
+						continue;
+
+					if (distance <= maxDistance)
+						return true;
+				}
+			}
+			return false;
+		}
+	};
+}
+
 void rage::phBoundPolyhedron::ComputeBoundingBoxCenter()
 {
 	m_BoundingBoxCenter = (m_BoundingBoxMax + m_BoundingBoxMin) * 0.5f;
@@ -618,58 +862,50 @@ void rage::phBoundGeometry::ShrinkPolysOrVertsByMargin(float margin, float t, Ve
 
 bool rage::phBoundGeometry::TryShrinkByMargin(float margin, float t, Vec3V* outShrunkVertices) const
 {
+	AM_TRACE_FUNCTION();
+
 	ShrinkPolysOrVertsByMargin(margin, t, outShrunkVertices);
 
-	// In order to do success shrinking, we have to make sure that no polygons collide with each other
-	for (u32 vertexIndex = 0; vertexIndex < m_NumVertices; vertexIndex++)
-	{
-		Vec3V vertex = DecompressVertex(vertexIndex);
-		Vec3V shrunkVertex = outShrunkVertices[vertexIndex];
+	if (m_NumPolygons == 0)
+		return true;
 
-		Vec3V segmentPos = shrunkVertex;
-		Vec3V segmentDir = vertex - shrunkVertex;
-		ScalarV segmentLength = segmentDir.Length();
-		segmentDir /= segmentLength;
+	// In order to do success shrinking, we have to make sure that no polygons collide with each other,
+	// segment from every shrunk vertex to original one must not intersect any other (original or shrunk) polygon
 
-		// Line segment intersection
-		float maxDistance = segmentLength.Get();
-		auto intersectTest = [&](const Vec3V& v1, const Vec3V& v2, const Vec3V& v3)
-			{
-				float distance;
-				if (!rageam::graphics::ShapeTest::RayIntersectsTriangle(segmentPos, segmentDir, v1, v2, v3, distance))
-					return false;
+	// Decompress everything once, original vertices go first and shrunk ones after them
+	u32 numVertices = m_NumVertices;
+	ShrinkTestVertices vertices;
+	vertices.Resize(numVertices * 2);
+	for (u32 i = 0; i < numVertices; i++)
+	{
+		vertices.Set(i, DecompressVertex(i));
+		vertices.Set(numVertices + i, outShrunkVertices[i]);
+	}
 
-				return distance <= maxDistance;
-			};
+	ShrinkTestBvh bvh;
+	bvh.Build(*this, vertices);
 
-		for (u32 polygonIndex = 0; polygonIndex < m_NumPolygons; polygonIndex++)
+	// Single intersection fails the test, remaining batches are skipped
+	std::atomic_bool intersects = false;
+	u32 batchCount = (numVertices + SHRINK_TEST_BATCH_SIZE - 1) / SHRINK_TEST_BATCH_SIZE;
+	rageam::BackgroundWorker::ParallelFor(batchCount, [&](u32 batch)
 		{
-			phPolygon& poly = GetPolygon(polygonIndex);
+			if (intersects)
+				return;
 
-			u16 vi1 = poly.GetVertexIndex(0);
-			u16 vi2 = poly.GetVertexIndex(1);
-			u16 vi3 = poly.GetVertexIndex(2);
-
-			// Intersection test is done against other polygons, so we must exclude polygons that share current vertex
-			if (vi1 == vertexIndex || vi2 == vertexIndex || vi3 == vertexIndex)
-				continue;
-
-			// Check intersection against non-shrunk polygon
-			Vec3V v1 = DecompressVertex(vi1);
-			Vec3V v2 = DecompressVertex(vi2);
-			Vec3V v3 = DecompressVertex(vi3);
-			if (intersectTest(v1, v2, v3))
-				return false;
+			u32 batchStart = batch * SHRINK_TEST_BATCH_SIZE;
+			u32 batchEnd = Min(batchStart + SHRINK_TEST_BATCH_SIZE, numVertices);
+			for (u32 vertexIndex = batchStart; vertexIndex < batchEnd; vertexIndex++)
+			{
+				if (bvh.SegmentIntersects(vertices, vertexIndex))
+				{
+					intersects = true;
+					return;
+				}
+			}
+		});
 
-			// Against shrunk polygon
-			Vec3V vs1 = outShrunkVertices[vi1];
-			Vec3V vs2 = outShrunkVertices[vi2];
-			Vec3V vs3 = outShrunkVertices[vi3];
-			if (intersectTest(vs1, vs2, vs3))
-				return false;
-		}
-	}
-	return true;
+	return !intersects;
 }
 
 rage::phBoundGeometry::phBoundGeometry()
@@ -1,9 +1,228 @@
 #include "optimizedbvh.h"
 
 #include "am/integration/memory/address.h"
+#include "am/system/worker.h"
 #include "common/logger.h"
 #include "rage/atl/string.h"
 
+struct rage::phBvhSahNode
+{
+	s16 AABBMin[3];
+	s16 AABBMax[3];
+	int StartIndex;
+	int PrimitiveCount;
+	int NodeCount;	// Total number of nodes in this subtree, including this one
+
+	amUPtr<phBvhSahNode> Left;
+	amUPtr<phBvhSahNode> Right;
+
+	bool IsLeafNode() const { return Left == nullptr; }
+};
+
+namespace
+{
+	using namespace rage;
+
+	static constexpr int SAH_BIN_COUNT = 16;
+	static constexpr int SAH_PARALLEL_DEPTH = 5;				// Up to 32 subtrees are built in parallel
+	static constexpr int SAH_PARALLEL_MIN_PRIMITIVES = 4096;	// Smaller subtrees are not worth scheduling task for
+	static constexpr int SAH_MAX_DEPTH = 48;					// Deeper levels are split in the middle to keep recursion bounded
+
+	struct SahBounds
+	{
+		s32 AABBMin[3] = { INT32_MAX, INT32_MAX, INT32_MAX };
+		s32 AABBMax[3] = { INT32_MIN, INT32_MIN, INT32_MIN };
+
+		void Add(const s16 min[3], const s16 max[3])
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				AABBMin[i] = Min(AABBMin[i], static_cast<s32>(min[i]));
+				AABBMax[i] = Max(AABBMax[i], static_cast<s32>(max[i]));
+			}
+		}
+
+		void Add(const SahBounds& other) { Add(other.AABBMin, other.AABBMax); }
+		void Add(const s32 min[3], const s32 max[3])
+		{
+			for (int i = 0; i < 3; i++)
+			{
+				AABBMin[i] = Min(AABBMin[i], min[i]);
+				AABBMax[i] = Max(AABBMax[i], max[i]);
+			}
+		}
+
+		// Half of surface area, constant factor doesn't matter for comparing costs
+		float GetArea() const
+		{
+			if (AABBMin[0] > AABBMax[0])
+				return 0.0f;
+
+			float x = static_cast<float>(AABBMax[0] - AABBMin[0]);
+			float y = static_cast<float>(AABBMax[1] - AABBMin[1]);
+			float z = static_cast<float>(AABBMax[2] - AABBMin[2]);
+			return x * y + y * z + z * x;
+		}
+	};
+
+	struct SahBin
+	{
+		SahBounds Bounds;
+		int		  Count = 0;
+	};
+
+	// Doubled AABB center, same as SortPrimitivesAlongAxes uses
+	s32 GetPrimitiveCenter(const phBvhPrimitiveData& primitive, int axis)
+	{
+		return s32(primitive.AABBMin[axis]) + s32(primitive.AABBMax[axis]);
+	}
+
+	int GetSahBinIndex(s32 center, s32 centerMin, s32 centerExtent)
+	{
+		s64 bin = static_cast<s64>(center - centerMin) * SAH_BIN_COUNT / (static_cast<s64>(centerExtent) + 1);
+		return static_cast<int>(bin);
+	}
+
+	// Without main worker (for e.g. in unit tests) tree is built on calling thread
+	rageam::TaskScheduler* GetSahScheduler()
+	{
+		return rageam::BackgroundWorker::GetMainInstance() ? rageam::BackgroundWorker::GetInstance()->GetScheduler() : nullptr;
+	}
+
+	amUPtr<phBvhSahNode> BuildSahNode(phBvhPrimitiveData* primitives, int startIndex, int endIndex, int maxPrimitivesPerNode, int depth)
+	{
+		amUPtr<phBvhSahNode> node = std::make_unique<phBvhSahNode>();
+		node->StartIndex = startIndex;
+		node->PrimitiveCount = endIndex - startIndex;
+		node->NodeCount = 1;
+
+		SahBounds bounds;
+		SahBounds centerBounds;
+		for (int i = startIndex; i < endIndex; i++)
+		{
+			const phBvhPrimitiveData& primitive = primitives[i];
+			bounds.Add(primitive.AABBMin, primitive.AABBMax);
+
+			s32 center[3] = { GetPrimitiveCenter(primitive, 0), GetPrimitiveCenter(primitive, 1), GetPrimitiveCenter(primitive, 2) };
+			centerBounds.Add(center, center);
+		}
+		for (int i = 0; i < 3; i++)
+		{
+			node->AABBMin[i] = static_cast<s16>(bounds.AABBMin[i]);
+			node->AABBMax[i] = static_cast<s16>(bounds.AABBMax[i]);
+		}
+
+		// Same as native builder, we always fill leaf with max number of primitives,
+		// splitting it further would give slightly cheaper traversal but tree with escape index is limited to 64K nodes
+		int primitiveCount = endIndex - startIndex;
+		if (primitiveCount <= maxPrimitivesPerNode)
+			return node;
+
+		// Find the cheapest split plane between bins on all axes
+		float bestCost = FLT_MAX;
+		int	  bestAxis = -1;
+		int	  bestBin = 0;
+		for (int axis = 0; axis < 3 && depth < SAH_MAX_DEPTH; axis++)
+		{
+			s32 centerMin = centerBounds.AABBMin[axis];
+			s32 centerExtent = centerBounds.AABBMax[axis] - centerMin;
+			if (centerExtent == 0)
+				continue;
+
+			SahBin bins[SAH_BIN_COUNT];
+			for (int i = startIndex; i < endIndex; i++)
+			{
+				const phBvhPrimitiveData& primitive = primitives[i];
+				SahBin& bin = bins[GetSahBinIndex(GetPrimitiveCenter(primitive, axis), centerMin, centerExtent)];
+				bin.Bounds.Add(primitive.AABBMin, primitive.AABBMax);
+				bin.Count++;
+			}
+
+			// Sweep from the right to get area & count of every right side, then from the left evaluating the cost
+			float rightAreas[SAH_BIN_COUNT];
+			int	  rightCounts[SAH_BIN_COUNT];
+			SahBounds rightBounds;
+			int rightCount = 0;
+			for (int i = SAH_BIN_COUNT - 1; i > 0; i--)
+			{
+				rightBounds.Add(bins[i].Bounds);
+				rightCount += bins[i].Count;
+				rightAreas[i] = rightBounds.GetArea();
+				rightCounts[i] = rightCount;
+			}
+
+			SahBounds leftBounds;
+			int leftCount = 0;
+			for (int i = 0; i < SAH_BIN_COUNT - 1; i++)
+			{
+				leftBounds.Add(bins[i].Bounds);
+				leftCount += bins[i].Count;
+				if (leftCount == 0 || rightCounts[i + 1] == 0)
+					continue;
+
+				float cost = leftBounds.GetArea() * static_cast<float>(leftCount) + rightAreas[i + 1] * static_cast<float>(rightCounts[i + 1]);
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					bestAxis = axis;
+					bestBin = i + 1;
+				}
+			}
+		}
+
+		int splitIndex;
+		if (bestAxis != -1)
+		{
+			s32 centerMin = centerBounds.AABBMin[bestAxis];
+			s32 centerExtent = centerBounds.AABBMax[bestAxis] - centerMin;
+			phBvhPrimitiveData* split = std::partition(primitives + startIndex, primitives + endIndex,
+				[&](const phBvhPrimitiveData& primitive)
+				{
+					return GetSahBinIndex(GetPrimitiveCenter(primitive, bestAxis), centerMin, centerExtent) < bestBin;
+				});
+			splitIndex = static_cast<int>(split - primitives);
+		}
+		else
+		{
+			// All centers are in the same point or tree is too deep, split in the middle along the longest axis
+			int axis = 0;
+			for (int i = 1; i < 3; i++)
+			{
+				if (centerBounds.AABBMax[i] - centerBounds.AABBMin[i] > centerBounds.AABBMax[axis] - centerBounds.AABBMin[axis])
+					axis = i;
+			}
+
+			splitIndex = (startIndex + endIndex) / 2;
+			std::nth_element(primitives + startIndex, primitives + splitIndex, primitives + endIndex,
+				[axis](const phBvhPrimitiveData& left, const phBvhPrimitiveData& right)
+				{
+					return GetPrimitiveCenter(left, axis) < GetPrimitiveCenter(right, axis);
+				});
+		}
+
+		// Build the sub-trees for our left and right children, large ones near the root are built in parallel
+		rageam::TaskScheduler* scheduler = GetSahScheduler();
+		if (scheduler && depth < SAH_PARALLEL_DEPTH && primitiveCount >= SAH_PARALLEL_MIN_PRIMITIVES)
+		{
+			rageam::TaskGroup group(scheduler);
+			group.Run([&]
+				{
+					node->Left = BuildSahNode(primitives, startIndex, splitIndex, maxPrimitivesPerNode, depth + 1);
+				});
+			node->Right = BuildSahNode(primitives, splitIndex, endIndex, maxPrimitivesPerNode, depth + 1);
+			group.Wait();
+		}
+		else
+		{
+			node->Left = BuildSahNode(primitives, startIndex, splitIndex, maxPrimitivesPerNode, depth + 1);
+			node->Right = BuildSahNode(primitives, splitIndex, endIndex, maxPrimitivesPerNode, depth + 1);
+		}
+
+		node->NodeCount += node->Left->NodeCount + node->Right->NodeCount;
+		return node;
+	}
+}
+
 int rage::phOptimizedBvh::CalculateSplittingIndex(int startIndex, int endIndex, int maxPrimitivesPerNode) const
 {
 	// One option for picking our initial splitting index is simply to chop it in half (splitting at the median)
@@ -138,11 +357,47 @@ rage::phOptimizedBvhNode* rage::phOptimizedBvh::BuildTree(phBvhPrimitiveData* pr
 
 	node.SetEscapeIndex(m_NumNodesInUse - currentIndex);
 
+	AddSubtreeHeaders(*leftChild, *rightChild);
+
+	node.CombineAABBs(*leftChild, *rightChild);
+
+	return &node;
+}
+
+rage::phOptimizedBvhNode* rage::phOptimizedBvh::EmitSahTree(const phBvhSahNode& buildNode)
+{
+	int currentIndex = m_NumNodesInUse++;
+	phOptimizedBvhNode& node = m_ContiniousNodes[currentIndex];
+
+	if (buildNode.IsLeafNode())
+	{
+		node.SetPrimitiveCount(buildNode.PrimitiveCount);
+		node.SetPrimitiveIndex(buildNode.StartIndex);
+		memcpy(node.AABBMin, buildNode.AABBMin, sizeof node.AABBMin);
+		memcpy(node.AABBMax, buildNode.AABBMax, sizeof node.AABBMax);
+		return &node;
+	}
+
+	phOptimizedBvhNode* leftChild = EmitSahTree(*buildNode.Left);
+	phOptimizedBvhNode* rightChild = EmitSahTree(*buildNode.Right);
+
+	node.Reset();
+	node.SetEscapeIndex(m_NumNodesInUse - currentIndex);
+
+	AddSubtreeHeaders(*leftChild, *rightChild);
+
+	node.CombineAABBs(*leftChild, *rightChild);
+
+	return &node;
+}
+
+void rage::phOptimizedBvh::AddSubtreeHeaders(phOptimizedBvhNode& leftChild, phOptimizedBvhNode& rightChild)
+{
 	constexpr int MAX_SUBTREE_SIZE = 128 * sizeof phOptimizedBvhNode;
 
 	// The escape index tells us by how many nodes to skip ahead, thereby telling us the size of the subtree
-	int leftSubTreeMaxCount = leftChild->GetEscapeIndex();
-	int rightSubTreeMaxCount = rightChild->GetEscapeIndex();
+	int leftSubTreeMaxCount = leftChild.GetEscapeIndex();
+	int rightSubTreeMaxCount = rightChild.GetEscapeIndex();
 	int leftSubTreeSize = leftSubTreeMaxCount * sizeof phOptimizedBvhNode;
 	int rightSubTreeSize = rightSubTreeMaxCount * sizeof phOptimizedBvhNode;
 	if (leftSubTreeSize + rightSubTreeSize >= MAX_SUBTREE_SIZE)
@@ -156,15 +411,39 @@ rage::phOptimizedBvhNode* rage::phOptimizedBvh::BuildTree(phBvhPrimitiveData* pr
 			};
 
 		if (leftSubTreeSize <= MAX_SUBTREE_SIZE)
-			createSubtreeInfo(*leftChild);
+			createSubtreeInfo(leftChild);
 
 		if (rightSubTreeSize <= MAX_SUBTREE_SIZE)
-			createSubtreeInfo(*rightChild);
+			createSubtreeInfo(rightChild);
 	}
+}
 
-	node.CombineAABBs(*leftChild, *rightChild);
+void rage::phOptimizedBvh::AllocateNodes(int nodeCount)
+{
+	m_NumNodes = nodeCount;
+	m_NumSubtreeHeaders = Max(m_NumNodes / 2, 1);
+	m_ContiniousNodes = new phOptimizedBvhNode[m_NumNodes];
+	m_SubtreeHeaders = new phOptimizedBvhSubtreeInfo[m_NumSubtreeHeaders];
+}
 
-	return &node;
+void rage::phOptimizedBvh::ResetNodes()
+{
+	m_NumNodesInUse = 0;
+	m_CurSubtreeHeaderIndex = 0;
+	for (int i = 0; i < m_NumNodes; i++)
+		m_ContiniousNodes[i].Reset();
+}
+
+void rage::phOptimizedBvh::FinalizeSubtreeHeaders()
+{
+	// Tree was too small to generate any subtree headers
+	if (m_CurSubtreeHeaderIndex == 0)
+	{
+		m_SubtreeHeaders[0].SetAABBFromNode(m_ContiniousNodes[0]);
+		m_SubtreeHeaders[0].RootNodeIndex = 0;
+		m_SubtreeHeaders[0].EndIndex = m_NumNodesInUse;
+		m_CurSubtreeHeaderIndex = 1;
+	}
 }
 
 rage::phOptimizedBvh::phOptimizedBvh()
@@ -192,8 +471,8 @@ rage::phOptimizedBvh::~phOptimizedBvh()
 
 void rage::phOptimizedBvh::Destroy()
 {
-	delete m_ContiniousNodes;
-	delete m_SubtreeHeaders;
+	delete[] m_ContiniousNodes;
+	delete[] m_SubtreeHeaders;
 
 	m_NumNodes = 0;
 	m_NumNodesInUse = 0;
@@ -252,37 +531,41 @@ void rage::phOptimizedBvh::BuildFromPrimitiveDataNoAllocate(phBvhPrimitiveData*
 {
 	AM_ASSERT(IS_POWER_OF_TWO(maxPrimitivesPerNode), "phOptimizedBvh::BuildFromPrimitiveDataNoAllocate() -> Max primitive count must be power of two!");
 
-	m_NumNodesInUse = 0;
-	m_CurSubtreeHeaderIndex = 0;
-	for (int i = 0; i < m_NumNodes; i++)
-		m_ContiniousNodes[i].Reset();
+	ResetNodes();
 
 	if (count == 0)
 		return;
 
 	BuildTree(primitives, 0, count, maxPrimitivesPerNode);
-
-	// Tree was too small to generate any subtree headers
-	if (m_CurSubtreeHeaderIndex == 0)
-	{
-		m_SubtreeHeaders[0].SetAABBFromNode(m_ContiniousNodes[0]);
-		m_SubtreeHeaders[0].RootNodeIndex = 0;
-		m_SubtreeHeaders[0].EndIndex = m_NumNodesInUse;
-		m_CurSubtreeHeaderIndex = 1;
-	}
+	FinalizeSubtreeHeaders();
 }
 
-void rage::phOptimizedBvh::BuildFromPrimitiveData(phBvhPrimitiveData* primitives, int count, int maxPrimitivesPerNode)
+void rage::phOptimizedBvh::BuildFromPrimitiveData(phBvhPrimitiveData* primitives, int count, int maxPrimitivesPerNode, phBvhBuildMode mode)
 {
 	Destroy();
 	if (count == 0)
 		return;
 
+	if (mode == PH_BVH_BUILD_SAH)
+	{
+		// Number of nodes depends on leaf sizes picked by SAH, build temporary tree first to allocate exact amount
+		amUPtr<phBvhSahNode> root = BuildSahNode(primitives, 0, count, maxPrimitivesPerNode, 0);
+
+		// Escape index is 16 bit
+		if (root->NodeCount <= UINT16_MAX)
+		{
+			AllocateNodes(root->NodeCount);
+			ResetNodes();
+			EmitSahTree(*root);
+			FinalizeSubtreeHeaders();
+			return;
+		}
+
+		AM_WARNINGF("phOptimizedBvh::BuildFromPrimitiveData() -> SAH tree has too many nodes (%i), falling back to median split.", root->NodeCount);
+	}
+
 	// Approximate number of nodes to allocate, this is may produce 1-2 more nodes than actually needed
-	m_NumNodes = 2 * count / maxPrimitivesPerNode + 1;
-	m_NumSubtreeHeaders = Max(m_NumNodes / 2, 1);
-	m_ContiniousNodes = new phOptimizedBvhNode[m_NumNodes];
-	m_SubtreeHeaders = new phOptimizedBvhSubtreeInfo[m_NumSubtreeHeaders];
+	AllocateNodes(2 * count / maxPrimitivesPerNode + 1);
 
 	BuildFromPrimitiveDataNoAllocate(primitives, count, maxPrimitivesPerNode);
 }
@@ -293,6 +576,12 @@ rage::phOptimizedBvhNode& rage::phOptimizedBvh::GetNode(int index) const
 	return m_ContiniousNodes[index];
 }
 
+const rage::phOptimizedBvhSubtreeInfo& rage::phOptimizedBvh::GetSubtreeHeader(int index) const
+{
+	AM_ASSERTS(index >= 0 && index < m_CurSubtreeHeaderIndex);
+	return m_SubtreeHeaders[index];
+}
+
 rage::spdAABB rage::phOptimizedBvh::GetNodeAABB(const phOptimizedBvhNode& node) const
 {
 	return spdAABB(UnQuantize(node.AABBMin), UnQuantize(node.AABBMax));
@@ -18,6 +18,15 @@ namespace rage
 	// NOTE: Native implementation uses term 'Polygon' for simplest shapes, we use 'Primitive' instead,
 	// to prevent confusion with phPolygon
 
+	enum phBvhBuildMode
+	{
+		PH_BVH_BUILD_MEDIAN,	// Native builder, splits primitives in the middle along axis with the largest variance
+		PH_BVH_BUILD_SAH,		// Binned surface area heuristic, top levels are built in parallel. Gives cheaper traversal
+	};
+
+	// Temporary tree node of SAH builder, see optimizedbvh.cpp
+	struct phBvhSahNode;
+
 	/**
 	 * \brief Used when building BVH tree.
 	 */
@@ -105,6 +114,15 @@ namespace rage
 		int CalculateSplittingAxis(phBvhPrimitiveData* primitives, int startIndex, int endIndex, int& middleAxis) const;
 		void SortPrimitivesAlongAxes(phBvhPrimitiveData* primitives, int startIndex, int endIndex, int axis1, int axis2) const;
 		phOptimizedBvhNode* BuildTree(phBvhPrimitiveData* primitives, int startIndex, int endIndex, int maxPrimitivesPerNode, int lastSortAxis = -1);
+		// Writes tree built by SAH builder to node array in the same (depth first, escape index) layout as BuildTree does
+		phOptimizedBvhNode* EmitSahTree(const phBvhSahNode& buildNode);
+		// Adds subtree headers for children if their parent subtree is too large
+		void AddSubtreeHeaders(phOptimizedBvhNode& leftChild, phOptimizedBvhNode& rightChild);
+
+		void AllocateNodes(int nodeCount);
+		void ResetNodes();
+		// Adds header for the whole tree if none was created during build
+		void FinalizeSubtreeHeaders();
 
 	public:
 		phOptimizedBvh();
@@ -127,12 +145,15 @@ namespace rage
 		// You have to remap all primitives by hand after building the tree.
 
 		// Used when BVH needs to be updated without re-allocating tree nodes (meaning number of elements didn't change)
+		// NOTE: Always uses median split, number of nodes in SAH tree depends on primitive positions and may not fit in allocated nodes
 		void BuildFromPrimitiveDataNoAllocate(phBvhPrimitiveData* primitives, int count, int maxPrimitivesPerNode);
 		// Builds the tree from scratch, destroying existing one
-		void BuildFromPrimitiveData(phBvhPrimitiveData* primitives, int count, int maxPrimitivesPerNode);
+		void BuildFromPrimitiveData(phBvhPrimitiveData* primitives, int count, int maxPrimitivesPerNode, phBvhBuildMode mode = PH_BVH_BUILD_MEDIAN);
 
 		int GetNodeCount() const { return m_NumNodesInUse; }
 		phOptimizedBvhNode& GetNode(int index) const;
+		int GetSubtreeHeaderCount() const { return m_CurSubtreeHeaderIndex; }
+		const phOptimizedBvhSubtreeInfo& GetSubtreeHeader(int index) const;
 		spdAABB GetNodeAABB(const phOptimizedBvhNode& node) const;
 
 		// Iterates all nodes as they're ordered in array (from first to end), but also keeps up depth level
@@ -375,26 +375,62 @@ void rage::sysMemSimpleAllocator::PrintState() const
 #endif
 }
 
+struct rage::sysMemSimpleAllocator::OperationLogRecord
+{
+	const sysMemSimpleAllocator* Allocator;
+	const char*					 Operation; // String literal
+	pVoid						 Address;
+	u32							 AllocID;
+	u32							 BlockSize;
+	u32							 Bucket;
+	u16							 FrameCount;
+	u64							 Frames[rageam::STACKTRACE_MAX_FRAMES]; // Only FrameCount are copied to log queue
+};
+
 AM_NOINLINE void rage::sysMemSimpleAllocator::PrintLogFor(const char* operation, const Node* node) const
 {
 #ifdef ENABLE_ALLOCATOR_OPERATION_LOG
 	if (!m_LogStream)
 		return;
 
+	// Symbols are resolved and file is written on log writer thread, here only raw frames are captured
+	OperationLogRecord record;
+	record.Allocator = this;
+	record.Operation = operation;
+	record.Address = (pVoid)node->GetBlockAddress();
+	record.AllocID = node->GetAllocID();
+	record.BlockSize = node->BlockSize;
+	record.Bucket = node->GetMemoryBucket();
+	record.FrameCount = 0;
+	if (m_TraceStack)
+		record.FrameCount = rageam::StackTracer::CaptureFrames(record.Frames, rageam::STACKTRACE_MAX_FRAMES, 1 /* PrintLogFor */);
+
+	// Warning level so record waits for space instead of being dropped, log must be complete
+	u32 recordSize = static_cast<u32>(offsetof(OperationLogRecord, Frames) + sizeof(u64) * record.FrameCount);
+	rageam::Logger::LogDeferred(WriteOperationLog, &record, recordSize, LOG_WARNING);
+#endif
+}
+
+void rage::sysMemSimpleAllocator::WriteOperationLog(pConstVoid payload, u32 payloadSize)
+{
+	auto record = static_cast<const OperationLogRecord*>(payload);
+	const sysMemSimpleAllocator* allocator = record->Allocator;
+	if (!allocator->m_LogStream)
+		return;
+
 	// op,ptr,allocId,size,bucket,stack
-	m_LogStream->WriteLinef("%s, 0x%p, %s, %u, %u\n",
-		operation, (pVoid)node->GetBlockAddress(), FormatAllocID(node->GetAllocID()),
-		node->BlockSize, node->GetMemoryBucket());
+	allocator->m_LogStream->WriteLinef("%s, 0x%p, %s, %u, %u\n",
+		record->Operation, record->Address, allocator->FormatAllocID(record->AllocID),
+		record->BlockSize, record->Bucket);
 
-	if (m_TraceStack)
+	if (record->FrameCount != 0)
 	{
 		static char buffer[rageam::STACKTRACE_BUFFER_SIZE];
-		rageam::StackTracer::CaptureAndWriteTo(buffer, rageam::STACKTRACE_BUFFER_SIZE, 1 /* PrintLogFor */);
-		m_LogStream->WriteLine(buffer);
+		rageam::StackTracer::WriteFramesTo(record->Frames, record->FrameCount, buffer, rageam::STACKTRACE_BUFFER_SIZE);
+		allocator->m_LogStream->WriteLine(buffer);
 	}
 
-	m_LogStream->WriteLine("\n");
-#endif
+	allocator->m_LogStream->WriteLine("\n");
 }
 
 const char* rage::sysMemSimpleAllocator::FormatAllocID(u32 id) const
@@ -958,6 +994,9 @@ void rage::sysMemSimpleAllocator::EndMemoryLog()
 	if (!m_LogStream)
 		return;
 
+	// Operations are still queued
+	rageam::Logger::Flush();
+
 	if (m_TraceStack)
 		rageam::StackTracer::FreeSymbols();
 
@@ -253,8 +253,13 @@ namespace rage
 		// Prints out all free blocks and their sizes in allocator log stream.
 		void PrintState() const;
 
+		// Operation with raw stack frames, written to log stream on log writer thread.
+		struct OperationLogRecord;
+
 		// Prints operation log if it was started using BeginMemoryLog.
 		void PrintLogFor(const char* operation, const Node* node) const;
+		// Writes OperationLogRecord to log stream, resolving stack frames.
+		static void WriteOperationLog(pConstVoid payload, u32 payloadSize);
 
 		// For easier search inside logs, format each alloc id as unique identifier.
 		const char* FormatAllocID(u32 id) const;
@@ -0,0 +1,130 @@
+#include "parallel.h"
+
+#include "am/system/worker.h"
+#include "am/types.h"
+
+#include <atomic>
+
+namespace
+{
+	struct zLibParallelBlock
+	{
+		List<char>		 Compressed;
+		u32				 CompressedSize = 0;
+		std::atomic_bool Done = false;
+	};
+
+	void CompressBlock(int level, const char* data, u32 dataSize, u32 blockIndex, zLibParallelBlock& block)
+	{
+		u32 blockStart = blockIndex * ZLIB_PARALLEL_BLOCK_SIZE;
+		u32 blockSize = MIN(ZLIB_PARALLEL_BLOCK_SIZE, dataSize - blockStart);
+
+		zStream_t stream = {};
+		int status = Z_DEFLATE_INIT2(&stream, level, Z_DEFLATED, ZLIB_WINDOW_BITS, ZLIB_MEMORY_LEVEL, Z_DEFAULT_STRATEGY);
+		AM_ASSERT(status >= 0, "zLibParallelCompressor() -> Init failed with status %i", status);
+
+		// Prime with the end of previous block, decompressor will have it in the window when reaching this block
+		if (blockStart > 0)
+		{
+			u32 dictionarySize = MIN(blockStart, ZLIB_DICTIONARY_SIZE);
+			status = Z_DEFLATE_SET_DICTIONARY(&stream, (zBuffer_t)(data + blockStart - dictionarySize), dictionarySize);
+			AM_ASSERT(status >= 0, "zLibParallelCompressor() -> Failed to set dictionary, status %i", status);
+		}
+
+		// Sync flush adds empty stored block at the end
+		u32 bound = static_cast<u32>(Z_DEFLATE_BOUND(&stream, blockSize)) + 64;
+		block.Compressed.Resize(bound);
+
+		stream.next_in = (zBuffer_t)(data + blockStart);
+		stream.avail_in = blockSize;
+		stream.next_out = (zBuffer_t)block.Compressed.GetItems();
+		stream.avail_out = bound;
+
+		while (true)
+		{
+			status = Z_DEFLATE(&stream, Z_SYNC_FLUSH);
+			AM_ASSERT(status >= 0, "zLibParallelCompressor::Compress() -> Failed with status %i", status);
+
+			// Output buffer was filled completely, there may be pending data
+			if (stream.avail_in == 0 && stream.avail_out != 0)
+				break;
+
+			u32 written = block.Compressed.GetSize() - stream.avail_out;
+			block.Compressed.Resize(block.Compressed.GetSize() * 2);
+			stream.next_out = (zBuffer_t)(block.Compressed.GetItems() + written);
+			stream.avail_out = block.Compressed.GetSize() - written;
+		}
+
+		block.CompressedSize = block.Compressed.GetSize() - stream.avail_out;
+		Z_DEFLATE_END(&stream);
+
+		block.Done = true;
+	}
+}
+
+zLibParallelCompressor::zLibParallelCompressor(int level, int threadCount)
+{
+	m_Level = level;
+	m_ThreadCount = threadCount;
+}
+
+bool zLibParallelCompressor::Compress(pVoid data, u32 dataSize, const std::function<bool(pVoid compressedBuffer, u32 compressedSize)>& writeFn) const
+{
+	if (dataSize == 0)
+		return true;
+
+	const char* bytes = static_cast<const char*>(data);
+	u32 blockCount = (dataSize + ZLIB_PARALLEL_BLOCK_SIZE - 1) / ZLIB_PARALLEL_BLOCK_SIZE;
+
+	amUPtr<zLibParallelBlock[]> blocks = std::make_unique<zLibParallelBlock[]>(blockCount);
+	std::atomic_uint nextBlock = 0;
+
+	auto compressBlocks = [&]
+		{
+			u32 blockIndex;
+			while ((blockIndex = nextBlock++) < blockCount)
+				CompressBlock(m_Level, bytes, dataSize, blockIndex, blocks[blockIndex]);
+		};
+
+	// Helpers run on shared worker pool, so resources that are compiled in parallel don't oversubscribe CPU.
+	// Without main worker (for e.g. in unit tests) calling thread compresses everything
+	TaskScheduler* scheduler = BackgroundWorker::GetMainInstance() ? BackgroundWorker::GetInstance()->GetScheduler() : nullptr;
+	int helperCount = 0;
+	if (scheduler)
+	{
+		int threadCount = m_ThreadCount != 0 ? m_ThreadCount : static_cast<int>(scheduler->GetThreadCount());
+		helperCount = MIN(threadCount, static_cast<int>(blockCount)) - 1;
+	}
+
+	TaskGroup helpers(scheduler);
+	for (int i = 0; i < helperCount; i++)
+		helpers.Run(compressBlocks);
+
+	// Calling thread compresses blocks too and writes finished blocks in order as soon as they are ready
+	bool success = true;
+	u32 blocksWritten = 0;
+	auto writeReadyBlocks = [&]
+		{
+			while (success && blocksWritten < blockCount && blocks[blocksWritten].Done)
+			{
+				zLibParallelBlock& block = blocks[blocksWritten];
+				if (!writeFn(block.Compressed.GetItems(), block.CompressedSize))
+					success = false;
+				block.Compressed.Destroy();
+				blocksWritten++;
+			}
+		};
+
+	u32 blockIndex;
+	while ((blockIndex = nextBlock++) < blockCount)
+	{
+		CompressBlock(m_Level, bytes, dataSize, blockIndex, blocks[blockIndex]);
+		writeReadyBlocks();
+	}
+
+	// Helpers that didn't start yet find no blocks left, only wait for ones that are compressing
+	helpers.Wait();
+	writeReadyBlocks();
+
+	return success;
+}
@@ -0,0 +1,38 @@
+//
+// File: parallel.h
+//
+// Copyright (C) 2023-2024 ranstar74. All rights violated.
+//
+// Part of "Rage Am" Research Project.
+//
+#pragma once
+
+#include "stream.h"
+
+#include <functional>
+
+static constexpr u32 ZLIB_PARALLEL_BLOCK_SIZE = 1024u * 1024u;	// 1MB
+static constexpr u32 ZLIB_DICTIONARY_SIZE = 32u * 1024u;		// Max deflate back reference distance
+
+/**
+ * \brief Compresses data on multiple threads into single raw deflate stream.
+ *
+ * Data is split in independent blocks, every block is compressed by its own stream that is primed with last 32KB of
+ * previous block as dictionary, so back references across blocks are not lost. Every block ends with sync flush
+ * (byte aligned, non-final), so compressed blocks can be simply concatenated; output is identical in format to zLibCompressor.
+ */
+class zLibParallelCompressor
+{
+	int m_Level;
+	int m_ThreadCount;
+
+public:
+	// Blocks are compressed on BackgroundWorker threads, thread count 0 means all of them
+	zLibParallelCompressor(int level = ZLIB_COMPRESSION_LEVEL, int threadCount = 0);
+
+	/**
+	 * \brief Compresses data and passes compressed blocks to write function, in order, from the calling thread.
+	 * \return False if write function failed.
+	 */
+	bool Compress(pVoid data, u32 dataSize, const std::function<bool(pVoid compressedBuffer, u32 compressedSize)>& writeFn) const;
+};
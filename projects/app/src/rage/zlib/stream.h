@@ -17,6 +17,8 @@ typedef Bytef* zBuffer_t;
 #define Z_DEFLATE_INIT2 deflateInit2
 #define Z_DEFLATE_END deflateEnd
 #define Z_DEFLATE deflate
+#define Z_DEFLATE_BOUND deflateBound
+#define Z_DEFLATE_SET_DICTIONARY deflateSetDictionary
 #define Z_INFLATE_INIT2 inflateInit2
 #define Z_INFLATE_END inflateEnd
 #define Z_INFLATE inflate
@@ -27,6 +29,8 @@ typedef Bytef* zBuffer_t;
 #define Z_DEFLATE_INIT2 zng_deflateInit2
 #define Z_DEFLATE_END zng_deflateEnd
 #define Z_DEFLATE zng_deflate
+#define Z_DEFLATE_BOUND zng_deflateBound
+#define Z_DEFLATE_SET_DICTIONARY zng_deflateSetDictionary
 #define Z_INFLATE_INIT2 zng_inflateInit2
 #define Z_INFLATE_END zng_inflateEnd
 #define Z_INFLATE zng_inflate
@@ -37,6 +41,9 @@ typedef Bytef* zBuffer_t;
 #define Z_DEFLATE_INIT2 mz_deflateInit2
 #define Z_DEFLATE_END mz_deflateEnd
 #define Z_DEFLATE mz_deflate
+#define Z_DEFLATE_BOUND mz_deflateBound
+// Miniz doesn't support preset dictionary, blocks of parallel compressor are not primed
+#define Z_DEFLATE_SET_DICTIONARY(stream, dictionary, size) Z_OK
 #define Z_INFLATE_INIT2 mz_inflateInit2
 #define Z_INFLATE_END mz_inflateEnd
 #define Z_INFLATE mz_inflate
@@ -57,11 +64,12 @@ class zLibCompressor
 	u32       m_BufferSize;
 	bool      m_OwnBuffer;
 	bool      m_Started = false;
+	int       m_Level = ZLIB_COMPRESSION_LEVEL;
 
 	void Init()
 	{
 		int status = Z_DEFLATE_INIT2(&m_Stream,
-			ZLIB_COMPRESSION_LEVEL,
+			m_Level,
 			Z_DEFLATED,
 			ZLIB_WINDOW_BITS,
 			ZLIB_MEMORY_LEVEL,
@@ -70,11 +78,12 @@ class zLibCompressor
 		AM_ASSERT(status >= 0, "zLibDecompressor() -> Init failed with status %i", status);
 	}
 public:
-	zLibCompressor(u32 bufferSize)
+	zLibCompressor(u32 bufferSize, int level = ZLIB_COMPRESSION_LEVEL)
 	{
 		m_Buffer = new Bytef[bufferSize];
 		m_BufferSize = bufferSize;
 		m_OwnBuffer = true;
+		m_Level = level;
 
 		Init();
 	}
@@ -0,0 +1,74 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/system/datahash.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace rageam;
+
+namespace unit_testing
+{
+	TEST_CLASS(DataHashTests)
+	{
+		static List<u8> CreateData(u32 size)
+		{
+			List<u8> data;
+			data.Resize(size);
+			u32 state = 0x12345678;
+			for (u32 i = 0; i < size; i++)
+			{
+				state = state * 1664525u + 1013904223u;
+				data[i] = static_cast<u8>(state >> 24);
+			}
+			return data;
+		}
+
+	public:
+		TEST_METHOD(VerifyHashDoesNotDependOnSplit)
+		{
+			// Crosses stripe and block boundaries
+			List<u8> data = CreateData(5000);
+			Hash128 expected = DataHash128(data.GetItems(), data.GetSize());
+
+			for (u32 step : { 1u, 7u, 63u, 64u, 65u, 1000u })
+			{
+				DataHasher hasher;
+				for (u32 offset = 0; offset < data.GetSize(); offset += step)
+					hasher.Add(data.GetItems() + offset, MIN(step, data.GetSize() - offset));
+				Assert::IsTrue(expected == hasher.Get128());
+				Assert::AreEqual(expected.Low, hasher.Get64());
+			}
+		}
+
+		TEST_METHOD(VerifyHashDependsOnInput)
+		{
+			List<u8> data = CreateData(256);
+			u64 hash = DataHash64(data.GetItems(), data.GetSize());
+
+			Assert::AreNotEqual(hash, DataHash64(data.GetItems(), data.GetSize(), 1));
+			Assert::AreNotEqual(hash, DataHash64(data.GetItems(), data.GetSize() - 1));
+
+			data[100] ^= 1;
+			Assert::AreNotEqual(hash, DataHash64(data.GetItems(), data.GetSize()));
+		}
+
+		TEST_METHOD(VerifyZeroPaddingDoesNotCollide)
+		{
+			u8 zeros[64] = {};
+			Assert::AreNotEqual(DataHash64(zeros, 10), DataHash64(zeros, 11));
+			Assert::AreNotEqual(DataHash64(zeros, 0), DataHash64(zeros, 64));
+		}
+
+		TEST_METHOD(VerifyParallelHashIsDeterministic)
+		{
+			List<u8> data = CreateData(3 * 1024 * 1024 + 123);
+			Hash128 hash = DataHash128Parallel(data.GetItems(), data.GetSize());
+			Assert::IsTrue(hash == DataHash128Parallel(data.GetItems(), data.GetSize()));
+
+			data[2 * 1024 * 1024] ^= 1;
+			Assert::IsFalse(hash == DataHash128Parallel(data.GetItems(), data.GetSize()));
+		}
+	};
+}
+
+#endif
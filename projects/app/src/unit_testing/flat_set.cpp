@@ -0,0 +1,250 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/string/string.h"
+#include "am/system/flatset.h"
+#include "am/system/timer.h"
+#include "rage/atl/map.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace rage;
+using namespace rageam;
+
+namespace Microsoft::VisualStudio::CppUnitTestFramework
+{
+	template<> std::wstring ToString<>(const FlatSet<int>& set)
+	{
+		std::wstring string;
+
+		for (int value : set)
+		{
+			string += L" ";
+			string += std::to_wstring(value);
+		}
+		string += L" ";
+
+		return string;
+	}
+
+	template<> std::wstring ToString<>(const FlatSetIterator<int, FlatSetHashFn>& it)
+	{
+		if (!it.HasValue())
+			return L"None";
+
+		return String::FormatTemp(L"{ %u }", it.GetValue());
+	}
+}
+
+namespace unit_testing
+{
+	TEST_CLASS(FlatSetTests)
+	{
+		// Generates keys with the same low bits, worst case for hash tables with weak hash mixing
+		static u32 GetBenchmarkKey(u32 i) { return i << 12; }
+
+	public:
+		TEST_METHOD(VerifyInsertFindRemove)
+		{
+			FlatSet<int> set;
+			for (int i = 0; i < 100000; i++)
+				set.Insert(i);
+
+			Assert::AreEqual(100000u, set.GetNumUsedSlots());
+
+			for (int i = 0; i < 100000; i += 2)
+				set.Remove(i);
+
+			for (int i = 0; i < 100000; i++)
+				Assert::AreEqual(i % 2 != 0, set.Contains(i));
+
+			Assert::AreEqual(50000u, set.GetNumUsedSlots());
+		}
+
+		TEST_METHOD(VerifyIterator)
+		{
+			FlatSet<int> set;
+			FlatSet<int> iteratedSet;
+
+			for (int i = 0; i < 4000; i++)
+				set.Insert(i);
+
+			for (int i : set)
+				iteratedSet.Insert(i);
+
+			Assert::AreEqual(set, iteratedSet);
+		}
+
+		// Inserting value with existing hash must replace it, same as in atMap
+		TEST_METHOD(VerifyInsertReplacesExisting)
+		{
+			FlatSet<int> set;
+			set.InsertAt(1, 10);
+			set.InsertAt(1, 20);
+
+			Assert::AreEqual(1u, set.GetNumUsedSlots());
+			Assert::AreEqual(20, set.GetAt(1));
+		}
+
+		TEST_METHOD(VerifyReserveDoesNotRehash)
+		{
+			FlatSet<int> set;
+			set.Reserve(100000);
+			u32 capacity = set.GetCapacity();
+
+			for (int i = 0; i < 100000; i++)
+				set.Insert(i);
+
+			Assert::AreEqual(capacity, set.GetCapacity());
+		}
+
+		// Deleted slots must be reused and cleaned up, otherwise table would grow forever
+		TEST_METHOD(VerifyDeletedSlotsDoNotGrowTable)
+		{
+			FlatSet<int> set;
+			for (int i = 0; i < 1000; i++)
+				set.Insert(i);
+			u32 capacity = set.GetCapacity();
+
+			for (int i = 1000; i < 200000; i++)
+			{
+				set.Remove(i - 1000);
+				set.Insert(i);
+			}
+
+			Assert::AreEqual(1000u, set.GetNumUsedSlots());
+			Assert::AreEqual(capacity, set.GetCapacity());
+			for (int i = 199000; i < 200000; i++)
+				Assert::IsTrue(set.Contains(i));
+		}
+
+		TEST_METHOD(VerifyHeterogeneousLookup)
+		{
+			FlatSet<atString> set;
+			set.Insert("adder");
+			set.Insert("zentorno");
+
+			ConstString name = "zentorno";
+			Assert::IsNotNull(set.TryGet(name));
+			Assert::IsNull(set.TryGet(ConstString("t20")));
+		}
+
+		TEST_METHOD(VerifyIteratorFindAndRemove)
+		{
+			FlatSet input = { 5, 10, 6 };
+			FlatSet expected = { 5, 6 };
+
+			auto it = input.Find(10);
+			Assert::AreNotEqual(input.end(), it);
+			input.RemoveAtIterator(it);
+
+			Assert::AreEqual(expected, input);
+		}
+
+		TEST_METHOD(VerifyCopying)
+		{
+			FlatSet<int> input;
+			for (int i = 0; i < 1000; i++)
+				input.Insert(i);
+
+			FlatSet copy = input; // NOLINT(performance-unnecessary-copy-initialization)
+
+			Assert::AreEqual(input, copy);
+		}
+
+		TEST_METHOD(VerifyCreateAndDestroyNoLeaks)
+		{
+			sysMemAllocator* allocator = GetAllocator(ALLOC_TYPE_GENERAL);
+			u64 memoryBefore = allocator->GetMemoryUsed();
+			{
+				FlatSet<std::shared_ptr<int[]>> set;
+
+				auto array1 = std::make_shared<int[]>(1000);
+				auto array2 = std::make_shared<int[]>(1000);
+
+				for (u32 i = 0; i < 30000; i++)
+					set.InsertAt(i, i % 2 ? array1 : array2); // Set will grow multiple times
+
+				for (u32 i = 0; i < 30000; i += 3)
+					set.RemoveAt(i);
+
+				set.Clear();
+				set.InsertAt(1, array1);
+			}
+			u64 memoryAfter = allocator->GetMemoryUsed();
+
+			allocator->SanityCheck();
+
+			Assert::AreEqual(memoryBefore, memoryAfter);
+		}
+
+		// Runs the same workload on both containers, FlatSet must not be slower than atMap it replaces
+		TEST_METHOD(BenchmarkAgainstAtMap)
+		{
+			static constexpr u32 COUNT = 500000;
+
+			u64 flatSum = 0;
+			u64 mapSum = 0;
+
+			Timer flatInsert = Timer::StartNew();
+			FlatSet<u32> flatSet;
+			for (u32 i = 0; i < COUNT; i++)
+				flatSet.InsertAt(GetBenchmarkKey(i), i);
+			flatInsert.Stop();
+
+			Timer mapInsert = Timer::StartNew();
+			atMap<u32> map;
+			for (u32 i = 0; i < COUNT; i++)
+				map.InsertAt(GetBenchmarkKey(i), i);
+			mapInsert.Stop();
+
+			// Half of lookups miss
+			Timer flatLookup = Timer::StartNew();
+			for (u32 i = 0; i < COUNT * 2; i++)
+			{
+				u32* value = flatSet.TryGetAt(GetBenchmarkKey(i));
+				if (value) flatSum += *value;
+			}
+			flatLookup.Stop();
+
+			Timer mapLookup = Timer::StartNew();
+			for (u32 i = 0; i < COUNT * 2; i++)
+			{
+				u32* value = map.TryGetAt(GetBenchmarkKey(i));
+				if (value) mapSum += *value;
+			}
+			mapLookup.Stop();
+
+			Timer flatRemove = Timer::StartNew();
+			for (u32 i = 0; i < COUNT; i++)
+				flatSet.RemoveAt(GetBenchmarkKey(i));
+			flatRemove.Stop();
+
+			Timer mapRemove = Timer::StartNew();
+			for (u32 i = 0; i < COUNT; i++)
+				map.RemoveAt(GetBenchmarkKey(i));
+			mapRemove.Stop();
+
+			Microsoft::VisualStudio::CppUnitTestFramework::Logger::WriteMessage(String::FormatTemp(
+				"FlatSet vs atMap, %u values\n"
+				"Insert: %llu us / %llu us\n"
+				"Lookup: %llu us / %llu us\n"
+				"Remove: %llu us / %llu us\n",
+				COUNT,
+				flatInsert.GetElapsedMicroseconds(), mapInsert.GetElapsedMicroseconds(),
+				flatLookup.GetElapsedMicroseconds(), mapLookup.GetElapsedMicroseconds(),
+				flatRemove.GetElapsedMicroseconds(), mapRemove.GetElapsedMicroseconds()));
+
+			Assert::AreEqual(mapSum, flatSum);
+			Assert::AreEqual(0u, flatSet.GetNumUsedSlots());
+
+			// atMap chains ~8 heap nodes per bucket on this many values (bucket count is u16), lookup is where
+			// open addressing wins the most; ratio is 1:1 so the test does not depend on the machine
+			u64 flatTotal = flatInsert.GetElapsedMicroseconds() + flatLookup.GetElapsedMicroseconds() + flatRemove.GetElapsedMicroseconds();
+			u64 mapTotal = mapInsert.GetElapsedMicroseconds() + mapLookup.GetElapsedMicroseconds() + mapRemove.GetElapsedMicroseconds();
+			Assert::IsTrue(flatLookup.GetElapsedMicroseconds() <= mapLookup.GetElapsedMicroseconds(), L"FlatSet lookup is slower than atMap");
+			Assert::IsTrue(flatTotal <= mapTotal, L"FlatSet is slower than atMap");
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,100 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/graphics/image/bc.h"
+
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace rageam::graphics;
+
+namespace unit_testing
+{
+	TEST_CLASS(ImageBCDecodeTests)
+	{
+		// Fills image with random blocks, every third block has equal endpoints to cover 3 color / 6 value modes
+		static PixelDataOwner CreateRandomBlocks(int width, int height, ImagePixelFormat format, std::mt19937& rng)
+		{
+			u32 blockSize = BlockFormatToBlockSize[ImagePixelFormatToBlockFormat(format)];
+			u32 blockCount = (width / 4) * (height / 4);
+
+			PixelDataOwner pixels = PixelDataOwner::AllocateForImage(width, height, format);
+			char* bytes = pixels.Data()->Bytes;
+			for (u32 i = 0; i < blockCount * blockSize; i++)
+				bytes[i] = static_cast<char>(rng());
+
+			for (u32 i = 0; i < blockCount; i += 3)
+			{
+				char* block = bytes + static_cast<size_t>(i) * blockSize;
+				switch (format)
+				{
+				case ImagePixelFormat_BC1:	block[2] = block[0]; block[3] = block[1];	break;
+				case ImagePixelFormat_BC2:	block[10] = block[8]; block[11] = block[9];	break;
+				case ImagePixelFormat_BC3:	block[1] = block[0]; block[10] = block[8]; block[11] = block[9]; break;
+				case ImagePixelFormat_BC4:	block[1] = block[0];						break;
+				case ImagePixelFormat_BC5:	block[1] = block[0]; block[9] = block[8];	break;
+				default: break;
+				}
+			}
+			return pixels;
+		}
+
+		// Decodes image block by block using ImageCompressor::DecompressBlock
+		static List<char> DecodeScalar(const PixelDataOwner& pixels, int width, int height, ImagePixelFormat format)
+		{
+			u32 blockSize = BlockFormatToBlockSize[ImagePixelFormatToBlockFormat(format)];
+			u32 rowPitch = width * IMAGE_RGBA_PITCH;
+			int blocksX = width / 4;
+			int blocksY = height / 4;
+
+			List<char> decoded;
+			decoded.Resize(rowPitch * height);
+
+			const char* block = pixels.Data()->Bytes;
+			for (int blockY = 0; blockY < blocksY; blockY++)
+			{
+				for (int blockX = 0; blockX < blocksX; blockX++)
+				{
+					char decodedBlock[IMAGE_BC_BLOCK_SLICE_PITCH];
+					ImageCompressor::DecompressBlock(block, decodedBlock, format);
+					for (int y = 0; y < 4; y++)
+					{
+						char* dst = decoded.GetItems() + static_cast<size_t>(blockY * 4 + y) * rowPitch + blockX * IMAGE_BC_BLOCK_ROW_PITCH;
+						memcpy(dst, decodedBlock + y * IMAGE_BC_BLOCK_ROW_PITCH, IMAGE_BC_BLOCK_ROW_PITCH);
+					}
+					block += blockSize;
+				}
+			}
+			return decoded;
+		}
+
+		static void VerifyFormat(ImagePixelFormat format)
+		{
+			std::mt19937 rng(static_cast<u32>(format));
+
+			// Block row counts that are not multiple of 4 are important, decoder processes 4 blocks at once
+			static constexpr int sizes[][2] = { { 4, 4 }, { 12, 8 }, { 52, 24 }, { 256, 128 }, { 1028, 64 } };
+			for (auto [width, height] : sizes)
+			{
+				PixelDataOwner pixels = CreateRandomBlocks(width, height, format, rng);
+
+				List<char> expected = DecodeScalar(pixels, width, height, format);
+				PixelDataOwner decoded = ImageDecodeBCToRGBA(pixels, width, height, format);
+
+				bool equal = memcmp(expected.GetItems(), decoded.Data()->Bytes, expected.GetSize()) == 0;
+				Assert::IsTrue(equal, String::FormatTemp(L"Decoded %hs %ix%i doesn't match scalar decoder",
+					ImagePixelFormatToName[format], width, height));
+			}
+		}
+
+	public:
+		TEST_METHOD(VerifyBC1) { VerifyFormat(ImagePixelFormat_BC1); }
+		TEST_METHOD(VerifyBC2) { VerifyFormat(ImagePixelFormat_BC2); }
+		TEST_METHOD(VerifyBC3) { VerifyFormat(ImagePixelFormat_BC3); }
+		TEST_METHOD(VerifyBC4) { VerifyFormat(ImagePixelFormat_BC4); }
+		TEST_METHOD(VerifyBC5) { VerifyFormat(ImagePixelFormat_BC5); }
+		TEST_METHOD(VerifyBC7) { VerifyFormat(ImagePixelFormat_BC7); }
+	};
+}
+
+#endif
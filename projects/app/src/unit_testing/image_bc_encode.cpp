@@ -0,0 +1,207 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/graphics/image/bc.h"
+#include "am/graphics/image/bcdecoder.h"
+#include "am/graphics/image/bcrangefit.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace rageam;
+using namespace rageam::graphics;
+
+namespace unit_testing
+{
+	TEST_CLASS(ImageBCEncodeTests)
+	{
+		// Same as ImageCompressor
+		static constexpr int BLOCK_GROUP_SIZE = 64;
+
+		// Every block is gradient between two random colors with some noise, close enough to real textures
+		// Every fifth block is solid color
+		static List<char> CreateGradientBlocks(int blockCount, std::mt19937& rng)
+		{
+			List<char> blocks;
+			blocks.Resize(blockCount * IMAGE_BC_BLOCK_SLICE_PITCH);
+
+			std::uniform_int_distribution<int> noise(-8, 8);
+			char* pixel = blocks.GetItems();
+			for (int i = 0; i < blockCount; i++)
+			{
+				u8 from[4], to[4];
+				for (int c = 0; c < 4; c++)
+				{
+					from[c] = static_cast<u8>(rng());
+					to[c] = static_cast<u8>(rng());
+				}
+				bool solid = i % 5 == 0;
+
+				for (int p = 0; p < 16; p++)
+				{
+					for (int c = 0; c < 4; c++)
+					{
+						int value = solid ? from[c] : from[c] + (to[c] - from[c]) * p / 15 + noise(rng);
+						*pixel++ = static_cast<char>(std::clamp(value, 0, 255));
+					}
+				}
+			}
+			return blocks;
+		}
+
+		using EncodeFn = void(int numBlocks, char* dstBlocks, const char* srcBlocks, RangeFitQuality quality);
+
+		// Preview encodes several blocks at once, result must be the same as when blocks are encoded one by one
+		static void VerifyPreviewBatch(EncodeFn encode, u32 blockSize, ConstWString name)
+		{
+			static constexpr int BLOCK_COUNT = BLOCK_GROUP_SIZE * 16;
+
+			std::mt19937 rng(blockSize);
+			List<char> blocks = CreateGradientBlocks(BLOCK_COUNT, rng);
+			List<char> batched;
+			List<char> single;
+			batched.Resize(BLOCK_COUNT * blockSize);
+			single.Resize(BLOCK_COUNT * blockSize);
+
+			for (int i = 0; i < BLOCK_COUNT; i += BLOCK_GROUP_SIZE)
+			{
+				encode(BLOCK_GROUP_SIZE, batched.GetItems() + static_cast<size_t>(i) * blockSize,
+					blocks.GetItems() + static_cast<size_t>(i) * IMAGE_BC_BLOCK_SLICE_PITCH, RangeFitQuality_Preview);
+			}
+			for (int i = 0; i < BLOCK_COUNT; i++)
+			{
+				encode(1, single.GetItems() + static_cast<size_t>(i) * blockSize,
+					blocks.GetItems() + static_cast<size_t>(i) * IMAGE_BC_BLOCK_SLICE_PITCH, RangeFitQuality_Preview);
+			}
+
+			bool equal = memcmp(batched.GetItems(), single.GetItems(), batched.GetSize()) == 0;
+			Assert::IsTrue(equal, String::FormatTemp(L"%ls preview block groups don't match single blocks", name));
+		}
+
+		// Encodes blocks as single block row and decodes them back with BCDecodeBlockRow,
+		// error is computed only for first channelCount channels because others are not stored by the format
+		static double ComputeRoundTripRMSE(EncodeFn encode, ImagePixelFormat format, RangeFitQuality quality, int channelCount)
+		{
+			static constexpr int BLOCK_COUNT = BLOCK_GROUP_SIZE * 16;
+
+			u32 blockSize = BlockFormatToBlockSize[ImagePixelFormatToBlockFormat(format)];
+			u32 rowPitch = BLOCK_COUNT * IMAGE_BC_BLOCK_ROW_PITCH;
+
+			std::mt19937 rng(static_cast<u32>(format));
+			List<char> blocks = CreateGradientBlocks(BLOCK_COUNT, rng);
+			List<char> encoded;
+			List<char> decoded;
+			encoded.Resize(BLOCK_COUNT * blockSize);
+			decoded.Resize(rowPitch * 4);
+
+			for (int i = 0; i < BLOCK_COUNT; i += BLOCK_GROUP_SIZE)
+			{
+				encode(BLOCK_GROUP_SIZE, encoded.GetItems() + static_cast<size_t>(i) * blockSize,
+					blocks.GetItems() + static_cast<size_t>(i) * IMAGE_BC_BLOCK_SLICE_PITCH, quality);
+			}
+			BCDecodeBlockRow(format, BLOCK_COUNT, encoded.GetItems(), decoded.GetItems(), rowPitch);
+
+			double squaredError = 0.0;
+			for (int block = 0; block < BLOCK_COUNT; block++)
+			{
+				for (int p = 0; p < 16; p++)
+				{
+					const u8* src = reinterpret_cast<const u8*>(blocks.GetItems()) + static_cast<size_t>(block) * IMAGE_BC_BLOCK_SLICE_PITCH + p * 4;
+					const u8* dst = reinterpret_cast<const u8*>(decoded.GetItems()) + static_cast<size_t>(p / 4) * rowPitch +
+						static_cast<size_t>(block * 4 + p % 4) * 4;
+					for (int c = 0; c < channelCount; c++)
+					{
+						double error = static_cast<double>(src[c]) - static_cast<double>(dst[c]);
+						squaredError += error * error;
+					}
+				}
+			}
+			return sqrt(squaredError / (BLOCK_COUNT * 16 * channelCount));
+		}
+
+		// Gradient blocks have +-8 noise, which alone gives ~4.9 RMSE, bounds are ~10% above measured error
+		static void VerifyRoundTrip(EncodeFn encode, ImagePixelFormat format, int channelCount, double maxPreviewRMSE, double maxNormalRMSE)
+		{
+			ConstString name = ImagePixelFormatToName[format];
+			double previewRMSE = ComputeRoundTripRMSE(encode, format, RangeFitQuality_Preview, channelCount);
+			double normalRMSE = ComputeRoundTripRMSE(encode, format, RangeFitQuality_Normal, channelCount);
+
+			Assert::IsTrue(previewRMSE <= maxPreviewRMSE, String::FormatTemp(L"%hs preview RMSE is %.2f, expected at most %.2f",
+				name, previewRMSE, maxPreviewRMSE));
+			Assert::IsTrue(normalRMSE <= maxNormalRMSE, String::FormatTemp(L"%hs normal RMSE is %.2f, expected at most %.2f",
+				name, normalRMSE, maxNormalRMSE));
+			Assert::IsTrue(normalRMSE <= previewRMSE + 0.01, String::FormatTemp(L"%hs normal RMSE %.2f is worse than preview %.2f",
+				name, normalRMSE, previewRMSE));
+		}
+
+		// Only metadata is computed, hash override skips hashing pixels
+		static CompressedImageInfo GetEncodeInfo(BlockFormat format, float quality, BlockCompressorImpl compressorImpl = BlockCompressorImpl::None)
+		{
+			ImageCompressorOptions options;
+			options.Format = format;
+			options.Quality = quality;
+			options.CompressorImpl = compressorImpl;
+
+			ImageInfo info = { ImagePixelFormat_U32, 256, 256, 1 };
+			Hash128 pixelHash = {};
+			Hash128 hash;
+			return ImageCompressor::GetInfoAndHash(info, options, hash, &pixelHash);
+		}
+
+	public:
+		TEST_METHOD(VerifyPreviewBatchBC1) { VerifyPreviewBatch(BCRangeFitEncodeBC1, IMAGE_BC_1_4_BLOCK_SIZE, L"BC1"); }
+		TEST_METHOD(VerifyPreviewBatchBC2) { VerifyPreviewBatch(BCRangeFitEncodeBC2, IMAGE_BC_2_3_5_7_BLOCK_SIZE, L"BC2"); }
+		TEST_METHOD(VerifyPreviewBatchBC3) { VerifyPreviewBatch(BCRangeFitEncodeBC3, IMAGE_BC_2_3_5_7_BLOCK_SIZE, L"BC3"); }
+
+		TEST_METHOD(VerifyRoundTripBC1) { VerifyRoundTrip(BCRangeFitEncodeBC1, ImagePixelFormat_BC1, 3, 9.75, 9.5); }
+		TEST_METHOD(VerifyRoundTripBC2) { VerifyRoundTrip(BCRangeFitEncodeBC2, ImagePixelFormat_BC2, 4, 8.5, 8.25); }
+		TEST_METHOD(VerifyRoundTripBC3) { VerifyRoundTrip(BCRangeFitEncodeBC3, ImagePixelFormat_BC3, 4, 8.5, 8.25); }
+		TEST_METHOD(VerifyRoundTripBC4) { VerifyRoundTrip(BCRangeFitEncodeBC4, ImagePixelFormat_BC4, 1, 4.0, 4.0); }
+		TEST_METHOD(VerifyRoundTripBC5) { VerifyRoundTrip(BCRangeFitEncodeBC5, ImagePixelFormat_BC5, 2, 4.0, 4.0); }
+
+		TEST_METHOD(VerifyPreviewQualitySelectsRangeFit)
+		{
+			for (BlockFormat format : { BlockFormat_BC1, BlockFormat_BC2, BlockFormat_BC3, BlockFormat_BC4, BlockFormat_BC5 })
+			{
+				ConstString name = ImagePixelFormatToName[BlockFormatToPixelFormat[format]];
+				for (float quality : { 0.0f, IMAGE_BC_PREVIEW_QUALITY })
+				{
+					CompressedImageInfo info = GetEncodeInfo(format, quality);
+					Assert::IsTrue(info.EncoderImpl == BlockCompressorImpl::rangefit,
+						String::FormatTemp(L"%hs on quality %.2f is not encoded with range fit", name, quality));
+					Assert::AreEqual(static_cast<int>(RangeFitQuality_Preview), info.EncoderData_rangefit.Quality,
+						String::FormatTemp(L"%hs on quality %.2f is not encoded with preview tier", name, quality));
+				}
+			}
+
+			// Range fit doesn't support BC7
+			Assert::IsTrue(GetEncodeInfo(BlockFormat_BC7, 0.0f).EncoderImpl == BlockCompressorImpl::bc7enc_rdo,
+				L"BC7 on preview quality must use default compressor");
+		}
+
+		TEST_METHOD(VerifyQualityAbovePreviewSelectsDefault)
+		{
+			for (BlockFormat format : { BlockFormat_BC1, BlockFormat_BC2, BlockFormat_BC3, BlockFormat_BC4, BlockFormat_BC5, BlockFormat_BC7 })
+			{
+				CompressedImageInfo info = GetEncodeInfo(format, IMAGE_BC_PREVIEW_QUALITY + 0.01f);
+				Assert::IsTrue(info.EncoderImpl == BlockFormatToDefaultCompressorImpl[format],
+					String::FormatTemp(L"%hs above preview quality doesn't use default compressor", ImagePixelFormatToName[BlockFormatToPixelFormat[format]]));
+			}
+
+			// BC2 has no other compressor than range fit, regular quality gives normal tier
+			CompressedImageInfo bc2Info = GetEncodeInfo(BlockFormat_BC2, 0.65f);
+			Assert::IsTrue(bc2Info.EncoderImpl == BlockCompressorImpl::rangefit, L"BC2 must be encoded with range fit");
+			Assert::AreEqual(static_cast<int>(RangeFitQuality_Normal), bc2Info.EncoderData_rangefit.Quality, L"BC2 is not encoded with normal tier");
+		}
+
+		TEST_METHOD(VerifyExplicitCompressorIsKept)
+		{
+			CompressedImageInfo info = GetEncodeInfo(BlockFormat_BC1, 0.0f, BlockCompressorImpl::icbc);
+			Assert::IsTrue(info.EncoderImpl == BlockCompressorImpl::icbc, L"Explicitly set compressor was replaced on preview quality");
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,203 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/system/worker.h"
+#include "rage/physics/bounds/optimizedbvh.h"
+
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace unit_testing
+{
+	using namespace rage;
+
+	TEST_CLASS(phOptimizedBvhTests)
+	{
+		static constexpr int MAX_PRIMITIVES_PER_NODE = 4;
+
+		// Top levels of SAH tree are built in parallel only if main worker exists
+		class ScopedMainWorker
+		{
+			rageam::BackgroundWorker m_Worker;
+		public:
+			ScopedMainWorker() : m_Worker("BVH Tests", 4)
+			{
+				rageam::BackgroundWorker::SetMainInstance(&m_Worker);
+				rageam::BackgroundWorker::Push(&m_Worker);
+			}
+			~ScopedMainWorker()
+			{
+				rageam::BackgroundWorker::Pop();
+				rageam::BackgroundWorker::SetMainInstance(nullptr);
+			}
+		};
+
+		// Small boxes scattered in clusters, with some large ones overlapping many others
+		static std::vector<phBvhPrimitiveData> CreatePrimitives(int count, u32 seed)
+		{
+			u32 state = seed;
+			auto next = [&] { state = state * 1664525u + 1013904223u; return state >> 8; };
+
+			std::vector<phBvhPrimitiveData> primitives(count);
+			for (int i = 0; i < count; i++)
+			{
+				phBvhPrimitiveData& primitive = primitives[i];
+				s32 cluster = static_cast<s32>(next() % 8) * 5000 - 17500;
+				s32 extent = next() % 100 == 0 ? 4000 : 200;
+				for (int axis = 0; axis < 3; axis++)
+				{
+					s32 center = cluster + static_cast<s32>(next() % 12000) - 6000;
+					s32 halfSize = static_cast<s32>(next() % extent) + 1;
+					primitive.AABBMin[axis] = static_cast<s16>(center - halfSize);
+					primitive.AABBMax[axis] = static_cast<s16>(center + halfSize);
+					primitive.Centroid[axis] = static_cast<s16>(center);
+				}
+				primitive.Pad = 0;
+				primitive.PrimitiveIndex = static_cast<u16>(i);
+			}
+			return primitives;
+		}
+
+		static bool AreAABBsEqual(const s16 leftMin[3], const s16 leftMax[3], const s16 rightMin[3], const s16 rightMax[3])
+		{
+			return memcmp(leftMin, rightMin, sizeof(s16) * 3) == 0 && memcmp(leftMax, rightMax, sizeof(s16) * 3) == 0;
+		}
+
+		// Number of nodes in subtree starting with given node, including it
+		static int GetSubtreeSize(const phOptimizedBvhNode& node)
+		{
+			return node.IsLeafNode() ? 1 : node.GetEscapeIndex();
+		}
+
+		// Walks nodes [start, end) of one level and their children, checks that child ranges end exactly where escape index of parent points
+		// and that every node bounds are union of its children (or primitives)
+		static void VerifySubtree(const phOptimizedBvh& bvh, const std::vector<phBvhPrimitiveData>& primitives,
+			int start, int end, std::vector<int>& primitiveVisits, int& visitedNodes)
+		{
+			int index = start;
+			while (index < end)
+			{
+				const phOptimizedBvhNode& node = bvh.GetNode(index);
+				int size = GetSubtreeSize(node);
+				Assert::IsTrue(size >= 1 && index + size <= end);
+				visitedNodes++;
+
+				s16 boundsMin[3] = { INT16_MAX, INT16_MAX, INT16_MAX };
+				s16 boundsMax[3] = { INT16_MIN, INT16_MIN, INT16_MIN };
+				auto addBounds = [&](const s16 min[3], const s16 max[3])
+					{
+						for (int axis = 0; axis < 3; axis++)
+						{
+							boundsMin[axis] = Min(boundsMin[axis], min[axis]);
+							boundsMax[axis] = Max(boundsMax[axis], max[axis]);
+						}
+					};
+
+				if (node.IsLeafNode())
+				{
+					int first = node.GetPrimitiveIndex();
+					int count = node.GetPrimitiveCount();
+					Assert::IsTrue(count <= MAX_PRIMITIVES_PER_NODE);
+					Assert::IsTrue(first + count <= static_cast<int>(primitives.size()));
+					for (int i = first; i < first + count; i++)
+					{
+						primitiveVisits[i]++;
+						addBounds(primitives[i].AABBMin, primitives[i].AABBMax);
+					}
+				}
+				else
+				{
+					// Internal node has exactly two children, left one starts right after it and right one ends at escape index
+					int left = index + 1;
+					Assert::IsTrue(left < index + size);
+					int right = left + GetSubtreeSize(bvh.GetNode(left));
+					Assert::IsTrue(right < index + size);
+					Assert::AreEqual(index + size, right + GetSubtreeSize(bvh.GetNode(right)));
+
+					addBounds(bvh.GetNode(left).AABBMin, bvh.GetNode(left).AABBMax);
+					addBounds(bvh.GetNode(right).AABBMin, bvh.GetNode(right).AABBMax);
+					VerifySubtree(bvh, primitives, left, index + size, primitiveVisits, visitedNodes);
+				}
+				Assert::IsTrue(AreAABBsEqual(node.AABBMin, node.AABBMax, boundsMin, boundsMax));
+
+				index += size;
+			}
+			Assert::AreEqual(end, index);
+		}
+
+		static void VerifyTree(std::vector<phBvhPrimitiveData> primitives, phBvhBuildMode mode)
+		{
+			int count = static_cast<int>(primitives.size());
+
+			phOptimizedBvh bvh;
+			bvh.BuildFromPrimitiveData(primitives.data(), count, MAX_PRIMITIVES_PER_NODE, mode);
+
+			// Builder reorders primitives, every one must still be there
+			std::vector<int> indexVisits(count);
+			for (const phBvhPrimitiveData& primitive : primitives)
+				indexVisits[primitive.PrimitiveIndex]++;
+			for (int visits : indexVisits)
+				Assert::AreEqual(1, visits);
+
+			// Root covers the whole tree, every node and primitive is reached exactly once
+			int nodeCount = bvh.GetNodeCount();
+			Assert::IsTrue(nodeCount > 0);
+			Assert::AreEqual(nodeCount, GetSubtreeSize(bvh.GetNode(0)));
+
+			std::vector<int> primitiveVisits(count);
+			int visitedNodes = 0;
+			VerifySubtree(bvh, primitives, 0, nodeCount, primitiveVisits, visitedNodes);
+			Assert::AreEqual(nodeCount, visitedNodes);
+			for (int visits : primitiveVisits)
+				Assert::AreEqual(1, visits);
+
+			// Subtree headers point to existing subtrees and hold their bounds
+			Assert::IsTrue(bvh.GetSubtreeHeaderCount() > 0);
+			for (int i = 0; i < bvh.GetSubtreeHeaderCount(); i++)
+			{
+				const phOptimizedBvhSubtreeInfo& header = bvh.GetSubtreeHeader(i);
+				Assert::IsTrue(header.RootNodeIndex < nodeCount);
+				const phOptimizedBvhNode& root = bvh.GetNode(header.RootNodeIndex);
+				Assert::AreEqual(header.RootNodeIndex + GetSubtreeSize(root), static_cast<int>(header.EndIndex));
+				Assert::IsTrue(AreAABBsEqual(header.AABBMin, header.AABBMax, root.AABBMin, root.AABBMax));
+			}
+		}
+
+	public:
+		TEST_METHOD(VerifySmallTrees)
+		{
+			for (phBvhBuildMode mode : { PH_BVH_BUILD_MEDIAN, PH_BVH_BUILD_SAH })
+			{
+				for (int count : { 1, 3, 4, 5, 17, 100, 1000 })
+					VerifyTree(CreatePrimitives(count, count), mode);
+			}
+		}
+
+		TEST_METHOD(VerifyLargeTreesBuiltInParallel)
+		{
+			ScopedMainWorker worker;
+			for (phBvhBuildMode mode : { PH_BVH_BUILD_MEDIAN, PH_BVH_BUILD_SAH })
+			{
+				for (u32 seed = 1; seed <= 3; seed++)
+					VerifyTree(CreatePrimitives(20000 + seed * 1000, seed), mode);
+			}
+		}
+
+		// Primitives with the same center can't be split by SAH, they're split in the middle instead
+		TEST_METHOD(VerifyCoincidentPrimitives)
+		{
+			std::vector<phBvhPrimitiveData> primitives = CreatePrimitives(5000, 7);
+			for (int i = 0; i < 5000; i++)
+			{
+				primitives[i] = primitives[0];
+				primitives[i].PrimitiveIndex = static_cast<u16>(i);
+			}
+
+			ScopedMainWorker worker;
+			VerifyTree(primitives, PH_BVH_BUILD_SAH);
+		}
+	};
+}
+
+#endif
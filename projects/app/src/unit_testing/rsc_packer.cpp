@@ -0,0 +1,151 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "rage/paging/compiler/packer.h"
+#include "rage/paging/compiler/snapshotallocator.h"
+#include "rage/paging/resourceinfo.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+namespace unit_testing
+{
+	using namespace rage;
+
+	TEST_CLASS(pgRscPackerTests)
+	{
+		static constexpr u32 ALLOCATOR_SIZE = 64u * 1024u * 1024u;
+
+		// Mostly small blocks with some medium and few large ones, like in drawable or texture dictionary
+		static void AllocateBlocks(pgSnapshotAllocator& allocator, u32 seed, u32 blockCount)
+		{
+			u32 state = seed;
+			auto next = [&] { state = state * 1664525u + 1013904223u; return state >> 8; };
+
+			for (u32 i = 0; i < blockCount; i++)
+			{
+				u32 kind = next() % 100;
+				u32 size;
+				if (kind < 75)		size = next() % 0x1000 + 16;
+				else if (kind < 97) size = next() % 0x10000 + 0x1000;
+				else				size = next() % 0x100000 + 0x10000;
+				allocator.Allocate(size);
+			}
+		}
+
+		// Packs blocks and checks that layout is valid, packer must be alive while chunks are accessed
+		static bool TryPackAndVerify(const pgSnapshotAllocator& allocator, u32 reservedChunks, bool optimize, datPackedChunks& pack)
+		{
+			pgRscPacker packer(allocator, reservedChunks, optimize);
+			if (!packer.Pack(pack))
+				return false;
+			Assert::IsTrue(pack.ChunkCount + reservedChunks <= PG_MAX_CHUNKS);
+
+			u16 blockCount = allocator.GetBlockCount();
+			atArray<u8> placed;
+			placed.Resize(blockCount);
+			for (u8& count : placed)
+				count = 0;
+
+			u32 usedSize = 0;
+			u32 allocSize = 0;
+			u32 chunkSize = PG_MIN_CHUNK_SIZE << pack.SizeShift;
+			for (u32 bucket = 0; bucket < PG_MAX_BUCKETS; bucket++)
+			{
+				const atArray<atArray<u16>>& chunks = pack.Buckets[bucket];
+				Assert::IsTrue(pack.BucketCounts[bucket] <= datResourceInfo::GetMaxChunkCountInBucket(bucket));
+
+				for (u32 chunkIndex = 0; chunkIndex < chunks.GetSize(); chunkIndex++)
+				{
+					const atArray<u16>& chunk = chunks[chunkIndex];
+
+					// Chunks are encoded by count, used ones must go first
+					Assert::AreEqual(chunkIndex < pack.BucketCounts[bucket], chunk.Any());
+
+					u32 chunkUsedSize = 0;
+					for (u16 blockIndex : chunk)
+					{
+						Assert::IsTrue(blockIndex < blockCount);
+						placed[blockIndex]++;
+						chunkUsedSize += allocator.GetBlockSize(blockIndex);
+					}
+					Assert::IsTrue(chunkUsedSize <= chunkSize);
+
+					usedSize += chunkUsedSize;
+					if (chunk.Any())
+						allocSize += chunkSize;
+				}
+				chunkSize /= 2;
+			}
+
+			// Main block of virtual resource must be at the beginning of the first (largest) chunk
+			if (allocator.IsVirtual())
+			{
+				u32 firstBucket = 0;
+				while (pack.BucketCounts[firstBucket] == 0)
+					firstBucket++;
+				Assert::AreEqual(static_cast<u16>(0), pack.Buckets[firstBucket][0][0]);
+			}
+
+			for (u8 count : placed)
+				Assert::AreEqual(static_cast<u8>(1), count);
+			Assert::AreEqual(pack.UsedSize, usedSize);
+			Assert::AreEqual(pack.AllocSize, allocSize);
+
+			pack.Buckets = nullptr;
+			return true;
+		}
+
+		static void VerifyOptimizedIsNotLarger(bool isVirtual, u32 blockCount)
+		{
+			u32 comparedCount = 0;
+			for (u32 seed = 1; seed <= 8; seed++)
+			{
+				pgSnapshotAllocator allocator(ALLOCATOR_SIZE, isVirtual);
+				AllocateBlocks(allocator, seed, blockCount);
+
+				datPackedChunks optimized;
+				Assert::IsTrue(TryPackAndVerify(allocator, 0, true, optimized));
+
+				// Greedy packer gives up on some block sets (when it runs out of chunks in small buckets), optimizing one must pack them anyway
+				datPackedChunks greedy;
+				if (!TryPackAndVerify(allocator, 0, false, greedy))
+					continue;
+
+				Assert::IsTrue(optimized.AllocSize <= greedy.AllocSize);
+				Assert::AreEqual(greedy.UsedSize, optimized.UsedSize);
+				comparedCount++;
+			}
+			Assert::IsTrue(comparedCount > 0);
+		}
+
+	public:
+		TEST_METHOD(VerifyOptimizedVirtualPackIsNotLarger)
+		{
+			VerifyOptimizedIsNotLarger(true, 50);
+		}
+
+		TEST_METHOD(VerifyOptimizedPhysicalPackIsNotLarger)
+		{
+			VerifyOptimizedIsNotLarger(false, 50);
+			VerifyOptimizedIsNotLarger(false, 1000);
+		}
+
+		// Virtual and physical chunks share the limit of 128
+		TEST_METHOD(VerifyPhysicalPackFitsInChunksLeftByVirtual)
+		{
+			for (u32 seed = 1; seed <= 4; seed++)
+			{
+				pgSnapshotAllocator virtualAllocator(ALLOCATOR_SIZE, true);
+				pgSnapshotAllocator physicalAllocator(ALLOCATOR_SIZE, false);
+				AllocateBlocks(virtualAllocator, seed, 1000);
+				AllocateBlocks(physicalAllocator, seed + 100, 1000);
+
+				datPackedChunks virtualPack, physicalPack;
+				Assert::IsTrue(TryPackAndVerify(virtualAllocator, 0, true, virtualPack));
+				Assert::IsTrue(TryPackAndVerify(physicalAllocator, virtualPack.ChunkCount, true, physicalPack));
+			}
+		}
+	};
+}
+
+#endif
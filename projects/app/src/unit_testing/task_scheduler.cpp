@@ -0,0 +1,150 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/system/scheduler.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace rageam;
+
+namespace unit_testing
+{
+	TEST_CLASS(TaskSchedulerTests)
+	{
+		static constexpr u32 THREAD_COUNT = 4;
+
+	public:
+		TEST_METHOD(VerifyParallelForVisitsEveryIndexOnce)
+		{
+			TaskScheduler scheduler(THREAD_COUNT);
+
+			std::atomic_uint visits[1000] = {};
+			scheduler.ParallelFor(1000, [&](u32 index) { ++visits[index]; });
+
+			for (std::atomic_uint& count : visits)
+				Assert::AreEqual(1u, count.load());
+		}
+
+		TEST_METHOD(VerifyParallelForRangeCoversRange)
+		{
+			TaskScheduler scheduler(THREAD_COUNT);
+
+			std::atomic_uint total = 0;
+			scheduler.ParallelForRange(1001, 7, [&](u32 begin, u32 end) { total += end - begin; });
+
+			Assert::AreEqual(1001u, total.load());
+		}
+
+		// Every task waits for tasks it spawned, if waiting thread didn't execute them itself it would deadlock once all threads are waiting
+		TEST_METHOD(VerifyNestedWaitDoesNotDeadlock)
+		{
+			TaskScheduler scheduler(THREAD_COUNT);
+
+			std::function<u64(u32)> fibonacci = [&](u32 n) -> u64
+				{
+					if (n < 2)
+						return n;
+
+					std::atomic_uint64_t a = 0, b = 0;
+					TaskGroup group(&scheduler);
+					group.Run([&] { a = fibonacci(n - 1); });
+					group.Run([&] { b = fibonacci(n - 2); });
+					group.Wait();
+					return a + b;
+				};
+
+			Assert::AreEqual(6765ull, fibonacci(20));
+		}
+
+		TEST_METHOD(VerifyNestedParallelFor)
+		{
+			TaskScheduler scheduler(THREAD_COUNT);
+
+			std::atomic_uint64_t sum = 0;
+			{
+				TaskGroup group(&scheduler, TaskPriority_Low);
+				for (u32 i = 0; i < 16; i++)
+				{
+					group.Run([&]
+						{
+							scheduler.ParallelFor(1000, [&](u32 index) { sum += index; });
+						});
+				}
+			}
+
+			Assert::AreEqual(16ull * 999 * 1000 / 2, sum.load());
+		}
+
+		// Waiting worker must not pick up unrelated queued task, it may be long or have lower priority
+		TEST_METHOD(VerifyWaitRunsOnlyAwaitedTasks)
+		{
+			TaskScheduler scheduler(1);
+
+			std::atomic_bool unrelatedExecuted = false;
+			std::atomic_bool executedWhileWaiting = false;
+			{
+				TaskGroup outer(&scheduler);
+				outer.Run([&]
+					{
+						TaskGroup inner(&scheduler);
+						inner.Run([] {});
+						scheduler.Submit([&] { unrelatedExecuted = true; });
+						inner.Wait();
+						executedWhileWaiting = unrelatedExecuted.load();
+					});
+			}
+			while (!unrelatedExecuted) std::this_thread::yield();
+
+			Assert::IsFalse(executedWhileWaiting.load());
+		}
+
+		TEST_METHOD(VerifyCancelledTasksAreSkipped)
+		{
+			TaskScheduler scheduler(THREAD_COUNT);
+
+			CancellationToken token = CancellationToken::Create();
+			token.Cancel();
+
+			std::atomic_uint executed = 0;
+			{
+				TaskGroup group(&scheduler, TaskPriority_Normal, token);
+				for (u32 i = 0; i < 100; i++)
+					group.Run([&] { ++executed; });
+			}
+			scheduler.ParallelFor(100, [&](u32) { ++executed; }, TaskPriority_Normal, token);
+
+			Assert::AreEqual(0u, executed.load());
+		}
+
+		TEST_METHOD(VerifyHighPriorityRunsFirst)
+		{
+			// Single thread, otherwise both tasks may start at the same time
+			TaskScheduler scheduler(1);
+
+			// Occupy the thread so both tasks are queued before any of them can start
+			std::atomic_bool release = false;
+			std::atomic_bool started = false;
+			TaskGroup blocker(&scheduler);
+			blocker.Run([&]
+				{
+					started = true;
+					while (!release) std::this_thread::yield();
+				});
+			while (!started) std::this_thread::yield();
+
+			std::atomic_uint order = 0;
+			std::atomic_uint lowOrder = 0;
+			std::atomic_uint highOrder = 0;
+			scheduler.Submit([&] { lowOrder = order++; }, TaskPriority_Low);
+			scheduler.Submit([&] { highOrder = order++; }, TaskPriority_High);
+
+			release = true;
+			blocker.Wait();
+			while (order < 2) std::this_thread::yield();
+
+			Assert::AreEqual(0u, highOrder.load());
+			Assert::AreEqual(1u, lowOrder.load());
+		}
+	};
+}
+
+#endif
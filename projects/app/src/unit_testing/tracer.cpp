@@ -0,0 +1,123 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/system/trace.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace rageam;
+
+namespace unit_testing
+{
+	TEST_CLASS(TracerTests)
+	{
+	public:
+		TEST_METHOD(VerifyEventsAreRecordedOnlyWhileCapturing)
+		{
+			Tracer::AddInstant("Before");
+			Assert::IsNull(Tracer::CopyString("Before"));
+
+			Tracer::BeginCapture();
+			u64 start = Tracer::GetTimestamp();
+			Tracer::AddScope("Scope", Tracer::CopyString(L"Detail"), start, Tracer::GetTimestamp());
+			Tracer::AddCounter("Counter", 1.0);
+			Tracer::AddInstant("Instant");
+			Tracer::EndCapture();
+
+			Tracer::AddInstant("After");
+			Assert::AreEqual(3u, Tracer::GetEventCount());
+		}
+
+		TEST_METHOD(VerifyNextCaptureReleasesPreviousEvents)
+		{
+			Tracer::BeginCapture();
+			Tracer::AddInstant("Instant");
+			Tracer::EndCapture();
+			Assert::AreEqual(1u, Tracer::GetEventCount());
+
+			Tracer::BeginCapture();
+			Tracer::EndCapture();
+			Assert::AreEqual(0u, Tracer::GetEventCount());
+		}
+
+		TEST_METHOD(VerifyEveryThreadEventIsRecorded)
+		{
+			// More than one event chunk per thread
+			static constexpr u32 THREAD_COUNT = 4;
+			static constexpr u32 EVENT_COUNT = 10000;
+
+			Tracer::BeginCapture();
+			std::thread threads[THREAD_COUNT];
+			for (std::thread& thread : threads)
+			{
+				thread = std::thread([]
+					{
+						Tracer::SetThreadName("Tracer Test");
+						for (u32 i = 0; i < EVENT_COUNT; i++)
+						{
+							TraceScope scope("Scope");
+						}
+					});
+			}
+			for (std::thread& thread : threads)
+				thread.join();
+			Tracer::EndCapture();
+
+			Assert::AreEqual(THREAD_COUNT * EVENT_COUNT, Tracer::GetEventCount());
+			Assert::AreEqual(0ull, Tracer::GetDroppedCount());
+		}
+
+		// Detail of such scope is stored in buffer of the first capture, scope must not get into the second one
+		TEST_METHOD(VerifyScopeOpenAcrossRestartIsDropped)
+		{
+			Tracer::BeginCapture();
+			{
+				TraceScope scope("Scope", "Detail");
+				Tracer::EndCapture();
+				Tracer::BeginCapture();
+			}
+			Tracer::AddInstant("Instant");
+			Tracer::EndCapture();
+
+			Assert::AreEqual(1u, Tracer::GetEventCount());
+		}
+
+		TEST_METHOD(VerifyCaptureCanBeRestartedWhileThreadsWrite)
+		{
+			static constexpr u32 THREAD_COUNT = 4;
+			static constexpr u32 RESTART_COUNT = 100;
+
+			std::atomic_bool stop = false;
+			std::thread threads[THREAD_COUNT];
+			for (std::thread& thread : threads)
+			{
+				thread = std::thread([&]
+					{
+						while (!stop)
+						{
+							TraceScope scope("Scope", "Detail");
+							Tracer::AddCounter("Counter", 1.0);
+						}
+					});
+			}
+			for (u32 i = 0; i < RESTART_COUNT; i++)
+			{
+				Tracer::BeginCapture();
+				Tracer::EndCapture();
+			}
+			stop = true;
+			for (std::thread& thread : threads)
+				thread.join();
+
+			// Events of previous captures are not counted
+			Tracer::BeginCapture();
+			Tracer::AddInstant("Instant");
+			Tracer::EndCapture();
+			Assert::AreEqual(1u, Tracer::GetEventCount());
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,138 @@
+#ifdef AM_UNIT_TESTS
+
+#include "CppUnitTest.h"
+#include "am/types.h"
+#include "rage/zlib/parallel.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+using namespace rageam;
+
+namespace unit_testing
+{
+	TEST_CLASS(zLibParallelTests)
+	{
+		// Random runs mixed with repeats of earlier data, so blocks have back references into previous block
+		static List<char> CreateData(u32 size)
+		{
+			List<char> data;
+			data.Resize(size);
+			u32 state = 0x12345678;
+			auto next = [&] { state = state * 1664525u + 1013904223u; return state >> 8; };
+
+			u32 offset = 0;
+			while (offset < size)
+			{
+				u32 runSize = next() % 512 + 16;
+				runSize = MIN(runSize, size - offset);
+				if (offset > 1024 && next() % 2)
+				{
+					u32 maxDistance = MIN(offset, ZLIB_DICTIONARY_SIZE);
+					u32 distance = next() % maxDistance + 1;
+					for (u32 i = 0; i < runSize; i++, offset++)
+						data[offset] = data[offset - distance];
+				}
+				else
+				{
+					for (u32 i = 0; i < runSize; i++, offset++)
+						data[offset] = static_cast<char>(next());
+				}
+			}
+			return data;
+		}
+
+		static List<char> Compress(const List<char>& data, int level)
+		{
+			List<char> compressed;
+			zLibParallelCompressor compressor(level);
+			bool success = compressor.Compress((pVoid)data.GetItems(), data.GetSize(), [&](pVoid buffer, u32 size)
+				{
+					u32 offset = compressed.GetSize();
+					compressed.Resize(offset + size);
+					memcpy(compressed.GetItems() + offset, buffer, size);
+					return true;
+				});
+			Assert::IsTrue(success);
+			return compressed;
+		}
+
+		// Inflates with plain zlib stream, output buffer has extra space to detect trailing garbage
+		static List<char> Decompress(List<char>& compressed, u32 expectedSize)
+		{
+			List<char> data;
+			data.Resize(expectedSize + 1);
+
+			zStream_t stream = {};
+			Assert::AreEqual(Z_OK, Z_INFLATE_INIT2(&stream, ZLIB_WINDOW_BITS));
+			stream.next_in = (zBuffer_t)compressed.GetItems();
+			stream.avail_in = compressed.GetSize();
+			stream.next_out = (zBuffer_t)data.GetItems();
+			stream.avail_out = data.GetSize();
+			int status = Z_INFLATE(&stream, Z_SYNC_FLUSH);
+			u32 decompressedSize = data.GetSize() - stream.avail_out;
+			u32 leftSize = stream.avail_in;
+			Z_INFLATE_END(&stream);
+
+			// Blocks end with sync flush, stream is never finished
+			Assert::IsTrue(status == Z_OK || status == Z_BUF_ERROR);
+			Assert::AreEqual(0u, leftSize);
+			Assert::AreEqual(expectedSize, decompressedSize);
+			data.Resize(decompressedSize);
+			return data;
+		}
+
+		static void VerifyRoundTrip(u32 size, int level)
+		{
+			List<char> data = CreateData(size);
+			List<char> compressed = Compress(data, level);
+			List<char> decompressed = Decompress(compressed, size);
+			Assert::AreEqual(0, memcmp(data.GetItems(), decompressed.GetItems(), size));
+		}
+
+	public:
+		TEST_METHOD(VerifyInputSmallerThanBlockRoundTrips)
+		{
+			VerifyRoundTrip(1, ZLIB_COMPRESSION_LEVEL);
+			VerifyRoundTrip(100, ZLIB_COMPRESSION_LEVEL);
+			VerifyRoundTrip(ZLIB_PARALLEL_BLOCK_SIZE / 2 + 7, ZLIB_COMPRESSION_LEVEL);
+		}
+
+		TEST_METHOD(VerifyInputAcrossBlocksRoundTrips)
+		{
+			VerifyRoundTrip(ZLIB_PARALLEL_BLOCK_SIZE, ZLIB_COMPRESSION_LEVEL);
+			VerifyRoundTrip(ZLIB_PARALLEL_BLOCK_SIZE + 1, ZLIB_COMPRESSION_LEVEL);
+			VerifyRoundTrip(ZLIB_PARALLEL_BLOCK_SIZE * 3 + ZLIB_DICTIONARY_SIZE / 2, ZLIB_COMPRESSION_LEVEL);
+		}
+
+		TEST_METHOD(VerifyEveryLevelRoundTrips)
+		{
+			for (int level : { 1, 3, 9 })
+				VerifyRoundTrip(ZLIB_PARALLEL_BLOCK_SIZE * 2 + 12345, level);
+		}
+
+		// Back references across blocks work only if every block is primed with the end of previous one
+		TEST_METHOD(VerifyRepeatedBlockIsCompressedAsReference)
+		{
+			// Deflate can't reach back the whole window, keep repeat distance well under it
+			constexpr u32 repeatSize = ZLIB_DICTIONARY_SIZE / 2;
+			List<char> block = CreateData(repeatSize);
+			List<char> data;
+			data.Resize(ZLIB_PARALLEL_BLOCK_SIZE + ZLIB_DICTIONARY_SIZE);
+			for (u32 i = 0; i < data.GetSize(); i++)
+				data[i] = block[i % repeatSize];
+
+			List<char> compressed = Compress(data, ZLIB_COMPRESSION_LEVEL);
+			List<char> decompressed = Decompress(compressed, data.GetSize());
+			Assert::AreEqual(0, memcmp(data.GetItems(), decompressed.GetItems(), data.GetSize()));
+
+#ifndef AM_MINIZ // Blocks are not primed
+			// Second block is only references to the first one, without priming it would cost as much as compressing the repeat again
+			List<char> firstBlock = data;
+			firstBlock.Resize(ZLIB_PARALLEL_BLOCK_SIZE);
+			u32 secondBlockSize = compressed.GetSize() - Compress(firstBlock, ZLIB_COMPRESSION_LEVEL).GetSize();
+			Assert::IsTrue(secondBlockSize < Compress(block, ZLIB_COMPRESSION_LEVEL).GetSize() / 4);
+#endif
+		}
+	};
+}
+
+#endif